@@ -30,6 +30,7 @@
 #include <glib-object.h>
 #include <math.h>
 #include <stdlib.h>
+#include <string.h>
 
 gboolean
 eel_g_strv_equal (char **a,
@@ -146,6 +147,161 @@ eel_g_hash_table_safe_for_each (GHashTable *hash_table,
     g_list_free (flattened.values);
 }
 
+/* Runs shorter than this aren't worth a thread of their own. */
+#define PARALLEL_SORT_MIN_RUN 4096
+#define PARALLEL_SORT_MAX_THREADS 8
+
+typedef struct
+{
+    gpointer *items;
+    guint n_items;
+    GCompareDataFunc compare_func;
+    gpointer user_data;
+} SortRun;
+
+static gint
+compare_pointed_items (gconstpointer a,
+                       gconstpointer b,
+                       gpointer      callback_data)
+{
+    SortRun *run;
+
+    run = callback_data;
+    return (*run->compare_func)(*(gpointer *) a, *(gpointer *) b, run->user_data);
+}
+
+static gpointer
+sort_run (gpointer data)
+{
+    SortRun *run;
+
+    run = data;
+    g_qsort_with_data (run->items, run->n_items, sizeof (gpointer),
+                       compare_pointed_items, run);
+
+    return NULL;
+}
+
+/* Merges the sorted runs items[0, n_1) and items[n_1, n_1 + n_2).
+ * Ties keep the item of the first run first.
+ */
+static void
+merge_runs (gpointer         *items,
+            guint             n_1,
+            guint             n_2,
+            gpointer         *buffer,
+            GCompareDataFunc  compare_func,
+            gpointer          user_data)
+{
+    guint i, j, k;
+
+    memcpy (buffer, items, n_1 * sizeof (gpointer));
+
+    i = 0;
+    j = n_1;
+    k = 0;
+    while (i < n_1 && j < n_1 + n_2)
+    {
+        if ((*compare_func)(items[j], buffer[i], user_data) < 0)
+        {
+            items[k++] = items[j++];
+        }
+        else
+        {
+            items[k++] = buffer[i++];
+        }
+    }
+    while (i < n_1)
+    {
+        items[k++] = buffer[i++];
+    }
+}
+
+/**
+ * eel_sort_pointers_parallel:
+ *
+ * Stable sort of an array of pointers, with large arrays cut in runs
+ * that are sorted by worker threads and then merged. Returns when the
+ * array is sorted, so @compare_func may only read data that nothing
+ * else changes meanwhile; it is called from several threads at once.
+ */
+void
+eel_sort_pointers_parallel (gpointer         *items,
+                            guint             n_items,
+                            GCompareDataFunc  compare_func,
+                            gpointer          user_data)
+{
+    SortRun *runs;
+    GThread **threads;
+    gpointer *buffer;
+    guint *bounds;
+    guint n_runs, i, j;
+
+    n_runs = MIN (n_items / PARALLEL_SORT_MIN_RUN,
+                  MIN ((guint) g_get_num_processors (), PARALLEL_SORT_MAX_THREADS));
+    n_runs = MAX (n_runs, 1);
+
+    runs = g_new (SortRun, n_runs);
+    bounds = g_new (guint, n_runs + 1);
+    for (i = 0; i <= n_runs; i++)
+    {
+        bounds[i] = (guint64) n_items * i / n_runs;
+    }
+    for (i = 0; i < n_runs; i++)
+    {
+        runs[i].items = items + bounds[i];
+        runs[i].n_items = bounds[i + 1] - bounds[i];
+        runs[i].compare_func = compare_func;
+        runs[i].user_data = user_data;
+    }
+
+    /* The calling thread takes the first run itself */
+    threads = g_new0 (GThread *, n_runs);
+    for (i = 1; i < n_runs; i++)
+    {
+        threads[i] = g_thread_try_new ("eel-sort", sort_run, &runs[i], NULL);
+    }
+    sort_run (&runs[0]);
+    for (i = 1; i < n_runs; i++)
+    {
+        if (threads[i] != NULL)
+        {
+            g_thread_join (threads[i]);
+        }
+        else
+        {
+            sort_run (&runs[i]);
+        }
+    }
+
+    /* Merge neighbouring runs until one is left */
+    if (n_runs > 1)
+    {
+        buffer = g_new (gpointer, n_items);
+        while (n_runs > 1)
+        {
+            for (i = 0, j = 0; i < n_runs; i += 2, j++)
+            {
+                if (i + 1 < n_runs)
+                {
+                    merge_runs (items + bounds[i],
+                                bounds[i + 1] - bounds[i],
+                                bounds[i + 2] - bounds[i + 1],
+                                buffer, compare_func, user_data);
+                }
+                bounds[j] = bounds[i];
+            }
+            bounds[j] = n_items;
+            n_runs = j;
+        }
+        g_free (buffer);
+    }
+
+    g_free (threads);
+    g_free (bounds);
+    g_free (runs);
+}
+
 #if !defined (EEL_OMIT_SELF_CHECK)
 
 #endif /* !EEL_OMIT_SELF_CHECK */
@@ -43,6 +43,12 @@ void        eel_g_hash_table_safe_for_each              (GHashTable            *
 							 GHFunc                 callback,
 							 gpointer               callback_data);
 
+/* Pointer arrays */
+void        eel_sort_pointers_parallel                  (gpointer              *items,
+							 guint                  n_items,
+							 GCompareDataFunc       compare_func,
+							 gpointer               user_data);
+
 /* NULL terminated string arrays (strv). */
 gboolean    eel_g_strv_equal                            (char                 **a,
 							 char                 **b);
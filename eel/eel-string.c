@@ -826,8 +826,33 @@ eel_strdup_printf_with_custom (EelPrintfHandler *handlers,
 
 /*********** refcounted strings ****************/
 
-G_LOCK_DEFINE_STATIC (unique_ref_strs);
-static GHashTable *unique_ref_strs = NULL;
+/* Unique strings are spread over several tables, each with its own
+ * lock, so threads interning different strings rarely wait for each
+ * other.
+ */
+#define UNIQUE_REF_STR_SHARDS 16
+
+/* Each thread remembers the unique strings it got last, holding a
+ * reference to them, and finds them again without taking any lock.
+ */
+#define UNIQUE_REF_STR_CACHE_SIZE 64
+
+typedef struct
+{
+    GMutex mutex;
+    GHashTable *table;
+} UniqueRefStrShard;
+
+typedef struct
+{
+    eel_ref_str strs[UNIQUE_REF_STR_CACHE_SIZE];
+} UniqueRefStrCache;
+
+static UniqueRefStrShard unique_ref_strs[UNIQUE_REF_STR_SHARDS];
+
+static void unique_ref_str_cache_free (UniqueRefStrCache *cache);
+
+static GPrivate unique_ref_str_cache = G_PRIVATE_INIT ((GDestroyNotify) unique_ref_str_cache_free);
 
 static eel_ref_str
 eel_ref_str_new_internal (const char *string,
@@ -857,24 +882,64 @@ eel_ref_str_new (const char *string)
     return eel_ref_str_new_internal (string, 1);
 }
 
+static UniqueRefStrShard *
+unique_ref_str_get_shard (guint hash)
+{
+    return &unique_ref_strs[hash % UNIQUE_REF_STR_SHARDS];
+}
+
+static void
+unique_ref_str_cache_free (UniqueRefStrCache *cache)
+{
+    int i;
+
+    for (i = 0; i < UNIQUE_REF_STR_CACHE_SIZE; i++)
+    {
+        eel_ref_str_unref (cache->strs[i]);
+    }
+    g_free (cache);
+}
+
 eel_ref_str
 eel_ref_str_get_unique (const char *string)
 {
-    eel_ref_str res;
+    eel_ref_str res, replaced;
+    UniqueRefStrShard *shard;
+    UniqueRefStrCache *cache;
+    guint hash, slot;
 
     if (string == NULL)
     {
         return NULL;
     }
 
-    G_LOCK (unique_ref_strs);
-    if (unique_ref_strs == NULL)
+    hash = g_str_hash (string);
+    slot = (hash / UNIQUE_REF_STR_SHARDS) % UNIQUE_REF_STR_CACHE_SIZE;
+
+    cache = g_private_get (&unique_ref_str_cache);
+    if (cache == NULL)
     {
-        unique_ref_strs =
+        cache = g_new0 (UniqueRefStrCache, 1);
+        g_private_set (&unique_ref_str_cache, cache);
+    }
+
+    /* The cache holds a reference, so the string can't go away. */
+    res = cache->strs[slot];
+    if (res != NULL && strcmp (res, string) == 0)
+    {
+        return eel_ref_str_ref (res);
+    }
+
+    shard = unique_ref_str_get_shard (hash);
+
+    g_mutex_lock (&shard->mutex);
+    if (shard->table == NULL)
+    {
+        shard->table =
             g_hash_table_new (g_str_hash, g_str_equal);
     }
 
-    res = g_hash_table_lookup (unique_ref_strs, string);
+    res = g_hash_table_lookup (shard->table, string);
     if (res != NULL)
     {
         eel_ref_str_ref (res);
@@ -882,10 +947,17 @@ eel_ref_str_get_unique (const char *string)
     else
     {
         res = eel_ref_str_new_internal (string, 0x80000001);
-        g_hash_table_insert (unique_ref_strs, res, res);
+        g_hash_table_insert (shard->table, res, res);
     }
 
-    G_UNLOCK (unique_ref_strs);
+    g_mutex_unlock (&shard->mutex);
+
+    /* Dropping the string this replaces may need a shard lock, so it
+     * can only be done now.
+     */
+    replaced = cache->strs[slot];
+    cache->strs[slot] = eel_ref_str_ref (res);
+    eel_ref_str_unref (replaced);
 
     return res;
 }
@@ -904,6 +976,7 @@ eel_ref_str_ref (eel_ref_str str)
 void
 eel_ref_str_unref (eel_ref_str str)
 {
+    UniqueRefStrShard *shard;
     volatile gint *count;
     gint old_ref;
 
@@ -922,14 +995,16 @@ retry_atomic_decrement:
     }
     else if (old_ref == 0x80000001)
     {
-        G_LOCK (unique_ref_strs);
+        shard = unique_ref_str_get_shard (g_str_hash (str));
+
+        g_mutex_lock (&shard->mutex);
         /* Need to recheck after taking lock to avoid races with _get_unique() */
         if (g_atomic_int_add (count, -1) == 0x80000001)
         {
-            g_hash_table_remove (unique_ref_strs, (char *) str);
+            g_hash_table_remove (shard->table, (char *) str);
             g_free ((char *) count);
         }
-        G_UNLOCK (unique_ref_strs);
+        g_mutex_unlock (&shard->mutex);
     }
     else if (!g_atomic_int_compare_and_exchange (count,
                                                  old_ref, old_ref - 1))
@@ -37,6 +37,7 @@
 #include <eel/eel-vfs-extensions.h>
 #include <eel/eel-gtk-extensions.h>
 #include <eel/eel-art-extensions.h>
+#include <eel/eel-glib-extensions.h>
 
 #include <gdk/gdkkeysyms.h>
 #include <gtk/gtk.h>
@@ -123,6 +124,19 @@
 /* Copied from NautilusFile */
 #define UNDEFINED_TIME ((time_t) (-1))
 
+/* Containers with at least this many icons sort them with several
+ * threads, if the class can make its comparisons read-only.
+ */
+#define PARALLEL_SORT_THRESHOLD 10000
+
+/* Size of the cells of the spatial index, in world coordinates. */
+#define SPATIAL_INDEX_CELL_SIZE 256
+
+/* In views laid out automatically, icons get their real image only
+ * within this many viewports before or after the visible one.
+ */
+#define REALIZED_VIEWPORT_MARGIN 1
+
 enum
 {
     ACTION_ACTIVATE,
@@ -235,6 +249,7 @@ enum
     SELECTION_CHANGED,
     ICON_ADDED,
     ICON_REMOVED,
+    ICON_HOVERED,
     CLEARED,
     LAST_SIGNAL
 };
@@ -257,15 +272,297 @@ icon_free (NautilusCanvasIcon *icon)
 {
     /* Destroy this icon item; the parent will unref it. */
     eel_canvas_item_destroy (EEL_CANVAS_ITEM (icon->item));
+    g_free (icon->uri);
     g_free (icon);
 }
 
+static void
+icon_uri_set_remove (NautilusCanvasContainer *container,
+                     NautilusCanvasIcon      *icon)
+{
+    if (icon->uri == NULL)
+    {
+        return;
+    }
+
+    if (g_hash_table_lookup (container->details->icon_uri_set, icon->uri) == icon)
+    {
+        g_hash_table_remove (container->details->icon_uri_set, icon->uri);
+    }
+    g_free (icon->uri);
+    icon->uri = NULL;
+}
+
+/* Files the icon under its current URI, which changes on renames. */
+static void
+icon_uri_set_update (NautilusCanvasContainer *container,
+                     NautilusCanvasIcon      *icon)
+{
+    char *uri;
+
+    uri = nautilus_canvas_container_get_icon_uri (container, icon);
+    if (g_strcmp0 (uri, icon->uri) == 0)
+    {
+        g_free (uri);
+        return;
+    }
+
+    icon_uri_set_remove (container, icon);
+
+    /* The icon owns the key. */
+    icon->uri = uri;
+    if (uri != NULL)
+    {
+        g_hash_table_insert (container->details->icon_uri_set, uri, icon);
+    }
+}
+
 static gboolean
 icon_is_positioned (const NautilusCanvasIcon *icon)
 {
     return icon->x != ICON_UNPOSITIONED_VALUE && icon->y != ICON_UNPOSITIONED_VALUE;
 }
 
+/* Spatial index.
+ *
+ * Positioned icons are filed under the cell of the grid their position
+ * falls into, so the icons near an area can be found without going
+ * through all of them. Icons extend from their position by at most the
+ * recorded reach, which is what lets a query know which cells to look in.
+ */
+
+static int
+spatial_index_get_cell (double coordinate)
+{
+    coordinate = floor (coordinate / SPATIAL_INDEX_CELL_SIZE);
+
+    return CLAMP (coordinate, G_MININT / 2, G_MAXINT / 2);
+}
+
+static gpointer
+spatial_index_get_key (int cell_x,
+                       int cell_y)
+{
+    /* Cells far enough apart share a key; lookups check the cell of
+     * each icon to tell them apart.
+     */
+    return GUINT_TO_POINTER (((guint) cell_x & 0xffff) << 16 | ((guint) cell_y & 0xffff));
+}
+
+static void
+spatial_index_reset (NautilusCanvasContainer *container)
+{
+    NautilusCanvasContainerDetails *details;
+
+    details = container->details;
+
+    g_hash_table_remove_all (details->spatial_index);
+    details->cell_min_x = G_MAXINT;
+    details->cell_min_y = G_MAXINT;
+    details->cell_max_x = G_MININT;
+    details->cell_max_y = G_MININT;
+    details->reach_left = 0;
+    details->reach_right = 0;
+    details->reach_above = 0;
+    details->reach_below = 0;
+}
+
+static void
+spatial_index_remove (NautilusCanvasContainer *container,
+                      NautilusCanvasIcon      *icon)
+{
+    GQueue *cell;
+    gpointer key;
+
+    if (!icon->is_indexed)
+    {
+        return;
+    }
+
+    key = spatial_index_get_key (icon->cell_x, icon->cell_y);
+    cell = g_hash_table_lookup (container->details->spatial_index, key);
+    g_queue_remove (cell, icon);
+    if (g_queue_is_empty (cell))
+    {
+        g_hash_table_remove (container->details->spatial_index, key);
+    }
+
+    icon->is_indexed = FALSE;
+}
+
+/* Grows the reach to cover the icon. Both the displayed bounds and the
+ * ones of the entire item count, as the label of a selected icon is
+ * shown in full.
+ */
+static void
+spatial_index_update_reach (NautilusCanvasContainer *container,
+                            NautilusCanvasIcon      *icon)
+{
+    NautilusCanvasContainerDetails *details;
+    int x1, y1, x2, y2;
+
+    if (!icon->is_indexed)
+    {
+        return;
+    }
+
+    details = container->details;
+
+    icon_get_bounding_box (icon, &x1, &y1, &x2, &y2,
+                           BOUNDS_USAGE_FOR_DISPLAY);
+    details->reach_left = MAX (details->reach_left, icon->x - x1);
+    details->reach_right = MAX (details->reach_right, x2 - icon->x);
+    details->reach_above = MAX (details->reach_above, icon->y - y1);
+    details->reach_below = MAX (details->reach_below, y2 - icon->y);
+
+    icon_get_bounding_box (icon, &x1, &y1, &x2, &y2,
+                           BOUNDS_USAGE_FOR_ENTIRE_ITEM);
+    details->reach_left = MAX (details->reach_left, icon->x - x1);
+    details->reach_right = MAX (details->reach_right, x2 - icon->x);
+    details->reach_above = MAX (details->reach_above, icon->y - y1);
+    details->reach_below = MAX (details->reach_below, y2 - icon->y);
+}
+
+static void
+spatial_index_update (NautilusCanvasContainer *container,
+                      NautilusCanvasIcon      *icon)
+{
+    NautilusCanvasContainerDetails *details;
+    GQueue *cell;
+    gpointer key;
+    int cell_x, cell_y;
+
+    if (!icon_is_positioned (icon))
+    {
+        spatial_index_remove (container, icon);
+        return;
+    }
+
+    details = container->details;
+    cell_x = spatial_index_get_cell (icon->x);
+    cell_y = spatial_index_get_cell (icon->y);
+
+    if (!icon->is_indexed ||
+        icon->cell_x != cell_x ||
+        icon->cell_y != cell_y)
+    {
+        spatial_index_remove (container, icon);
+
+        key = spatial_index_get_key (cell_x, cell_y);
+        cell = g_hash_table_lookup (details->spatial_index, key);
+        if (cell == NULL)
+        {
+            cell = g_queue_new ();
+            g_hash_table_insert (details->spatial_index, key, cell);
+        }
+        g_queue_push_tail (cell, icon);
+
+        icon->cell_x = cell_x;
+        icon->cell_y = cell_y;
+        icon->is_indexed = TRUE;
+
+        details->cell_min_x = MIN (details->cell_min_x, cell_x);
+        details->cell_min_y = MIN (details->cell_min_y, cell_y);
+        details->cell_max_x = MAX (details->cell_max_x, cell_x);
+        details->cell_max_y = MAX (details->cell_max_y, cell_y);
+    }
+
+    spatial_index_update_reach (container, icon);
+}
+
+/* Returns the positioned icons whose bounds may intersect the given
+ * area, in world coordinates. Callers still have to test the icons
+ * themselves; pass -G_MAXDOUBLE or G_MAXDOUBLE to leave a side of the
+ * area open. Free the list with g_list_free().
+ */
+GList *
+nautilus_canvas_container_get_icons_in_area (NautilusCanvasContainer *container,
+                                             double                   x0,
+                                             double                   y0,
+                                             double                   x1,
+                                             double                   y1)
+{
+    NautilusCanvasContainerDetails *details;
+    GHashTableIter iter;
+    GQueue *cell;
+    GList *l, *icons;
+    NautilusCanvasIcon *icon;
+    int cell_x0, cell_y0, cell_x1, cell_y1;
+    int cell_x, cell_y;
+
+    details = container->details;
+    icons = NULL;
+
+    if (g_hash_table_size (details->spatial_index) == 0)
+    {
+        return NULL;
+    }
+
+    /* An icon reaches past the cell of its position, so widen the area
+     * by the reach on the opposite side, and by a unit for rounding.
+     */
+    cell_x0 = MAX (details->cell_min_x,
+                   spatial_index_get_cell (x0 - details->reach_right - 1));
+    cell_y0 = MAX (details->cell_min_y,
+                   spatial_index_get_cell (y0 - details->reach_below - 1));
+    cell_x1 = MIN (details->cell_max_x,
+                   spatial_index_get_cell (x1 + details->reach_left + 1));
+    cell_y1 = MIN (details->cell_max_y,
+                   spatial_index_get_cell (y1 + details->reach_above + 1));
+
+    if (cell_x0 > cell_x1 || cell_y0 > cell_y1)
+    {
+        return NULL;
+    }
+
+    if ((gint64) (cell_x1 - cell_x0 + 1) * (cell_y1 - cell_y0 + 1) >
+        g_hash_table_size (details->spatial_index))
+    {
+        /* Most of the cells in range are empty, going through the
+         * used ones is cheaper.
+         */
+        g_hash_table_iter_init (&iter, details->spatial_index);
+        while (g_hash_table_iter_next (&iter, NULL, (gpointer *) &cell))
+        {
+            for (l = cell->head; l != NULL; l = l->next)
+            {
+                icon = l->data;
+                if (icon->cell_x >= cell_x0 && icon->cell_x <= cell_x1 &&
+                    icon->cell_y >= cell_y0 && icon->cell_y <= cell_y1)
+                {
+                    icons = g_list_prepend (icons, icon);
+                }
+            }
+        }
+
+        return icons;
+    }
+
+    for (cell_y = cell_y0; cell_y <= cell_y1; cell_y++)
+    {
+        for (cell_x = cell_x0; cell_x <= cell_x1; cell_x++)
+        {
+            cell = g_hash_table_lookup (details->spatial_index,
+                                        spatial_index_get_key (cell_x, cell_y));
+            if (cell == NULL)
+            {
+                continue;
+            }
+
+            for (l = cell->head; l != NULL; l = l->next)
+            {
+                icon = l->data;
+                if (icon->cell_x == cell_x && icon->cell_y == cell_y)
+                {
+                    icons = g_list_prepend (icons, icon);
+                }
+            }
+        }
+    }
+
+    return icons;
+}
+
 
 /* x, y are the top-left coordinates of the icon. */
 static void
@@ -283,13 +580,18 @@ icon_set_position (NautilusCanvasIcon *icon,
     int height_above, width_left;
     int min_x, max_x, min_y, max_y;
 
+    container = NAUTILUS_CANVAS_CONTAINER (EEL_CANVAS_ITEM (icon->item)->canvas);
+
     if (icon->x == x && icon->y == y)
     {
+        /* The position may have been set without going through here. */
+        if (!icon->is_indexed)
+        {
+            spatial_index_update (container, icon);
+        }
         return;
     }
 
-    container = NAUTILUS_CANVAS_CONTAINER (EEL_CANVAS_ITEM (icon->item)->canvas);
-
     if (nautilus_canvas_container_get_is_fixed_size (container))
     {
         /*  FIXME: This should be:
@@ -355,6 +657,8 @@ icon_set_position (NautilusCanvasIcon *icon,
 
     icon->x = x;
     icon->y = y;
+
+    spatial_index_update (container, icon);
 }
 
 static guint
@@ -1342,16 +1646,54 @@ sort_selection (NautilusCanvasContainer *container)
     container->details->selection_needs_resort = FALSE;
 }
 
+static void
+sort_icons_in_parallel (NautilusCanvasContainer *container,
+                        GList                   *icons,
+                        guint                    length)
+{
+    NautilusCanvasContainerClass *klass;
+    NautilusCanvasIcon **array;
+    GList *l;
+    guint i;
+
+    klass = NAUTILUS_CANVAS_CONTAINER_GET_CLASS (container);
+
+    array = g_new (NautilusCanvasIcon *, length);
+    for (l = icons, i = 0; l != NULL; l = l->next, i++)
+    {
+        array[i] = l->data;
+        klass->prepare_icon_for_sort (container, array[i]->data);
+    }
+
+    eel_sort_pointers_parallel ((gpointer *) array, length, compare_icons, container);
+
+    for (l = icons, i = 0; l != NULL; l = l->next, i++)
+    {
+        l->data = array[i];
+    }
+
+    g_free (array);
+}
+
 static void
 sort_icons (NautilusCanvasContainer  *container,
             GList                   **icons)
 {
     NautilusCanvasContainerClass *klass;
+    guint length;
 
     klass = NAUTILUS_CANVAS_CONTAINER_GET_CLASS (container);
     g_assert (klass->compare_icons != NULL);
 
-    *icons = g_list_sort_with_data (*icons, compare_icons, container);
+    length = klass->prepare_icon_for_sort != NULL ? g_list_length (*icons) : 0;
+    if (length >= PARALLEL_SORT_THRESHOLD)
+    {
+        sort_icons_in_parallel (container, *icons, length);
+    }
+    else
+    {
+        *icons = g_list_sort_with_data (*icons, compare_icons, container);
+    }
 }
 
 static void
@@ -1362,13 +1704,61 @@ resort (NautilusCanvasContainer *container)
     cache_icon_positions (container);
 }
 
-typedef struct
+/* Measures the icon for the automatic layout, unless the measurements
+ * taken for an earlier layout still hold; they don't depend on where
+ * the icon is. Returns whether they changed.
+ */
+static gboolean
+icon_measure_for_layout (NautilusCanvasIcon *icon,
+                         double              grid_width,
+                         int                 icon_size)
 {
-    double width;
-    double height;
-    double x_offset;
-    double y_offset;
-} IconPositions;
+    EelDRect bounds;
+    EelDRect icon_bounds;
+    double width, height_above, height_below;
+    double x_offset, y_offset;
+    gboolean changed;
+
+    if (icon->layout_size_valid)
+    {
+        return FALSE;
+    }
+
+    /* Assume it's only one level hierarchy to avoid costly affine calculations */
+    nautilus_canvas_item_get_bounds_for_layout (icon->item,
+                                                &bounds.x0, &bounds.y0,
+                                                &bounds.x1, &bounds.y1);
+
+    /* Normalize the icon width to the grid unit.
+     * Use the icon size for this zoom level too in the calculation, since
+     * the actual bounds might be smaller - e.g. because we have a very
+     * narrow thumbnail.
+     */
+    width = ceil (MAX ((bounds.x1 - bounds.x0), icon_size) / grid_width) * grid_width;
+
+    /* Calculate size above/below baseline */
+    icon_bounds = nautilus_canvas_item_get_icon_rectangle (icon->item);
+    height_above = icon_bounds.y1 - bounds.y0;
+    height_below = bounds.y1 - icon_bounds.y1;
+
+    x_offset = (width - (icon_bounds.x1 - icon_bounds.x0)) / 2;
+    y_offset = icon_bounds.y0 - icon_bounds.y1;
+
+    changed = width != icon->layout_width ||
+              height_above != icon->layout_height_above ||
+              height_below != icon->layout_height_below ||
+              x_offset != icon->layout_x_offset ||
+              y_offset != icon->layout_y_offset;
+
+    icon->layout_width = width;
+    icon->layout_height_above = height_above;
+    icon->layout_height_below = height_below;
+    icon->layout_x_offset = x_offset;
+    icon->layout_y_offset = y_offset;
+    icon->layout_size_valid = TRUE;
+
+    return changed;
+}
 
 static void
 lay_down_one_line (NautilusCanvasContainer *container,
@@ -1376,37 +1766,30 @@ lay_down_one_line (NautilusCanvasContainer *container,
                    GList                   *line_end,
                    double                   y,
                    double                   max_height,
-                   GArray                  *positions,
                    gboolean                 whole_text)
 {
     GList *p;
     NautilusCanvasIcon *icon;
-    double x, y_offset;
-    IconPositions *position;
-    int i;
+    double x;
     gboolean is_rtl;
 
     is_rtl = nautilus_canvas_container_is_layout_rtl (container);
 
     /* Lay out the icons along the baseline. */
     x = ICON_PAD_LEFT;
-    i = 0;
     for (p = line_start; p != line_end; p = p->next)
     {
         icon = p->data;
 
-        position = &g_array_index (positions, IconPositions, i++);
-        y_offset = position->y_offset;
-
         icon_set_position
             (icon,
-            is_rtl ? get_mirror_x_position (container, icon, x + position->x_offset) : x + position->x_offset,
-            y + y_offset);
+            is_rtl ? get_mirror_x_position (container, icon, x + icon->layout_x_offset) : x + icon->layout_x_offset,
+            y + icon->layout_y_offset);
         nautilus_canvas_item_set_entire_text (icon->item, whole_text);
 
         icon->saved_ltr_x = is_rtl ? get_mirror_x_position (container, icon, icon->x) : icon->x;
 
-        x += position->width;
+        x += icon->layout_width;
     }
 }
 
@@ -1418,16 +1801,10 @@ lay_down_icons_horizontal (NautilusCanvasContainer *container,
     GList *p, *line_start;
     NautilusCanvasIcon *icon;
     double canvas_width, y;
-    GArray *positions;
-    IconPositions *position;
-    EelDRect bounds;
-    EelDRect icon_bounds;
     double max_height_above, max_height_below;
-    double height_above, height_below;
     double line_width;
     double grid_width;
-    int icon_width, icon_size;
-    int i;
+    int icon_size;
     GtkAllocation allocation;
 
     g_assert (NAUTILUS_IS_CANVAS_CONTAINER (container));
@@ -1437,7 +1814,6 @@ lay_down_icons_horizontal (NautilusCanvasContainer *container,
         return;
     }
 
-    positions = g_array_new (FALSE, FALSE, sizeof (IconPositions));
     gtk_widget_get_allocation (GTK_WIDGET (container), &allocation);
 
     /* Lay out icons a line at a time. */
@@ -1449,7 +1825,6 @@ lay_down_icons_horizontal (NautilusCanvasContainer *container,
     line_width = 0;
     line_start = icons;
     y = start_y + CONTAINER_PAD_TOP;
-    i = 0;
 
     max_height_above = 0;
     max_height_below = 0;
@@ -1457,63 +1832,46 @@ lay_down_icons_horizontal (NautilusCanvasContainer *container,
     {
         icon = p->data;
 
-        /* Assume it's only one level hierarchy to avoid costly affine calculations */
-        nautilus_canvas_item_get_bounds_for_layout (icon->item,
-                                                    &bounds.x0, &bounds.y0,
-                                                    &bounds.x1, &bounds.y1);
-
-        /* Normalize the icon width to the grid unit.
-         * Use the icon size for this zoom level too in the calculation, since
-         * the actual bounds might be smaller - e.g. because we have a very
-         * narrow thumbnail.
-         */
-        icon_width = ceil (MAX ((bounds.x1 - bounds.x0), icon_size) / grid_width) * grid_width;
-
-        /* Calculate size above/below baseline */
-        icon_bounds = nautilus_canvas_item_get_icon_rectangle (icon->item);
-        height_above = icon_bounds.y1 - bounds.y0;
-        height_below = bounds.y1 - icon_bounds.y1;
+        icon_measure_for_layout (icon, grid_width, icon_size);
 
         /* If this icon doesn't fit, it's time to lay out the line that's queued up. */
-        if (line_start != p && line_width + icon_width >= canvas_width)
+        if (line_start != p && line_width + icon->layout_width >= canvas_width)
         {
             /* Advance to the baseline. */
             y += ICON_PAD_TOP + max_height_above;
 
-            lay_down_one_line (container, line_start, p, y, max_height_above, positions, FALSE);
+            lay_down_one_line (container, line_start, p, y, max_height_above, FALSE);
 
             /* Advance to next line. */
             y += max_height_below + ICON_PAD_BOTTOM;
 
             line_width = 0;
             line_start = p;
-            i = 0;
 
-            max_height_above = height_above;
-            max_height_below = height_below;
+            max_height_above = icon->layout_height_above;
+            max_height_below = icon->layout_height_below;
         }
         else
         {
-            if (height_above > max_height_above)
+            if (icon->layout_height_above > max_height_above)
             {
-                max_height_above = height_above;
+                max_height_above = icon->layout_height_above;
             }
-            if (height_below > max_height_below)
+            if (icon->layout_height_below > max_height_below)
             {
-                max_height_below = height_below;
+                max_height_below = icon->layout_height_below;
             }
         }
 
-        g_array_set_size (positions, i + 1);
-        position = &g_array_index (positions, IconPositions, i++);
-        position->width = icon_width;
-        position->height = icon_bounds.y1 - icon_bounds.y0;
-
-        position->x_offset = (icon_width - (icon_bounds.x1 - icon_bounds.x0)) / 2;
-        position->y_offset = icon_bounds.y0 - icon_bounds.y1;
+        /* Remember where the lines start, a later layout can resume there. */
+        icon->layout_starts_line = line_start == p;
+        if (icon->layout_starts_line)
+        {
+            icon->layout_line_top = y;
+        }
 
         /* Add this icon. */
-        line_width += icon_width;
+        line_width += icon->layout_width;
     }
 
     /* Lay down that last line of icons. */
@@ -1522,10 +1880,102 @@ lay_down_icons_horizontal (NautilusCanvasContainer *container,
         /* Advance to the baseline. */
         y += ICON_PAD_TOP + max_height_above;
 
-        lay_down_one_line (container, line_start, NULL, y, max_height_above, positions, TRUE);
+        lay_down_one_line (container, line_start, NULL, y, max_height_above, TRUE);
+    }
+}
+
+/* Lays out all the icons of a view in automatic layout. The lines before
+ * the first icon that got a new place in the list or a new size stay as
+ * they are, so only the icons from the line that icon was on are laid out
+ * again. Resizing the view only needs a new layout when it changes how many
+ * grid units fit on a line, right to left positions are mirrored afterwards.
+ */
+static void
+lay_down_icons_incrementally (NautilusCanvasContainer *container)
+{
+    NautilusCanvasContainerDetails *details;
+    GList *p, *start, *last;
+    NautilusCanvasIcon *icon;
+    double grid_width;
+    int icon_size, columns, index;
+    gboolean is_rtl, full;
+    GtkAllocation allocation;
+
+    details = container->details;
+
+    gtk_widget_get_allocation (GTK_WIDGET (container), &allocation);
+
+    grid_width = nautilus_canvas_container_get_grid_size_for_zoom_level (details->zoom_level);
+    icon_size = nautilus_canvas_container_get_icon_size_for_zoom_level (details->zoom_level);
+    columns = ceil (CANVAS_WIDTH (container, allocation) / grid_width);
+    is_rtl = nautilus_canvas_container_is_layout_rtl (container);
+
+    full = details->needs_full_layout ||
+           columns != details->layout_columns ||
+           details->zoom_level != details->layout_zoom_level ||
+           is_rtl != details->layout_is_rtl;
+
+    /* Find the first icon that isn't where and what it was
+     * in the last layout.
+     */
+    start = NULL;
+    last = NULL;
+    for (p = details->icons, index = 0; p != NULL; p = p->next, index++)
+    {
+        icon = p->data;
+
+        if (full)
+        {
+            icon->layout_size_valid = FALSE;
+        }
+
+        if (start == NULL &&
+            (full ||
+             icon->layout_position != index ||
+             !icon_is_positioned (icon) ||
+             icon_measure_for_layout (icon, grid_width, icon_size)))
+        {
+            start = p;
+        }
+
+        icon->layout_position = index;
+        last = p;
+    }
+
+    if (start != NULL)
+    {
+        /* Icons further down may now fit on the line before. */
+        if (start->prev != NULL)
+        {
+            start = start->prev;
+        }
+    }
+    else if (index != details->layout_n_icons)
+    {
+        /* Icons went away from the end, the line that is
+         * last now has to show its entire text.
+         */
+        start = last;
+    }
+
+    if (start != NULL)
+    {
+        while (start->prev != NULL &&
+               !((NautilusCanvasIcon *) start->data)->layout_starts_line)
+        {
+            start = start->prev;
+        }
+
+        icon = start->data;
+        lay_down_icons_horizontal (container, start,
+                                   start == details->icons ? 0 : icon->layout_line_top - CONTAINER_PAD_TOP);
     }
 
-    g_array_free (positions, TRUE);
+    details->layout_n_icons = index;
+    details->layout_columns = columns;
+    details->layout_zoom_level = details->zoom_level;
+    details->layout_is_rtl = is_rtl;
+    details->needs_full_layout = FALSE;
 }
 
 static void
@@ -2147,6 +2597,8 @@ redo_layout_internal (NautilusCanvasContainer *container)
 {
     gboolean layout_possible;
 
+    container->details->needs_relayout = FALSE;
+
     layout_possible = finish_adding_new_icons (container);
     if (!layout_possible)
     {
@@ -2167,7 +2619,15 @@ redo_layout_internal (NautilusCanvasContainer *container)
             resort (container);
             container->details->needs_resort = FALSE;
         }
-        lay_down_icons (container, container->details->icons, 0);
+
+        if (container->details->is_desktop)
+        {
+            lay_down_icons (container, container->details->icons, 0);
+        }
+        else
+        {
+            lay_down_icons_incrementally (container);
+        }
     }
 
     if (nautilus_canvas_container_is_layout_rtl (container))
@@ -2190,7 +2650,13 @@ redo_layout_callback (gpointer callback_data)
     redo_layout_internal (container);
     container->details->idle_id = 0;
 
-    return FALSE;
+    /* Icons brought near the viewport by this layout may need another. */
+    if (container->details->needs_relayout)
+    {
+        schedule_redo_layout (container);
+    }
+
+    return FALSE;
 }
 
 static void
@@ -2290,7 +2756,9 @@ button_event_modifies_selection (GdkEventButton *event)
     return (event->state & (GDK_CONTROL_MASK | GDK_SHIFT_MASK)) != 0;
 }
 
-/* invalidate the cached label sizes for all the icons */
+/* invalidate the cached label sizes for all the icons, and the sizes
+ * the automatic layout measured them at
+ */
 static void
 invalidate_label_sizes (NautilusCanvasContainer *container)
 {
@@ -2302,6 +2770,7 @@ invalidate_label_sizes (NautilusCanvasContainer *container)
         icon = p->data;
 
         nautilus_canvas_item_invalidate_label_size (icon->item);
+        icon->layout_size_valid = FALSE;
     }
 }
 
@@ -2454,12 +2923,17 @@ nautilus_canvas_container_move_icon (NautilusCanvasContainer *container,
      */
 }
 
-/* Implementation of rubberband selection.  */
+/* Implementation of rubberband selection.
+ * Icons outside of both rectangles keep their state, so when the
+ * rectangle of the previous update is given only the icons in either
+ * one are looked at.
+ */
 static void
 rubberband_select (NautilusCanvasContainer *container,
-                   const EelDRect          *current_rect)
+                   const EelDRect          *current_rect,
+                   const EelDRect          *previous_rect)
 {
-    GList *p;
+    GList *p, *candidates;
     gboolean selection_changed, is_in, canvas_rect_calculated;
     NautilusCanvasIcon *icon;
     EelIRect canvas_rect;
@@ -2468,7 +2942,19 @@ rubberband_select (NautilusCanvasContainer *container,
     selection_changed = FALSE;
     canvas_rect_calculated = FALSE;
 
-    for (p = container->details->icons; p != NULL; p = p->next)
+    candidates = NULL;
+    if (previous_rect != NULL)
+    {
+        candidates = nautilus_canvas_container_get_icons_in_area
+                         (container,
+                         MIN (current_rect->x0, previous_rect->x0),
+                         MIN (current_rect->y0, previous_rect->y0),
+                         MAX (current_rect->x1, previous_rect->x1),
+                         MAX (current_rect->y1, previous_rect->y1));
+    }
+
+    for (p = previous_rect != NULL ? candidates : container->details->icons;
+         p != NULL; p = p->next)
     {
         icon = p->data;
 
@@ -2498,6 +2984,8 @@ rubberband_select (NautilusCanvasContainer *container,
                                  is_in ^ icon->was_selected_before_rubberband);
     }
 
+    g_list_free (candidates);
+
     if (selection_changed)
     {
         g_signal_emit (container,
@@ -2638,8 +3126,16 @@ rubberband_timeout_callback (gpointer data)
     selection_rect.x1 = x2;
     selection_rect.y1 = y2;
 
+    if (!band_info->has_prev_rect)
+    {
+        band_info->prev_rect = selection_rect;
+        band_info->has_prev_rect = TRUE;
+    }
+
     rubberband_select (container,
-                       &selection_rect);
+                       &selection_rect,
+                       &band_info->prev_rect);
+    band_info->prev_rect = selection_rect;
 
     band_info->prev_x = x;
     band_info->prev_y = y;
@@ -2774,6 +3270,7 @@ start_rubberbanding (NautilusCanvasContainer *container,
     band_info->prev_x = event->x - gtk_adjustment_get_value (gtk_scrollable_get_hadjustment (GTK_SCROLLABLE (container)));
     band_info->prev_y = event->y - gtk_adjustment_get_value (gtk_scrollable_get_vadjustment (GTK_SCROLLABLE (container)));
 
+    band_info->has_prev_rect = FALSE;
     band_info->active = TRUE;
 
     if (band_info->timer_id == 0)
@@ -2844,16 +3341,17 @@ typedef gboolean (*IsBetterCanvasFunction) (NautilusCanvasContainer *container,
                                             void                    *data);
 
 static NautilusCanvasIcon *
-find_best_icon (NautilusCanvasContainer *container,
-                NautilusCanvasIcon      *start_icon,
-                IsBetterCanvasFunction   function,
-                void                    *data)
+find_best_icon_in_list (NautilusCanvasContainer *container,
+                        GList                   *icons,
+                        NautilusCanvasIcon      *start_icon,
+                        IsBetterCanvasFunction   function,
+                        void                    *data)
 {
     GList *p;
     NautilusCanvasIcon *best, *candidate;
 
     best = NULL;
-    for (p = container->details->icons; p != NULL; p = p->next)
+    for (p = icons; p != NULL; p = p->next)
     {
         candidate = p->data;
 
@@ -2868,6 +3366,16 @@ find_best_icon (NautilusCanvasContainer *container,
     return best;
 }
 
+static NautilusCanvasIcon *
+find_best_icon (NautilusCanvasContainer *container,
+                NautilusCanvasIcon      *start_icon,
+                IsBetterCanvasFunction   function,
+                void                    *data)
+{
+    return find_best_icon_in_list (container, container->details->icons,
+                                   start_icon, function, data);
+}
+
 static NautilusCanvasIcon *
 find_best_selected_icon (NautilusCanvasContainer *container,
                          NautilusCanvasIcon      *start_icon,
@@ -3705,7 +4213,7 @@ keyboard_move_to (NautilusCanvasContainer *container,
         {
             rect = get_rubberband (container->details->keyboard_rubberband_start,
                                    icon);
-            rubberband_select (container, &rect);
+            rubberband_select (container, &rect, NULL);
         }
     }
     else if (event != NULL &&
@@ -3801,6 +4309,48 @@ record_arrow_key_start (NautilusCanvasContainer *container,
     container->details->arrow_key_direction = direction;
 }
 
+/* Like find_best_icon(), but when only icons on the row or column of
+ * the arrow key start qualify, just the icons crossing it are tried.
+ */
+static NautilusCanvasIcon *
+find_best_icon_from_arrow_key_start (NautilusCanvasContainer *container,
+                                     NautilusCanvasIcon      *start_icon,
+                                     IsBetterCanvasFunction   function,
+                                     void                    *data)
+{
+    NautilusCanvasIcon *best;
+    GList *candidates;
+    double x, y;
+
+    eel_canvas_c2w (EEL_CANVAS (container),
+                    container->details->arrow_key_start_x,
+                    container->details->arrow_key_start_y,
+                    &x, &y);
+
+    if (function == same_row_right_side_leftmost ||
+        function == same_row_left_side_rightmost)
+    {
+        candidates = nautilus_canvas_container_get_icons_in_area
+                         (container, -G_MAXDOUBLE, y, G_MAXDOUBLE, y);
+    }
+    else if (function == same_column_above_lowest ||
+             function == same_column_below_highest)
+    {
+        candidates = nautilus_canvas_container_get_icons_in_area
+                         (container, x, -G_MAXDOUBLE, x, G_MAXDOUBLE);
+    }
+    else
+    {
+        return find_best_icon (container, start_icon, function, data);
+    }
+
+    best = find_best_icon_in_list (container, candidates,
+                                   start_icon, function, data);
+    g_list_free (candidates);
+
+    return best;
+}
+
 static void
 keyboard_arrow_key (NautilusCanvasContainer *container,
                     GdkEventKey             *event,
@@ -3860,7 +4410,7 @@ keyboard_arrow_key (NautilusCanvasContainer *container,
     {
         record_arrow_key_start (container, from, direction);
 
-        to = find_best_icon
+        to = find_best_icon_from_arrow_key_start
                  (container, from,
                  container->details->auto_layout ? better_destination : better_destination_manual,
                  &data);
@@ -4197,6 +4747,17 @@ finalize (GObject *object)
 
     g_hash_table_destroy (details->icon_set);
     details->icon_set = NULL;
+    g_hash_table_destroy (details->icon_uri_set);
+    details->icon_uri_set = NULL;
+    g_hash_table_destroy (details->spatial_index);
+    details->spatial_index = NULL;
+    g_list_free (details->visible_icons);
+    details->visible_icons = NULL;
+    g_list_free (details->realized_icons);
+    details->realized_icons = NULL;
+    g_hash_table_destroy (details->placeholder_images);
+    details->placeholder_images = NULL;
+    g_clear_object (&details->placeholder_pixels);
 
     g_free (details->font);
 
@@ -5665,6 +6226,15 @@ nautilus_canvas_container_class_init (NautilusCanvasContainerClass *class)
                         NULL, NULL,
                         g_cclosure_marshal_VOID__POINTER,
                         G_TYPE_NONE, 1, G_TYPE_POINTER);
+    signals[ICON_HOVERED]
+        = g_signal_new ("icon-hovered",
+                        G_TYPE_FROM_CLASS (class),
+                        G_SIGNAL_RUN_LAST,
+                        G_STRUCT_OFFSET (NautilusCanvasContainerClass,
+                                         icon_hovered),
+                        NULL, NULL,
+                        g_cclosure_marshal_VOID__POINTER,
+                        G_TYPE_NONE, 1, G_TYPE_POINTER);
 
     signals[CLEARED]
         = g_signal_new ("cleared",
@@ -5842,10 +6412,17 @@ nautilus_canvas_container_init (NautilusCanvasContainer *container)
     details = g_new0 (NautilusCanvasContainerDetails, 1);
 
     details->icon_set = g_hash_table_new (g_direct_hash, g_direct_equal);
+    details->icon_uri_set = g_hash_table_new (g_str_hash, g_str_equal);
+    details->placeholder_images = g_hash_table_new_full (g_direct_hash, g_direct_equal,
+                                                         NULL, g_object_unref);
+    details->spatial_index = g_hash_table_new_full (g_direct_hash, g_direct_equal,
+                                                    NULL, (GDestroyNotify) g_queue_free);
     details->layout_timestamp = UNDEFINED_TIME;
     details->zoom_level = NAUTILUS_CANVAS_ZOOM_LEVEL_STANDARD;
+    details->needs_full_layout = TRUE;
 
     container->details = details;
+    spatial_index_reset (container);
 
     g_signal_connect (container, "focus-in-event",
                       G_CALLBACK (handle_focus_in_event), NULL);
@@ -6055,6 +6632,14 @@ item_event_callback (EelCanvasItem *item,
             return FALSE;
         }
 
+        case GDK_ENTER_NOTIFY:
+        case GDK_LEAVE_NOTIFY:
+        {
+            g_signal_emit (container, signals[ICON_HOVERED], 0,
+                           event->type == GDK_ENTER_NOTIFY ? icon->data : NULL);
+            return FALSE;
+        }
+
         case GDK_BUTTON_PRESS:
         {
             container->details->double_clicked = FALSE;
@@ -6113,6 +6698,7 @@ nautilus_canvas_container_clear (NautilusCanvasContainer *container)
     details = container->details;
     details->layout_timestamp = UNDEFINED_TIME;
     details->store_layout_timestamps_when_finishing_new_icons = FALSE;
+    details->needs_full_layout = TRUE;
 
     if (details->icons == NULL)
     {
@@ -6126,6 +6712,7 @@ nautilus_canvas_container_clear (NautilusCanvasContainer *container)
     details->stretch_icon = NULL;
     details->drop_target = NULL;
 
+    g_hash_table_remove_all (details->icon_uri_set);
     for (p = details->icons; p != NULL; p = p->next)
     {
         icon_free (p->data);
@@ -6136,9 +6723,14 @@ nautilus_canvas_container_clear (NautilusCanvasContainer *container)
     details->new_icons = NULL;
     g_list_free (details->selection);
     details->selection = NULL;
+    g_list_free (details->visible_icons);
+    details->visible_icons = NULL;
+    g_list_free (details->realized_icons);
+    details->realized_icons = NULL;
 
     g_hash_table_destroy (details->icon_set);
     details->icon_set = g_hash_table_new (g_direct_hash, g_direct_equal);
+    spatial_index_reset (container);
 
     nautilus_canvas_container_update_scroll_region (container);
 }
@@ -6245,7 +6837,6 @@ void
 nautilus_canvas_container_scroll_to_canvas (NautilusCanvasContainer *container,
                                             NautilusCanvasIconData  *data)
 {
-    GList *l;
     NautilusCanvasIcon *icon;
     GtkAdjustment *hadj, *vadj;
     EelIRect bounds;
@@ -6259,42 +6850,34 @@ nautilus_canvas_container_scroll_to_canvas (NautilusCanvasContainer *container,
      * since we need the final positions */
     nautilus_canvas_container_layout_now (container);
 
-    l = container->details->icons;
-    while (l != NULL)
+    icon = g_hash_table_lookup (container->details->icon_set, data);
+    if (icon != NULL && icon_is_positioned (icon))
     {
-        icon = l->data;
-
-        if (icon->data == data &&
-            icon_is_positioned (icon))
+        if (nautilus_canvas_container_is_auto_layout (container))
         {
-            if (nautilus_canvas_container_is_auto_layout (container))
-            {
-                /* ensure that we reveal the entire row/column */
-                icon_get_row_and_column_bounds (container, icon, &bounds);
-            }
-            else
-            {
-                item_get_canvas_bounds (EEL_CANVAS_ITEM (icon->item), &bounds);
-            }
+            /* ensure that we reveal the entire row/column */
+            icon_get_row_and_column_bounds (container, icon, &bounds);
+        }
+        else
+        {
+            item_get_canvas_bounds (EEL_CANVAS_ITEM (icon->item), &bounds);
+        }
 
-            if (nautilus_canvas_container_is_layout_vertical (container))
+        if (nautilus_canvas_container_is_layout_vertical (container))
+        {
+            if (nautilus_canvas_container_is_layout_rtl (container))
             {
-                if (nautilus_canvas_container_is_layout_rtl (container))
-                {
-                    gtk_adjustment_set_value (hadj, bounds.x1 - allocation.width);
-                }
-                else
-                {
-                    gtk_adjustment_set_value (hadj, bounds.x0);
-                }
+                gtk_adjustment_set_value (hadj, bounds.x1 - allocation.width);
             }
             else
             {
-                gtk_adjustment_set_value (vadj, bounds.y0);
+                gtk_adjustment_set_value (hadj, bounds.x0);
             }
         }
-
-        l = l->next;
+        else
+        {
+            gtk_adjustment_set_value (vadj, bounds.y0);
+        }
     }
 }
 
@@ -6367,7 +6950,14 @@ icon_destroy (NautilusCanvasContainer *container,
     details->icons = g_list_remove (details->icons, icon);
     details->new_icons = g_list_remove (details->new_icons, icon);
     details->selection = g_list_remove (details->selection, icon->data);
+    details->visible_icons = g_list_remove (details->visible_icons, icon);
+    if (icon->is_realized)
+    {
+        details->realized_icons = g_list_remove (details->realized_icons, icon);
+    }
     g_hash_table_remove (details->icon_set, icon->data);
+    icon_uri_set_remove (container, icon);
+    spatial_index_remove (container, icon);
 
     was_selected = icon->is_selected;
 
@@ -6526,18 +7116,381 @@ nautilus_canvas_container_prioritize_thumbnailing (NautilusCanvasContainer *cont
     klass->prioritize_thumbnailing (container, icon->data);
 }
 
+/* Virtualized views.
+ *
+ * Looking up the image of an icon and keeping it around is the costly
+ * part of an icon, so in views laid out automatically only the icons
+ * near the viewport get theirs. The others show a blank image of the
+ * same size, shared between icons, which keeps the layout as it is when
+ * an icon moves away from the viewport.
+ */
+
+static gboolean
+is_virtualized (NautilusCanvasContainer *container)
+{
+    return container->details->auto_layout && !container->details->is_desktop;
+}
+
+/* Gets the range along the scrolling axis, in world coordinates, in
+ * which icons get their real image.
+ */
+static void
+get_realized_range (NautilusCanvasContainer *container,
+                    double                  *start,
+                    double                  *end)
+{
+    GtkAdjustment *vadj, *hadj;
+    double min_x, max_x, min_y, max_y;
+    double margin;
+    GtkAllocation allocation;
+
+    hadj = gtk_scrollable_get_hadjustment (GTK_SCROLLABLE (container));
+    vadj = gtk_scrollable_get_vadjustment (GTK_SCROLLABLE (container));
+    if (hadj == NULL || vadj == NULL)
+    {
+        *start = -G_MAXDOUBLE;
+        *end = G_MAXDOUBLE;
+        return;
+    }
+
+    gtk_widget_get_allocation (GTK_WIDGET (container), &allocation);
+
+    min_x = gtk_adjustment_get_value (hadj);
+    max_x = min_x + allocation.width;
+    min_y = gtk_adjustment_get_value (vadj);
+    max_y = min_y + allocation.height;
+
+    eel_canvas_c2w (EEL_CANVAS (container),
+                    min_x, min_y, &min_x, &min_y);
+    eel_canvas_c2w (EEL_CANVAS (container),
+                    max_x, max_y, &max_x, &max_y);
+
+    if (nautilus_canvas_container_is_layout_vertical (container))
+    {
+        margin = (max_x - min_x) * REALIZED_VIEWPORT_MARGIN;
+        *start = min_x - margin;
+        *end = max_x + margin;
+    }
+    else
+    {
+        margin = (max_y - min_y) * REALIZED_VIEWPORT_MARGIN;
+        *start = min_y - margin;
+        *end = max_y + margin;
+    }
+}
+
+/* Whether the icon overlaps the given range of the scrolling axis. */
+static gboolean
+icon_is_in_range (NautilusCanvasContainer *container,
+                  NautilusCanvasIcon      *icon,
+                  double                   start,
+                  double                   end)
+{
+    double x0, y0, x1, y1;
+
+    if (!icon_is_positioned (icon))
+    {
+        return FALSE;
+    }
+
+    eel_canvas_item_get_bounds (EEL_CANVAS_ITEM (icon->item),
+                                &x0,
+                                &y0,
+                                &x1,
+                                &y1);
+    eel_canvas_item_i2w (EEL_CANVAS_ITEM (icon->item)->parent,
+                         &x0,
+                         &y0);
+    eel_canvas_item_i2w (EEL_CANVAS_ITEM (icon->item)->parent,
+                         &x1,
+                         &y1);
+
+    if (nautilus_canvas_container_is_layout_vertical (container))
+    {
+        return x1 >= start && x0 <= end;
+    }
+    else
+    {
+        return y1 >= start && y0 <= end;
+    }
+}
+
+static gboolean
+icon_is_near_viewport (NautilusCanvasContainer *container,
+                       NautilusCanvasIcon      *icon)
+{
+    double start, end;
+
+    get_realized_range (container, &start, &end);
+
+    return icon_is_in_range (container, icon, start, end);
+}
+
+/* Returns a blank image of the given size. All of them share the
+ * pixels of a single one, so they cost next to nothing.
+ */
+static GdkPixbuf *
+get_placeholder_image (NautilusCanvasContainer *container,
+                       int                      width,
+                       int                      height)
+{
+    NautilusCanvasContainerDetails *details;
+    GdkPixbuf *pixels, *image;
+    gpointer key;
+
+    details = container->details;
+    width = MAX (width, 1);
+    height = MAX (height, 1);
+    key = GUINT_TO_POINTER ((guint) width << 16 | (guint) height);
+
+    image = g_hash_table_lookup (details->placeholder_images, key);
+    if (image != NULL)
+    {
+        return image;
+    }
+
+    if (details->placeholder_pixels == NULL ||
+        width > gdk_pixbuf_get_width (details->placeholder_pixels) ||
+        height > gdk_pixbuf_get_height (details->placeholder_pixels))
+    {
+        /* Images already in use keep the old pixels alive. */
+        if (details->placeholder_pixels != NULL)
+        {
+            width = MAX (width, gdk_pixbuf_get_width (details->placeholder_pixels));
+            height = MAX (height, gdk_pixbuf_get_height (details->placeholder_pixels));
+        }
+        pixels = gdk_pixbuf_new (GDK_COLORSPACE_RGB, TRUE, 8, width, height);
+        gdk_pixbuf_fill (pixels, 0);
+
+        g_hash_table_remove_all (details->placeholder_images);
+        g_clear_object (&details->placeholder_pixels);
+        details->placeholder_pixels = pixels;
+
+        return get_placeholder_image (container,
+                                      GPOINTER_TO_UINT (key) >> 16,
+                                      GPOINTER_TO_UINT (key) & 0xffff);
+    }
+
+    image = gdk_pixbuf_new_subpixbuf (details->placeholder_pixels,
+                                      0, 0, width, height);
+    g_hash_table_insert (details->placeholder_images, key, image);
+
+    return image;
+}
+
+/* Gives the icon a blank image, either of the size of the image it
+ * has, which leaves the layout alone, or of the size of the icons
+ * at the current zoom level.
+ */
+static void
+icon_set_placeholder_image (NautilusCanvasContainer *container,
+                            NautilusCanvasIcon      *icon,
+                            guint                    icon_size,
+                            gboolean                 keep_size)
+{
+    GdkPixbuf *pixbuf;
+    int width, height;
+
+    pixbuf = nautilus_canvas_item_get_image (icon->item);
+    if (keep_size && pixbuf != NULL)
+    {
+        width = gdk_pixbuf_get_width (pixbuf);
+        height = gdk_pixbuf_get_height (pixbuf);
+    }
+    else
+    {
+        width = icon_size * gtk_widget_get_scale_factor (GTK_WIDGET (container));
+        height = width;
+    }
+
+    nautilus_canvas_item_set_image (icon->item,
+                                    get_placeholder_image (container, width, height));
+    icon->is_placeholder = TRUE;
+
+    if (icon->is_realized)
+    {
+        container->details->realized_icons = g_list_remove (container->details->realized_icons, icon);
+        icon->is_realized = FALSE;
+    }
+}
+
+static void
+icon_update_image (NautilusCanvasContainer *container,
+                   NautilusCanvasIcon      *icon,
+                   gboolean                 near_viewport)
+{
+    NautilusCanvasContainerDetails *details;
+    guint icon_size;
+    guint min_image_size, max_image_size;
+    NautilusIconInfo *icon_info;
+    GdkPixbuf *pixbuf;
+
+    details = container->details;
+
+    /* compute the maximum size based on the scale factor */
+    min_image_size = MINIMUM_IMAGE_SIZE * EEL_CANVAS (container)->pixels_per_unit;
+    max_image_size = MAX (MAXIMUM_IMAGE_SIZE * EEL_CANVAS (container)->pixels_per_unit, NAUTILUS_ICON_MAXIMUM_SIZE);
+
+    /* Get the appropriate images for the file. */
+    icon_get_size (container, icon, &icon_size);
+
+    icon_size = MAX (icon_size, min_image_size);
+    icon_size = MIN (icon_size, max_image_size);
+
+    if (!near_viewport)
+    {
+        icon_set_placeholder_image (container, icon, icon_size, FALSE);
+        return;
+    }
+
+    DEBUG ("Icon size, getting for size %d", icon_size);
+
+    /* Get the icons. */
+    icon_info = nautilus_canvas_container_get_icon_images (container, icon->data, icon_size,
+                                                           icon == details->drop_target);
+
+    pixbuf = nautilus_icon_info_get_pixbuf (icon_info);
+    g_object_unref (icon_info);
+
+    nautilus_canvas_item_set_image (icon->item, pixbuf);
+    icon->is_placeholder = FALSE;
+
+    /* Let the pixbufs go. */
+    g_object_unref (pixbuf);
+
+    if (is_virtualized (container) && !icon->is_realized)
+    {
+        details->realized_icons = g_list_prepend (details->realized_icons, icon);
+        icon->is_realized = TRUE;
+    }
+}
+
+/* Gives the icons near the viewport their real image and takes it
+ * from the ones that moved away. Returns whether an image changed size.
+ */
+static gboolean
+update_realized_icons (NautilusCanvasContainer *container)
+{
+    GList *node, *next, *candidates;
+    NautilusCanvasIcon *icon;
+    GdkPixbuf *pixbuf;
+    int width, height;
+    double start, end;
+    gboolean size_changed;
+
+    get_realized_range (container, &start, &end);
+
+    if (nautilus_canvas_container_is_layout_vertical (container))
+    {
+        candidates = nautilus_canvas_container_get_icons_in_area
+                         (container, start, -G_MAXDOUBLE, end, G_MAXDOUBLE);
+    }
+    else
+    {
+        candidates = nautilus_canvas_container_get_icons_in_area
+                         (container, -G_MAXDOUBLE, start, G_MAXDOUBLE, end);
+    }
+
+    size_changed = FALSE;
+    for (node = candidates; node != NULL; node = node->next)
+    {
+        icon = node->data;
+
+        if (icon->is_placeholder &&
+            icon_is_in_range (container, icon, start, end))
+        {
+            pixbuf = nautilus_canvas_item_get_image (icon->item);
+            width = gdk_pixbuf_get_width (pixbuf);
+            height = gdk_pixbuf_get_height (pixbuf);
+
+            icon_update_image (container, icon, TRUE);
+
+            pixbuf = nautilus_canvas_item_get_image (icon->item);
+            if (pixbuf == NULL ||
+                gdk_pixbuf_get_width (pixbuf) != width ||
+                gdk_pixbuf_get_height (pixbuf) != height)
+            {
+                icon->layout_size_valid = FALSE;
+                size_changed = TRUE;
+            }
+        }
+    }
+    g_list_free (candidates);
+
+    for (node = container->details->realized_icons; node != NULL; node = next)
+    {
+        next = node->next;
+        icon = node->data;
+
+        if (!icon_is_in_range (container, icon, start, end))
+        {
+            icon_set_placeholder_image (container, icon, 0, TRUE);
+        }
+    }
+
+    return size_changed;
+}
+
+/* Brings the images in line with whether the container is virtualized,
+ * after that changed.
+ */
+static void
+reset_realized_icons (NautilusCanvasContainer *container)
+{
+    GList *node;
+    NautilusCanvasIcon *icon;
+
+    g_list_free (container->details->realized_icons);
+    container->details->realized_icons = NULL;
+
+    for (node = container->details->icons; node != NULL; node = node->next)
+    {
+        icon = node->data;
+        icon->is_realized = FALSE;
+
+        if (!is_virtualized (container))
+        {
+            if (icon->is_placeholder)
+            {
+                icon_update_image (container, icon, TRUE);
+            }
+        }
+        else if (!icon->is_placeholder)
+        {
+            container->details->realized_icons = g_list_prepend (container->details->realized_icons, icon);
+            icon->is_realized = TRUE;
+        }
+    }
+}
+
+static int
+compare_icons_by_position_reversed (gconstpointer a,
+                                    gconstpointer b)
+{
+    const NautilusCanvasIcon *icon_a = a;
+    const NautilusCanvasIcon *icon_b = b;
+
+    return icon_b->position - icon_a->position;
+}
+
 static void
 nautilus_canvas_container_update_visible_icons (NautilusCanvasContainer *container)
 {
     GtkAdjustment *vadj, *hadj;
     double min_y, max_y;
     double min_x, max_x;
-    double x0, y0, x1, y1;
-    GList *node;
+    GList *node, *candidates, *visible_icons;
     NautilusCanvasIcon *icon;
-    gboolean visible;
     GtkAllocation allocation;
 
+    if (is_virtualized (container) &&
+        update_realized_icons (container))
+    {
+        /* The icons that got their image have to be laid out again. */
+        container->details->needs_relayout = TRUE;
+        schedule_redo_layout (container);
+    }
+
     hadj = gtk_scrollable_get_hadjustment (GTK_SCROLLABLE (container));
     vadj = gtk_scrollable_get_vadjustment (GTK_SCROLLABLE (container));
     gtk_widget_get_allocation (GTK_WIDGET (container), &allocation);
@@ -6553,48 +7506,59 @@ nautilus_canvas_container_update_visible_icons (NautilusCanvasContainer *contain
     eel_canvas_c2w (EEL_CANVAS (container),
                     max_x, max_y, &max_x, &max_y);
 
+    /* Only the icons near the visible band can become visible, the
+     * others just have to be hidden if they were shown before.
+     */
+    if (nautilus_canvas_container_is_layout_vertical (container))
+    {
+        candidates = nautilus_canvas_container_get_icons_in_area
+                         (container, min_x, -G_MAXDOUBLE, max_x, G_MAXDOUBLE);
+    }
+    else
+    {
+        candidates = nautilus_canvas_container_get_icons_in_area
+                         (container, -G_MAXDOUBLE, min_y, G_MAXDOUBLE, max_y);
+    }
+
+    for (node = container->details->visible_icons; node != NULL; node = node->next)
+    {
+        icon = node->data;
+        icon->is_visible = FALSE;
+    }
+
     /* Do the iteration in reverse to get the render-order from top to
      * bottom for the prioritized thumbnails.
      */
-    for (node = g_list_last (container->details->icons); node != NULL; node = node->prev)
+    candidates = g_list_sort (candidates, compare_icons_by_position_reversed);
+
+    visible_icons = NULL;
+    for (node = candidates; node != NULL; node = node->next)
     {
         icon = node->data;
 
-        if (icon_is_positioned (icon))
+        if (nautilus_canvas_container_is_layout_vertical (container) ?
+            icon_is_in_range (container, icon, min_x, max_x) :
+            icon_is_in_range (container, icon, min_y, max_y))
         {
-            eel_canvas_item_get_bounds (EEL_CANVAS_ITEM (icon->item),
-                                        &x0,
-                                        &y0,
-                                        &x1,
-                                        &y1);
-            eel_canvas_item_i2w (EEL_CANVAS_ITEM (icon->item)->parent,
-                                 &x0,
-                                 &y0);
-            eel_canvas_item_i2w (EEL_CANVAS_ITEM (icon->item)->parent,
-                                 &x1,
-                                 &y1);
-
-            if (nautilus_canvas_container_is_layout_vertical (container))
-            {
-                visible = x1 >= min_x && x0 <= max_x;
-            }
-            else
-            {
-                visible = y1 >= min_y && y0 <= max_y;
-            }
+            nautilus_canvas_item_set_is_visible (icon->item, TRUE);
+            nautilus_canvas_container_prioritize_thumbnailing (container,
+                                                               icon);
+            icon->is_visible = TRUE;
+            visible_icons = g_list_prepend (visible_icons, icon);
+        }
+    }
+    g_list_free (candidates);
 
-            if (visible)
-            {
-                nautilus_canvas_item_set_is_visible (icon->item, TRUE);
-                nautilus_canvas_container_prioritize_thumbnailing (container,
-                                                                   icon);
-            }
-            else
-            {
-                nautilus_canvas_item_set_is_visible (icon->item, FALSE);
-            }
+    for (node = container->details->visible_icons; node != NULL; node = node->next)
+    {
+        icon = node->data;
+        if (!icon->is_visible)
+        {
+            nautilus_canvas_item_set_is_visible (icon->item, FALSE);
         }
     }
+    g_list_free (container->details->visible_icons);
+    container->details->visible_icons = visible_icons;
 }
 
 static void
@@ -6623,10 +7587,6 @@ nautilus_canvas_container_update_icon (NautilusCanvasContainer *container,
                                        NautilusCanvasIcon      *icon)
 {
     NautilusCanvasContainerDetails *details;
-    guint icon_size;
-    guint min_image_size, max_image_size;
-    NautilusIconInfo *icon_info;
-    GdkPixbuf *pixbuf;
     char *editable_text, *additional_text;
 
     if (icon == NULL)
@@ -6636,25 +7596,6 @@ nautilus_canvas_container_update_icon (NautilusCanvasContainer *container,
 
     details = container->details;
 
-    /* compute the maximum size based on the scale factor */
-    min_image_size = MINIMUM_IMAGE_SIZE * EEL_CANVAS (container)->pixels_per_unit;
-    max_image_size = MAX (MAXIMUM_IMAGE_SIZE * EEL_CANVAS (container)->pixels_per_unit, NAUTILUS_ICON_MAXIMUM_SIZE);
-
-    /* Get the appropriate images for the file. */
-    icon_get_size (container, icon, &icon_size);
-
-    icon_size = MAX (icon_size, min_image_size);
-    icon_size = MIN (icon_size, max_image_size);
-
-    DEBUG ("Icon size, getting for size %d", icon_size);
-
-    /* Get the icons. */
-    icon_info = nautilus_canvas_container_get_icon_images (container, icon->data, icon_size,
-                                                           icon == details->drop_target);
-
-    pixbuf = nautilus_icon_info_get_pixbuf (icon_info);
-    g_object_unref (icon_info);
-
     nautilus_canvas_container_get_icon_text (container,
                                              icon->data,
                                              &editable_text,
@@ -6667,13 +7608,22 @@ nautilus_canvas_container_update_icon (NautilusCanvasContainer *container,
                          "highlighted_for_drop", icon == details->drop_target,
                          NULL);
 
-    nautilus_canvas_item_set_image (icon->item, pixbuf);
-
-    /* Let the pixbufs go. */
-    g_object_unref (pixbuf);
+    icon_update_image (container, icon,
+                       !is_virtualized (container) ||
+                       icon == details->drop_target ||
+                       icon_is_near_viewport (container, icon));
 
     g_free (editable_text);
     g_free (additional_text);
+
+    /* The object may have been renamed. */
+    icon_uri_set_update (container, icon);
+
+    /* The new image or text may make the icon extend farther. */
+    spatial_index_update_reach (container, icon);
+
+    /* Have the next layout measure it again. */
+    icon->layout_size_valid = FALSE;
 }
 
 static gboolean
@@ -6893,6 +7843,7 @@ nautilus_canvas_container_add (NautilusCanvasContainer *container,
     icon->data = data;
     icon->x = ICON_UNPOSITIONED_VALUE;
     icon->y = ICON_UNPOSITIONED_VALUE;
+    icon->layout_position = -1;
 
     /* Whether the saved icon position should only be used
      * if the previous icon position is free. If the position
@@ -6920,6 +7871,7 @@ nautilus_canvas_container_add (NautilusCanvasContainer *container,
     details->new_icons = g_list_prepend (details->new_icons, icon);
 
     g_hash_table_insert (details->icon_set, data, icon);
+    icon_uri_set_update (container, icon);
 
     details->needs_resort = TRUE;
 
@@ -7317,7 +8269,7 @@ nautilus_canvas_container_set_selection (NautilusCanvasContainer *container,
 {
     gboolean selection_changed;
     GHashTable *hash;
-    GList *p;
+    GList *p, *old_selection;
     gboolean res;
     NautilusCanvasIcon *icon, *selected_icon;
 
@@ -7331,13 +8283,30 @@ nautilus_canvas_container_set_selection (NautilusCanvasContainer *container,
     {
         g_hash_table_insert (hash, p->data, p->data);
     }
-    for (p = container->details->icons; p != NULL; p = p->next)
+
+    /* Only the icons selected now and the ones to be selected can
+     * change, so look them up rather than going through every icon.
+     */
+    old_selection = g_list_copy (container->details->selection);
+    for (p = old_selection; p != NULL; p = p->next)
     {
-        icon = p->data;
+        if (g_hash_table_lookup (hash, p->data) == NULL)
+        {
+            icon = g_hash_table_lookup (container->details->icon_set, p->data);
+            selection_changed |= icon_set_selected (container, icon, FALSE);
+        }
+    }
+    g_list_free (old_selection);
+
+    for (p = selection; p != NULL; p = p->next)
+    {
+        icon = g_hash_table_lookup (container->details->icon_set, p->data);
+        if (icon == NULL)
+        {
+            continue;
+        }
 
-        res = icon_set_selected
-                  (container, icon,
-                  g_hash_table_lookup (hash, icon->data) != NULL);
+        res = icon_set_selected (container, icon, TRUE);
         selection_changed |= res;
 
         if (res)
@@ -7432,36 +8401,7 @@ NautilusCanvasIcon *
 nautilus_canvas_container_get_icon_by_uri (NautilusCanvasContainer *container,
                                            const char              *uri)
 {
-    NautilusCanvasContainerDetails *details;
-    GList *p;
-
-    /* Eventually, we must avoid searching the entire canvas list,
-     *  but it's OK for now.
-     *  A hash table mapping uri to canvas is one possibility.
-     */
-
-    details = container->details;
-
-    for (p = details->icons; p != NULL; p = p->next)
-    {
-        NautilusCanvasIcon *icon;
-        char *icon_uri;
-        gboolean is_match;
-
-        icon = p->data;
-
-        icon_uri = nautilus_canvas_container_get_icon_uri
-                       (container, icon);
-        is_match = strcmp (uri, icon_uri) == 0;
-        g_free (icon_uri);
-
-        if (is_match)
-        {
-            return icon;
-        }
-    }
-
-    return NULL;
+    return g_hash_table_lookup (container->details->icon_uri_set, uri);
 }
 
 static NautilusCanvasIcon *
@@ -7753,6 +8693,8 @@ nautilus_canvas_container_set_auto_layout (NautilusCanvasContainer *container,
 
     reset_scroll_region_if_not_empty (container);
     container->details->auto_layout = auto_layout;
+    container->details->needs_full_layout = TRUE;
+    reset_realized_icons (container);
 
     if (!auto_layout)
     {
@@ -7926,6 +8868,7 @@ nautilus_canvas_container_set_is_desktop (NautilusCanvasContainer *container,
     g_return_if_fail (NAUTILUS_IS_CANVAS_CONTAINER (container));
 
     container->details->is_desktop = is_desktop;
+    container->details->needs_full_layout = TRUE;
 
     if (is_desktop)
     {
@@ -8010,20 +8953,29 @@ nautilus_canvas_container_set_highlighted_for_clipboard (NautilusCanvasContainer
                                                          GList                   *clipboard_canvas_data)
 {
     GList *l;
+    GHashTable *hash;
     NautilusCanvasIcon *icon;
     gboolean highlighted_for_clipboard;
 
     g_return_if_fail (NAUTILUS_IS_CANVAS_CONTAINER (container));
 
+    hash = g_hash_table_new (NULL, NULL);
+    for (l = clipboard_canvas_data; l != NULL; l = l->next)
+    {
+        g_hash_table_add (hash, l->data);
+    }
+
     for (l = container->details->icons; l != NULL; l = l->next)
     {
         icon = l->data;
-        highlighted_for_clipboard = (g_list_find (clipboard_canvas_data, icon->data) != NULL);
+        highlighted_for_clipboard = g_hash_table_contains (hash, icon->data);
 
         eel_canvas_item_set (EEL_CANVAS_ITEM (icon->item),
                              "highlighted-for-clipboard", highlighted_for_clipboard,
                              NULL);
     }
+
+    g_hash_table_destroy (hash);
 }
 
 /* NautilusCanvasContainerAccessible */
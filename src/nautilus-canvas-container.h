@@ -148,6 +148,11 @@ typedef struct {
 						     NautilusCanvasIconData *canvas_b);
 	void         (* prioritize_thumbnailing)  (NautilusCanvasContainer *container,
 						   NautilusCanvasIconData *data);
+	/* Optional. Makes compare_icons read-only for the icon, so large
+	 * sorts can compare icons from several threads.
+	 */
+	void         (* prepare_icon_for_sort)    (NautilusCanvasContainer *container,
+						   NautilusCanvasIconData *data);
 
 	/* Queries on icons for subclass/client.
 	 * These must be implemented => These are signals !
@@ -205,6 +210,9 @@ typedef struct {
 						     NautilusCanvasIconData *data);
         void         (* icon_removed)             (NautilusCanvasContainer *container,
 						     NautilusCanvasIconData *data);
+	/* The pointer went over an icon, or off one if data is NULL. */
+	void         (* icon_hovered)             (NautilusCanvasContainer *container,
+						     NautilusCanvasIconData *data);
         void         (* cleared)                  (NautilusCanvasContainer *container);
 	gboolean     (* start_interactive_search) (NautilusCanvasContainer *container);
 } NautilusCanvasContainerClass;
@@ -622,10 +622,11 @@ nautilus_canvas_container_item_at (NautilusCanvasContainer *container,
                                    int                      x,
                                    int                      y)
 {
-    GList *p;
+    GList *p, *icons;
     int size;
     EelDRect point;
     EelIRect canvas_point;
+    NautilusCanvasIcon *hit;
 
     /* build the hit-test rectangle. Base the size on the scale factor to ensure that it is
      * non-empty even at the smallest scale factor
@@ -637,7 +638,13 @@ nautilus_canvas_container_item_at (NautilusCanvasContainer *container,
     point.x1 = x + size;
     point.y1 = y + size;
 
-    for (p = container->details->icons; p != NULL; p = p->next)
+    /* Only the icons near the point can be hit. */
+    icons = nautilus_canvas_container_get_icons_in_area (container,
+                                                         point.x0, point.y0,
+                                                         point.x1, point.y1);
+
+    hit = NULL;
+    for (p = icons; p != NULL; p = p->next)
     {
         NautilusCanvasIcon *icon;
         icon = p->data;
@@ -654,11 +661,14 @@ nautilus_canvas_container_item_at (NautilusCanvasContainer *container,
                         &canvas_point.y1);
         if (nautilus_canvas_item_hit_test_rectangle (icon->item, canvas_point))
         {
-            return icon;
+            hit = icon;
+            break;
         }
     }
 
-    return NULL;
+    g_list_free (icons);
+
+    return hit;
 }
 
 static char *
@@ -512,6 +512,14 @@ nautilus_canvas_item_set_image (NautilusCanvasItem *item,
     eel_canvas_item_request_update (EEL_CANVAS_ITEM (item));
 }
 
+GdkPixbuf *
+nautilus_canvas_item_get_image (NautilusCanvasItem *item)
+{
+    g_return_val_if_fail (NAUTILUS_IS_CANVAS_ITEM (item), NULL);
+
+    return item->details->pixbuf;
+}
+
 /* Recomputes the bounding box of a canvas item.
  * This is a generic implementation that could be used for any canvas item
  * class, it has no assumptions about how the item is used.
@@ -37,6 +37,9 @@ typedef struct {
 	/* Canvas item for the icon. */
 	NautilusCanvasItem *item;
 
+	/* URI of the object, as last looked up for the URI index. */
+	char *uri;
+
 	/* X/Y coordinates. */
 	double x, y;
 
@@ -54,6 +57,18 @@ typedef struct {
 	/* Position in the view */
 	int position;
 
+	/* Cell of the spatial index the icon is filed under. */
+	int cell_x, cell_y;
+
+	/* Index in the icon list at the last automatic layout, the size
+	 * the icon was measured at and, for the first icon of a line, the
+	 * top of that line.
+	 */
+	int layout_position;
+	double layout_width, layout_height_above, layout_height_below;
+	double layout_x_offset, layout_y_offset;
+	double layout_line_top;
+
 	/* Whether this item is selected. */
 	eel_boolean_bit is_selected : 1;
 
@@ -64,6 +79,23 @@ typedef struct {
 	eel_boolean_bit is_visible : 1;
 
 	eel_boolean_bit has_lazy_position : 1;
+
+	/* Whether the icon is filed in the spatial index. */
+	eel_boolean_bit is_indexed : 1;
+
+	/* Whether the item shows a blank image instead of the real one,
+	 * because the icon is far from the viewport.
+	 */
+	eel_boolean_bit is_placeholder : 1;
+
+	/* Whether the icon is on the list of realized icons. */
+	eel_boolean_bit is_realized : 1;
+
+	/* Whether the layout_ sizes above match the item. */
+	eel_boolean_bit layout_size_valid : 1;
+
+	/* Whether the icon started a line in the last automatic layout. */
+	eel_boolean_bit layout_starts_line : 1;
 } NautilusCanvasIcon;
 
 
@@ -81,6 +113,10 @@ typedef struct {
 	guint prev_x, prev_y;
 	int last_adj_x;
 	int last_adj_y;
+
+	/* Rectangle of the previous selection update, in world coordinates. */
+	EelDRect prev_rect;
+	gboolean has_prev_rect;
 } NautilusCanvasRubberbandInfo;
 
 typedef enum {
@@ -122,6 +158,36 @@ struct NautilusCanvasContainerDetails {
 	GList *selection;
 	GHashTable *icon_set;
 
+	/* Icons by the URI of their object, see
+	 * nautilus_canvas_container_get_icon_by_uri().
+	 */
+	GHashTable *icon_uri_set;
+
+	/* Positioned icons bucketed by the cell their position falls into,
+	 * along with the range of cells used so far and the farthest any
+	 * icon extends from its position.
+	 */
+	GHashTable *spatial_index;
+	int cell_min_x, cell_min_y, cell_max_x, cell_max_y;
+	double reach_left, reach_right, reach_above, reach_below;
+
+	/* Icons found visible by the last visibility update. */
+	GList *visible_icons;
+
+	/* Icons showing their real image in a virtualized view, and the
+	 * blank images shown by the other ones.
+	 */
+	GList *realized_icons;
+	GdkPixbuf *placeholder_pixels;
+	GHashTable *placeholder_images;
+
+	/* Parameters of the last automatic layout; when they still hold,
+	 * only the icons from the first changed one onward are laid out again.
+	 */
+	int layout_n_icons;
+	int layout_columns;
+	int layout_zoom_level;
+
 	/* Currently focused icon for accessibility. */
 	NautilusCanvasIcon *focus;
 	gboolean keyboard_focus;
@@ -236,6 +302,9 @@ struct NautilusCanvasContainerDetails {
 
 	eel_boolean_bit is_loading : 1;
 	eel_boolean_bit needs_resort : 1;
+	eel_boolean_bit needs_relayout : 1;
+	eel_boolean_bit needs_full_layout : 1;
+	eel_boolean_bit layout_is_rtl : 1;
 	eel_boolean_bit selection_needs_resort : 1;
 
 	eel_boolean_bit store_layout_timestamps : 1;
@@ -268,5 +337,10 @@ gboolean      nautilus_canvas_container_scroll                      (NautilusCan
 								     int                    delta_x,
 								     int                    delta_y);
 void          nautilus_canvas_container_update_scroll_region        (NautilusCanvasContainer *container);
+GList *       nautilus_canvas_container_get_icons_in_area           (NautilusCanvasContainer *container,
+								     double                 x0,
+								     double                 y0,
+								     double                 x1,
+								     double                 y1);
 
 #endif /* NAUTILUS_CANVAS_CONTAINER_PRIVATE_H */
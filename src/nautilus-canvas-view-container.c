@@ -326,6 +326,18 @@ nautilus_canvas_view_container_compare_icons_by_name (NautilusCanvasContainer *c
                FALSE, FALSE);
 }
 
+static void
+nautilus_canvas_view_container_prepare_icon_for_sort (NautilusCanvasContainer *container,
+                                                      NautilusCanvasIconData  *data)
+{
+    NautilusCanvasView *canvas_view;
+
+    canvas_view = get_canvas_view (container);
+    g_return_if_fail (canvas_view != NULL);
+
+    nautilus_canvas_view_prepare_file_for_sort (canvas_view, (NautilusFile *) data);
+}
+
 static void
 nautilus_canvas_view_container_class_init (NautilusCanvasViewContainerClass *klass)
 {
@@ -342,6 +354,7 @@ nautilus_canvas_view_container_class_init (NautilusCanvasViewContainerClass *kla
 
     ic_class->compare_icons = nautilus_canvas_view_container_compare_icons;
     ic_class->compare_icons_by_name = nautilus_canvas_view_container_compare_icons_by_name;
+    ic_class->prepare_icon_for_sort = nautilus_canvas_view_container_prepare_icon_for_sort;
 }
 
 static void
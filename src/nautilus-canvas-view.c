@@ -1371,6 +1371,13 @@ nautilus_canvas_view_compare_files (NautilusCanvasView *canvas_view,
                canvas_view->details->sort->reverse_order);
 }
 
+void
+nautilus_canvas_view_prepare_file_for_sort (NautilusCanvasView *canvas_view,
+                                            NautilusFile       *file)
+{
+    nautilus_file_prepare_for_sort (file, canvas_view->details->sort->sort_type);
+}
+
 static int
 compare_files (NautilusFilesView *canvas_view,
                NautilusFile      *a,
@@ -1389,6 +1396,17 @@ selection_changed_callback (NautilusCanvasContainer *container,
     nautilus_files_view_notify_selection_changed (NAUTILUS_FILES_VIEW (canvas_view));
 }
 
+static void
+icon_hovered_callback (NautilusCanvasContainer *container,
+                       NautilusFile            *file,
+                       NautilusCanvasView      *canvas_view)
+{
+    g_assert (NAUTILUS_IS_CANVAS_VIEW (canvas_view));
+    g_assert (container == get_canvas_container (canvas_view));
+
+    nautilus_files_view_set_prefetch_file (NAUTILUS_FILES_VIEW (canvas_view), file);
+}
+
 static void
 canvas_container_context_click_selection_callback (NautilusCanvasContainer *container,
                                                    GdkEventButton          *event,
@@ -1698,6 +1716,8 @@ initialize_canvas_container (NautilusCanvasView      *canvas_view,
                              G_CALLBACK (icon_position_changed_callback), canvas_view, 0);
     g_signal_connect_object (canvas_container, "selection-changed",
                              G_CALLBACK (selection_changed_callback), canvas_view, 0);
+    g_signal_connect_object (canvas_container, "icon-hovered",
+                             G_CALLBACK (icon_hovered_callback), canvas_view, 0);
     /* FIXME: many of these should move into fm-canvas-container as virtual methods */
     g_signal_connect_object (canvas_container, "get-icon-uri",
                              G_CALLBACK (get_icon_uri_callback), canvas_view, 0);
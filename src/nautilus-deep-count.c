@@ -0,0 +1,468 @@
+/*
+ *  nautilus-deep-count.c: Counting the contents of a folder tree.
+ *
+ *  This program is free software; you can redistribute it and/or
+ *  modify it under the terms of the GNU General Public License as
+ *  published by the Free Software Foundation; either version 2 of the
+ *  License, or (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ *  General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public
+ *  License along with this program; if not, see <http://www.gnu.org/licenses/>.
+ */
+
+/* A deep count reads a whole folder tree, which can be hundreds of
+ * thousands of files. Several worker threads share the folders still
+ * to be read, so slow reads on one branch do not hold up the others.
+ *
+ * Nothing is cached between counts. Writing to a file does not touch
+ * its folder, so a cached total could only be trusted after looking
+ * at every file again, which costs as much as reading the folder.
+ *
+ * Files with more than one link are only sized once per count.
+ */
+
+#include <config.h>
+#include "nautilus-deep-count.h"
+
+#include <string.h>
+
+/* Worker threads for all counts together. Reading folders is mostly
+ * waiting for the disk, so a few help, and many do not.
+ */
+#define DEEP_COUNT_MAX_THREADS 8
+
+/* Workers one count takes from the pool. Kept below the pool size so
+ * that a count started while another runs does not wait for it.
+ */
+#define DEEP_COUNT_THREADS_PER_COUNT 2
+
+/* How often the totals so far are passed on, in milliseconds. */
+#define DEEP_COUNT_PROGRESS_INTERVAL 100
+
+#define DEEP_COUNT_ENTRY_ATTRIBUTES \
+    G_FILE_ATTRIBUTE_STANDARD_NAME "," \
+    G_FILE_ATTRIBUTE_STANDARD_TYPE "," \
+    G_FILE_ATTRIBUTE_STANDARD_SIZE "," \
+    G_FILE_ATTRIBUTE_STANDARD_IS_HIDDEN "," \
+    G_FILE_ATTRIBUTE_STANDARD_IS_BACKUP "," \
+    G_FILE_ATTRIBUTE_ID_FILESYSTEM "," \
+    G_FILE_ATTRIBUTE_UNIX_DEVICE "," \
+    G_FILE_ATTRIBUTE_UNIX_INODE "," \
+    G_FILE_ATTRIBUTE_UNIX_NLINK
+
+typedef struct
+{
+    guint64 device;
+    guint64 inode;
+    goffset size;
+} DeepCountLink;
+
+typedef struct
+{
+    GFile *location;
+    gboolean is_root;
+} PendingDirectory;
+
+struct NautilusDeepCount
+{
+    gint ref_count;
+    GCancellable *cancellable;
+    gboolean count_hidden;
+
+    GMutex mutex;
+    GCond cond;
+    GQueue pending;          /* PendingDirectory's, next first */
+    guint n_busy;            /* workers reading a folder */
+    guint n_workers;         /* workers not done yet */
+    gboolean cancelled;
+    char *fs_id;             /* set once the root was read */
+    GHashTable *seen_links;  /* DeepCountLink's already sized */
+    NautilusDeepCountTotals totals;
+
+    guint progress_id;
+    NautilusDeepCountCallback callback;
+    gpointer user_data;
+};
+
+static GThreadPool *worker_pool;
+
+static guint
+link_hash (gconstpointer key)
+{
+    const DeepCountLink *link = key;
+
+    return (guint) (link->inode ^ (link->inode >> 32) ^ (link->device * 31));
+}
+
+static gboolean
+link_equal (gconstpointer a,
+            gconstpointer b)
+{
+    const DeepCountLink *link_a = a;
+    const DeepCountLink *link_b = b;
+
+    return link_a->inode == link_b->inode && link_a->device == link_b->device;
+}
+
+static void
+pending_directory_free (PendingDirectory *pending)
+{
+    g_object_unref (pending->location);
+    g_free (pending);
+}
+
+/* Adds the size of a file to size, or to links if it has more than
+ * one link and may be met again.
+ */
+static void
+add_size (GFileInfo *info,
+          goffset   *size,
+          GArray    *links)
+{
+    DeepCountLink link;
+
+    if (!g_file_info_has_attribute (info, G_FILE_ATTRIBUTE_STANDARD_SIZE))
+    {
+        return;
+    }
+
+    if (g_file_info_get_file_type (info) != G_FILE_TYPE_DIRECTORY &&
+        g_file_info_get_attribute_uint32 (info, G_FILE_ATTRIBUTE_UNIX_NLINK) > 1)
+    {
+        link.device = g_file_info_get_attribute_uint32 (info, G_FILE_ATTRIBUTE_UNIX_DEVICE);
+        link.inode = g_file_info_get_attribute_uint64 (info, G_FILE_ATTRIBUTE_UNIX_INODE);
+        link.size = g_file_info_get_size (info);
+        g_array_append_val (links, link);
+    }
+    else
+    {
+        *size += g_file_info_get_size (info);
+    }
+}
+
+/* Reads a folder, counting and sizing what it holds and listing the
+ * folders to descend into. Returns FALSE if it cannot be read at all.
+ */
+static gboolean
+read_directory (NautilusDeepCount *count,
+                GFile             *location,
+                const char        *fs_id,
+                guint             *directory_count,
+                guint             *file_count,
+                goffset           *size,
+                GArray            *links,
+                GList            **subdirectories)
+{
+    GFileEnumerator *enumerator;
+    GFileInfo *info;
+    PendingDirectory *child;
+
+    enumerator = g_file_enumerate_children (location,
+                                            DEEP_COUNT_ENTRY_ATTRIBUTES,
+                                            G_FILE_QUERY_INFO_NOFOLLOW_SYMLINKS,
+                                            count->cancellable, NULL);
+    if (enumerator == NULL)
+    {
+        return FALSE;
+    }
+
+    while ((info = g_file_enumerator_next_file (enumerator, count->cancellable, NULL)) != NULL)
+    {
+        if (!count->count_hidden &&
+            (g_file_info_get_is_hidden (info) || g_file_info_get_is_backup (info)))
+        {
+            g_object_unref (info);
+            continue;
+        }
+
+        if (g_file_info_get_file_type (info) == G_FILE_TYPE_DIRECTORY)
+        {
+            *directory_count += 1;
+
+            /* Only descend if it is on the same file system. */
+            if (g_strcmp0 (g_file_info_get_attribute_string (info, G_FILE_ATTRIBUTE_ID_FILESYSTEM),
+                           fs_id) == 0)
+            {
+                child = g_new0 (PendingDirectory, 1);
+                child->location = g_file_get_child (location, g_file_info_get_name (info));
+                *subdirectories = g_list_prepend (*subdirectories, child);
+            }
+        }
+        else
+        {
+            /* Even non-regular files count as files. */
+            *file_count += 1;
+        }
+
+        add_size (info, size, links);
+
+        g_object_unref (info);
+    }
+
+    g_object_unref (enumerator);
+
+    return TRUE;
+}
+
+static void
+count_directory (NautilusDeepCount *count,
+                 PendingDirectory  *pending)
+{
+    DeepCountLink *link;
+    GFileInfo *info;
+    GList *children, *l;
+    gboolean readable;
+    guint directory_count, file_count;
+    goffset size;
+    GArray *links;
+    guint i;
+
+    if (pending->is_root)
+    {
+        /* No other worker has anything to do before this one
+         * queues the first subfolders, under the lock.
+         */
+        info = g_file_query_info (pending->location,
+                                  G_FILE_ATTRIBUTE_ID_FILESYSTEM,
+                                  G_FILE_QUERY_INFO_NOFOLLOW_SYMLINKS,
+                                  count->cancellable, NULL);
+        if (info != NULL)
+        {
+            count->fs_id = g_strdup (g_file_info_get_attribute_string (info, G_FILE_ATTRIBUTE_ID_FILESYSTEM));
+            g_object_unref (info);
+        }
+    }
+
+    directory_count = 0;
+    file_count = 0;
+    size = 0;
+    links = g_array_new (FALSE, FALSE, sizeof (DeepCountLink));
+    children = NULL;
+
+    readable = read_directory (count, pending->location, count->fs_id,
+                               &directory_count, &file_count, &size, links,
+                               &children);
+
+    g_mutex_lock (&count->mutex);
+
+    if (!readable)
+    {
+        count->totals.unreadable_count += 1;
+    }
+    else
+    {
+        count->totals.directory_count += directory_count;
+        count->totals.file_count += file_count;
+        count->totals.size += size;
+
+        for (i = 0; i < links->len; i++)
+        {
+            link = &g_array_index (links, DeepCountLink, i);
+            if (!g_hash_table_contains (count->seen_links, link))
+            {
+                g_hash_table_add (count->seen_links, g_memdup (link, sizeof (DeepCountLink)));
+                count->totals.size += link->size;
+            }
+        }
+    }
+
+    /* Depth first, which keeps the queue short. */
+    for (l = children; l != NULL; l = l->next)
+    {
+        g_queue_push_head (&count->pending, l->data);
+    }
+    if (children != NULL)
+    {
+        g_cond_broadcast (&count->cond);
+    }
+
+    g_mutex_unlock (&count->mutex);
+
+    g_list_free (children);
+    g_array_free (links, TRUE);
+}
+
+static void
+deep_count_unref (NautilusDeepCount *count)
+{
+    if (g_atomic_int_dec_and_test (&count->ref_count))
+    {
+        g_object_unref (count->cancellable);
+        g_mutex_clear (&count->mutex);
+        g_cond_clear (&count->cond);
+        g_queue_foreach (&count->pending, (GFunc) pending_directory_free, NULL);
+        g_queue_clear (&count->pending);
+        g_hash_table_destroy (count->seen_links);
+        g_free (count->fs_id);
+        g_free (count);
+    }
+}
+
+static gboolean
+deep_count_progress_callback (gpointer user_data)
+{
+    NautilusDeepCount *count;
+    NautilusDeepCountTotals totals;
+
+    count = user_data;
+
+    g_mutex_lock (&count->mutex);
+    totals = count->totals;
+    g_mutex_unlock (&count->mutex);
+
+    count->callback (&totals, FALSE, count->user_data);
+
+    return G_SOURCE_CONTINUE;
+}
+
+static gboolean
+deep_count_done_callback (gpointer user_data)
+{
+    NautilusDeepCount *count;
+    NautilusDeepCountTotals totals;
+
+    count = user_data;
+
+    /* Cancelling dropped the caller's reference already. */
+    if (!count->cancelled)
+    {
+        g_source_remove (count->progress_id);
+        count->progress_id = 0;
+
+        totals = count->totals;
+        count->callback (&totals, TRUE, count->user_data);
+
+        deep_count_unref (count);
+    }
+
+    deep_count_unref (count);
+
+    return G_SOURCE_REMOVE;
+}
+
+static void
+deep_count_worker (gpointer data,
+                   gpointer user_data)
+{
+    NautilusDeepCount *count;
+    PendingDirectory *pending;
+    gboolean last;
+
+    count = data;
+
+    g_mutex_lock (&count->mutex);
+
+    for (;;)
+    {
+        /* Folders being read may still turn up more work. */
+        while (g_queue_is_empty (&count->pending) &&
+               count->n_busy > 0 &&
+               !count->cancelled)
+        {
+            g_cond_wait (&count->cond, &count->mutex);
+        }
+
+        if (g_queue_is_empty (&count->pending) || count->cancelled)
+        {
+            break;
+        }
+
+        pending = g_queue_pop_head (&count->pending);
+        count->n_busy++;
+        g_mutex_unlock (&count->mutex);
+
+        count_directory (count, pending);
+        pending_directory_free (pending);
+
+        g_mutex_lock (&count->mutex);
+        count->n_busy--;
+    }
+
+    count->n_workers--;
+    last = count->n_workers == 0;
+    g_cond_broadcast (&count->cond);
+
+    g_mutex_unlock (&count->mutex);
+
+    if (last)
+    {
+        /* Passes on this worker's reference. */
+        g_idle_add (deep_count_done_callback, count);
+    }
+    else
+    {
+        deep_count_unref (count);
+    }
+}
+
+NautilusDeepCount *
+nautilus_deep_count_start (GFile                     *location,
+                           gboolean                   count_hidden,
+                           NautilusDeepCountCallback  callback,
+                           gpointer                   user_data)
+{
+    NautilusDeepCount *count;
+    PendingDirectory *root;
+    guint i;
+
+    g_return_val_if_fail (G_IS_FILE (location), NULL);
+    g_return_val_if_fail (callback != NULL, NULL);
+
+    if (worker_pool == NULL)
+    {
+        worker_pool = g_thread_pool_new (deep_count_worker, NULL,
+                                         DEEP_COUNT_MAX_THREADS, FALSE, NULL);
+    }
+
+    count = g_new0 (NautilusDeepCount, 1);
+    count->cancellable = g_cancellable_new ();
+    count->count_hidden = count_hidden;
+    g_mutex_init (&count->mutex);
+    g_cond_init (&count->cond);
+    g_queue_init (&count->pending);
+    count->seen_links = g_hash_table_new_full (link_hash, link_equal, g_free, NULL);
+    count->callback = callback;
+    count->user_data = user_data;
+
+    root = g_new0 (PendingDirectory, 1);
+    root->location = g_object_ref (location);
+    root->is_root = TRUE;
+    g_queue_push_head (&count->pending, root);
+
+    /* One reference for the caller, one for each worker. */
+    count->ref_count = 1 + DEEP_COUNT_THREADS_PER_COUNT;
+    count->n_workers = DEEP_COUNT_THREADS_PER_COUNT;
+    for (i = 0; i < DEEP_COUNT_THREADS_PER_COUNT; i++)
+    {
+        g_thread_pool_push (worker_pool, count, NULL);
+    }
+
+    count->progress_id = g_timeout_add (DEEP_COUNT_PROGRESS_INTERVAL,
+                                        deep_count_progress_callback,
+                                        count);
+
+    return count;
+}
+
+void
+nautilus_deep_count_cancel (NautilusDeepCount *count)
+{
+    g_return_if_fail (count != NULL);
+
+    g_source_remove (count->progress_id);
+    count->progress_id = 0;
+
+    g_cancellable_cancel (count->cancellable);
+
+    g_mutex_lock (&count->mutex);
+    count->cancelled = TRUE;
+    g_cond_broadcast (&count->cond);
+    g_mutex_unlock (&count->mutex);
+
+    deep_count_unref (count);
+}
@@ -0,0 +1,55 @@
+/*
+   nautilus-deep-count.h: Counting the contents of a folder tree.
+
+   This program is free software; you can redistribute it and/or
+   modify it under the terms of the GNU General Public License as
+   published by the Free Software Foundation; either version 2 of the
+   License, or (at your option) any later version.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+   General Public License for more details.
+
+   You should have received a copy of the GNU General Public
+   License along with this program; if not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef NAUTILUS_DEEP_COUNT_H
+#define NAUTILUS_DEEP_COUNT_H
+
+#include <gio/gio.h>
+
+typedef struct
+{
+	guint directory_count;
+	guint file_count;
+	guint unreadable_count;
+	goffset size;
+} NautilusDeepCountTotals;
+
+typedef struct NautilusDeepCount NautilusDeepCount;
+
+/* Called on the main thread with the totals so far while the count
+ * runs, and a last time with done set once the whole tree is counted.
+ * The count is gone after that last call.
+ */
+typedef void (* NautilusDeepCountCallback) (const NautilusDeepCountTotals *totals,
+					    gboolean                       done,
+					    gpointer                       user_data);
+
+/* Counts everything below location, on worker threads. Hidden and
+ * backup files are left out unless count_hidden is set, and other
+ * file systems mounted inside the tree are not descended into.
+ */
+NautilusDeepCount *nautilus_deep_count_start  (GFile                     *location,
+					       gboolean                   count_hidden,
+					       NautilusDeepCountCallback  callback,
+					       gpointer                   user_data);
+
+/* Stops a count that is not done yet. The callback is not called
+ * again.
+ */
+void               nautilus_deep_count_cancel (NautilusDeepCount         *count);
+
+#endif /* NAUTILUS_DEEP_COUNT_H */
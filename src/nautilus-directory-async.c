@@ -21,6 +21,7 @@
 
 #include <config.h>
 
+#include "nautilus-deep-count.h"
 #include "nautilus-directory-notify.h"
 #include "nautilus-directory-private.h"
 #include "nautilus-file-attributes.h"
@@ -29,6 +30,7 @@
 #include "nautilus-signaller.h"
 #include "nautilus-global-preferences.h"
 #include "nautilus-link.h"
+#include "nautilus-listing-cache.h"
 #include "nautilus-profile.h"
 #include <eel/eel-glib-extensions.h>
 #include <gtk/gtk.h>
@@ -53,8 +55,103 @@
 
 #define DIRECTORY_LOAD_ITEMS_PER_CALLBACK 100
 
-/* Keep async. jobs down to this number for all directories. */
-#define MAX_ASYNC_JOBS 10
+/* Local entries are much cheaper to read, so fetch more at a time. */
+#define DIRECTORY_LOAD_LOCAL_ITEMS_PER_CALLBACK 500
+
+/* The first batch of a load is small so that the first files show up
+ * quickly. Each further batch is twice as big, up to this size; big
+ * batches can't hold up the main loop, since adding the files to the
+ * directory is time sliced.
+ */
+#define DIRECTORY_LOAD_MAX_ITEMS_PER_CALLBACK 4000
+
+/* How long one run of dequeue_pending_idle_callback() may take, in
+ * microseconds. Whatever is left waits for the next idle, which lets
+ * input and redraws through in between.
+ */
+#define DEQUEUE_PENDING_TIME_BUDGET 8000
+
+/* Keep async. jobs down to these numbers for all directories. Remote
+ * (gvfs) locations get a separate, smaller limit so a slow network
+ * share can't use up the job slots that local folders need.
+ */
+#define MAX_ASYNC_JOBS_LOCAL 10
+#define MAX_ASYNC_JOBS_REMOTE 4
+
+/* Job slots in each pool that only the directory shown in the active
+ * window slot may use.
+ */
+#define FOREGROUND_RESERVED_JOBS 2
+
+/* Directories loaded ahead of time only get a job slot while this
+ * many more beyond the reserved ones are free, so they run on spare
+ * capacity alone. In the remote pool that leaves none.
+ */
+#define PREFETCH_FREE_JOBS 2
+
+/* Number of directories nautilus_directory_prefetch() keeps loaded. */
+#define MAX_PREFETCHED_DIRECTORIES 8
+
+/* Number of files at the head of a work queue that start_or_stop_io()
+ * keeps busy at the same time.
+ */
+#define WORK_QUEUE_LOOKAHEAD 32
+
+/* Item counts and MIME lists of subfolders come from one read of each
+ * subfolder. Subfolders are read this many at a time on a worker
+ * thread, with this many such batches per directory.
+ */
+#define DIRECTORY_SUMMARY_BATCH_SIZE 8
+#define DIRECTORY_SUMMARY_BATCHES_IN_FLIGHT 4
+
+#define DIRECTORY_SUMMARY_ATTRIBUTES \
+    G_FILE_ATTRIBUTE_STANDARD_NAME "," \
+    G_FILE_ATTRIBUTE_STANDARD_IS_HIDDEN "," \
+    G_FILE_ATTRIBUTE_STANDARD_IS_BACKUP
+
+#define DIRECTORY_SUMMARY_MIME_LIST_ATTRIBUTES \
+    DIRECTORY_SUMMARY_ATTRIBUTES "," \
+    G_FILE_ATTRIBUTE_STANDARD_CONTENT_TYPE
+
+/* Information about files that show up in a directory is read on a
+ * worker thread, all files of one notification together. Past this
+ * many files, the directory is read again instead of asking about each
+ * file in turn, as long as the new files make up at least one in
+ * NEW_FILES_RESCAN_FRACTION of it. A directory that keeps growing is
+ * then not read in full for every batch.
+ */
+#define NEW_FILES_RESCAN_THRESHOLD 64
+#define NEW_FILES_RESCAN_FRACTION 4
+
+/* Every directory monitor may use up an inotify watch, and there are
+ * only so many of those. Past this many monitors, the least recently
+ * used directories give up theirs.
+ */
+#define MAX_DIRECTORY_MONITORS 256
+
+/* Directories without a monitor are read again when they get one back,
+ * unless they did not change since. Some file systems only store
+ * modification times to the nearest two seconds.
+ */
+#define DIRECTORY_REVALIDATE_ATTRIBUTES \
+    G_FILE_ATTRIBUTE_TIME_MODIFIED "," \
+    G_FILE_ATTRIBUTE_TIME_MODIFIED_USEC "," \
+    G_FILE_ATTRIBUTE_TIME_CHANGED "," \
+    G_FILE_ATTRIBUTE_TIME_CHANGED_USEC
+#define DIRECTORY_REVALIDATE_TIME_SLACK (2 * G_USEC_PER_SEC)
+
+/* Keep at most this many requests of each attribute class in flight for
+ * a single directory. Each request still has to get a job slot from
+ * async_job_start(), so the global limit applies on top of these.
+ * Classes not listed here run one request at a time.
+ */
+static const guint max_requests_in_flight[REQUEST_TYPE_LAST] =
+{
+    [REQUEST_FILE_INFO] = 4,
+    [REQUEST_THUMBNAIL] = 2,
+    [REQUEST_FILESYSTEM_INFO] = 2,
+    [REQUEST_LINK_INFO] = 2,
+};
 
 struct TopLeftTextReadState
 {
@@ -99,51 +196,93 @@ struct DirectoryLoadState
     NautilusDirectory *directory;
     GCancellable *cancellable;
     GFileEnumerator *enumerator;
+    NautilusLocalEnumerator *local_enumerator;
     GHashTable *load_mime_list_hash;
     NautilusFile *load_directory_file;
     int load_file_count;
+    int items_per_callback;
+
+    /* The files are built on a worker thread, one batch at a
+     * time. Whatever the enumerator returns in the meantime waits
+     * for the next batch.
+     */
+    GList *unprepared; /* GFileInfo's, or NautilusLocalEntry's for local_enumerator */
+    gboolean read_listing_cache; /* the first batch comes from the cache */
+    gboolean preparing;
+    gboolean enumeration_done;
+    GError *load_error;
 };
 
-struct MimeListState
+/* A file read by a directory load. file is built off the main thread
+ * and not part of the directory yet; it is NULL for entries that only
+ * carry metadata. info or entry is kept for the case that the
+ * directory got a file of the same name in the meantime.
+ *
+ * Files from the listing cache are only a guess of what the directory
+ * holds. They stay unconfirmed until the load finds them too.
+ */
+struct PreparedFile
 {
-    NautilusDirectory *directory;
-    NautilusFile *mime_list_file;
-    GCancellable *cancellable;
-    GFileEnumerator *enumerator;
-    GHashTable *mime_list_hash;
+    NautilusFile *file;
+    GFileInfo *info;
+    NautilusLocalEntry *entry;
+    gboolean from_cache;
 };
 
+typedef struct
+{
+    NautilusDirectory *directory;
+    GFile *location;
+    GList *items;
+    gboolean local;
+    gboolean read_listing_cache;
+} PrepareFilesData;
+
 struct GetInfoState
 {
     NautilusDirectory *directory;
     GCancellable *cancellable;
+    NautilusFile *file;
 };
 
 struct NewFilesState
 {
-    NautilusDirectory *directory;
+    NautilusDirectory *directory; /* NULL once cancelled */
     GCancellable *cancellable;
-    int count;
+    GFile *location; /* of the directory */
+    GList *locations; /* of the new files */
+    guint n_locations;
+    guint n_files; /* in the directory already */
+    GList *infos; /* filled in on the worker thread */
 };
 
-struct DirectoryCountState
+/* One subfolder of a summary batch. */
+typedef struct
+{
+    NautilusFile *file; /* NULL once the summary is not wanted */
+    GFile *location;
+    gboolean want_count;
+    gboolean want_mime_list;
+
+    /* Filled in by the worker thread. */
+    gboolean succeeded;
+    guint count;
+    GHashTable *mime_list_hash;
+} DirectorySummaryItem;
+
+struct DirectorySummaryState
 {
     NautilusDirectory *directory;
-    NautilusFile *count_file;
     GCancellable *cancellable;
-    GFileEnumerator *enumerator;
-    int file_count;
+    gboolean count_hidden;
+    GList *items; /* DirectorySummaryItem's */
+    guint n_items;
 };
 
 struct DeepCountState
 {
     NautilusDirectory *directory;
-    GCancellable *cancellable;
-    GFileEnumerator *enumerator;
-    GFile *deep_count_location;
-    GList *deep_count_subdirectories;
-    GArray *seen_deep_count_inodes;
-    char *fs_id;
+    NautilusDeepCount *count;
 };
 
 
@@ -184,22 +323,110 @@ typedef struct
 typedef gboolean (*RequestCheck) (Request);
 typedef gboolean (*FileCheck) (NautilusFile *);
 
+typedef enum
+{
+    ASYNC_JOB_FILE_LIST,
+    ASYNC_JOB_DIRECTORY_SUMMARY,
+    ASYNC_JOB_DEEP_COUNT,
+    ASYNC_JOB_FILE_INFO,
+    ASYNC_JOB_LINK_INFO,
+    ASYNC_JOB_THUMBNAIL,
+    ASYNC_JOB_MOUNT,
+    ASYNC_JOB_FILESYSTEM_INFO,
+    ASYNC_JOB_EXTENSION_INFO,
+    ASYNC_JOB_LAST
+} AsyncJobClass;
+
+static const char * const async_job_names[ASYNC_JOB_LAST] =
+{
+    [ASYNC_JOB_FILE_LIST] = "file list",
+    [ASYNC_JOB_DIRECTORY_SUMMARY] = "directory summary",
+    [ASYNC_JOB_DEEP_COUNT] = "deep count",
+    [ASYNC_JOB_FILE_INFO] = "file info",
+    [ASYNC_JOB_LINK_INFO] = "link info",
+    [ASYNC_JOB_THUMBNAIL] = "thumbnail",
+    [ASYNC_JOB_MOUNT] = "mount",
+    [ASYNC_JOB_FILESYSTEM_INFO] = "filesystem info",
+    [ASYNC_JOB_EXTENSION_INFO] = "extension info",
+};
+
+/* Keep async. jobs of each class down to this number for all
+ * directories together, so that one kind of slow request (say, deep
+ * counts of big trees) can't hold every job slot.
+ */
+static const int async_job_class_budget[ASYNC_JOB_LAST] =
+{
+    [ASYNC_JOB_FILE_LIST] = 6,
+    [ASYNC_JOB_DIRECTORY_SUMMARY] = 6,
+    [ASYNC_JOB_DEEP_COUNT] = 2,
+    [ASYNC_JOB_FILE_INFO] = 8,
+    [ASYNC_JOB_LINK_INFO] = 4,
+    [ASYNC_JOB_THUMBNAIL] = 4,
+    [ASYNC_JOB_MOUNT] = 4,
+    [ASYNC_JOB_FILESYSTEM_INFO] = 4,
+    [ASYNC_JOB_EXTENSION_INFO] = 4,
+};
+
+static const int async_job_pool_limit[NAUTILUS_ASYNC_JOB_POOL_LAST] =
+{
+    [NAUTILUS_ASYNC_JOB_POOL_LOCAL] = MAX_ASYNC_JOBS_LOCAL,
+    [NAUTILUS_ASYNC_JOB_POOL_REMOTE] = MAX_ASYNC_JOBS_REMOTE,
+};
+
+/* A directory that could not get a job slot. */
+typedef struct
+{
+    NautilusDirectory *directory;
+    guint blocked_classes; /* bit mask of AsyncJobClass */
+    gint64 since;
+} AsyncJobWaiter;
+
 /* Current number of async. jobs. */
 static int async_job_count;
+static int async_job_class_count[ASYNC_JOB_LAST];
+static int async_job_pool_count[NAUTILUS_ASYNC_JOB_POOL_LAST];
+
+/* Directories waiting for a job slot, in the order they get woken up,
+ * and the same waiters by directory.
+ */
+static GQueue waiting_queue = G_QUEUE_INIT;
 static GHashTable *waiting_directories;
+
+/* The location shown by the active window slot. */
+static GFile *foreground_location;
+
+/* Directories with a monitor, most recently used first. */
+static GQueue monitored_directories = G_QUEUE_INIT;
+
+/* Monitors from this client alone don't keep a directory monitor. */
+static gconstpointer background_monitor_client;
+
+/* Directories loaded ahead of time because they are likely to be
+ * shown next, most recent first. Each one holds a reference and a
+ * file list monitor, and is the client of that monitor.
+ */
+static GQueue prefetched_directories = G_QUEUE_INIT;
+static guint prefetch_yield_idle_id;
+
+/* The directory async_job_wake_up() is giving its turn to. */
+static NautilusDirectory *woken_directory;
+
+static NautilusAsyncJobStats async_job_stats;
 #ifdef DEBUG_ASYNC_JOBS
 static GHashTable *async_jobs;
 #endif
 
 /* Forward declarations for functions that need them. */
-static void     deep_count_load (DeepCountState *state,
-                                 GFile          *location);
 static gboolean request_is_satisfied (NautilusDirectory *directory,
                                       NautilusFile      *file,
                                       Request            request);
 static void     cancel_loading_attributes (NautilusDirectory     *directory,
                                            NautilusFileAttributes file_attributes);
 static void     add_all_files_to_work_queue (NautilusDirectory *directory);
+static void     update_directory_monitor (NautilusDirectory *directory);
+static void     prefetch_yield (void);
+static void     file_list_cancel (NautilusDirectory *directory);
+static void     file_info_cancel (NautilusDirectory *directory);
 static void     link_info_done (NautilusDirectory *directory,
                                 NautilusFile      *file,
                                 const char        *uri,
@@ -207,12 +434,19 @@ static void     link_info_done (NautilusDirectory *directory,
                                 GIcon             *icon,
                                 gboolean           is_launcher,
                                 gboolean           is_foreign);
-static void     move_file_to_low_priority_queue (NautilusDirectory *directory,
-                                                 NautilusFile      *file);
-static void     move_file_to_extension_queue (NautilusDirectory *directory,
-                                              NautilusFile      *file);
 static void     nautilus_directory_invalidate_file_attributes (NautilusDirectory     *directory,
                                                                NautilusFileAttributes file_attributes);
+static DirectorySummaryItem *find_directory_summary_item (NautilusDirectory *directory,
+                                                          NautilusFile      *file);
+static void                 directory_summary_flush (NautilusDirectory *directory);
+static GetInfoState        *find_file_info_state (NautilusDirectory *directory,
+                                                  NautilusFile      *file);
+static LinkInfoReadState   *find_link_info_state (NautilusDirectory *directory,
+                                                  NautilusFile      *file);
+static ThumbnailState      *find_thumbnail_state (NautilusDirectory *directory,
+                                                  NautilusFile      *file);
+static FilesystemInfoState *find_filesystem_info_state (NautilusDirectory *directory,
+                                                        NautilusFile      *file);
 
 /* Some helpers for case-insensitive strings.
  * Move to nautilus-glib-extensions?
@@ -363,36 +597,251 @@ nautilus_directory_verify_request_counts (NautilusDirectory *directory)
 }
 #endif
 
+static NautilusAsyncJobPool
+async_job_get_pool (NautilusDirectory *directory)
+{
+    /* The pool is decided once, so that a job always ends in the pool
+     * it was started in.
+     */
+    if (!directory->details->async_job_pool_set)
+    {
+        directory->details->async_job_pool_remote = !nautilus_directory_is_local (directory);
+        directory->details->async_job_pool_set = TRUE;
+    }
+
+    return directory->details->async_job_pool_remote ?
+           NAUTILUS_ASYNC_JOB_POOL_REMOTE : NAUTILUS_ASYNC_JOB_POOL_LOCAL;
+}
+
+static gboolean
+async_job_is_foreground (NautilusDirectory *directory)
+{
+    return foreground_location != NULL &&
+           directory->details->location != NULL &&
+           g_file_equal (foreground_location, directory->details->location);
+}
+
+/* Whether all I/O the directory wants is for a prefetch, with nobody
+ * waiting for the results yet.
+ */
+static gboolean
+async_job_is_prefetch (NautilusDirectory *directory)
+{
+    GList *node;
+    Monitor *monitor;
+
+    if (directory->details->monitor_list == NULL ||
+        directory->details->call_when_ready_list != NULL ||
+        async_job_is_foreground (directory))
+    {
+        return FALSE;
+    }
+
+    for (node = directory->details->monitor_list; node != NULL; node = node->next)
+    {
+        monitor = node->data;
+        if (monitor->client != &prefetched_directories)
+        {
+            return FALSE;
+        }
+    }
+
+    return TRUE;
+}
+
+/* Whether a new job of this class can get a slot right now. */
+static gboolean
+async_job_slot_available (NautilusDirectory *directory,
+                          AsyncJobClass      job)
+{
+    NautilusAsyncJobPool pool;
+    int limit;
+
+    if (async_job_class_count[job] >= async_job_class_budget[job])
+    {
+        return FALSE;
+    }
+
+    pool = async_job_get_pool (directory);
+    limit = async_job_pool_limit[pool];
+    if (!async_job_is_foreground (directory))
+    {
+        limit -= FOREGROUND_RESERVED_JOBS;
+        if (async_job_is_prefetch (directory))
+        {
+            limit -= PREFETCH_FREE_JOBS;
+        }
+    }
+
+    return async_job_pool_count[pool] < limit;
+}
+
+static gboolean
+async_job_waiter_can_run (AsyncJobWaiter *waiter)
+{
+    AsyncJobClass job;
+
+    for (job = 0; job < ASYNC_JOB_LAST; job++)
+    {
+        if ((waiter->blocked_classes & (1 << job)) != 0 &&
+            async_job_slot_available (waiter->directory, job))
+        {
+            return TRUE;
+        }
+    }
+
+    return FALSE;
+}
+
+/* Whether another directory in the same pool is already waiting for a
+ * slot it could use now. A directory that isn't in the foreground then
+ * has to queue up behind it, which makes the waiting directories take
+ * turns instead of the busiest one grabbing every slot that frees up.
+ */
+static gboolean
+async_job_has_earlier_waiter (NautilusDirectory *directory)
+{
+    NautilusAsyncJobPool pool;
+    AsyncJobWaiter *waiter;
+    GList *node;
+
+    pool = async_job_get_pool (directory);
+    for (node = waiting_queue.head; node != NULL; node = node->next)
+    {
+        waiter = node->data;
+        if (waiter->directory != directory &&
+            async_job_get_pool (waiter->directory) == pool &&
+            !async_job_is_prefetch (waiter->directory) &&
+            async_job_waiter_can_run (waiter))
+        {
+            return TRUE;
+        }
+    }
+
+    return FALSE;
+}
+
+/* Whether any other directory in the same pool waits for a slot for
+ * real work. Prefetches don't start then, even if there is room.
+ */
+static gboolean
+async_job_has_real_waiter (NautilusDirectory *directory)
+{
+    NautilusAsyncJobPool pool;
+    AsyncJobWaiter *waiter;
+    GList *node;
+
+    pool = async_job_get_pool (directory);
+    for (node = waiting_queue.head; node != NULL; node = node->next)
+    {
+        waiter = node->data;
+        if (waiter->directory != directory &&
+            async_job_get_pool (waiter->directory) == pool &&
+            !async_job_is_prefetch (waiter->directory))
+        {
+            return TRUE;
+        }
+    }
+
+    return FALSE;
+}
+
+static void
+async_job_wait (NautilusDirectory *directory,
+                AsyncJobClass      job)
+{
+    AsyncJobWaiter *waiter;
+
+    if (waiting_directories == NULL)
+    {
+        waiting_directories = g_hash_table_new (NULL, NULL);
+    }
+
+    waiter = g_hash_table_lookup (waiting_directories, directory);
+    if (waiter == NULL)
+    {
+        waiter = g_new0 (AsyncJobWaiter, 1);
+        waiter->directory = directory;
+        waiter->since = g_get_monotonic_time ();
+        g_hash_table_insert (waiting_directories, directory, waiter);
+        g_queue_push_tail (&waiting_queue, waiter);
+
+        async_job_stats.queue_depth = waiting_queue.length;
+        async_job_stats.max_queue_depth = MAX (async_job_stats.max_queue_depth,
+                                               async_job_stats.queue_depth);
+    }
+
+    waiter->blocked_classes |= 1 << job;
+    async_job_stats.blocked_jobs += 1;
+}
+
+/* Drops the directory from the waiting list. Only waits that end with
+ * the directory being woken up count towards the wait time.
+ */
+static void
+async_job_stop_waiting (NautilusDirectory *directory,
+                        gboolean           woken)
+{
+    AsyncJobWaiter *waiter;
+    gint64 waited;
+
+    if (waiting_directories == NULL)
+    {
+        return;
+    }
+
+    waiter = g_hash_table_lookup (waiting_directories, directory);
+    if (waiter == NULL)
+    {
+        return;
+    }
+
+    g_hash_table_remove (waiting_directories, directory);
+    g_queue_remove (&waiting_queue, waiter);
+    async_job_stats.queue_depth = waiting_queue.length;
+
+    if (woken)
+    {
+        waited = g_get_monotonic_time () - waiter->since;
+        async_job_stats.wake_ups += 1;
+        async_job_stats.total_wait_time += waited;
+        async_job_stats.max_wait_time = MAX (async_job_stats.max_wait_time, waited);
+    }
+
+    g_free (waiter);
+}
+
 /* Start a job. This is really just a way of limiting the number of
  * async. requests that we issue at any given time. Without this, the
  * number of requests is unbounded.
  */
 static gboolean
 async_job_start (NautilusDirectory *directory,
-                 const char        *job)
+                 AsyncJobClass      job)
 {
+    NautilusAsyncJobPool pool;
 #ifdef DEBUG_ASYNC_JOBS
     char *key;
 #endif
 
 #ifdef DEBUG_START_STOP
-    g_message ("starting %s in %p", job, directory->details->location);
+    g_message ("starting %s in %p", async_job_names[job], directory->details->location);
 #endif
 
     g_assert (async_job_count >= 0);
-    g_assert (async_job_count <= MAX_ASYNC_JOBS);
 
-    if (async_job_count >= MAX_ASYNC_JOBS)
+    if (!async_job_slot_available (directory, job) ||
+        (directory != woken_directory &&
+         !async_job_is_foreground (directory) &&
+         async_job_has_earlier_waiter (directory)) ||
+        (async_job_is_prefetch (directory) &&
+         async_job_has_real_waiter (directory)))
     {
-        if (waiting_directories == NULL)
+        async_job_wait (directory, job);
+        if (!async_job_is_prefetch (directory))
         {
-            waiting_directories = g_hash_table_new (NULL, NULL);
+            prefetch_yield ();
         }
-
-        g_hash_table_insert (waiting_directories,
-                             directory,
-                             directory);
-
         return FALSE;
     }
 
@@ -404,47 +853,62 @@ async_job_start (NautilusDirectory *directory,
             async_jobs = g_hash_table_new (g_str_hash, g_str_equal);
         }
         uri = nautilus_directory_get_uri (directory);
-        key = g_strconcat (uri, ": ", job, NULL);
+        key = g_strconcat (uri, ": ", async_job_names[job], NULL);
         if (g_hash_table_lookup (async_jobs, key) != NULL)
         {
             g_warning ("same job twice: %s in %s",
-                       job, uri);
+                       async_job_names[job], uri);
         }
         g_free (uri);
         g_hash_table_insert (async_jobs, key, directory);
     }
 #endif
 
+    /* A woken directory gets one job per turn. */
+    if (directory == woken_directory)
+    {
+        woken_directory = NULL;
+    }
+
+    pool = async_job_get_pool (directory);
     async_job_count += 1;
+    async_job_class_count[job] += 1;
+    async_job_pool_count[pool] += 1;
+    async_job_stats.running_jobs[pool] = async_job_pool_count[pool];
     return TRUE;
 }
 
 /* End a job. */
 static void
 async_job_end (NautilusDirectory *directory,
-               const char        *job)
+               AsyncJobClass      job)
 {
+    NautilusAsyncJobPool pool;
 #ifdef DEBUG_ASYNC_JOBS
     char *key;
     gpointer table_key, value;
 #endif
 
 #ifdef DEBUG_START_STOP
-    g_message ("stopping %s in %p", job, directory->details->location);
+    g_message ("stopping %s in %p", async_job_names[job], directory->details->location);
 #endif
 
+    pool = async_job_get_pool (directory);
+
     g_assert (async_job_count > 0);
+    g_assert (async_job_class_count[job] > 0);
+    g_assert (async_job_pool_count[pool] > 0);
 
 #ifdef DEBUG_ASYNC_JOBS
     {
         char *uri;
         uri = nautilus_directory_get_uri (directory);
         g_assert (async_jobs != NULL);
-        key = g_strconcat (uri, ": ", job, NULL);
+        key = g_strconcat (uri, ": ", async_job_names[job], NULL);
         if (!g_hash_table_lookup_extended (async_jobs, key, &table_key, &value))
         {
             g_warning ("ending job we didn't start: %s in %s",
-                       job, uri);
+                       async_job_names[job], uri);
         }
         else
         {
@@ -457,45 +921,35 @@ async_job_end (NautilusDirectory *directory,
 #endif
 
     async_job_count -= 1;
+    async_job_class_count[job] -= 1;
+    async_job_pool_count[pool] -= 1;
+    async_job_stats.running_jobs[pool] = async_job_pool_count[pool];
 }
 
-/* Helper to get one value from a hash table. */
 static void
-get_one_value_callback (gpointer key,
-                        gpointer value,
-                        gpointer callback_data)
+async_job_wake_up_directory (NautilusDirectory *directory)
 {
-    gpointer *returned_value;
+    async_job_stop_waiting (directory, TRUE);
 
-    returned_value = callback_data;
-    *returned_value = value;
-}
-
-/* return a single value from a hash table. */
-static gpointer
-get_one_value (GHashTable *table)
-{
-    gpointer value;
-
-    value = NULL;
-    if (table != NULL)
-    {
-        g_hash_table_foreach (table, get_one_value_callback, &value);
-    }
-    return value;
+    woken_directory = directory;
+    nautilus_directory_async_state_changed (directory);
+    woken_directory = NULL;
 }
 
 /* Wake up directories that are "blocked" as long as there are job
- * slots available.
+ * slots available. The foreground directory goes first, the others
+ * take turns in the order they started waiting.
  */
 static void
 async_job_wake_up (void)
 {
     static gboolean already_waking_up = FALSE;
-    gpointer value;
+    AsyncJobWaiter *waiter;
+    GList *node;
+    guint n_waiters;
+    int job_count_before;
 
     g_assert (async_job_count >= 0);
-    g_assert (async_job_count <= MAX_ASYNC_JOBS);
 
     if (already_waking_up)
     {
@@ -503,79 +957,274 @@ async_job_wake_up (void)
     }
 
     already_waking_up = TRUE;
-    while (async_job_count < MAX_ASYNC_JOBS)
+
+    for (node = waiting_queue.head; node != NULL; node = node->next)
     {
-        value = get_one_value (waiting_directories);
-        if (value == NULL)
+        waiter = node->data;
+        if (async_job_is_foreground (waiter->directory))
         {
+            if (async_job_waiter_can_run (waiter))
+            {
+                async_job_wake_up_directory (waiter->directory);
+            }
             break;
         }
-        g_hash_table_remove (waiting_directories, value);
-        nautilus_directory_async_state_changed
-            (NAUTILUS_DIRECTORY (value));
     }
-    already_waking_up = FALSE;
-}
 
-static void
-directory_count_cancel (NautilusDirectory *directory)
-{
-    if (directory->details->count_in_progress != NULL)
+    /* A woken directory that still can't start everything it wants
+     * queues up again at the tail, so every pass visits each waiter at
+     * most once. Keep going as long as a pass got some job started.
+     */
+    do
     {
-        g_cancellable_cancel (directory->details->count_in_progress->cancellable);
-        directory->details->count_in_progress = NULL;
+        job_count_before = async_job_count;
+        n_waiters = waiting_queue.length;
+        while (n_waiters-- > 0 && !g_queue_is_empty (&waiting_queue))
+        {
+            waiter = g_queue_pop_head (&waiting_queue);
+            if (!async_job_waiter_can_run (waiter))
+            {
+                g_queue_push_tail (&waiting_queue, waiter);
+                continue;
+            }
+
+            /* Put it back so async_job_stop_waiting() finds it. */
+            g_queue_push_head (&waiting_queue, waiter);
+            async_job_wake_up_directory (waiter->directory);
+        }
     }
+    while (async_job_count > job_count_before &&
+           !g_queue_is_empty (&waiting_queue));
+
+    already_waking_up = FALSE;
 }
 
-static void
-deep_count_cancel (NautilusDirectory *directory)
+void
+nautilus_directory_set_foreground_location (GFile *location)
 {
-    if (directory->details->deep_count_in_progress != NULL)
-    {
-        g_assert (NAUTILUS_IS_FILE (directory->details->deep_count_file));
+    NautilusDirectory *directory;
 
-        g_cancellable_cancel (directory->details->deep_count_in_progress->cancellable);
+    if (foreground_location == location ||
+        (foreground_location != NULL && location != NULL &&
+         g_file_equal (foreground_location, location)))
+    {
+        return;
+    }
 
-        directory->details->deep_count_file->details->deep_counts_status = NAUTILUS_REQUEST_NOT_STARTED;
+    directory = foreground_location != NULL ?
+                nautilus_directory_get_existing (foreground_location) : NULL;
 
-        directory->details->deep_count_in_progress->directory = NULL;
-        directory->details->deep_count_in_progress = NULL;
-        directory->details->deep_count_file = NULL;
+    g_clear_object (&foreground_location);
+    if (location != NULL)
+    {
+        foreground_location = g_object_ref (location);
+    }
 
-        async_job_end (directory, "deep count");
+    /* Directories give up their monitors in the background, and get
+     * them back in the foreground.
+     */
+    if (directory != NULL)
+    {
+        update_directory_monitor (directory);
+        nautilus_directory_unref (directory);
+    }
+    directory = location != NULL ? nautilus_directory_get_existing (location) : NULL;
+    if (directory != NULL)
+    {
+        update_directory_monitor (directory);
+        nautilus_directory_unref (directory);
     }
+
+    /* The new foreground directory may now use the reserved slots. */
+    async_job_wake_up ();
 }
 
-static void
-mime_list_cancel (NautilusDirectory *directory)
+static gboolean
+prefetch_yield_callback (gpointer callback_data)
 {
-    if (directory->details->mime_list_in_progress != NULL)
+    NautilusDirectory *directory;
+    GList *node;
+
+    prefetch_yield_idle_id = 0;
+
+    for (node = prefetched_directories.head; node != NULL; node = node->next)
     {
-        g_cancellable_cancel (directory->details->mime_list_in_progress->cancellable);
+        directory = node->data;
+        if (!async_job_is_prefetch (directory) ||
+            (directory->details->directory_load_in_progress == NULL &&
+             directory->details->get_info_in_progress == NULL))
+        {
+            continue;
+        }
+
+        file_list_cancel (directory);
+        file_info_cancel (directory);
+
+        /* Load it again once there is room to spare. */
+        async_job_wait (directory, ASYNC_JOB_FILE_LIST);
     }
+
+    async_job_wake_up ();
+
+    return G_SOURCE_REMOVE;
 }
 
+/* Real work had to wait for a job slot. Get the prefetches out of
+ * its way. This is done from an idle since it can come up in the
+ * middle of starting I/O for another directory.
+ */
 static void
-link_info_cancel (NautilusDirectory *directory)
+prefetch_yield (void)
 {
-    if (directory->details->link_info_read_state != NULL)
+    if (prefetch_yield_idle_id == 0 &&
+        !g_queue_is_empty (&prefetched_directories))
     {
-        g_cancellable_cancel (directory->details->link_info_read_state->cancellable);
-        directory->details->link_info_read_state->directory = NULL;
-        directory->details->link_info_read_state = NULL;
-        async_job_end (directory, "link info");
+        prefetch_yield_idle_id = g_idle_add_full (G_PRIORITY_HIGH,
+                                                  prefetch_yield_callback,
+                                                  NULL, NULL);
     }
 }
 
+void
+nautilus_directory_prefetch (NautilusDirectory *directory)
+{
+    GList *node;
+
+    g_return_if_fail (NAUTILUS_IS_DIRECTORY (directory));
+
+    /* Remote locations have no spare job slots anyway, and searches
+     * are not worth running on speculation.
+     */
+    if (!nautilus_directory_is_local (directory))
+    {
+        return;
+    }
+
+    node = g_queue_find (&prefetched_directories, directory);
+    if (node != NULL)
+    {
+        g_queue_unlink (&prefetched_directories, node);
+        g_queue_push_head_link (&prefetched_directories, node);
+        return;
+    }
+
+    g_queue_push_head (&prefetched_directories,
+                       nautilus_directory_ref (directory));
+    nautilus_directory_file_monitor_add (directory,
+                                         &prefetched_directories,
+                                         TRUE,
+                                         NAUTILUS_FILE_ATTRIBUTE_INFO,
+                                         NULL, NULL);
+
+    while (prefetched_directories.length > MAX_PREFETCHED_DIRECTORIES)
+    {
+        directory = g_queue_pop_tail (&prefetched_directories);
+        nautilus_directory_file_monitor_remove (directory, &prefetched_directories);
+        nautilus_directory_unref (directory);
+    }
+}
+
+void
+nautilus_directory_get_async_job_stats (NautilusAsyncJobStats *stats)
+{
+    g_return_if_fail (stats != NULL);
+
+    *stats = async_job_stats;
+}
+
+static void
+directory_summary_cancel_state (NautilusDirectory     *directory,
+                                DirectorySummaryState *state)
+{
+    GList *node;
+    DirectorySummaryItem *item;
+
+    for (node = state->items; node != NULL; node = node->next)
+    {
+        item = node->data;
+        item->file = NULL;
+    }
+
+    /* The callback notices the cancellation and ends the job. */
+    g_cancellable_cancel (state->cancellable);
+    directory->details->summary_in_progress =
+        g_list_remove (directory->details->summary_in_progress, state);
+
+    /* A batch still being gathered has to run to get there. */
+    if (directory->details->summary_batch == state)
+    {
+        directory_summary_flush (directory);
+    }
+}
+
+static void
+directory_summary_cancel (NautilusDirectory *directory)
+{
+    while (directory->details->summary_in_progress != NULL)
+    {
+        directory_summary_cancel_state (directory,
+                                        directory->details->summary_in_progress->data);
+    }
+}
+
+static void
+deep_count_cancel (NautilusDirectory *directory)
+{
+    if (directory->details->deep_count_in_progress != NULL)
+    {
+        g_assert (NAUTILUS_IS_FILE (directory->details->deep_count_file));
+
+        nautilus_deep_count_cancel (directory->details->deep_count_in_progress->count);
+        g_free (directory->details->deep_count_in_progress);
+
+        directory->details->deep_count_file->details->deep_counts_status = NAUTILUS_REQUEST_NOT_STARTED;
+
+        directory->details->deep_count_in_progress = NULL;
+        directory->details->deep_count_file = NULL;
+
+        async_job_end (directory, ASYNC_JOB_DEEP_COUNT);
+    }
+}
+
+static void
+link_info_cancel_state (NautilusDirectory *directory,
+                        LinkInfoReadState *state)
+{
+    g_cancellable_cancel (state->cancellable);
+    state->directory = NULL;
+    directory->details->link_info_read_states =
+        g_list_remove (directory->details->link_info_read_states, state);
+    async_job_end (directory, ASYNC_JOB_LINK_INFO);
+}
+
+static void
+link_info_cancel (NautilusDirectory *directory)
+{
+    while (directory->details->link_info_read_states != NULL)
+    {
+        link_info_cancel_state (directory,
+                                directory->details->link_info_read_states->data);
+    }
+}
+
+static void
+thumbnail_cancel_state (NautilusDirectory *directory,
+                        ThumbnailState    *state)
+{
+    g_cancellable_cancel (state->cancellable);
+    state->directory = NULL;
+    directory->details->thumbnail_states =
+        g_list_remove (directory->details->thumbnail_states, state);
+    async_job_end (directory, ASYNC_JOB_THUMBNAIL);
+}
+
 static void
 thumbnail_cancel (NautilusDirectory *directory)
 {
-    if (directory->details->thumbnail_state != NULL)
+    while (directory->details->thumbnail_states != NULL)
     {
-        g_cancellable_cancel (directory->details->thumbnail_state->cancellable);
-        directory->details->thumbnail_state->directory = NULL;
-        directory->details->thumbnail_state = NULL;
-        async_job_end (directory, "thumbnail");
+        thumbnail_cancel_state (directory,
+                                directory->details->thumbnail_states->data);
     }
 }
 
@@ -587,21 +1236,29 @@ mount_cancel (NautilusDirectory *directory)
         g_cancellable_cancel (directory->details->mount_state->cancellable);
         directory->details->mount_state->directory = NULL;
         directory->details->mount_state = NULL;
-        async_job_end (directory, "mount");
+        async_job_end (directory, ASYNC_JOB_MOUNT);
     }
 }
 
+static void
+file_info_cancel_state (NautilusDirectory *directory,
+                        GetInfoState      *state)
+{
+    g_cancellable_cancel (state->cancellable);
+    state->directory = NULL;
+    state->file = NULL;
+    directory->details->get_info_in_progress =
+        g_list_remove (directory->details->get_info_in_progress, state);
+    async_job_end (directory, ASYNC_JOB_FILE_INFO);
+}
+
 static void
 file_info_cancel (NautilusDirectory *directory)
 {
-    if (directory->details->get_info_in_progress != NULL)
+    while (directory->details->get_info_in_progress != NULL)
     {
-        g_cancellable_cancel (directory->details->get_info_in_progress->cancellable);
-        directory->details->get_info_in_progress->directory = NULL;
-        directory->details->get_info_in_progress = NULL;
-        directory->details->get_info_file = NULL;
-
-        async_job_end (directory, "file info");
+        file_info_cancel_state (directory,
+                                directory->details->get_info_in_progress->data);
     }
 }
 
@@ -769,6 +1426,227 @@ mime_db_changed_callback (GObject           *ignore,
     nautilus_directory_force_reload_internal (dir, attrs);
 }
 
+void
+nautilus_directory_set_background_monitor_client (gconstpointer client)
+{
+    background_monitor_client = client;
+}
+
+static gboolean
+directory_monitor_is_background (NautilusDirectory *directory)
+{
+    GList *node;
+    Monitor *monitor;
+
+    if (async_job_is_foreground (directory))
+    {
+        return FALSE;
+    }
+
+    for (node = directory->details->monitor_list; node != NULL; node = node->next)
+    {
+        monitor = node->data;
+        if (monitor->client != background_monitor_client &&
+            monitor->client != &prefetched_directories)
+        {
+            return FALSE;
+        }
+    }
+
+    return TRUE;
+}
+
+static void
+directory_monitor_cancel (NautilusDirectory *directory)
+{
+    if (directory->details->revalidate_cancellable != NULL)
+    {
+        g_cancellable_cancel (directory->details->revalidate_cancellable);
+        g_clear_object (&directory->details->revalidate_cancellable);
+    }
+
+    if (directory->details->monitor != NULL)
+    {
+        nautilus_monitor_cancel (directory->details->monitor);
+        directory->details->monitor = NULL;
+        g_queue_delete_link (&monitored_directories, directory->details->monitor_link);
+        directory->details->monitor_link = NULL;
+    }
+
+    directory->details->monitor_suspended = FALSE;
+}
+
+/* Gives up the monitor of a directory that is still in use. */
+static void
+directory_monitor_suspend (NautilusDirectory *directory)
+{
+    gint64 suspended_time;
+
+    /* A check that did not get to finish still has to look back to
+     * when the monitor was given up the first time.
+     */
+    suspended_time = directory->details->revalidate_cancellable != NULL ?
+                     directory->details->monitor_suspended_time :
+                     g_get_real_time ();
+
+    directory_monitor_cancel (directory);
+
+    directory->details->monitor_suspended = TRUE;
+    directory->details->monitor_suspended_time = suspended_time;
+}
+
+static gboolean
+directory_changed_since (GFileInfo *info,
+                         gint64     time)
+{
+    gint64 modified, changed;
+
+    if (!g_file_info_has_attribute (info, G_FILE_ATTRIBUTE_TIME_MODIFIED))
+    {
+        return TRUE;
+    }
+
+    modified = g_file_info_get_attribute_uint64 (info, G_FILE_ATTRIBUTE_TIME_MODIFIED) * G_USEC_PER_SEC +
+               g_file_info_get_attribute_uint32 (info, G_FILE_ATTRIBUTE_TIME_MODIFIED_USEC);
+    changed = g_file_info_get_attribute_uint64 (info, G_FILE_ATTRIBUTE_TIME_CHANGED) * G_USEC_PER_SEC +
+              g_file_info_get_attribute_uint32 (info, G_FILE_ATTRIBUTE_TIME_CHANGED_USEC);
+
+    return MAX (modified, changed) >= time - DIRECTORY_REVALIDATE_TIME_SLACK;
+}
+
+static void
+directory_revalidate_callback (GObject      *source_object,
+                               GAsyncResult *res,
+                               gpointer      user_data)
+{
+    NautilusDirectory *directory;
+    GFileInfo *info;
+    GError *error;
+
+    directory = NAUTILUS_DIRECTORY (user_data);
+
+    error = NULL;
+    info = g_file_query_info_finish (G_FILE (source_object), res, &error);
+    if (g_error_matches (error, G_IO_ERROR, G_IO_ERROR_CANCELLED))
+    {
+        g_error_free (error);
+        nautilus_directory_unref (directory);
+        return;
+    }
+
+    g_clear_object (&directory->details->revalidate_cancellable);
+
+    /* Files may have come and gone while nobody was watching. */
+    if (info == NULL ||
+        directory_changed_since (info, directory->details->monitor_suspended_time))
+    {
+        nautilus_directory_force_reload_internal (directory, 0);
+    }
+
+    g_clear_error (&error);
+    g_clear_object (&info);
+    nautilus_directory_unref (directory);
+}
+
+/* Checks whether a directory changed while it had no monitor. Adding
+ * or removing files changes the directory itself, so looking at its
+ * times is enough to know the file list is still right.
+ */
+static void
+directory_revalidate (NautilusDirectory *directory,
+                      gint64             suspended_time)
+{
+    /* The clocks of other machines can't be trusted. */
+    if (!g_file_is_native (directory->details->location))
+    {
+        nautilus_directory_force_reload_internal (directory, 0);
+        return;
+    }
+
+    directory->details->monitor_suspended_time = suspended_time;
+    directory->details->revalidate_cancellable = g_cancellable_new ();
+    g_file_query_info_async (directory->details->location,
+                             DIRECTORY_REVALIDATE_ATTRIBUTES,
+                             0,
+                             G_PRIORITY_DEFAULT,
+                             directory->details->revalidate_cancellable,
+                             directory_revalidate_callback,
+                             nautilus_directory_ref (directory));
+}
+
+static void
+directory_monitor_start (NautilusDirectory *directory)
+{
+    NautilusDirectory *other;
+    GList *node, *prev;
+    gboolean suspended;
+    gint64 suspended_time;
+
+    suspended = directory->details->monitor_suspended;
+    suspended_time = directory->details->monitor_suspended_time;
+    directory_monitor_cancel (directory);
+
+    directory->details->monitor = nautilus_monitor_directory (directory->details->location);
+    g_queue_push_head (&monitored_directories, directory);
+    directory->details->monitor_link = monitored_directories.head;
+
+    if (suspended)
+    {
+        directory_revalidate (directory, suspended_time);
+    }
+
+    /* Make room by taking the monitors of the directories that were
+     * used least recently.
+     */
+    for (node = monitored_directories.tail;
+         node != NULL && monitored_directories.length > MAX_DIRECTORY_MONITORS;
+         node = prev)
+    {
+        prev = node->prev;
+        other = node->data;
+        if (other != directory && !async_job_is_foreground (other))
+        {
+            directory_monitor_suspend (other);
+        }
+    }
+}
+
+/* Starts, keeps or drops the monitor of a directory, depending on who
+ * is monitoring it.
+ */
+static void
+update_directory_monitor (NautilusDirectory *directory)
+{
+    if (directory->details->monitor_list == NULL)
+    {
+        directory_monitor_cancel (directory);
+    }
+    else if (directory_monitor_is_background (directory))
+    {
+        if (directory->details->monitor != NULL)
+        {
+            directory_monitor_suspend (directory);
+        }
+        else if (!directory->details->monitor_suspended)
+        {
+            /* Loading without a monitor misses changes just the same,
+             * so check the directory once it gets a monitor.
+             */
+            directory->details->monitor_suspended = TRUE;
+            directory->details->monitor_suspended_time = g_get_real_time ();
+        }
+    }
+    else if (directory->details->monitor == NULL)
+    {
+        directory_monitor_start (directory);
+    }
+    else
+    {
+        g_queue_unlink (&monitored_directories, directory->details->monitor_link);
+        g_queue_push_head_link (&monitored_directories, directory->details->monitor_link);
+    }
+}
+
 void
 nautilus_directory_monitor_add_internal (NautilusDirectory         *directory,
                                          NautilusFile              *file,
@@ -828,11 +1706,7 @@ nautilus_directory_monitor_add_internal (NautilusDirectory         *directory,
      * nautilus almost always shows the whole directory anyway, and
      * it allows us to avoid one file monitor per file in a directory.
      */
-    if (directory->details->monitor == NULL)
-    {
-        directory->details->monitor = nautilus_monitor_directory (directory->details->location);
-    }
-
+    update_directory_monitor (directory);
 
     if (REQUEST_WANTS_TYPE (monitor->request, REQUEST_FILE_INFO) &&
         directory->details->mime_db_monitor == 0)
@@ -858,6 +1732,13 @@ nautilus_directory_monitor_add_internal (NautilusDirectory         *directory,
     nautilus_profile_end (NULL);
 }
 
+static gboolean
+file_is_unconfirmed (NautilusFile *file)
+{
+    return file->details->load_generation !=
+           file->details->directory->details->load_generation;
+}
+
 static void
 set_file_unconfirmed (NautilusFile *file,
                       gboolean      unconfirmed)
@@ -867,19 +1748,20 @@ set_file_unconfirmed (NautilusFile *file,
     g_assert (NAUTILUS_IS_FILE (file));
     g_assert (unconfirmed == FALSE || unconfirmed == TRUE);
 
-    if (file->details->unconfirmed == unconfirmed)
+    if (file_is_unconfirmed (file) == unconfirmed)
     {
         return;
     }
-    file->details->unconfirmed = unconfirmed;
 
     directory = file->details->directory;
     if (unconfirmed)
     {
+        file->details->load_generation = directory->details->load_generation - 1;
         directory->details->confirmed_file_count--;
     }
     else
     {
+        file->details->load_generation = directory->details->load_generation;
         directory->details->confirmed_file_count++;
     }
 }
@@ -893,8 +1775,7 @@ show_hidden_files_changed_callback (gpointer callback_data)
 }
 
 static gboolean
-should_skip_file (NautilusDirectory *directory,
-                  GFileInfo         *info)
+should_skip_hidden (gboolean is_hidden)
 {
     static gboolean show_hidden_files_changed_callback_installed = FALSE;
 
@@ -912,126 +1793,249 @@ should_skip_file (NautilusDirectory *directory,
         show_hidden_files_changed_callback (NULL);
     }
 
-    if (!show_hidden_files &&
-        (g_file_info_get_is_hidden (info) ||
-         g_file_info_get_is_backup (info)))
-    {
-        return TRUE;
-    }
-
-    return FALSE;
+    return !show_hidden_files && is_hidden;
 }
 
 static gboolean
-dequeue_pending_idle_callback (gpointer callback_data)
+should_skip_file (NautilusDirectory *directory,
+                  GFileInfo         *info)
 {
-    NautilusDirectory *directory;
-    GList *pending_file_info;
-    GList *node, *next;
-    NautilusFile *file;
-    GList *changed_files, *added_files;
-    GFileInfo *file_info;
-    const char *mimetype, *name;
-    DirectoryLoadState *dir_load_state;
-
-    directory = NAUTILUS_DIRECTORY (callback_data);
-
-    nautilus_directory_ref (directory);
-
-    nautilus_profile_start ("nitems %d", g_list_length (directory->details->pending_file_info));
-
-    directory->details->dequeue_pending_idle_id = 0;
+    return should_skip_hidden (g_file_info_get_is_hidden (info) ||
+                               g_file_info_get_is_backup (info));
+}
 
-    /* Handle the files in the order we saw them. */
-    pending_file_info = g_list_reverse (directory->details->pending_file_info);
-    directory->details->pending_file_info = NULL;
+static gboolean
+should_skip_local_entry (NautilusLocalEntry *entry)
+{
+    return should_skip_hidden (entry->is_hidden || entry->is_backup);
+}
 
-    /* If we are no longer monitoring, then throw away these. */
-    if (!nautilus_directory_is_file_list_monitored (directory))
+static void
+prepared_file_free (PreparedFile *prepared)
+{
+    if (prepared->file != NULL)
     {
-        nautilus_directory_async_state_changed (directory);
-        goto drain;
+        nautilus_file_discard_detached (prepared->file);
     }
-
-    added_files = NULL;
-    changed_files = NULL;
-
-    dir_load_state = directory->details->directory_load_in_progress;
-
-    /* Build a list of NautilusFile objects. */
-    for (node = pending_file_info; node != NULL; node = node->next)
+    if (prepared->info != NULL)
     {
-        file_info = node->data;
+        g_object_unref (prepared->info);
+    }
+    if (prepared->entry != NULL)
+    {
+        nautilus_local_entry_free (prepared->entry);
+    }
+    g_free (prepared);
+}
 
-        name = g_file_info_get_name (file_info);
+/* Turn one pending file into a NautilusFile, adding it to the list of
+ * added or changed files. It comes either as a GFileInfo or as an
+ * entry from the local enumerator. If *prepared is set, it is the
+ * file built off the main thread; it is taken over if the directory
+ * doesn't have a file of that name yet.
+ */
+static void
+dequeue_pending_file (NautilusDirectory   *directory,
+                      GFileInfo           *file_info,
+                      NautilusLocalEntry  *entry,
+                      NautilusFile       **prepared,
+                      gboolean             from_cache,
+                      GList              **added_files,
+                      GList              **changed_files)
+{
+    NautilusFile *file;
+    const char *name;
 
-        /* Update the file count. */
-        /* FIXME bugzilla.gnome.org 45063: This could count a
-         * file twice if we get it from both load_directory
-         * and from new_files_callback. Not too hard to fix by
-         * moving this into the actual callback instead of
-         * waiting for the idle function.
-         */
-        if (dir_load_state &&
-            !should_skip_file (directory, file_info))
+    if (entry != NULL && entry->metadata_only)
+    {
+        file = nautilus_directory_find_file_by_name (directory, entry->name);
+        if (file != NULL &&
+            nautilus_file_update_metadata_from_info (file, entry->metadata_info))
         {
-            dir_load_state->load_file_count += 1;
-
-            /* Add the MIME type to the set. */
-            mimetype = g_file_info_get_content_type (file_info);
-            if (mimetype != NULL)
-            {
-                istr_set_insert (dir_load_state->load_mime_list_hash,
-                                 mimetype);
-            }
+            nautilus_file_ref (file);
+            *changed_files = g_list_prepend (*changed_files, file);
         }
+        return;
+    }
 
-        /* check if the file already exists */
-        file = nautilus_directory_find_file_by_name (directory, name);
-        if (file != NULL)
+    name = file_info != NULL ? g_file_info_get_name (file_info) : entry->name;
+
+    /* check if the file already exists */
+    file = nautilus_directory_find_file_by_name (directory, name);
+    if (file != NULL && from_cache)
+    {
+        /* Whatever we have is newer than the cache. */
+        return;
+    }
+    else if (file != NULL)
+    {
+        /* file already exists in dir, check if we still need to
+         *  emit file_added or if it changed */
+        set_file_unconfirmed (file, FALSE);
+        file->details->is_from_listing_cache = FALSE;
+        if (!file->details->is_added)
         {
-            /* file already exists in dir, check if we still need to
-             *  emit file_added or if it changed */
-            set_file_unconfirmed (file, FALSE);
-            if (!file->details->is_added)
-            {
-                /* We consider this newly added even if its in the list.
-                 * This can happen if someone called nautilus_file_get_by_uri()
-                 * on a file in the folder before the add signal was
-                 * emitted */
-                nautilus_file_ref (file);
-                file->details->is_added = TRUE;
-                added_files = g_list_prepend (added_files, file);
-            }
-            else if (nautilus_file_update_info (file, file_info))
-            {
-                /* File changed, notify about the change. */
-                nautilus_file_ref (file);
-                changed_files = g_list_prepend (changed_files, file);
-            }
+            /* We consider this newly added even if its in the list.
+             * This can happen if someone called nautilus_file_get_by_uri()
+             * on a file in the folder before the add signal was
+             * emitted */
+            nautilus_file_ref (file);
+            file->details->is_added = TRUE;
+            *added_files = g_list_prepend (*added_files, file);
+        }
+        else if (file_info != NULL ?
+                 nautilus_file_update_info (file, file_info) :
+                 nautilus_file_update_from_local_entry (file, entry))
+        {
+            /* File changed, notify about the change. */
+            nautilus_file_ref (file);
+            *changed_files = g_list_prepend (*changed_files, file);
+        }
+    }
+    else
+    {
+        /* new file, create a nautilus file object and add it to the list */
+        if (*prepared != NULL)
+        {
+            file = *prepared;
+            *prepared = NULL;
+            nautilus_file_attach_detached (file);
         }
         else
         {
-            /* new file, create a nautilus file object and add it to the list */
             file = nautilus_file_new_from_info (directory, file_info);
-            nautilus_directory_add_file (directory, file);
-            file->details->is_added = TRUE;
-            added_files = g_list_prepend (added_files, file);
         }
+        nautilus_directory_add_file (directory, file);
+        file->details->is_added = TRUE;
+        *added_files = g_list_prepend (*added_files, file);
+
+        if (from_cache)
+        {
+            set_file_unconfirmed (file, TRUE);
+            file->details->is_from_listing_cache = TRUE;
+        }
+    }
+}
+
+/* Drops the files from the listing cache that wait to be added. */
+static void
+free_pending_cached_files (NautilusDirectory *directory)
+{
+    GList *node, *next;
+    PreparedFile *prepared;
+
+    for (node = directory->details->pending_prepared_files->head;
+         node != NULL; node = next)
+    {
+        next = node->next;
+        prepared = node->data;
+
+        if (prepared->from_cache)
+        {
+            g_queue_delete_link (directory->details->pending_prepared_files, node);
+            prepared_file_free (prepared);
+        }
+    }
+}
+
+static void
+free_pending_files (NautilusDirectory *directory)
+{
+    g_queue_foreach (directory->details->pending_file_info,
+                     (GFunc) g_object_unref, NULL);
+    g_queue_clear (directory->details->pending_file_info);
+    g_queue_foreach (directory->details->pending_prepared_files,
+                     (GFunc) prepared_file_free, NULL);
+    g_queue_clear (directory->details->pending_prepared_files);
+}
+
+static gboolean
+has_pending_files (NautilusDirectory *directory)
+{
+    return !g_queue_is_empty (directory->details->pending_file_info) ||
+           !g_queue_is_empty (directory->details->pending_prepared_files);
+}
+
+static gboolean
+dequeue_pending_idle_callback (gpointer callback_data)
+{
+    NautilusDirectory *directory;
+    GList *node, *next;
+    NautilusFile *file;
+    GFileInfo *info;
+    PreparedFile *prepared;
+    GList *changed_files, *added_files;
+    gint64 deadline;
+
+    directory = NAUTILUS_DIRECTORY (callback_data);
+
+    nautilus_directory_ref (directory);
+
+    nautilus_profile_start ("nitems %d", directory->details->pending_file_info->length +
+                            directory->details->pending_prepared_files->length);
+
+    directory->details->dequeue_pending_idle_id = 0;
+
+    /* If we are no longer monitoring, then throw away these. */
+    if (!nautilus_directory_is_file_list_monitored (directory))
+    {
+        free_pending_files (directory);
+        goto done;
     }
 
-    /* If we are done loading, then we assume that any unconfirmed
-     * files are gone.
+    added_files = NULL;
+    changed_files = NULL;
+
+    /* Build a list of NautilusFile objects, handling the files in the
+     * order we saw them. Stop once the time is up and come back for
+     * the rest later.
      */
-    if (directory->details->directory_loaded)
+    deadline = g_get_monotonic_time () + DEQUEUE_PENDING_TIME_BUDGET;
+    while (has_pending_files (directory))
+    {
+        if (!g_queue_is_empty (directory->details->pending_prepared_files))
+        {
+            prepared = g_queue_pop_head (directory->details->pending_prepared_files);
+            dequeue_pending_file (directory,
+                                  prepared->info, prepared->entry, &prepared->file,
+                                  prepared->from_cache,
+                                  &added_files, &changed_files);
+            prepared_file_free (prepared);
+        }
+        else
+        {
+            info = g_queue_pop_head (directory->details->pending_file_info);
+            file = NULL;
+            dequeue_pending_file (directory,
+                                  info, NULL, &file, FALSE,
+                                  &added_files, &changed_files);
+            g_object_unref (info);
+        }
+
+        if (g_get_monotonic_time () >= deadline)
+        {
+            break;
+        }
+    }
+
+    if (has_pending_files (directory))
+    {
+        nautilus_directory_schedule_dequeue_pending (directory);
+    }
+    else if (directory->details->directory_loaded &&
+             directory->details->confirmed_file_count <
+             (int) g_hash_table_size (directory->details->file_hash))
     {
+        /* If we are done loading, then we assume that any unconfirmed
+         * files are gone. Only look for them if there are any.
+         */
         for (node = directory->details->file_list;
              node != NULL; node = next)
         {
             file = NAUTILUS_FILE (node->data);
             next = node->next;
 
-            if (file->details->unconfirmed)
+            if (file_is_unconfirmed (file))
             {
                 nautilus_file_ref (file);
                 changed_files = g_list_prepend (changed_files, file);
@@ -1048,36 +2052,25 @@ dequeue_pending_idle_callback (gpointer callback_data)
     nautilus_file_list_free (added_files);
 
     if (directory->details->directory_loaded &&
-        !directory->details->directory_loaded_sent_notification)
+        !directory->details->directory_loaded_sent_notification &&
+        !has_pending_files (directory))
     {
-        /* Send the done_loading signal. */
-        nautilus_directory_emit_done_loading (directory);
-
-        if (dir_load_state)
+        if (directory->details->save_listing_cache)
         {
-            file = dir_load_state->load_directory_file;
-
-            file->details->directory_count = dir_load_state->load_file_count;
-            file->details->directory_count_is_up_to_date = TRUE;
-            file->details->got_directory_count = TRUE;
-
-            file->details->got_mime_list = TRUE;
-            file->details->mime_list_is_up_to_date = TRUE;
-            g_list_free_full (file->details->mime_list, g_free);
-            file->details->mime_list = istr_set_get_as_list
-                                           (dir_load_state->load_mime_list_hash);
-
-            nautilus_file_changed (file);
+            nautilus_listing_cache_save (directory->details->location,
+                                         directory->details->file_list);
+            directory->details->save_listing_cache = FALSE;
         }
 
+        /* Send the done_loading signal. */
+        nautilus_directory_emit_done_loading (directory);
+
         nautilus_directory_async_state_changed (directory);
 
         directory->details->directory_loaded_sent_notification = TRUE;
     }
 
-drain:
-    g_list_free_full (pending_file_info, g_object_unref);
-
+done:
     /* Get the state machine running again. */
     nautilus_directory_async_state_changed (directory);
 
@@ -1097,13 +2090,13 @@ nautilus_directory_schedule_dequeue_pending (NautilusDirectory *directory)
     }
 }
 
-static void
-directory_load_one (NautilusDirectory *directory,
-                    GFileInfo         *info)
+static gboolean
+directory_load_info_is_valid (NautilusDirectory *directory,
+                              GFileInfo         *info)
 {
     if (info == NULL)
     {
-        return;
+        return FALSE;
     }
 
     if (g_file_info_get_name (info) == NULL)
@@ -1114,13 +2107,24 @@ directory_load_one (NautilusDirectory *directory,
         g_warning ("Got GFileInfo with NULL name in %s, ignoring. This shouldn't happen unless the gvfs backend is broken.\n", uri);
         g_free (uri);
 
+        return FALSE;
+    }
+
+    return TRUE;
+}
+
+static void
+directory_load_one (NautilusDirectory *directory,
+                    GFileInfo         *info)
+{
+    if (!directory_load_info_is_valid (directory, info))
+    {
         return;
     }
 
     /* Arrange for the "loading" part of the work. */
-    g_object_ref (info);
-    directory->details->pending_file_info
-        = g_list_prepend (directory->details->pending_file_info, info);
+    g_queue_push_tail (directory->details->pending_file_info,
+                       g_object_ref (info));
     nautilus_directory_schedule_dequeue_pending (directory);
 }
 
@@ -1143,7 +2147,7 @@ directory_load_cancel (NautilusDirectory *directory)
         g_cancellable_cancel (state->cancellable);
         state->directory = NULL;
         directory->details->directory_load_in_progress = NULL;
-        async_job_end (directory, "file list");
+        async_job_end (directory, ASYNC_JOB_FILE_LIST);
     }
 }
 
@@ -1158,11 +2162,7 @@ file_list_cancel (NautilusDirectory *directory)
         directory->details->dequeue_pending_idle_id = 0;
     }
 
-    if (directory->details->pending_file_info != NULL)
-    {
-        g_list_free_full (directory->details->pending_file_info, g_object_unref);
-        directory->details->pending_file_info = NULL;
-    }
+    free_pending_files (directory);
 }
 
 static void
@@ -1170,30 +2170,62 @@ directory_load_done (NautilusDirectory *directory,
                      GError            *error)
 {
     GList *node;
+    DirectoryLoadState *state;
+    NautilusFile *file;
 
     nautilus_profile_start (NULL);
     g_object_ref (directory);
 
     directory->details->directory_loaded = TRUE;
     directory->details->directory_loaded_sent_notification = FALSE;
+    directory->details->save_listing_cache = error == NULL &&
+                                             nautilus_listing_cache_is_enabled ();
 
     if (error != NULL)
     {
         /* The load did not complete successfully. This means
          * we don't know the status of the files in this directory.
-         * We clear the unconfirmed bit on each file here so that
+         * We confirm each file here so that
          * they won't be marked "gone" later -- we don't know enough
          * about them to know whether they are really gone.
+         * Files only known from the listing cache are left
+         * unconfirmed, so they go away with the load.
          */
         for (node = directory->details->file_list;
              node != NULL; node = node->next)
         {
-            set_file_unconfirmed (NAUTILUS_FILE (node->data), FALSE);
+            file = NAUTILUS_FILE (node->data);
+            if (!file->details->is_from_listing_cache)
+            {
+                set_file_unconfirmed (file, FALSE);
+            }
         }
+        free_pending_cached_files (directory);
 
         nautilus_directory_emit_load_error (directory, error);
     }
 
+    /* The files were counted as they came in, so the count and MIME
+     * list are complete even while some files still wait to be added.
+     */
+    state = directory->details->directory_load_in_progress;
+    if (state != NULL)
+    {
+        file = state->load_directory_file;
+
+        file->details->directory_count = state->load_file_count;
+        file->details->directory_count_is_up_to_date = TRUE;
+        file->details->got_directory_count = TRUE;
+
+        file->details->got_mime_list = TRUE;
+        file->details->mime_list_is_up_to_date = TRUE;
+        g_list_free_full (file->details->mime_list, g_free);
+        file->details->mime_list = istr_set_get_as_list
+                                       (state->load_mime_list_hash);
+
+        nautilus_file_changed (file);
+    }
+
     /* Call the idle function right away. */
     if (directory->details->dequeue_pending_idle_id != 0)
     {
@@ -1218,12 +2250,7 @@ nautilus_directory_monitor_remove_internal (NautilusDirectory *directory,
 
     remove_monitor (directory, file, client);
 
-    if (directory->details->monitor != NULL
-        && directory->details->monitor_list == NULL)
-    {
-        nautilus_monitor_cancel (directory->details->monitor);
-        directory->details->monitor = NULL;
-    }
+    update_directory_monitor (directory);
 
     /* XXX - do we need to remove anything from the work queue? */
 
@@ -1569,22 +2596,118 @@ nautilus_directory_cancel_callback_internal (NautilusDirectory         *director
 }
 
 static void
-new_files_state_unref (NewFilesState *state)
+new_files_state_free (NewFilesState *state)
+{
+    g_object_unref (state->cancellable);
+    g_object_unref (state->location);
+    g_list_free_full (state->locations, g_object_unref);
+    g_list_free_full (state->infos, g_object_unref);
+    g_free (state);
+}
+
+/* Reads the whole directory and keeps what is known about the new
+ * files. Returns FALSE if the directory could not be read.
+ */
+static gboolean
+new_files_rescan (NewFilesState *state)
+{
+    GFileEnumerator *enumerator;
+    GHashTable *names;
+    GFileInfo *info;
+    GList *l;
+
+    enumerator = g_file_enumerate_children (state->location,
+                                            NAUTILUS_FILE_DEFAULT_ATTRIBUTES,
+                                            0,
+                                            state->cancellable,
+                                            NULL);
+    if (enumerator == NULL)
+    {
+        return FALSE;
+    }
+
+    names = g_hash_table_new_full (g_str_hash, g_str_equal, g_free, NULL);
+    for (l = state->locations; l != NULL; l = l->next)
+    {
+        g_hash_table_add (names, g_file_get_basename (l->data));
+    }
+
+    while (g_hash_table_size (names) > 0 &&
+           (info = g_file_enumerator_next_file (enumerator, state->cancellable, NULL)) != NULL)
+    {
+        if (g_file_info_get_name (info) != NULL &&
+            g_hash_table_remove (names, g_file_info_get_name (info)))
+        {
+            state->infos = g_list_prepend (state->infos, info);
+        }
+        else
+        {
+            g_object_unref (info);
+        }
+    }
+
+    g_hash_table_destroy (names);
+    g_object_unref (enumerator);
+
+    return TRUE;
+}
+
+static gboolean
+new_files_are_children (NewFilesState *state)
 {
-    state->count--;
+    GList *l;
 
-    if (state->count == 0)
+    for (l = state->locations; l != NULL; l = l->next)
     {
-        if (state->directory)
+        if (!g_file_has_parent (l->data, state->location))
         {
-            state->directory->details->new_files_in_progress =
-                g_list_remove (state->directory->details->new_files_in_progress,
-                               state);
+            return FALSE;
         }
+    }
 
-        g_object_unref (state->cancellable);
-        g_free (state);
+    return TRUE;
+}
+
+static void
+new_files_thread (GTask        *task,
+                  gpointer      source_object,
+                  gpointer      task_data,
+                  GCancellable *cancellable)
+{
+    NewFilesState *state;
+    GFileInfo *info;
+    GList *l;
+
+    state = task_data;
+
+    if (state->n_locations >= NEW_FILES_RESCAN_THRESHOLD &&
+        state->n_locations * NEW_FILES_RESCAN_FRACTION >= state->n_files + state->n_locations &&
+        new_files_are_children (state) &&
+        new_files_rescan (state))
+    {
+        g_task_return_boolean (task, TRUE);
+        return;
+    }
+
+    for (l = state->locations; l != NULL; l = l->next)
+    {
+        if (g_cancellable_is_cancelled (state->cancellable))
+        {
+            break;
+        }
+
+        info = g_file_query_info (l->data,
+                                  NAUTILUS_FILE_DEFAULT_ATTRIBUTES,
+                                  0,
+                                  state->cancellable,
+                                  NULL);
+        if (info != NULL)
+        {
+            state->infos = g_list_prepend (state->infos, info);
+        }
     }
+
+    g_task_return_boolean (task, TRUE);
 }
 
 static void
@@ -1593,29 +2716,32 @@ new_files_callback (GObject      *source_object,
                     gpointer      user_data)
 {
     NautilusDirectory *directory;
-    GFileInfo *info;
     NewFilesState *state;
+    GList *l;
 
     state = user_data;
 
     if (state->directory == NULL)
     {
         /* Operation was cancelled. Bail out */
-        new_files_state_unref (state);
+        new_files_state_free (state);
         return;
     }
 
     directory = nautilus_directory_ref (state->directory);
+    directory->details->new_files_in_progress =
+        g_list_remove (directory->details->new_files_in_progress, state);
 
-    /* Queue up the new file. */
-    info = g_file_query_info_finish (G_FILE (source_object), res, NULL);
-    if (info != NULL)
+    /* Queue up the new files. They are all added in one go, unless
+     * there are too many to do that without blocking.
+     */
+    state->infos = g_list_reverse (state->infos);
+    for (l = state->infos; l != NULL; l = l->next)
     {
-        directory_load_one (directory, info);
-        g_object_unref (info);
+        directory_load_one (directory, l->data);
     }
 
-    new_files_state_unref (state);
+    new_files_state_free (state);
 
     nautilus_directory_unref (directory);
 }
@@ -1625,36 +2751,29 @@ nautilus_directory_get_info_for_new_files (NautilusDirectory *directory,
                                            GList             *location_list)
 {
     NewFilesState *state;
-    GFile *location;
-    GList *l;
+    GTask *task;
 
     if (location_list == NULL)
     {
         return;
     }
 
-    state = g_new (NewFilesState, 1);
+    state = g_new0 (NewFilesState, 1);
     state->directory = directory;
     state->cancellable = g_cancellable_new ();
-    state->count = 0;
-
-    for (l = location_list; l != NULL; l = l->next)
-    {
-        location = l->data;
-
-        state->count++;
-
-        g_file_query_info_async (location,
-                                 NAUTILUS_FILE_DEFAULT_ATTRIBUTES,
-                                 0,
-                                 G_PRIORITY_DEFAULT,
-                                 state->cancellable,
-                                 new_files_callback, state);
-    }
+    state->location = nautilus_directory_get_location (directory);
+    state->locations = g_list_copy_deep (location_list, (GCopyFunc) g_object_ref, NULL);
+    state->n_locations = g_list_length (state->locations);
+    state->n_files = g_hash_table_size (directory->details->file_hash);
 
     directory->details->new_files_in_progress
         = g_list_prepend (directory->details->new_files_in_progress,
                           state);
+
+    task = g_task_new (NULL, state->cancellable, new_files_callback, state);
+    g_task_set_task_data (task, state, NULL);
+    g_task_run_in_thread (task, new_files_thread);
+    g_object_unref (task);
 }
 
 void
@@ -1665,6 +2784,11 @@ nautilus_async_destroying_file (NautilusFile *file)
     GList *node, *next;
     ReadyCallback *callback;
     Monitor *monitor;
+    DirectorySummaryItem *summary_item;
+    GetInfoState *get_info_state;
+    LinkInfoReadState *link_info_state;
+    ThumbnailState *thumbnail_state;
+    FilesystemInfoState *filesystem_info_state;
 
     directory = file->details->directory;
     changed = FALSE;
@@ -1705,32 +2829,30 @@ nautilus_async_destroying_file (NautilusFile *file)
     /* Check if it's a file that's currently being worked on.
      * If so, make that NULL so it gets canceled right away.
      */
-    if (directory->details->count_in_progress != NULL &&
-        directory->details->count_in_progress->count_file == file)
+    summary_item = find_directory_summary_item (directory, file);
+    if (summary_item != NULL)
     {
-        directory->details->count_in_progress->count_file = NULL;
+        summary_item->file = NULL;
         changed = TRUE;
     }
     if (directory->details->deep_count_file == file)
     {
-        directory->details->deep_count_file = NULL;
-        changed = TRUE;
-    }
-    if (directory->details->mime_list_in_progress != NULL &&
-        directory->details->mime_list_in_progress->mime_list_file == file)
-    {
-        directory->details->mime_list_in_progress->mime_list_file = NULL;
+        /* The count runs on its own, so it has to be stopped rather
+         * than left to report to a file that is gone.
+         */
+        deep_count_cancel (directory);
         changed = TRUE;
     }
-    if (directory->details->get_info_file == file)
+    get_info_state = find_file_info_state (directory, file);
+    if (get_info_state != NULL)
     {
-        directory->details->get_info_file = NULL;
+        get_info_state->file = NULL;
         changed = TRUE;
     }
-    if (directory->details->link_info_read_state != NULL &&
-        directory->details->link_info_read_state->file == file)
+    link_info_state = find_link_info_state (directory, file);
+    if (link_info_state != NULL)
     {
-        directory->details->link_info_read_state->file = NULL;
+        link_info_state->file = NULL;
         changed = TRUE;
     }
     if (directory->details->extension_info_file == file)
@@ -1739,10 +2861,10 @@ nautilus_async_destroying_file (NautilusFile *file)
         changed = TRUE;
     }
 
-    if (directory->details->thumbnail_state != NULL &&
-        directory->details->thumbnail_state->file == file)
+    thumbnail_state = find_thumbnail_state (directory, file);
+    if (thumbnail_state != NULL)
     {
-        directory->details->thumbnail_state->file = NULL;
+        thumbnail_state->file = NULL;
         changed = TRUE;
     }
 
@@ -1753,10 +2875,10 @@ nautilus_async_destroying_file (NautilusFile *file)
         changed = TRUE;
     }
 
-    if (directory->details->filesystem_info_state != NULL &&
-        directory->details->filesystem_info_state->file == file)
+    filesystem_info_state = find_filesystem_info_state (directory, file);
+    if (filesystem_info_state != NULL)
     {
-        directory->details->filesystem_info_state->file = NULL;
+        filesystem_info_state->file = NULL;
         changed = TRUE;
     }
 
@@ -2119,17 +3241,14 @@ nautilus_directory_is_file_list_monitored (NautilusDirectory *directory)
     return directory->details->file_list_monitored;
 }
 
+/* Files stay unconfirmed until the load sees them, without having to
+ * touch each of them.
+ */
 static void
 mark_all_files_unconfirmed (NautilusDirectory *directory)
 {
-    GList *node;
-    NautilusFile *file;
-
-    for (node = directory->details->file_list; node != NULL; node = node->next)
-    {
-        file = node->data;
-        set_file_unconfirmed (file, TRUE);
-    }
+    directory->details->load_generation++;
+    directory->details->confirmed_file_count = 0;
 }
 
 static void
@@ -2145,6 +3264,21 @@ directory_load_state_free (DirectoryLoadState *state)
         g_object_unref (state->enumerator);
     }
 
+    if (state->local_enumerator != NULL)
+    {
+        g_list_free_full (state->unprepared, (GDestroyNotify) nautilus_local_entry_free);
+    }
+    else
+    {
+        g_list_free_full (state->unprepared, g_object_unref);
+    }
+    nautilus_local_enumerator_free (state->local_enumerator);
+
+    if (state->load_error != NULL)
+    {
+        g_error_free (state->load_error);
+    }
+
     if (state->load_mime_list_hash != NULL)
     {
         istr_set_destroy (state->load_mime_list_hash);
@@ -2154,29 +3288,271 @@ directory_load_state_free (DirectoryLoadState *state)
     g_free (state);
 }
 
-static void
-more_files_callback (GObject      *source_object,
-                     GAsyncResult *res,
-                     gpointer      user_data)
+/* The number of files to ask the enumerator for next. The batches grow
+ * for as long as the main loop keeps up with adding the files; if a
+ * backlog builds up, the size stays where it is.
+ */
+static int
+directory_load_next_batch_size (DirectoryLoadState *state)
 {
-    DirectoryLoadState *state;
-    NautilusDirectory *directory;
-    GError *error;
-    GList *files, *l;
-    GFileInfo *info;
-
-    state = user_data;
+    int size;
 
-    if (state->directory == NULL)
+    size = state->items_per_callback;
+    if (state->directory->details->pending_prepared_files->length < (guint) size)
     {
-        /* Operation was cancelled. Bail out */
-        directory_load_state_free (state);
-        return;
+        state->items_per_callback = MIN (size * 2, DIRECTORY_LOAD_MAX_ITEMS_PER_CALLBACK);
     }
 
-    directory = nautilus_directory_ref (state->directory);
+    return size;
+}
 
-    g_assert (directory->details->directory_load_in_progress != NULL);
+static void
+prepare_files_data_free (PrepareFilesData *data)
+{
+    nautilus_directory_unref (data->directory);
+    g_object_unref (data->location);
+    g_free (data);
+}
+
+/* Runs on a worker thread: builds the NautilusFile objects for a
+ * batch, so all that is left for the main thread is adding them to
+ * the directory.
+ */
+static void
+prepare_files_thread (GTask        *task,
+                      gpointer      source_object,
+                      gpointer      task_data,
+                      GCancellable *cancellable)
+{
+    PrepareFilesData *data;
+    PreparedFile *prepared;
+    GList *result, *cached, *l;
+    char *uri, *collation_key;
+
+    data = task_data;
+
+    /* The same for every file of the batch. */
+    uri = g_file_get_uri (data->location);
+    collation_key = g_utf8_collate_key_for_filename (uri, -1);
+    g_free (uri);
+
+    result = NULL;
+    if (data->read_listing_cache)
+    {
+        cached = nautilus_listing_cache_load (data->location);
+        for (l = cached; l != NULL; l = l->next)
+        {
+            prepared = g_new0 (PreparedFile, 1);
+            prepared->info = l->data;
+            prepared->from_cache = TRUE;
+            prepared->file = nautilus_file_new_detached_from_info
+                                 (data->directory, collation_key, prepared->info);
+            if (g_file_info_has_attribute (prepared->info,
+                                           NAUTILUS_LISTING_CACHE_ATTRIBUTE_ITEM_COUNT))
+            {
+                /* Shown until the folder is counted again. */
+                prepared->file->details->directory_count =
+                    g_file_info_get_attribute_int32 (prepared->info,
+                                                     NAUTILUS_LISTING_CACHE_ATTRIBUTE_ITEM_COUNT);
+                prepared->file->details->got_directory_count = TRUE;
+            }
+            result = g_list_prepend (result, prepared);
+        }
+        g_list_free (cached);
+    }
+
+    for (l = data->items; l != NULL; l = l->next)
+    {
+        prepared = g_new0 (PreparedFile, 1);
+        if (data->local)
+        {
+            prepared->entry = l->data;
+            if (!prepared->entry->metadata_only)
+            {
+                prepared->file = nautilus_file_new_detached_from_local_entry
+                                     (data->directory, collation_key, prepared->entry);
+            }
+        }
+        else
+        {
+            prepared->info = l->data;
+            prepared->file = nautilus_file_new_detached_from_info
+                                 (data->directory, collation_key, prepared->info);
+        }
+        result = g_list_prepend (result, prepared);
+    }
+    result = g_list_reverse (result);
+
+    /* The items belong to the prepared files now. */
+    g_list_free (data->items);
+    data->items = NULL;
+    g_free (collation_key);
+
+    g_task_return_pointer (task, result, NULL);
+}
+
+/* Count the file for the directory count and MIME list of the
+ * directory being loaded. Doing this as the files come in, instead of
+ * when they are added, keeps files reported by the monitor meanwhile
+ * from being counted twice.
+ */
+static void
+directory_load_count_file (DirectoryLoadState *state,
+                           PreparedFile       *prepared)
+{
+    const char *mimetype;
+    gboolean skip;
+
+    if (prepared->from_cache)
+    {
+        return;
+    }
+
+    if (prepared->entry != NULL)
+    {
+        if (prepared->entry->metadata_only)
+        {
+            return;
+        }
+        skip = should_skip_local_entry (prepared->entry);
+        mimetype = prepared->entry->content_type;
+    }
+    else
+    {
+        skip = should_skip_file (state->directory, prepared->info);
+        mimetype = g_file_info_get_content_type (prepared->info);
+    }
+
+    if (!skip)
+    {
+        state->load_file_count += 1;
+
+        /* Add the MIME type to the set. */
+        if (mimetype != NULL)
+        {
+            istr_set_insert (state->load_mime_list_hash, mimetype);
+        }
+    }
+}
+
+static void directory_load_prepare_or_finish (DirectoryLoadState *state);
+
+static void
+prepare_files_callback (GObject      *source_object,
+                        GAsyncResult *res,
+                        gpointer      user_data)
+{
+    DirectoryLoadState *state;
+    NautilusDirectory *directory;
+    GList *prepared, *l;
+
+    state = user_data;
+
+    /* The task has no cancellable and always returns its result, so
+     * the files are never dropped on the worker thread.
+     */
+    prepared = g_task_propagate_pointer (G_TASK (res), NULL);
+    prepare_files_data_free (g_task_get_task_data (G_TASK (res)));
+
+    state->preparing = FALSE;
+
+    if (state->directory == NULL)
+    {
+        /* Operation was cancelled. Bail out */
+        g_list_free_full (prepared, (GDestroyNotify) prepared_file_free);
+        if (state->enumeration_done)
+        {
+            directory_load_state_free (state);
+        }
+        return;
+    }
+
+    directory = nautilus_directory_ref (state->directory);
+
+    for (l = prepared; l != NULL; l = l->next)
+    {
+        directory_load_count_file (state, l->data);
+        g_queue_push_tail (directory->details->pending_prepared_files, l->data);
+    }
+    if (prepared != NULL)
+    {
+        nautilus_directory_schedule_dequeue_pending (directory);
+    }
+    g_list_free (prepared);
+
+    directory_load_prepare_or_finish (state);
+
+    nautilus_directory_unref (directory);
+}
+
+/* Hands what the enumerator returned so far to a worker thread, unless
+ * one is busy already. Once the enumerator is done and everything is
+ * prepared, the load is done, and the state is freed.
+ */
+static void
+directory_load_prepare_or_finish (DirectoryLoadState *state)
+{
+    PrepareFilesData *data;
+    GTask *task;
+
+    if (state->preparing)
+    {
+        return;
+    }
+
+    if (state->unprepared != NULL || state->read_listing_cache)
+    {
+        data = g_new0 (PrepareFilesData, 1);
+        data->directory = nautilus_directory_ref (state->directory);
+        data->location = g_object_ref (state->directory->details->location);
+        data->items = g_list_reverse (state->unprepared);
+        data->local = state->local_enumerator != NULL;
+        data->read_listing_cache = state->read_listing_cache;
+        state->unprepared = NULL;
+        state->read_listing_cache = FALSE;
+        state->preparing = TRUE;
+
+        task = g_task_new (NULL, NULL, prepare_files_callback, state);
+        g_task_set_task_data (task, data, NULL);
+        g_task_run_in_thread (task, prepare_files_thread);
+        g_object_unref (task);
+    }
+    else if (state->enumeration_done)
+    {
+        directory_load_done (state->directory, state->load_error);
+        directory_load_state_free (state);
+    }
+}
+
+static void
+more_files_callback (GObject      *source_object,
+                     GAsyncResult *res,
+                     gpointer      user_data)
+{
+    DirectoryLoadState *state;
+    NautilusDirectory *directory;
+    GError *error;
+    GList *files, *l;
+    GFileInfo *info;
+
+    state = user_data;
+
+    if (state->directory == NULL)
+    {
+        /* Operation was cancelled. Bail out, unless files are
+         * still being prepared; the state is freed after those then.
+         */
+        state->enumeration_done = TRUE;
+        if (!state->preparing)
+        {
+            directory_load_state_free (state);
+        }
+        return;
+    }
+
+    directory = nautilus_directory_ref (state->directory);
+
+    g_assert (directory->details->directory_load_in_progress != NULL);
     g_assert (directory->details->directory_load_in_progress == state);
 
     error = NULL;
@@ -2186,31 +3562,38 @@ more_files_callback (GObject      *source_object,
     for (l = files; l != NULL; l = l->next)
     {
         info = l->data;
-        directory_load_one (directory, info);
-        g_object_unref (info);
+        if (directory_load_info_is_valid (directory, info))
+        {
+            state->unprepared = g_list_prepend (state->unprepared, info);
+        }
+        else
+        {
+            g_object_unref (info);
+        }
     }
 
     if (files == NULL)
     {
-        directory_load_done (directory, error);
-        directory_load_state_free (state);
+        state->enumeration_done = TRUE;
+        state->load_error = error;
     }
     else
     {
         g_file_enumerator_next_files_async (state->enumerator,
-                                            DIRECTORY_LOAD_ITEMS_PER_CALLBACK,
+                                            directory_load_next_batch_size (state),
                                             G_PRIORITY_DEFAULT,
                                             state->cancellable,
                                             more_files_callback,
                                             state);
+        if (error)
+        {
+            g_error_free (error);
+        }
     }
 
-    nautilus_directory_unref (directory);
+    directory_load_prepare_or_finish (state);
 
-    if (error)
-    {
-        g_error_free (error);
-    }
+    nautilus_directory_unref (directory);
 
     g_list_free (files);
 }
@@ -2221,6 +3604,7 @@ enumerate_children_callback (GObject      *source_object,
                              gpointer      user_data)
 {
     DirectoryLoadState *state;
+    NautilusDirectory *directory;
     GFileEnumerator *enumerator;
     GError *error;
 
@@ -2228,8 +3612,15 @@ enumerate_children_callback (GObject      *source_object,
 
     if (state->directory == NULL)
     {
-        /* Operation was cancelled. Bail out */
-        directory_load_state_free (state);
+        /* Operation was cancelled. Bail out, unless files from the
+         * listing cache are still being prepared; the state is freed
+         * after those then.
+         */
+        state->enumeration_done = TRUE;
+        if (!state->preparing)
+        {
+            directory_load_state_free (state);
+        }
         return;
     }
 
@@ -2239,16 +3630,21 @@ enumerate_children_callback (GObject      *source_object,
 
     if (enumerator == NULL)
     {
-        directory_load_done (state->directory, error);
-        g_error_free (error);
-        directory_load_state_free (state);
+        /* The load is done once the files from the listing cache
+         * are prepared.
+         */
+        directory = nautilus_directory_ref (state->directory);
+        state->enumeration_done = TRUE;
+        state->load_error = error;
+        directory_load_prepare_or_finish (state);
+        nautilus_directory_unref (directory);
         return;
     }
     else
     {
         state->enumerator = enumerator;
         g_file_enumerator_next_files_async (state->enumerator,
-                                            DIRECTORY_LOAD_ITEMS_PER_CALLBACK,
+                                            directory_load_next_batch_size (state),
                                             G_PRIORITY_DEFAULT,
                                             state->cancellable,
                                             more_files_callback,
@@ -2256,6 +3652,76 @@ enumerate_children_callback (GObject      *source_object,
     }
 }
 
+static void
+more_local_entries_callback (GObject      *source_object,
+                             GAsyncResult *res,
+                             gpointer      user_data)
+{
+    DirectoryLoadState *state;
+    NautilusDirectory *directory;
+    GError *error;
+    GList *entries;
+
+    state = user_data;
+
+    if (state->directory == NULL)
+    {
+        /* Operation was cancelled. Bail out, unless files are
+         * still being prepared; the state is freed after those then.
+         */
+        state->enumeration_done = TRUE;
+        if (!state->preparing)
+        {
+            directory_load_state_free (state);
+        }
+        return;
+    }
+
+    directory = nautilus_directory_ref (state->directory);
+
+    g_assert (directory->details->directory_load_in_progress != NULL);
+    g_assert (directory->details->directory_load_in_progress == state);
+
+    error = NULL;
+    entries = nautilus_local_enumerator_next_entries_finish (state->local_enumerator,
+                                                             res, &error);
+
+    /* The state takes over the entries. */
+    state->unprepared = g_list_concat (g_list_reverse (entries), state->unprepared);
+
+    if (entries == NULL)
+    {
+        state->enumeration_done = TRUE;
+        state->load_error = error;
+    }
+    else
+    {
+        nautilus_local_enumerator_next_entries_async (state->local_enumerator,
+                                                      directory_load_next_batch_size (state),
+                                                      state->cancellable,
+                                                      more_local_entries_callback,
+                                                      state);
+        if (error)
+        {
+            g_error_free (error);
+        }
+    }
+
+    directory_load_prepare_or_finish (state);
+
+    nautilus_directory_unref (directory);
+}
+
+/* Whether the directory can be read with the local enumerator. The
+ * desktop is left to GIO: its icon positions are metadata, which the
+ * local enumerator only reads after all the files.
+ */
+static gboolean
+can_load_directory_locally (NautilusDirectory *directory)
+{
+    return nautilus_local_enumerator_is_supported (directory->details->location) &&
+           !nautilus_is_desktop_directory (directory->details->location);
+}
 
 /* Start monitoring the file list if it isn't already. */
 static void
@@ -2276,7 +3742,7 @@ start_monitoring_file_list (NautilusDirectory *directory)
         return;
     }
 
-    if (!async_job_start (directory, "file list"))
+    if (!async_job_start (directory, ASYNC_JOB_FILE_LIST))
     {
         return;
     }
@@ -2288,6 +3754,7 @@ start_monitoring_file_list (NautilusDirectory *directory)
     state->cancellable = g_cancellable_new ();
     state->load_mime_list_hash = istr_set_new ();
     state->load_file_count = 0;
+    state->items_per_callback = DIRECTORY_LOAD_ITEMS_PER_CALLBACK;
 
     g_assert (directory->details->location != NULL);
     state->load_directory_file =
@@ -2301,6 +3768,28 @@ start_monitoring_file_list (NautilusDirectory *directory)
 
     directory->details->directory_load_in_progress = state;
 
+    /* A directory seen for the first time since it was last freed gets
+     * its files from the listing cache while it loads.
+     */
+    if (directory->details->file_list == NULL &&
+        nautilus_listing_cache_is_enabled ())
+    {
+        state->read_listing_cache = TRUE;
+        directory_load_prepare_or_finish (state);
+    }
+
+    if (can_load_directory_locally (directory))
+    {
+        state->items_per_callback = DIRECTORY_LOAD_LOCAL_ITEMS_PER_CALLBACK;
+        state->local_enumerator = nautilus_local_enumerator_new (directory->details->location);
+        nautilus_local_enumerator_next_entries_async (state->local_enumerator,
+                                                      directory_load_next_batch_size (state),
+                                                      state->cancellable,
+                                                      more_local_entries_callback,
+                                                      state);
+        return;
+    }
+
     g_file_enumerate_children_async (directory->details->location,
                                      NAUTILUS_FILE_DEFAULT_ATTRIBUTES,
                                      0,     /* flags */
@@ -2371,6 +3860,74 @@ nautilus_directory_invalidate_count_and_mime_list (NautilusDirectory *directory)
     nautilus_file_unref (file);
 }
 
+/* Brings the directory's own item count and MIME list in line with
+ * the show hidden files preference. A directory that is loaded and
+ * monitored has all its files at hand, hidden or not, so they are
+ * counted again in memory; any other one is read again.
+ */
+void
+nautilus_directory_update_count_and_mime_list (NautilusDirectory *directory)
+{
+    NautilusFile *file, *child;
+    GHashTable *mime_list_hash;
+    const char *mime_type;
+    GList *node;
+    guint count;
+
+    file = nautilus_directory_get_existing_corresponding_file (directory);
+    if (file == NULL)
+    {
+        return;
+    }
+
+    if (!directory->details->directory_loaded ||
+        directory->details->directory_load_in_progress != NULL ||
+        !nautilus_directory_is_file_list_monitored (directory))
+    {
+        nautilus_file_invalidate_count_and_mime_list (file);
+        nautilus_file_unref (file);
+        return;
+    }
+
+    /* Whoever is told about the preference first cannot rely on the
+     * cached value having been updated already.
+     */
+    show_hidden_files_changed_callback (NULL);
+
+    count = 0;
+    mime_list_hash = istr_set_new ();
+    for (node = directory->details->file_list; node != NULL; node = node->next)
+    {
+        child = NAUTILUS_FILE (node->data);
+        if (child->details->is_gone || should_skip_hidden (child->details->is_hidden))
+        {
+            continue;
+        }
+
+        count += 1;
+        mime_type = eel_ref_str_peek (child->details->mime_type);
+        if (mime_type != NULL)
+        {
+            istr_set_insert (mime_list_hash, mime_type);
+        }
+    }
+
+    file->details->directory_count = count;
+    file->details->directory_count_is_up_to_date = TRUE;
+    file->details->directory_count_failed = FALSE;
+    file->details->got_directory_count = TRUE;
+
+    g_list_free_full (file->details->mime_list, g_free);
+    file->details->mime_list = istr_set_get_as_list (mime_list_hash);
+    file->details->mime_list_is_up_to_date = TRUE;
+    file->details->mime_list_failed = FALSE;
+    file->details->got_mime_list = TRUE;
+    istr_set_destroy (mime_list_hash);
+
+    nautilus_file_changed (file);
+    nautilus_file_unref (file);
+}
+
 static void
 nautilus_directory_invalidate_file_attributes (NautilusDirectory      *directory,
                                                NautilusFileAttributes  file_attributes)
@@ -2491,227 +4048,295 @@ is_needy (NautilusFile *file,
     return FALSE;
 }
 
-static void
-directory_count_stop (NautilusDirectory *directory)
+static gboolean
+directory_summary_is_wanted (DirectorySummaryState *state)
 {
-    NautilusFile *file;
+    GList *node;
+    DirectorySummaryItem *item;
 
-    if (directory->details->count_in_progress != NULL)
+    for (node = state->items; node != NULL; node = node->next)
     {
-        file = directory->details->count_in_progress->count_file;
-        if (file != NULL)
+        item = node->data;
+        if (item->file != NULL)
         {
-            g_assert (NAUTILUS_IS_FILE (file));
-            g_assert (file->details->directory == directory);
-            if (is_needy (file,
-                          should_get_directory_count_now,
-                          REQUEST_DIRECTORY_COUNT))
-            {
-                return;
-            }
+            return TRUE;
         }
-
-        /* The count is not wanted, so stop it. */
-        directory_count_cancel (directory);
     }
+
+    return FALSE;
 }
 
-static guint
-count_non_skipped_files (GList *list)
+static void
+directory_summary_stop (NautilusDirectory *directory)
 {
-    guint count;
-    GList *node;
-    GFileInfo *info;
+    NautilusFile *file;
+    DirectorySummaryState *state;
+    DirectorySummaryItem *item;
+    GList *node, *next, *item_node;
 
-    count = 0;
-    for (node = list; node != NULL; node = node->next)
+    for (node = directory->details->summary_in_progress; node != NULL; node = next)
     {
-        info = node->data;
-        if (!should_skip_file (NULL, info))
+        next = node->next;
+        state = node->data;
+
+        for (item_node = state->items; item_node != NULL; item_node = item_node->next)
+        {
+            item = item_node->data;
+            file = item->file;
+            if (file == NULL)
+            {
+                continue;
+            }
+
+            g_assert (NAUTILUS_IS_FILE (file));
+            g_assert (file->details->directory == directory);
+            if ((item->want_count &&
+                 is_needy (file, should_get_directory_count_now, REQUEST_DIRECTORY_COUNT)) ||
+                (item->want_mime_list &&
+                 is_needy (file, should_get_mime_list, REQUEST_MIME_LIST)))
+            {
+                continue;
+            }
+
+            /* The summary is not wanted, so drop it when it comes. */
+            item->file = NULL;
+        }
+
+        if (!directory_summary_is_wanted (state))
         {
-            count += 1;
+            directory_summary_cancel_state (directory, state);
         }
     }
-    return count;
 }
 
-static void
-count_children_done (NautilusDirectory *directory,
-                     NautilusFile      *count_file,
-                     gboolean           succeeded,
-                     int                count)
+static DirectorySummaryItem *
+find_directory_summary_item (NautilusDirectory *directory,
+                             NautilusFile      *file)
 {
-    g_assert (NAUTILUS_IS_FILE (count_file));
-
-    count_file->details->directory_count_is_up_to_date = TRUE;
+    GList *node, *item_node;
+    DirectorySummaryState *state;
+    DirectorySummaryItem *item;
 
-    /* Record either a failure or success. */
-    if (!succeeded)
-    {
-        count_file->details->directory_count_failed = TRUE;
-        count_file->details->got_directory_count = FALSE;
-        count_file->details->directory_count = 0;
-    }
-    else
+    for (node = directory->details->summary_in_progress; node != NULL; node = node->next)
     {
-        count_file->details->directory_count_failed = FALSE;
-        count_file->details->got_directory_count = TRUE;
-        count_file->details->directory_count = count;
+        state = node->data;
+        for (item_node = state->items; item_node != NULL; item_node = item_node->next)
+        {
+            item = item_node->data;
+            if (item->file == file)
+            {
+                return item;
+            }
+        }
     }
-    directory->details->count_in_progress = NULL;
-
-    /* Send file-changed even if count failed, so interested parties can
-     * distinguish between unknowable and not-yet-known cases.
-     */
-    nautilus_file_changed (count_file);
 
-    /* Start up the next one. */
-    async_job_end (directory, "directory count");
-    nautilus_directory_async_state_changed (directory);
+    return NULL;
 }
 
 static void
-directory_count_state_free (DirectoryCountState *state)
+directory_summary_item_free (DirectorySummaryItem *item)
 {
-    if (state->enumerator)
+    g_object_unref (item->location);
+    if (item->mime_list_hash != NULL)
     {
-        if (!g_file_enumerator_is_closed (state->enumerator))
-        {
-            g_file_enumerator_close_async (state->enumerator,
-                                           0, NULL, NULL, NULL);
-        }
-        g_object_unref (state->enumerator);
+        istr_set_destroy (item->mime_list_hash);
     }
+    g_free (item);
+}
+
+static void
+directory_summary_state_free (DirectorySummaryState *state)
+{
+    g_list_free_full (state->items, (GDestroyNotify) directory_summary_item_free);
     g_object_unref (state->cancellable);
     nautilus_directory_unref (state->directory);
     g_free (state);
 }
 
+/* Reads one subfolder, on the worker thread. */
 static void
-count_more_files_callback (GObject      *source_object,
-                           GAsyncResult *res,
-                           gpointer      user_data)
+summarize_directory (DirectorySummaryState *state,
+                     DirectorySummaryItem  *item)
 {
-    DirectoryCountState *state;
-    NautilusDirectory *directory;
+    GFileEnumerator *enumerator;
+    GFileInfo *info;
+    const char *mime_type;
     GError *error;
-    GList *files;
-
-    state = user_data;
-    directory = state->directory;
 
-    if (g_cancellable_is_cancelled (state->cancellable))
+#ifdef DEBUG_LOAD_DIRECTORY
     {
-        /* Operation was cancelled. Bail out */
-
-        async_job_end (directory, "directory count");
-        nautilus_directory_async_state_changed (directory);
-
-        directory_count_state_free (state);
+        char *uri;
+        uri = g_file_get_uri (item->location);
+        g_message ("load_directory called to get summary of %s", uri);
+        g_free (uri);
+    }
+#endif
 
+    /* Content types are those of the link targets, like for the
+     * files of a directory that is shown.
+     */
+    enumerator = g_file_enumerate_children (item->location,
+                                            item->want_mime_list ?
+                                            DIRECTORY_SUMMARY_MIME_LIST_ATTRIBUTES :
+                                            DIRECTORY_SUMMARY_ATTRIBUTES,
+                                            item->want_mime_list ?
+                                            0 : G_FILE_QUERY_INFO_NOFOLLOW_SYMLINKS,
+                                            state->cancellable,
+                                            NULL);
+    if (enumerator == NULL)
+    {
         return;
     }
 
-    g_assert (directory->details->count_in_progress != NULL);
-    g_assert (directory->details->count_in_progress == state);
-
     error = NULL;
-    files = g_file_enumerator_next_files_finish (state->enumerator,
-                                                 res, &error);
-
-    state->file_count += count_non_skipped_files (files);
-
-    if (files == NULL)
-    {
-        count_children_done (directory, state->count_file,
-                             TRUE, state->file_count);
-        directory_count_state_free (state);
-    }
-    else
+    while ((info = g_file_enumerator_next_file (enumerator, state->cancellable, &error)) != NULL)
     {
-        g_file_enumerator_next_files_async (state->enumerator,
-                                            DIRECTORY_LOAD_ITEMS_PER_CALLBACK,
-                                            G_PRIORITY_DEFAULT,
-                                            state->cancellable,
-                                            count_more_files_callback,
-                                            state);
+        if (state->count_hidden ||
+            !(g_file_info_get_is_hidden (info) || g_file_info_get_is_backup (info)))
+        {
+            item->count += 1;
+
+            mime_type = g_file_info_get_content_type (info);
+            if (item->want_mime_list && mime_type != NULL)
+            {
+                istr_set_insert (item->mime_list_hash, mime_type);
+            }
+        }
+        g_object_unref (info);
     }
 
-    g_list_free_full (files, g_object_unref);
+    item->succeeded = error == NULL;
+
+    g_clear_error (&error);
+    g_object_unref (enumerator);
+}
+
+static void
+directory_summary_thread (GTask        *task,
+                          gpointer      source_object,
+                          gpointer      task_data,
+                          GCancellable *cancellable)
+{
+    DirectorySummaryState *state;
+    GList *node;
+
+    state = task_data;
 
-    if (error)
+    for (node = state->items; node != NULL; node = node->next)
     {
-        g_error_free (error);
+        if (g_cancellable_is_cancelled (state->cancellable))
+        {
+            break;
+        }
+        summarize_directory (state, node->data);
     }
+
+    g_task_return_boolean (task, TRUE);
 }
 
 static void
-count_children_callback (GObject      *source_object,
-                         GAsyncResult *res,
-                         gpointer      user_data)
+directory_summary_callback (GObject      *source_object,
+                            GAsyncResult *res,
+                            gpointer      user_data)
 {
-    DirectoryCountState *state;
-    GFileEnumerator *enumerator;
+    DirectorySummaryState *state;
+    DirectorySummaryItem *item;
     NautilusDirectory *directory;
-    GError *error;
+    NautilusFile *file;
+    GList *node;
 
     state = user_data;
+    directory = state->directory;
+
+    directory->details->summary_in_progress =
+        g_list_remove (directory->details->summary_in_progress, state);
 
-    if (g_cancellable_is_cancelled (state->cancellable))
+    for (node = state->items; node != NULL; node = node->next)
     {
-        /* Operation was cancelled. Bail out */
-        directory = state->directory;
+        item = node->data;
+        file = item->file;
+        if (file == NULL)
+        {
+            continue;
+        }
 
-        async_job_end (directory, "directory count");
-        nautilus_directory_async_state_changed (directory);
+        g_assert (NAUTILUS_IS_FILE (file));
 
-        directory_count_state_free (state);
+        /* Record either a failure or success. */
+        if (item->want_count)
+        {
+            file->details->directory_count_is_up_to_date = TRUE;
+            file->details->directory_count_failed = !item->succeeded;
+            file->details->got_directory_count = item->succeeded;
+            file->details->directory_count = item->succeeded ? item->count : 0;
+        }
 
-        return;
+        if (item->want_mime_list)
+        {
+            file->details->mime_list_is_up_to_date = TRUE;
+            g_list_free_full (file->details->mime_list, g_free);
+            file->details->mime_list_failed = !item->succeeded;
+            file->details->got_mime_list = item->succeeded;
+            file->details->mime_list = item->succeeded ?
+                                       istr_set_get_as_list (item->mime_list_hash) : NULL;
+        }
+
+        /* Send file-changed even if reading the folder failed, so
+         * interested parties can distinguish between unknowable and
+         * not-yet-known cases.
+         */
+        nautilus_file_changed (file);
     }
 
-    error = NULL;
-    enumerator = g_file_enumerate_children_finish (G_FILE (source_object),
-                                                   res, &error);
+    /* Start up the next batch. */
+    async_job_end (directory, ASYNC_JOB_DIRECTORY_SUMMARY);
+    nautilus_directory_async_state_changed (directory);
 
-    if (enumerator == NULL)
+    directory_summary_state_free (state);
+}
+
+/* Starts reading the subfolders gathered since the last call. */
+static void
+directory_summary_flush (NautilusDirectory *directory)
+{
+    DirectorySummaryState *state;
+    GTask *task;
+
+    state = directory->details->summary_batch;
+    if (state == NULL)
     {
-        count_children_done (state->directory,
-                             state->count_file,
-                             FALSE, 0);
-        g_error_free (error);
-        directory_count_state_free (state);
         return;
     }
-    else
-    {
-        state->enumerator = enumerator;
-        g_file_enumerator_next_files_async (state->enumerator,
-                                            DIRECTORY_LOAD_ITEMS_PER_CALLBACK,
-                                            G_PRIORITY_DEFAULT,
-                                            state->cancellable,
-                                            count_more_files_callback,
-                                            state);
-    }
+    directory->details->summary_batch = NULL;
+
+    task = g_task_new (NULL, NULL, directory_summary_callback, state);
+    g_task_set_task_data (task, state, NULL);
+    g_task_run_in_thread (task, directory_summary_thread);
+    g_object_unref (task);
 }
 
 static void
-directory_count_start (NautilusDirectory *directory,
-                       NautilusFile      *file,
-                       gboolean          *doing_io)
+directory_summary_start (NautilusDirectory *directory,
+                         NautilusFile      *file,
+                         gboolean          *doing_io)
 {
-    DirectoryCountState *state;
-    GFile *location;
+    DirectorySummaryState *state;
+    DirectorySummaryItem *item;
+    gboolean want_count, want_mime_list;
 
-    if (directory->details->count_in_progress != NULL)
+    if (find_directory_summary_item (directory, file) != NULL)
     {
         *doing_io = TRUE;
         return;
     }
 
-    if (!is_needy (file,
-                   should_get_directory_count_now,
-                   REQUEST_DIRECTORY_COUNT))
+    want_count = is_needy (file,
+                           should_get_directory_count_now,
+                           REQUEST_DIRECTORY_COUNT);
+    want_mime_list = is_needy (file,
+                               should_get_mime_list,
+                               REQUEST_MIME_LIST);
+    if (!want_count && !want_mime_list)
     {
         return;
     }
@@ -2719,191 +4344,96 @@ directory_count_start (NautilusDirectory *directory,
 
     if (!nautilus_file_is_directory (file))
     {
-        file->details->directory_count_is_up_to_date = TRUE;
-        file->details->directory_count_failed = FALSE;
-        file->details->got_directory_count = FALSE;
+        if (want_count)
+        {
+            file->details->directory_count_is_up_to_date = TRUE;
+            file->details->directory_count_failed = FALSE;
+            file->details->got_directory_count = FALSE;
+        }
+        if (want_mime_list)
+        {
+            g_list_free_full (file->details->mime_list, g_free);
+            file->details->mime_list = NULL;
+            file->details->mime_list_failed = FALSE;
+            file->details->got_mime_list = FALSE;
+            file->details->mime_list_is_up_to_date = TRUE;
+        }
 
         nautilus_directory_async_state_changed (directory);
         return;
     }
 
-    if (!async_job_start (directory, "directory count"))
-    {
-        return;
-    }
-
-    /* Start counting. */
-    state = g_new0 (DirectoryCountState, 1);
-    state->count_file = file;
-    state->directory = nautilus_directory_ref (directory);
-    state->cancellable = g_cancellable_new ();
-
-    directory->details->count_in_progress = state;
-
-    location = nautilus_file_get_location (file);
-#ifdef DEBUG_LOAD_DIRECTORY
-    {
-        char *uri;
-        uri = g_file_get_uri (location);
-        g_message ("load_directory called to get shallow file count for %s", uri);
-        g_free (uri);
-    }
-#endif
-
-    g_file_enumerate_children_async (location,
-                                     G_FILE_ATTRIBUTE_STANDARD_NAME ","
-                                     G_FILE_ATTRIBUTE_STANDARD_IS_HIDDEN ","
-                                     G_FILE_ATTRIBUTE_STANDARD_IS_BACKUP,
-                                     G_FILE_QUERY_INFO_NOFOLLOW_SYMLINKS,     /* flags */
-                                     G_PRIORITY_DEFAULT,     /* prio */
-                                     state->cancellable,
-                                     count_children_callback,
-                                     state);
-    g_object_unref (location);
-}
-
-static inline gboolean
-seen_inode (DeepCountState *state,
-            GFileInfo      *info)
-{
-    guint64 inode, inode2;
-    guint i;
-
-    inode = g_file_info_get_attribute_uint64 (info, G_FILE_ATTRIBUTE_UNIX_INODE);
-
-    if (inode != 0)
+    state = directory->details->summary_batch;
+    if (state == NULL)
     {
-        for (i = 0; i < state->seen_deep_count_inodes->len; i++)
+        if (g_list_length (directory->details->summary_in_progress) >=
+            DIRECTORY_SUMMARY_BATCHES_IN_FLIGHT)
         {
-            inode2 = g_array_index (state->seen_deep_count_inodes, guint64, i);
-            if (inode == inode2)
-            {
-                return TRUE;
-            }
+            return;
         }
-    }
-
-    return FALSE;
-}
-
-static inline void
-mark_inode_as_seen (DeepCountState *state,
-                    GFileInfo      *info)
-{
-    guint64 inode;
-
-    inode = g_file_info_get_attribute_uint64 (info, G_FILE_ATTRIBUTE_UNIX_INODE);
-    if (inode != 0)
-    {
-        g_array_append_val (state->seen_deep_count_inodes, inode);
-    }
-}
 
-static void
-deep_count_one (DeepCountState *state,
-                GFileInfo      *info)
-{
-    NautilusFile *file;
-    GFile *subdir;
-    gboolean is_seen_inode;
-    const char *fs_id;
+        if (!async_job_start (directory, ASYNC_JOB_DIRECTORY_SUMMARY))
+        {
+            return;
+        }
 
-    if (should_skip_file (NULL, info))
-    {
-        return;
-    }
+        state = g_new0 (DirectorySummaryState, 1);
+        state->directory = nautilus_directory_ref (directory);
+        state->cancellable = g_cancellable_new ();
+        state->count_hidden = !should_skip_hidden (TRUE);
 
-    is_seen_inode = seen_inode (state, info);
-    if (!is_seen_inode)
-    {
-        mark_inode_as_seen (state, info);
+        directory->details->summary_in_progress =
+            g_list_prepend (directory->details->summary_in_progress, state);
+        directory->details->summary_batch = state;
     }
 
-    file = state->directory->details->deep_count_file;
-
-    if (g_file_info_get_file_type (info) == G_FILE_TYPE_DIRECTORY)
-    {
-        /* Count the directory. */
-        file->details->deep_directory_count += 1;
-
-        /* Record the fact that we have to descend into this directory. */
-        fs_id = g_file_info_get_attribute_string (info, G_FILE_ATTRIBUTE_ID_FILESYSTEM);
-        if (g_strcmp0 (fs_id, state->fs_id) == 0)
-        {
-            /* only if it is on the same filesystem */
-            subdir = g_file_get_child (state->deep_count_location, g_file_info_get_name (info));
-            state->deep_count_subdirectories = g_list_prepend
-                                                   (state->deep_count_subdirectories, subdir);
-        }
-    }
-    else
+    item = g_new0 (DirectorySummaryItem, 1);
+    item->file = file;
+    item->location = nautilus_file_get_location (file);
+    item->want_count = want_count;
+    item->want_mime_list = want_mime_list;
+    if (want_mime_list)
     {
-        /* Even non-regular files count as files. */
-        file->details->deep_file_count += 1;
+        item->mime_list_hash = istr_set_new ();
     }
 
-    /* Count the size. */
-    if (!is_seen_inode && g_file_info_has_attribute (info, G_FILE_ATTRIBUTE_STANDARD_SIZE))
-    {
-        file->details->deep_size += g_file_info_get_size (info);
-    }
-}
+    state->items = g_list_append (state->items, item);
+    state->n_items++;
 
-static void
-deep_count_state_free (DeepCountState *state)
-{
-    if (state->enumerator)
-    {
-        if (!g_file_enumerator_is_closed (state->enumerator))
-        {
-            g_file_enumerator_close_async (state->enumerator,
-                                           0, NULL, NULL, NULL);
-        }
-        g_object_unref (state->enumerator);
-    }
-    g_object_unref (state->cancellable);
-    if (state->deep_count_location)
+    if (state->n_items == DIRECTORY_SUMMARY_BATCH_SIZE)
     {
-        g_object_unref (state->deep_count_location);
+        directory_summary_flush (directory);
     }
-    g_list_free_full (state->deep_count_subdirectories, g_object_unref);
-    g_array_free (state->seen_deep_count_inodes, TRUE);
-    g_free (state->fs_id);
-    g_free (state);
 }
 
 static void
-deep_count_next_dir (DeepCountState *state)
+deep_count_callback (const NautilusDeepCountTotals *totals,
+                     gboolean                       done,
+                     gpointer                       user_data)
 {
-    GFile *location;
-    NautilusFile *file;
+    DeepCountState *state;
     NautilusDirectory *directory;
-    gboolean done;
+    NautilusFile *file;
+    NautilusFileRareDetails *rare;
 
+    state = user_data;
     directory = state->directory;
+    file = directory->details->deep_count_file;
 
-    g_object_unref (state->deep_count_location);
-    state->deep_count_location = NULL;
+    g_assert (directory->details->deep_count_in_progress == state);
 
-    done = FALSE;
-    file = directory->details->deep_count_file;
+    rare = nautilus_file_get_rare (file);
+    rare->deep_directory_count = totals->directory_count;
+    rare->deep_file_count = totals->file_count;
+    rare->deep_unreadable_count = totals->unreadable_count;
+    rare->deep_size = totals->size;
 
-    if (state->deep_count_subdirectories != NULL)
-    {
-        /* Work on a new directory. */
-        location = state->deep_count_subdirectories->data;
-        state->deep_count_subdirectories = g_list_remove
-                                               (state->deep_count_subdirectories, location);
-        deep_count_load (state, location);
-        g_object_unref (location);
-    }
-    else
+    if (done)
     {
         file->details->deep_counts_status = NAUTILUS_REQUEST_DONE;
         directory->details->deep_count_file = NULL;
         directory->details->deep_count_in_progress = NULL;
-        deep_count_state_free (state);
-        done = TRUE;
+        g_free (state);
     }
 
     nautilus_file_updated_deep_count_in_progress (file);
@@ -2911,139 +4441,17 @@ deep_count_next_dir (DeepCountState *state)
     if (done)
     {
         nautilus_file_changed (file);
-        async_job_end (directory, "deep count");
+        async_job_end (directory, ASYNC_JOB_DEEP_COUNT);
         nautilus_directory_async_state_changed (directory);
     }
 }
 
 static void
-deep_count_more_files_callback (GObject      *source_object,
-                                GAsyncResult *res,
-                                gpointer      user_data)
+deep_count_stop (NautilusDirectory *directory)
 {
-    DeepCountState *state;
-    NautilusDirectory *directory;
-    GList *files, *l;
-    GFileInfo *info;
-
-    state = user_data;
+    NautilusFile *file;
 
-    if (state->directory == NULL)
-    {
-        /* Operation was cancelled. Bail out */
-        deep_count_state_free (state);
-        return;
-    }
-
-    directory = nautilus_directory_ref (state->directory);
-
-    g_assert (directory->details->deep_count_in_progress != NULL);
-    g_assert (directory->details->deep_count_in_progress == state);
-
-    files = g_file_enumerator_next_files_finish (state->enumerator,
-                                                 res, NULL);
-
-    for (l = files; l != NULL; l = l->next)
-    {
-        info = l->data;
-        deep_count_one (state, info);
-        g_object_unref (info);
-    }
-
-    if (files == NULL)
-    {
-        g_file_enumerator_close_async (state->enumerator, 0, NULL, NULL, NULL);
-        g_object_unref (state->enumerator);
-        state->enumerator = NULL;
-
-        deep_count_next_dir (state);
-    }
-    else
-    {
-        g_file_enumerator_next_files_async (state->enumerator,
-                                            DIRECTORY_LOAD_ITEMS_PER_CALLBACK,
-                                            G_PRIORITY_LOW,
-                                            state->cancellable,
-                                            deep_count_more_files_callback,
-                                            state);
-    }
-
-    g_list_free (files);
-
-    nautilus_directory_unref (directory);
-}
-
-static void
-deep_count_callback (GObject      *source_object,
-                     GAsyncResult *res,
-                     gpointer      user_data)
-{
-    DeepCountState *state;
-    GFileEnumerator *enumerator;
-    NautilusFile *file;
-
-    state = user_data;
-
-    if (state->directory == NULL)
-    {
-        /* Operation was cancelled. Bail out */
-        deep_count_state_free (state);
-        return;
-    }
-
-    file = state->directory->details->deep_count_file;
-
-    enumerator = g_file_enumerate_children_finish (G_FILE (source_object), res, NULL);
-
-    if (enumerator == NULL)
-    {
-        file->details->deep_unreadable_count += 1;
-
-        deep_count_next_dir (state);
-    }
-    else
-    {
-        state->enumerator = enumerator;
-        g_file_enumerator_next_files_async (state->enumerator,
-                                            DIRECTORY_LOAD_ITEMS_PER_CALLBACK,
-                                            G_PRIORITY_LOW,
-                                            state->cancellable,
-                                            deep_count_more_files_callback,
-                                            state);
-    }
-}
-
-
-static void
-deep_count_load (DeepCountState *state,
-                 GFile          *location)
-{
-    state->deep_count_location = g_object_ref (location);
-
-#ifdef DEBUG_LOAD_DIRECTORY
-    g_message ("load_directory called to get deep file count for %p", location);
-#endif
-    g_file_enumerate_children_async (state->deep_count_location,
-                                     G_FILE_ATTRIBUTE_STANDARD_NAME ","
-                                     G_FILE_ATTRIBUTE_STANDARD_TYPE ","
-                                     G_FILE_ATTRIBUTE_STANDARD_SIZE ","
-                                     G_FILE_ATTRIBUTE_STANDARD_IS_HIDDEN ","
-                                     G_FILE_ATTRIBUTE_STANDARD_IS_BACKUP ","
-                                     G_FILE_ATTRIBUTE_ID_FILESYSTEM ","
-                                     G_FILE_ATTRIBUTE_UNIX_INODE,
-                                     G_FILE_QUERY_INFO_NOFOLLOW_SYMLINKS,     /* flags */
-                                     G_PRIORITY_LOW,     /* prio */
-                                     state->cancellable,
-                                     deep_count_callback,
-                                     state);
-}
-
-static void
-deep_count_stop (NautilusDirectory *directory)
-{
-    NautilusFile *file;
-
-    if (directory->details->deep_count_in_progress != NULL)
+    if (directory->details->deep_count_in_progress != NULL)
     {
         file = directory->details->deep_count_file;
         if (file != NULL)
@@ -3053,378 +4461,72 @@ deep_count_stop (NautilusDirectory *directory)
             if (is_needy (file,
                           lacks_deep_count,
                           REQUEST_DEEP_COUNT))
-            {
-                return;
-            }
-        }
-
-        /* The count is not wanted, so stop it. */
-        deep_count_cancel (directory);
-    }
-}
-
-static void
-deep_count_got_info (GObject      *source_object,
-                     GAsyncResult *res,
-                     gpointer      user_data)
-{
-    GFileInfo *info;
-    const char *id;
-    GFile *file = (GFile *) source_object;
-    DeepCountState *state = (DeepCountState *) user_data;
-
-    info = g_file_query_info_finish (file, res, NULL);
-    if (info != NULL)
-    {
-        id = g_file_info_get_attribute_string (info, G_FILE_ATTRIBUTE_ID_FILESYSTEM);
-        state->fs_id = g_strdup (id);
-        g_object_unref (info);
-    }
-    deep_count_load (state, file);
-}
-
-static void
-deep_count_start (NautilusDirectory *directory,
-                  NautilusFile      *file,
-                  gboolean          *doing_io)
-{
-    GFile *location;
-    DeepCountState *state;
-
-    if (directory->details->deep_count_in_progress != NULL)
-    {
-        *doing_io = TRUE;
-        return;
-    }
-
-    if (!is_needy (file,
-                   lacks_deep_count,
-                   REQUEST_DEEP_COUNT))
-    {
-        return;
-    }
-    *doing_io = TRUE;
-
-    if (!nautilus_file_is_directory (file))
-    {
-        file->details->deep_counts_status = NAUTILUS_REQUEST_DONE;
-
-        nautilus_directory_async_state_changed (directory);
-        return;
-    }
-
-    if (!async_job_start (directory, "deep count"))
-    {
-        return;
-    }
-
-    /* Start counting. */
-    file->details->deep_counts_status = NAUTILUS_REQUEST_IN_PROGRESS;
-    file->details->deep_directory_count = 0;
-    file->details->deep_file_count = 0;
-    file->details->deep_unreadable_count = 0;
-    file->details->deep_size = 0;
-    directory->details->deep_count_file = file;
-
-    state = g_new0 (DeepCountState, 1);
-    state->directory = directory;
-    state->cancellable = g_cancellable_new ();
-    state->seen_deep_count_inodes = g_array_new (FALSE, TRUE, sizeof (guint64));
-    state->fs_id = NULL;
-
-    directory->details->deep_count_in_progress = state;
-
-    location = nautilus_file_get_location (file);
-    g_file_query_info_async (location,
-                             G_FILE_ATTRIBUTE_ID_FILESYSTEM,
-                             G_FILE_QUERY_INFO_NOFOLLOW_SYMLINKS,
-                             G_PRIORITY_DEFAULT,
-                             NULL,
-                             deep_count_got_info,
-                             state);
-    g_object_unref (location);
-}
-
-static void
-mime_list_stop (NautilusDirectory *directory)
-{
-    NautilusFile *file;
-
-    if (directory->details->mime_list_in_progress != NULL)
-    {
-        file = directory->details->mime_list_in_progress->mime_list_file;
-        if (file != NULL)
-        {
-            g_assert (NAUTILUS_IS_FILE (file));
-            g_assert (file->details->directory == directory);
-            if (is_needy (file,
-                          should_get_mime_list,
-                          REQUEST_MIME_LIST))
-            {
-                return;
-            }
-        }
-
-        /* The count is not wanted, so stop it. */
-        mime_list_cancel (directory);
-    }
-}
-
-static void
-mime_list_state_free (MimeListState *state)
-{
-    if (state->enumerator)
-    {
-        if (!g_file_enumerator_is_closed (state->enumerator))
-        {
-            g_file_enumerator_close_async (state->enumerator,
-                                           0, NULL, NULL, NULL);
-        }
-        g_object_unref (state->enumerator);
-    }
-    g_object_unref (state->cancellable);
-    istr_set_destroy (state->mime_list_hash);
-    nautilus_directory_unref (state->directory);
-    g_free (state);
-}
-
-
-static void
-mime_list_done (MimeListState *state,
-                gboolean       success)
-{
-    NautilusFile *file;
-    NautilusDirectory *directory;
-
-    directory = state->directory;
-    g_assert (directory != NULL);
-
-    file = state->mime_list_file;
-
-    file->details->mime_list_is_up_to_date = TRUE;
-    g_list_free_full (file->details->mime_list, g_free);
-    if (success)
-    {
-        file->details->mime_list_failed = TRUE;
-        file->details->mime_list = NULL;
-    }
-    else
-    {
-        file->details->got_mime_list = TRUE;
-        file->details->mime_list = istr_set_get_as_list (state->mime_list_hash);
-    }
-    directory->details->mime_list_in_progress = NULL;
-
-    /* Send file-changed even if getting the item type list
-     * failed, so interested parties can distinguish between
-     * unknowable and not-yet-known cases.
-     */
-    nautilus_file_changed (file);
-
-    /* Start up the next one. */
-    async_job_end (directory, "MIME list");
-    nautilus_directory_async_state_changed (directory);
-}
-
-static void
-mime_list_one (MimeListState *state,
-               GFileInfo     *info)
-{
-    const char *mime_type;
-
-    if (should_skip_file (NULL, info))
-    {
-        g_object_unref (info);
-        return;
-    }
-
-    mime_type = g_file_info_get_content_type (info);
-    if (mime_type != NULL)
-    {
-        istr_set_insert (state->mime_list_hash, mime_type);
-    }
-}
-
-static void
-mime_list_callback (GObject      *source_object,
-                    GAsyncResult *res,
-                    gpointer      user_data)
-{
-    MimeListState *state;
-    NautilusDirectory *directory;
-    GError *error;
-    GList *files, *l;
-    GFileInfo *info;
-
-    state = user_data;
-    directory = state->directory;
-
-    if (g_cancellable_is_cancelled (state->cancellable))
-    {
-        /* Operation was cancelled. Bail out */
-        directory->details->mime_list_in_progress = NULL;
-
-        async_job_end (directory, "MIME list");
-        nautilus_directory_async_state_changed (directory);
-
-        mime_list_state_free (state);
-
-        return;
-    }
-
-    g_assert (directory->details->mime_list_in_progress != NULL);
-    g_assert (directory->details->mime_list_in_progress == state);
-
-    error = NULL;
-    files = g_file_enumerator_next_files_finish (state->enumerator,
-                                                 res, &error);
-
-    for (l = files; l != NULL; l = l->next)
-    {
-        info = l->data;
-        mime_list_one (state, info);
-        g_object_unref (info);
-    }
-
-    if (files == NULL)
-    {
-        mime_list_done (state, error != NULL);
-        mime_list_state_free (state);
-    }
-    else
-    {
-        g_file_enumerator_next_files_async (state->enumerator,
-                                            DIRECTORY_LOAD_ITEMS_PER_CALLBACK,
-                                            G_PRIORITY_DEFAULT,
-                                            state->cancellable,
-                                            mime_list_callback,
-                                            state);
-    }
-
-    g_list_free (files);
-
-    if (error)
-    {
-        g_error_free (error);
-    }
-}
-
-static void
-list_mime_enum_callback (GObject      *source_object,
-                         GAsyncResult *res,
-                         gpointer      user_data)
-{
-    MimeListState *state;
-    GFileEnumerator *enumerator;
-    NautilusDirectory *directory;
-    GError *error;
-
-    state = user_data;
-
-    if (g_cancellable_is_cancelled (state->cancellable))
-    {
-        /* Operation was cancelled. Bail out */
-        directory = state->directory;
-        directory->details->mime_list_in_progress = NULL;
-
-        async_job_end (directory, "MIME list");
-        nautilus_directory_async_state_changed (directory);
-
-        mime_list_state_free (state);
-
-        return;
-    }
-
-    error = NULL;
-    enumerator = g_file_enumerate_children_finish (G_FILE (source_object),
-                                                   res, &error);
-
-    if (enumerator == NULL)
-    {
-        mime_list_done (state, FALSE);
-        g_error_free (error);
-        mime_list_state_free (state);
-        return;
-    }
-    else
-    {
-        state->enumerator = enumerator;
-        g_file_enumerator_next_files_async (state->enumerator,
-                                            DIRECTORY_LOAD_ITEMS_PER_CALLBACK,
-                                            G_PRIORITY_DEFAULT,
-                                            state->cancellable,
-                                            mime_list_callback,
-                                            state);
+            {
+                return;
+            }
+        }
+
+        /* The count is not wanted, so stop it. */
+        deep_count_cancel (directory);
     }
 }
 
 static void
-mime_list_start (NautilusDirectory *directory,
-                 NautilusFile      *file,
-                 gboolean          *doing_io)
+deep_count_start (NautilusDirectory *directory,
+                  NautilusFile      *file,
+                  gboolean          *doing_io)
 {
-    MimeListState *state;
     GFile *location;
+    DeepCountState *state;
 
-    mime_list_stop (directory);
-
-    if (directory->details->mime_list_in_progress != NULL)
+    if (!is_needy (file,
+                   lacks_deep_count,
+                   REQUEST_DEEP_COUNT))
     {
-        *doing_io = TRUE;
         return;
     }
+    *doing_io = TRUE;
 
-    /* Figure out which file to get a mime list for. */
-    if (!is_needy (file,
-                   should_get_mime_list,
-                   REQUEST_MIME_LIST))
+    if (directory->details->deep_count_in_progress != NULL)
     {
+        /* Deep counts run one at a time. */
         return;
     }
-    *doing_io = TRUE;
 
     if (!nautilus_file_is_directory (file))
     {
-        g_list_free (file->details->mime_list);
-        file->details->mime_list_failed = FALSE;
-        file->details->got_mime_list = FALSE;
-        file->details->mime_list_is_up_to_date = TRUE;
+        file->details->deep_counts_status = NAUTILUS_REQUEST_DONE;
 
         nautilus_directory_async_state_changed (directory);
         return;
     }
 
-    if (!async_job_start (directory, "MIME list"))
+    if (!async_job_start (directory, ASYNC_JOB_DEEP_COUNT))
     {
         return;
     }
 
+    /* Start counting. */
+    file->details->deep_counts_status = NAUTILUS_REQUEST_IN_PROGRESS;
+    if (file->details->rare != NULL)
+    {
+        file->details->rare->deep_directory_count = 0;
+        file->details->rare->deep_file_count = 0;
+        file->details->rare->deep_unreadable_count = 0;
+        file->details->rare->deep_size = 0;
+    }
+    directory->details->deep_count_file = file;
 
-    state = g_new0 (MimeListState, 1);
-    state->mime_list_file = file;
-    state->directory = nautilus_directory_ref (directory);
-    state->cancellable = g_cancellable_new ();
-    state->mime_list_hash = istr_set_new ();
+    state = g_new0 (DeepCountState, 1);
+    state->directory = directory;
 
-    directory->details->mime_list_in_progress = state;
+    directory->details->deep_count_in_progress = state;
 
     location = nautilus_file_get_location (file);
-#ifdef DEBUG_LOAD_DIRECTORY
-    {
-        char *uri;
-        uri = g_file_get_uri (location);
-        g_message ("load_directory called to get MIME list of %s", uri);
-        g_free (uri);
-    }
-#endif
-
-    g_file_enumerate_children_async (location,
-                                     G_FILE_ATTRIBUTE_STANDARD_CONTENT_TYPE,
-                                     0,     /* flags */
-                                     G_PRIORITY_LOW,     /* prio */
-                                     state->cancellable,
-                                     list_mime_enum_callback,
-                                     state);
+    state->count = nautilus_deep_count_start (location,
+                                              !should_skip_hidden (TRUE),
+                                              deep_count_callback,
+                                              state);
     g_object_unref (location);
 }
 
@@ -3457,11 +4559,11 @@ query_info_callback (GObject      *source_object,
 
     directory = nautilus_directory_ref (state->directory);
 
-    get_info_file = directory->details->get_info_file;
+    get_info_file = state->file;
     g_assert (NAUTILUS_IS_FILE (get_info_file));
 
-    directory->details->get_info_file = NULL;
-    directory->details->get_info_in_progress = NULL;
+    directory->details->get_info_in_progress =
+        g_list_remove (directory->details->get_info_in_progress, state);
 
     /* ref here because we might be removing the last ref when we
      * mark the file gone below, but we need to keep a ref at
@@ -3493,7 +4595,7 @@ query_info_callback (GObject      *source_object,
     nautilus_file_changed (get_info_file);
     nautilus_file_unref (get_info_file);
 
-    async_job_end (directory, "file info");
+    async_job_end (directory, ASYNC_JOB_FILE_INFO);
     nautilus_directory_async_state_changed (directory);
 
     nautilus_directory_unref (directory);
@@ -3505,23 +4607,47 @@ static void
 file_info_stop (NautilusDirectory *directory)
 {
     NautilusFile *file;
+    GetInfoState *state;
+    GList *node, *next;
 
-    if (directory->details->get_info_in_progress != NULL)
+    for (node = directory->details->get_info_in_progress; node != NULL; node = next)
     {
-        file = directory->details->get_info_file;
+        next = node->next;
+        state = node->data;
+
+        file = state->file;
         if (file != NULL)
         {
             g_assert (NAUTILUS_IS_FILE (file));
             g_assert (file->details->directory == directory);
             if (is_needy (file, lacks_info, REQUEST_FILE_INFO))
             {
-                return;
+                continue;
             }
         }
 
         /* The info is not wanted, so stop it. */
-        file_info_cancel (directory);
+        file_info_cancel_state (directory, state);
+    }
+}
+
+static GetInfoState *
+find_file_info_state (NautilusDirectory *directory,
+                      NautilusFile      *file)
+{
+    GList *node;
+    GetInfoState *state;
+
+    for (node = directory->details->get_info_in_progress; node != NULL; node = node->next)
+    {
+        state = node->data;
+        if (state->file == file)
+        {
+            return state;
+        }
     }
+
+    return NULL;
 }
 
 static void
@@ -3532,9 +4658,7 @@ file_info_start (NautilusDirectory *directory,
     GFile *location;
     GetInfoState *state;
 
-    file_info_stop (directory);
-
-    if (directory->details->get_info_in_progress != NULL)
+    if (find_file_info_state (directory, file) != NULL)
     {
         *doing_io = TRUE;
         return;
@@ -3546,12 +4670,17 @@ file_info_start (NautilusDirectory *directory,
     }
     *doing_io = TRUE;
 
-    if (!async_job_start (directory, "file info"))
+    if (g_list_length (directory->details->get_info_in_progress) >=
+        max_requests_in_flight[REQUEST_FILE_INFO])
+    {
+        return;
+    }
+
+    if (!async_job_start (directory, ASYNC_JOB_FILE_INFO))
     {
         return;
     }
 
-    directory->details->get_info_file = file;
     file->details->get_info_failed = FALSE;
     if (file->details->get_info_error)
     {
@@ -3561,9 +4690,11 @@ file_info_start (NautilusDirectory *directory,
 
     state = g_new (GetInfoState, 1);
     state->directory = directory;
+    state->file = file;
     state->cancellable = g_cancellable_new ();
 
-    directory->details->get_info_in_progress = state;
+    directory->details->get_info_in_progress =
+        g_list_prepend (directory->details->get_info_in_progress, state);
 
     location = nautilus_file_get_location (file);
     g_file_query_info_async (location,
@@ -3652,11 +4783,15 @@ static void
 link_info_stop (NautilusDirectory *directory)
 {
     NautilusFile *file;
+    LinkInfoReadState *state;
+    GList *node, *next;
 
-    if (directory->details->link_info_read_state != NULL)
+    for (node = directory->details->link_info_read_states; node != NULL; node = next)
     {
-        file = directory->details->link_info_read_state->file;
+        next = node->next;
+        state = node->data;
 
+        file = state->file;
         if (file != NULL)
         {
             g_assert (NAUTILUS_IS_FILE (file));
@@ -3665,13 +4800,32 @@ link_info_stop (NautilusDirectory *directory)
                           lacks_link_info,
                           REQUEST_LINK_INFO))
             {
-                return;
+                continue;
             }
         }
 
         /* The link info is not wanted, so stop it. */
-        link_info_cancel (directory);
+        link_info_cancel_state (directory, state);
+    }
+}
+
+static LinkInfoReadState *
+find_link_info_state (NautilusDirectory *directory,
+                      NautilusFile      *file)
+{
+    GList *node;
+    LinkInfoReadState *state;
+
+    for (node = directory->details->link_info_read_states; node != NULL; node = node->next)
+    {
+        state = node->data;
+        if (state->file == file)
+        {
+            return state;
+        }
     }
+
+    return NULL;
 }
 
 static void
@@ -3757,8 +4911,9 @@ link_info_nautilus_link_read_callback (GObject      *source_object,
                                           &file_contents, &file_size,
                                           NULL, NULL);
 
-    state->directory->details->link_info_read_state = NULL;
-    async_job_end (state->directory, "link info");
+    state->directory->details->link_info_read_states =
+        g_list_remove (state->directory->details->link_info_read_states, state);
+    async_job_end (state->directory, ASYNC_JOB_LINK_INFO);
 
     link_info_got_data (state->directory, state->file, result, file_size, file_contents);
 
@@ -3781,7 +4936,7 @@ link_info_start (NautilusDirectory *directory,
     gboolean nautilus_style_link;
     LinkInfoReadState *state;
 
-    if (directory->details->link_info_read_state != NULL)
+    if (find_link_info_state (directory, file) != NULL)
     {
         *doing_io = TRUE;
         return;
@@ -3806,7 +4961,9 @@ link_info_start (NautilusDirectory *directory,
     }
     else
     {
-        if (!async_job_start (directory, "link info"))
+        if (g_list_length (directory->details->link_info_read_states) >=
+            max_requests_in_flight[REQUEST_LINK_INFO] ||
+            !async_job_start (directory, ASYNC_JOB_LINK_INFO))
         {
             g_object_unref (location);
             return;
@@ -3817,7 +4974,8 @@ link_info_start (NautilusDirectory *directory,
         state->file = file;
         state->cancellable = g_cancellable_new ();
 
-        directory->details->link_info_read_state = state;
+        directory->details->link_info_read_states =
+            g_list_prepend (directory->details->link_info_read_states, state);
 
         g_file_load_contents_async (location,
                                     state->cancellable,
@@ -3884,11 +5042,15 @@ static void
 thumbnail_stop (NautilusDirectory *directory)
 {
     NautilusFile *file;
+    ThumbnailState *state;
+    GList *node, *next;
 
-    if (directory->details->thumbnail_state != NULL)
+    for (node = directory->details->thumbnail_states; node != NULL; node = next)
     {
-        file = directory->details->thumbnail_state->file;
+        next = node->next;
+        state = node->data;
 
+        file = state->file;
         if (file != NULL)
         {
             g_assert (NAUTILUS_IS_FILE (file));
@@ -3897,13 +5059,32 @@ thumbnail_stop (NautilusDirectory *directory)
                           lacks_thumbnail,
                           REQUEST_THUMBNAIL))
             {
-                return;
+                continue;
             }
         }
 
-        /* The link info is not wanted, so stop it. */
-        thumbnail_cancel (directory);
+        /* The thumbnail is not wanted, so stop it. */
+        thumbnail_cancel_state (directory, state);
+    }
+}
+
+static ThumbnailState *
+find_thumbnail_state (NautilusDirectory *directory,
+                      NautilusFile      *file)
+{
+    GList *node;
+    ThumbnailState *state;
+
+    for (node = directory->details->thumbnail_states; node != NULL; node = node->next)
+    {
+        state = node->data;
+        if (state->file == file)
+        {
+            return state;
+        }
     }
+
+    return NULL;
 }
 
 static void
@@ -4060,8 +5241,9 @@ thumbnail_read_callback (GObject      *source_object,
     }
     else
     {
-        state->directory->details->thumbnail_state = NULL;
-        async_job_end (state->directory, "thumbnail");
+        state->directory->details->thumbnail_states =
+            g_list_remove (state->directory->details->thumbnail_states, state);
+        async_job_end (state->directory, ASYNC_JOB_THUMBNAIL);
 
         thumbnail_got_pixbuf (state->directory, state->file, pixbuf, state->tried_original);
 
@@ -4079,7 +5261,7 @@ thumbnail_start (NautilusDirectory *directory,
     GFile *location;
     ThumbnailState *state;
 
-    if (directory->details->thumbnail_state != NULL)
+    if (find_thumbnail_state (directory, file) != NULL)
     {
         *doing_io = TRUE;
         return;
@@ -4093,7 +5275,13 @@ thumbnail_start (NautilusDirectory *directory,
     }
     *doing_io = TRUE;
 
-    if (!async_job_start (directory, "thumbnail"))
+    if (g_list_length (directory->details->thumbnail_states) >=
+        max_requests_in_flight[REQUEST_THUMBNAIL])
+    {
+        return;
+    }
+
+    if (!async_job_start (directory, ASYNC_JOB_THUMBNAIL))
     {
         return;
     }
@@ -4114,7 +5302,8 @@ thumbnail_start (NautilusDirectory *directory,
         location = g_file_new_for_path (file->details->thumbnail_path);
     }
 
-    directory->details->thumbnail_state = state;
+    directory->details->thumbnail_states =
+        g_list_prepend (directory->details->thumbnail_states, state);
 
     g_file_load_contents_async (location,
                                 state->cancellable,
@@ -4166,7 +5355,7 @@ got_mount (MountState *state,
     directory = nautilus_directory_ref (state->directory);
 
     state->directory->details->mount_state = NULL;
-    async_job_end (state->directory, "mount");
+    async_job_end (state->directory, ASYNC_JOB_MOUNT);
 
     file = nautilus_file_ref (state->file);
 
@@ -4271,12 +5460,6 @@ mount_start (NautilusDirectory *directory,
     GFile *location;
     MountState *state;
 
-    if (directory->details->mount_state != NULL)
-    {
-        *doing_io = TRUE;
-        return;
-    }
-
     if (!is_needy (file,
                    lacks_mount,
                    REQUEST_MOUNT))
@@ -4285,7 +5468,13 @@ mount_start (NautilusDirectory *directory,
     }
     *doing_io = TRUE;
 
-    if (!async_job_start (directory, "mount"))
+    if (directory->details->mount_state != NULL)
+    {
+        /* Mounts are looked up one at a time. */
+        return;
+    }
+
+    if (!async_job_start (directory, ASYNC_JOB_MOUNT))
     {
         return;
     }
@@ -4330,15 +5519,24 @@ mount_start (NautilusDirectory *directory,
     g_object_unref (location);
 }
 
+static void
+filesystem_info_cancel_state (NautilusDirectory   *directory,
+                              FilesystemInfoState *state)
+{
+    g_cancellable_cancel (state->cancellable);
+    state->directory = NULL;
+    directory->details->filesystem_info_states =
+        g_list_remove (directory->details->filesystem_info_states, state);
+    async_job_end (directory, ASYNC_JOB_FILESYSTEM_INFO);
+}
+
 static void
 filesystem_info_cancel (NautilusDirectory *directory)
 {
-    if (directory->details->filesystem_info_state != NULL)
+    while (directory->details->filesystem_info_states != NULL)
     {
-        g_cancellable_cancel (directory->details->filesystem_info_state->cancellable);
-        directory->details->filesystem_info_state->directory = NULL;
-        directory->details->filesystem_info_state = NULL;
-        async_job_end (directory, "filesystem info");
+        filesystem_info_cancel_state (directory,
+                                      directory->details->filesystem_info_states->data);
     }
 }
 
@@ -4346,11 +5544,15 @@ static void
 filesystem_info_stop (NautilusDirectory *directory)
 {
     NautilusFile *file;
+    FilesystemInfoState *state;
+    GList *node, *next;
 
-    if (directory->details->filesystem_info_state != NULL)
+    for (node = directory->details->filesystem_info_states; node != NULL; node = next)
     {
-        file = directory->details->filesystem_info_state->file;
+        next = node->next;
+        state = node->data;
 
+        file = state->file;
         if (file != NULL)
         {
             g_assert (NAUTILUS_IS_FILE (file));
@@ -4359,13 +5561,32 @@ filesystem_info_stop (NautilusDirectory *directory)
                           lacks_filesystem_info,
                           REQUEST_FILESYSTEM_INFO))
             {
-                return;
+                continue;
             }
         }
 
         /* The filesystem info is not wanted, so stop it. */
-        filesystem_info_cancel (directory);
+        filesystem_info_cancel_state (directory, state);
+    }
+}
+
+static FilesystemInfoState *
+find_filesystem_info_state (NautilusDirectory *directory,
+                            NautilusFile      *file)
+{
+    GList *node;
+    FilesystemInfoState *state;
+
+    for (node = directory->details->filesystem_info_states; node != NULL; node = node->next)
+    {
+        state = node->data;
+        if (state->file == file)
+        {
+            return state;
+        }
     }
+
+    return NULL;
 }
 
 static void
@@ -4387,8 +5608,9 @@ got_filesystem_info (FilesystemInfoState *state,
 
     directory = nautilus_directory_ref (state->directory);
 
-    state->directory->details->filesystem_info_state = NULL;
-    async_job_end (state->directory, "filesystem info");
+    state->directory->details->filesystem_info_states =
+        g_list_remove (state->directory->details->filesystem_info_states, state);
+    async_job_end (state->directory, ASYNC_JOB_FILESYSTEM_INFO);
 
     file = nautilus_file_ref (state->file);
 
@@ -4451,7 +5673,7 @@ filesystem_info_start (NautilusDirectory *directory,
     GFile *location;
     FilesystemInfoState *state;
 
-    if (directory->details->filesystem_info_state != NULL)
+    if (find_filesystem_info_state (directory, file) != NULL)
     {
         *doing_io = TRUE;
         return;
@@ -4465,7 +5687,13 @@ filesystem_info_start (NautilusDirectory *directory,
     }
     *doing_io = TRUE;
 
-    if (!async_job_start (directory, "filesystem info"))
+    if (g_list_length (directory->details->filesystem_info_states) >=
+        max_requests_in_flight[REQUEST_FILESYSTEM_INFO])
+    {
+        return;
+    }
+
+    if (!async_job_start (directory, ASYNC_JOB_FILESYSTEM_INFO))
     {
         return;
     }
@@ -4477,7 +5705,8 @@ filesystem_info_start (NautilusDirectory *directory,
 
     location = nautilus_file_get_location (file);
 
-    directory->details->filesystem_info_state = state;
+    directory->details->filesystem_info_states =
+        g_list_prepend (directory->details->filesystem_info_states, state);
 
     g_file_query_filesystem_info_async (location,
                                         G_FILE_ATTRIBUTE_FILESYSTEM_READONLY ","
@@ -4511,7 +5740,7 @@ extension_info_cancel (NautilusDirectory *directory)
         directory->details->extension_info_provider = NULL;
         directory->details->extension_info_idle = 0;
 
-        async_job_end (directory, "extension info");
+        async_job_end (directory, ASYNC_JOB_EXTENSION_INFO);
     }
 }
 
@@ -4574,7 +5803,7 @@ info_provider_idle_callback (gpointer user_data)
     else
     {
         NautilusFile *file;
-        async_job_end (directory, "extension info");
+        async_job_end (directory, ASYNC_JOB_EXTENSION_INFO);
 
         file = directory->details->extension_info_file;
 
@@ -4619,19 +5848,19 @@ extension_info_start (NautilusDirectory *directory,
     NautilusOperationHandle *handle;
     GClosure *update_complete;
 
-    if (directory->details->extension_info_in_progress != NULL)
+    if (!is_needy (file, lacks_extension_info, REQUEST_EXTENSION_INFO))
     {
-        *doing_io = TRUE;
         return;
     }
+    *doing_io = TRUE;
 
-    if (!is_needy (file, lacks_extension_info, REQUEST_EXTENSION_INFO))
+    if (directory->details->extension_info_in_progress != NULL)
     {
+        /* Extensions are asked about one file at a time. */
         return;
     }
-    *doing_io = TRUE;
 
-    if (!async_job_start (directory, "extension info"))
+    if (!async_job_start (directory, ASYNC_JOB_EXTENSION_INFO))
     {
         return;
     }
@@ -4656,7 +5885,7 @@ extension_info_start (NautilusDirectory *directory,
         result == NAUTILUS_OPERATION_FAILED)
     {
         finish_info_provider (directory, file, provider);
-        async_job_end (directory, "extension info");
+        async_job_end (directory, ASYNC_JOB_EXTENSION_INFO);
     }
     else
     {
@@ -4666,10 +5895,87 @@ extension_info_start (NautilusDirectory *directory,
     }
 }
 
+typedef void (*AttributeStartFunc) (NautilusDirectory *directory,
+                                    NautilusFile      *file,
+                                    gboolean          *doing_io);
+
+static const AttributeStartFunc high_priority_starts[] =
+{
+    file_info_start,
+    link_info_start,
+};
+
+static const AttributeStartFunc low_priority_starts[] =
+{
+    mount_start,
+    directory_summary_start,
+    deep_count_start,
+    thumbnail_start,
+    filesystem_info_start,
+};
+
+static const AttributeStartFunc extension_starts[] =
+{
+    extension_info_start,
+};
+
+/* Start getting attributes for the files at the head of @queue.
+ * Files that need nothing more from this queue move on to @next_queue,
+ * or leave the work queue if @next_queue is NULL. Up to
+ * WORK_QUEUE_LOOKAHEAD files can have I/O pending at once, so requests
+ * for different files overlap. Returns TRUE if any file still has I/O
+ * pending, in which case the lower priority queues have to wait.
+ */
+static gboolean
+start_queue_io (NautilusDirectory        *directory,
+                NautilusFileQueue        *queue,
+                NautilusFileQueue        *next_queue,
+                const AttributeStartFunc *starts,
+                guint                     n_starts)
+{
+    NautilusFile *file, *next;
+    gboolean doing_io, file_doing_io;
+    guint busy_files, i;
+
+    doing_io = FALSE;
+    busy_files = 0;
+
+    file = nautilus_file_ref (nautilus_file_queue_head (queue));
+    while (file != NULL && busy_files < WORK_QUEUE_LOOKAHEAD)
+    {
+        file_doing_io = FALSE;
+        for (i = 0; i < n_starts; i++)
+        {
+            (*starts[i])(directory, file, &file_doing_io);
+        }
+
+        next = nautilus_file_ref (nautilus_file_queue_next (queue, file));
+
+        if (file_doing_io)
+        {
+            doing_io = TRUE;
+            busy_files++;
+        }
+        else
+        {
+            if (next_queue != NULL)
+            {
+                nautilus_file_queue_enqueue (next_queue, file);
+            }
+            nautilus_file_queue_remove (queue, file);
+        }
+
+        nautilus_file_unref (file);
+        file = next;
+    }
+    nautilus_file_unref (file);
+
+    return doing_io;
+}
+
 static void
 start_or_stop_io (NautilusDirectory *directory)
 {
-    NautilusFile *file;
     gboolean doing_io;
 
     /* Start or stop reading files. */
@@ -4677,68 +5983,48 @@ start_or_stop_io (NautilusDirectory *directory)
 
     /* Stop any no longer wanted attribute fetches. */
     file_info_stop (directory);
-    directory_count_stop (directory);
+    directory_summary_stop (directory);
     deep_count_stop (directory);
-    mime_list_stop (directory);
     link_info_stop (directory);
     extension_info_stop (directory);
     mount_stop (directory);
     thumbnail_stop (directory);
     filesystem_info_stop (directory);
 
-    doing_io = FALSE;
-    /* Take files that are all done off the queue. */
-    while (!nautilus_file_queue_is_empty (directory->details->high_priority_queue))
+    /* Take files that are all done off the queues, in priority
+     * order: a queue is only serviced once the ones above it have
+     * no I/O pending.
+     */
+    if (start_queue_io (directory,
+                        directory->details->high_priority_queue,
+                        directory->details->low_priority_queue,
+                        high_priority_starts,
+                        G_N_ELEMENTS (high_priority_starts)))
     {
-        file = nautilus_file_queue_head (directory->details->high_priority_queue);
-
-        /* Start getting attributes if possible */
-        file_info_start (directory, file, &doing_io);
-        link_info_start (directory, file, &doing_io);
-
-        if (doing_io)
-        {
-            return;
-        }
-
-        move_file_to_low_priority_queue (directory, file);
+        return;
     }
 
-    /* High priority queue must be empty */
-    while (!nautilus_file_queue_is_empty (directory->details->low_priority_queue))
-    {
-        file = nautilus_file_queue_head (directory->details->low_priority_queue);
-
-        /* Start getting attributes if possible */
-        mount_start (directory, file, &doing_io);
-        directory_count_start (directory, file, &doing_io);
-        deep_count_start (directory, file, &doing_io);
-        mime_list_start (directory, file, &doing_io);
-        thumbnail_start (directory, file, &doing_io);
-        filesystem_info_start (directory, file, &doing_io);
+    doing_io = start_queue_io (directory,
+                               directory->details->low_priority_queue,
+                               directory->details->extension_queue,
+                               low_priority_starts,
+                               G_N_ELEMENTS (low_priority_starts));
 
-        if (doing_io)
-        {
-            return;
-        }
-
-        move_file_to_extension_queue (directory, file);
-    }
+    /* Subfolders that want a summary were gathered into a batch while
+     * going through the queue. Start reading them.
+     */
+    directory_summary_flush (directory);
 
-    /* Low priority queue must be empty */
-    while (!nautilus_file_queue_is_empty (directory->details->extension_queue))
+    if (doing_io)
     {
-        file = nautilus_file_queue_head (directory->details->extension_queue);
-
-        /* Start getting attributes if possible */
-        extension_info_start (directory, file, &doing_io);
-        if (doing_io)
-        {
-            return;
-        }
-
-        nautilus_directory_remove_file_from_work_queue (directory, file);
+        return;
     }
+
+    start_queue_io (directory,
+                    directory->details->extension_queue,
+                    NULL,
+                    extension_starts,
+                    G_N_ELEMENTS (extension_starts));
 }
 
 /* Call this when the monitor or call when ready list changes,
@@ -4784,11 +6070,11 @@ nautilus_directory_cancel (NautilusDirectory *directory)
 {
     /* Arbitrary order (kept alphabetical). */
     deep_count_cancel (directory);
-    directory_count_cancel (directory);
+    directory_monitor_cancel (directory);
+    directory_summary_cancel (directory);
     file_info_cancel (directory);
     file_list_cancel (directory);
     link_info_cancel (directory);
-    mime_list_cancel (directory);
     new_files_cancel (directory);
     extension_info_cancel (directory);
     thumbnail_cancel (directory);
@@ -4796,23 +6082,23 @@ nautilus_directory_cancel (NautilusDirectory *directory)
     filesystem_info_cancel (directory);
 
     /* We aren't waiting for anything any more. */
-    if (waiting_directories != NULL)
-    {
-        g_hash_table_remove (waiting_directories, directory);
-    }
+    async_job_stop_waiting (directory, FALSE);
 
     /* Check if any directories should wake up. */
     async_job_wake_up ();
 }
 
 static void
-cancel_directory_count_for_file (NautilusDirectory *directory,
-                                 NautilusFile      *file)
+cancel_directory_summary_for_file (NautilusDirectory *directory,
+                                   NautilusFile      *file)
 {
-    if (directory->details->count_in_progress != NULL &&
-        directory->details->count_in_progress->count_file == file)
+    DirectorySummaryItem *item;
+
+    /* The rest of its batch may still be wanted. */
+    item = find_directory_summary_item (directory, file);
+    if (item != NULL)
     {
-        directory_count_cancel (directory);
+        item->file = NULL;
     }
 }
 
@@ -4826,24 +6112,16 @@ cancel_deep_counts_for_file (NautilusDirectory *directory,
     }
 }
 
-static void
-cancel_mime_list_for_file (NautilusDirectory *directory,
-                           NautilusFile      *file)
-{
-    if (directory->details->mime_list_in_progress != NULL &&
-        directory->details->mime_list_in_progress->mime_list_file == file)
-    {
-        mime_list_cancel (directory);
-    }
-}
-
 static void
 cancel_file_info_for_file (NautilusDirectory *directory,
                            NautilusFile      *file)
 {
-    if (directory->details->get_info_file == file)
+    GetInfoState *state;
+
+    state = find_file_info_state (directory, file);
+    if (state != NULL)
     {
-        file_info_cancel (directory);
+        file_info_cancel_state (directory, state);
     }
 }
 
@@ -4851,10 +6129,12 @@ static void
 cancel_thumbnail_for_file (NautilusDirectory *directory,
                            NautilusFile      *file)
 {
-    if (directory->details->thumbnail_state != NULL &&
-        directory->details->thumbnail_state->file == file)
+    ThumbnailState *state;
+
+    state = find_thumbnail_state (directory, file);
+    if (state != NULL)
     {
-        thumbnail_cancel (directory);
+        thumbnail_cancel_state (directory, state);
     }
 }
 
@@ -4873,10 +6153,12 @@ static void
 cancel_filesystem_info_for_file (NautilusDirectory *directory,
                                  NautilusFile      *file)
 {
-    if (directory->details->filesystem_info_state != NULL &&
-        directory->details->filesystem_info_state->file == file)
+    FilesystemInfoState *state;
+
+    state = find_filesystem_info_state (directory, file);
+    if (state != NULL)
     {
-        filesystem_info_cancel (directory);
+        filesystem_info_cancel_state (directory, state);
     }
 }
 
@@ -4884,10 +6166,12 @@ static void
 cancel_link_info_for_file (NautilusDirectory *directory,
                            NautilusFile      *file)
 {
-    if (directory->details->link_info_read_state != NULL &&
-        directory->details->link_info_read_state->file == file)
+    LinkInfoReadState *state;
+
+    state = find_link_info_state (directory, file);
+    if (state != NULL)
     {
-        link_info_cancel (directory);
+        link_info_cancel_state (directory, state);
     }
 }
 
@@ -4900,18 +6184,15 @@ cancel_loading_attributes (NautilusDirectory      *directory,
 
     request = nautilus_directory_set_up_request (file_attributes);
 
-    if (REQUEST_WANTS_TYPE (request, REQUEST_DIRECTORY_COUNT))
+    if (REQUEST_WANTS_TYPE (request, REQUEST_DIRECTORY_COUNT) ||
+        REQUEST_WANTS_TYPE (request, REQUEST_MIME_LIST))
     {
-        directory_count_cancel (directory);
+        directory_summary_cancel (directory);
     }
     if (REQUEST_WANTS_TYPE (request, REQUEST_DEEP_COUNT))
     {
         deep_count_cancel (directory);
     }
-    if (REQUEST_WANTS_TYPE (request, REQUEST_MIME_LIST))
-    {
-        mime_list_cancel (directory);
-    }
     if (REQUEST_WANTS_TYPE (request, REQUEST_FILE_INFO))
     {
         file_info_cancel (directory);
@@ -4954,18 +6235,15 @@ nautilus_directory_cancel_loading_file_attributes (NautilusDirectory      *direc
 
     request = nautilus_directory_set_up_request (file_attributes);
 
-    if (REQUEST_WANTS_TYPE (request, REQUEST_DIRECTORY_COUNT))
+    if (REQUEST_WANTS_TYPE (request, REQUEST_DIRECTORY_COUNT) ||
+        REQUEST_WANTS_TYPE (request, REQUEST_MIME_LIST))
     {
-        cancel_directory_count_for_file (directory, file);
+        cancel_directory_summary_for_file (directory, file);
     }
     if (REQUEST_WANTS_TYPE (request, REQUEST_DEEP_COUNT))
     {
         cancel_deep_counts_for_file (directory, file);
     }
-    if (REQUEST_WANTS_TYPE (request, REQUEST_MIME_LIST))
-    {
-        cancel_mime_list_for_file (directory, file);
-    }
     if (REQUEST_WANTS_TYPE (request, REQUEST_FILE_INFO))
     {
         cancel_file_info_for_file (directory, file);
@@ -5026,26 +6304,3 @@ nautilus_directory_remove_file_from_work_queue (NautilusDirectory *directory,
     nautilus_file_queue_remove (directory->details->extension_queue,
                                 file);
 }
-
-
-static void
-move_file_to_low_priority_queue (NautilusDirectory *directory,
-                                 NautilusFile      *file)
-{
-    /* Must add before removing to avoid ref underflow */
-    nautilus_file_queue_enqueue (directory->details->low_priority_queue,
-                                 file);
-    nautilus_file_queue_remove (directory->details->high_priority_queue,
-                                file);
-}
-
-static void
-move_file_to_extension_queue (NautilusDirectory *directory,
-                              NautilusFile      *file)
-{
-    /* Must add before removing to avoid ref underflow */
-    nautilus_file_queue_enqueue (directory->details->extension_queue,
-                                 file);
-    nautilus_file_queue_remove (directory->details->low_priority_queue,
-                                file);
-}
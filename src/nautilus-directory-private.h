@@ -24,6 +24,7 @@
 #include "nautilus-directory.h"
 #include "nautilus-file-queue.h"
 #include "nautilus-file.h"
+#include "nautilus-local-enumerator.h"
 #include "nautilus-monitor.h"
 #include <libnautilus-extension/nautilus-info-provider.h>
 #include <libxml/tree.h>
@@ -32,14 +33,14 @@ typedef struct LinkInfoReadState LinkInfoReadState;
 typedef struct TopLeftTextReadState TopLeftTextReadState;
 typedef struct FileMonitors FileMonitors;
 typedef struct DirectoryLoadState DirectoryLoadState;
-typedef struct DirectoryCountState DirectoryCountState;
+typedef struct DirectorySummaryState DirectorySummaryState;
 typedef struct DeepCountState DeepCountState;
 typedef struct GetInfoState GetInfoState;
 typedef struct NewFilesState NewFilesState;
-typedef struct MimeListState MimeListState;
 typedef struct ThumbnailState ThumbnailState;
 typedef struct MountState MountState;
 typedef struct FilesystemInfoState FilesystemInfoState;
+typedef struct PreparedFile PreparedFile;
 
 typedef enum {
 	REQUEST_LINK_INFO,
@@ -87,6 +88,10 @@ struct NautilusDirectoryDetails
 	guint call_ready_idle_id;
 
 	NautilusMonitor *monitor;
+	GList *monitor_link; /* in the list of directories with a monitor */
+	gboolean monitor_suspended; /* changes may have been missed */
+	gint64 monitor_suspended_time;
+	GCancellable *revalidate_cancellable;
 	gulong 		 mime_db_monitor;
 
 	gboolean in_async_service_loop;
@@ -96,39 +101,69 @@ struct NautilusDirectoryDetails
 	gboolean directory_loaded;
 	gboolean directory_loaded_sent_notification;
 	DirectoryLoadState *directory_load_in_progress;
+	gboolean save_listing_cache; /* when the loaded files are all added */
 
-	GList *pending_file_info; /* list of GnomeVFSFileInfo's that are pending */
-	int confirmed_file_count;
+	GQueue *pending_file_info; /* GFileInfo's that are pending, oldest first */
+	GQueue *pending_prepared_files; /* PreparedFile's that are pending, oldest first */
+	guint load_generation; /* bumped when a load starts */
+	int confirmed_file_count; /* files seen by the current load */
         guint dequeue_pending_idle_id;
 
 	GList *new_files_in_progress; /* list of NewFilesState * */
 
-	DirectoryCountState *count_in_progress;
+	/* Attribute classes that can have several requests in flight
+	 * at once keep a list of their states.
+	 */
+	GList *summary_in_progress; /* list of DirectorySummaryState * */
+	DirectorySummaryState *summary_batch; /* gathered, not started yet */
 
 	NautilusFile *deep_count_file;
 	DeepCountState *deep_count_in_progress;
 
-	MimeListState *mime_list_in_progress;
-
-	NautilusFile *get_info_file;
-	GetInfoState *get_info_in_progress;
+	GList *get_info_in_progress; /* list of GetInfoState * */
 
 	NautilusFile *extension_info_file;
 	NautilusInfoProvider *extension_info_provider;
 	NautilusOperationHandle *extension_info_in_progress;
 	guint extension_info_idle;
 
-	ThumbnailState *thumbnail_state;
+	GList *thumbnail_states; /* list of ThumbnailState * */
 
 	MountState *mount_state;
 
-	FilesystemInfoState *filesystem_info_state;
+	GList *filesystem_info_states; /* list of FilesystemInfoState * */
 	
-	LinkInfoReadState *link_info_read_state;
+	GList *link_info_read_states; /* list of LinkInfoReadState * */
 
 	GList *file_operations_in_progress; /* list of FileOperation * */
+
+	/* Whether async. jobs for this directory count against the
+	 * remote job limit. Decided when the first job starts.
+	 */
+	gboolean async_job_pool_set;
+	gboolean async_job_pool_remote;
 };
 
+/* Local and remote locations have separate async. job limits. */
+typedef enum {
+	NAUTILUS_ASYNC_JOB_POOL_LOCAL,
+	NAUTILUS_ASYNC_JOB_POOL_REMOTE,
+	NAUTILUS_ASYNC_JOB_POOL_LAST
+} NautilusAsyncJobPool;
+
+/* Counters kept by the global async. job scheduler. Times are in
+ * microseconds.
+ */
+typedef struct {
+	guint queue_depth;      /* directories waiting for a job slot now */
+	guint max_queue_depth;
+	guint64 blocked_jobs;   /* job starts that had to wait */
+	guint64 wake_ups;       /* waiting directories that got woken up */
+	gint64 total_wait_time;
+	gint64 max_wait_time;
+	int running_jobs[NAUTILUS_ASYNC_JOB_POOL_LAST];
+} NautilusAsyncJobStats;
+
 NautilusDirectory *nautilus_directory_get_existing                    (GFile                     *location);
 
 /* async. interface */
@@ -162,12 +197,14 @@ void               nautilus_directory_get_info_for_new_files          (NautilusD
 								       GList                     *vfs_uris);
 NautilusFile *     nautilus_directory_get_existing_corresponding_file (NautilusDirectory         *directory);
 void               nautilus_directory_invalidate_count_and_mime_list  (NautilusDirectory         *directory);
+void               nautilus_directory_update_count_and_mime_list      (NautilusDirectory         *directory);
 gboolean           nautilus_directory_is_file_list_monitored          (NautilusDirectory         *directory);
 gboolean           nautilus_directory_is_anyone_monitoring_file_list  (NautilusDirectory         *directory);
 gboolean           nautilus_directory_has_active_request_for_file     (NautilusDirectory         *directory,
 								       NautilusFile              *file);
 void               nautilus_directory_remove_file_monitor_link        (NautilusDirectory         *directory,
 								       GList                     *link);
+void               nautilus_directory_set_background_monitor_client   (gconstpointer              client);
 void               nautilus_directory_schedule_dequeue_pending        (NautilusDirectory         *directory);
 void               nautilus_directory_stop_monitoring_file_list       (NautilusDirectory         *directory);
 void               nautilus_directory_cancel                          (NautilusDirectory         *directory);
@@ -227,3 +264,4 @@ void               nautilus_directory_remove_file_from_work_queue     (NautilusD
 
 /* debugging functions */
 int                nautilus_directory_number_outstanding              (void);
+void               nautilus_directory_get_async_job_stats             (NautilusAsyncJobStats     *stats);
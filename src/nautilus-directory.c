@@ -59,6 +59,18 @@ static GParamSpec *properties[NUM_PROPERTIES] = { NULL, };
 
 static GHashTable *directories;
 
+/* Recently viewed directories, most recent first. Each one holds a
+ * reference and a file monitor, which keeps its files loaded and up
+ * to date until it falls off the end.
+ */
+static GQueue retained_directories = G_QUEUE_INIT;
+static guint trim_retained_directories_idle_id;
+
+/* A rough guess of what a loaded file costs, NautilusFile and details
+ * plus the strings and GFileInfo hanging off it.
+ */
+#define RETAINED_BYTES_PER_FILE 1024
+
 static void               nautilus_directory_finalize (GObject *object);
 static NautilusDirectory *nautilus_directory_new (GFile *location);
 static GList *real_get_file_list (NautilusDirectory *directory);
@@ -189,6 +201,8 @@ nautilus_directory_init (NautilusDirectory *directory)
     directory->details->high_priority_queue = nautilus_file_queue_new ();
     directory->details->low_priority_queue = nautilus_file_queue_new ();
     directory->details->extension_queue = nautilus_file_queue_new ();
+    directory->details->pending_file_info = g_queue_new ();
+    directory->details->pending_prepared_files = g_queue_new ();
 }
 
 NautilusDirectory *
@@ -228,7 +242,7 @@ nautilus_directory_finalize (GObject *object)
     g_hash_table_remove (directories, directory->details->location);
 
     nautilus_directory_cancel (directory);
-    g_assert (directory->details->count_in_progress == NULL);
+    g_assert (directory->details->summary_in_progress == NULL);
 
     if (directory->details->monitor_list != NULL)
     {
@@ -236,11 +250,6 @@ nautilus_directory_finalize (GObject *object)
         g_list_free_full (directory->details->monitor_list, g_free);
     }
 
-    if (directory->details->monitor != NULL)
-    {
-        nautilus_monitor_cancel (directory->details->monitor);
-    }
-
     if (directory->details->dequeue_pending_idle_id != 0)
     {
         g_source_remove (directory->details->dequeue_pending_idle_id);
@@ -263,9 +272,11 @@ nautilus_directory_finalize (GObject *object)
     nautilus_file_queue_destroy (directory->details->low_priority_queue);
     nautilus_file_queue_destroy (directory->details->extension_queue);
     g_assert (directory->details->directory_load_in_progress == NULL);
-    g_assert (directory->details->count_in_progress == NULL);
+    g_assert (directory->details->summary_in_progress == NULL);
     g_assert (directory->details->dequeue_pending_idle_id == 0);
-    g_list_free_full (directory->details->pending_file_info, g_object_unref);
+    g_queue_free_full (directory->details->pending_file_info, g_object_unref);
+    g_assert (g_queue_is_empty (directory->details->pending_prepared_files));
+    g_queue_free (directory->details->pending_prepared_files);
 
     G_OBJECT_CLASS (nautilus_directory_parent_class)->finalize (object);
 }
@@ -301,7 +312,7 @@ filtering_changed_callback (gpointer callback_data)
     for (l = dirs; l != NULL; l = l->next)
     {
         directory = NAUTILUS_DIRECTORY (l->data);
-        nautilus_directory_invalidate_count_and_mime_list (directory);
+        nautilus_directory_update_count_and_mime_list (directory);
     }
 
     nautilus_directory_list_unref (dirs);
@@ -374,6 +385,113 @@ async_data_preference_changed_callback (gpointer callback_data)
     g_hash_table_foreach (directories, async_state_changed_one, NULL);
 }
 
+static gsize
+retained_directory_size (NautilusDirectory *directory)
+{
+    return g_hash_table_size (directory->details->file_hash) * RETAINED_BYTES_PER_FILE;
+}
+
+static void
+trim_retained_directories (void)
+{
+    NautilusDirectory *directory;
+    GList *node, *next;
+    guint max_count, count;
+    gsize max_size, size, total_size;
+
+    max_count = MAX (g_settings_get_int (nautilus_preferences,
+                                         NAUTILUS_PREFERENCES_RETAINED_FOLDERS), 0);
+    max_size = (gsize) MAX (g_settings_get_int (nautilus_preferences,
+                                                NAUTILUS_PREFERENCES_RETAINED_FOLDERS_MEMORY), 0) * 1024 * 1024;
+
+    count = 0;
+    total_size = 0;
+    for (node = retained_directories.head; node != NULL; node = next)
+    {
+        next = node->next;
+        directory = node->data;
+        size = retained_directory_size (directory);
+
+        if (count < max_count && total_size + size <= max_size)
+        {
+            count++;
+            total_size += size;
+            continue;
+        }
+
+        g_queue_delete_link (&retained_directories, node);
+        nautilus_directory_file_monitor_remove (directory, &retained_directories);
+        nautilus_directory_unref (directory);
+    }
+}
+
+static gboolean
+trim_retained_directories_idle_callback (gpointer data)
+{
+    trim_retained_directories_idle_id = 0;
+    trim_retained_directories ();
+
+    return G_SOURCE_REMOVE;
+}
+
+/* A retained directory that is still loading keeps growing after it
+ * was retained. Check the limits again once the current batch of
+ * files is through.
+ */
+static void
+retained_directory_grew (NautilusDirectory *directory)
+{
+    if (trim_retained_directories_idle_id == 0 &&
+        g_queue_find (&retained_directories, directory) != NULL)
+    {
+        trim_retained_directories_idle_id =
+            g_idle_add (trim_retained_directories_idle_callback, NULL);
+    }
+}
+
+static void
+retained_folders_changed_callback (gpointer callback_data)
+{
+    g_assert (callback_data == NULL);
+
+    trim_retained_directories ();
+}
+
+void
+nautilus_directory_retain (NautilusDirectory *directory)
+{
+    GList *node;
+
+    g_return_if_fail (NAUTILUS_IS_DIRECTORY (directory));
+
+    /* Searches and other virtual directories are cheap to drop, or
+     * not worth keeping busy in the background.
+     */
+    if (!NAUTILUS_IS_VFS_DIRECTORY (directory))
+    {
+        return;
+    }
+
+    node = g_queue_find (&retained_directories, directory);
+    if (node != NULL)
+    {
+        g_queue_unlink (&retained_directories, node);
+        g_queue_push_head_link (&retained_directories, node);
+    }
+    else
+    {
+        nautilus_directory_file_monitor_add (directory,
+                                             &retained_directories,
+                                             TRUE,
+                                             NAUTILUS_FILE_ATTRIBUTE_INFO,
+                                             NULL, NULL);
+        g_queue_push_head (&retained_directories,
+                           nautilus_directory_ref (directory));
+    }
+
+    trim_retained_directories ();
+}
+
 static void
 add_preferences_callbacks (void)
 {
@@ -387,6 +505,19 @@ add_preferences_callbacks (void)
                               "changed::" NAUTILUS_PREFERENCES_SHOW_DIRECTORY_ITEM_COUNTS,
                               G_CALLBACK (async_data_preference_changed_callback),
                               NULL);
+    /* Nobody looks at retained directories, so they do without
+     * monitors until they are shown again.
+     */
+    nautilus_directory_set_background_monitor_client (&retained_directories);
+
+    g_signal_connect_swapped (nautilus_preferences,
+                              "changed::" NAUTILUS_PREFERENCES_RETAINED_FOLDERS,
+                              G_CALLBACK (retained_folders_changed_callback),
+                              NULL);
+    g_signal_connect_swapped (nautilus_preferences,
+                              "changed::" NAUTILUS_PREFERENCES_RETAINED_FOLDERS_MEMORY,
+                              G_CALLBACK (retained_folders_changed_callback),
+                              NULL);
 }
 
 /**
@@ -832,6 +963,7 @@ nautilus_directory_add_file (NautilusDirectory *directory,
     /* Add to hash table. */
     add_to_hash_table (directory, file, node);
 
+    file->details->load_generation = directory->details->load_generation;
     directory->details->confirmed_file_count++;
 
     add_to_work_queue = FALSE;
@@ -877,7 +1009,7 @@ nautilus_directory_remove_file (NautilusDirectory *directory,
 
     nautilus_directory_remove_file_from_work_queue (directory, file);
 
-    if (!file->details->unconfirmed)
+    if (file->details->load_generation == directory->details->load_generation)
     {
         directory->details->confirmed_file_count--;
     }
@@ -933,6 +1065,7 @@ nautilus_directory_emit_files_added (NautilusDirectory *directory,
         g_signal_emit (directory,
                        signals[FILES_ADDED], 0,
                        added_files);
+        retained_directory_grew (directory);
     }
     nautilus_profile_end (NULL);
 }
@@ -971,6 +1104,7 @@ nautilus_directory_emit_done_loading (NautilusDirectory *directory)
 {
     g_signal_emit (directory,
                    signals[DONE_LOADING], 0);
+    retained_directory_grew (directory);
 }
 
 void
@@ -1042,6 +1176,7 @@ call_files_added_free_list (gpointer key,
     g_signal_emit (key,
                    signals[FILES_ADDED], 0,
                    value);
+    retained_directory_grew (key);
     g_list_free (value);
 }
 
@@ -207,6 +207,18 @@ void               nautilus_directory_file_monitor_remove      (NautilusDirector
 								gconstpointer              client);
 void               nautilus_directory_force_reload             (NautilusDirectory         *directory);
 
+/* Keep a directory that stops being shown loaded and monitored, so
+ * going back to it is instant. Only the most recently viewed ones are
+ * kept, up to the "retained-folders" limits.
+ */
+void               nautilus_directory_retain                   (NautilusDirectory         *directory);
+
+/* Start loading a directory that is likely to be shown next, using
+ * spare I/O capacity only. It gives way to any other directory that
+ * needs a job slot. The few most recent ones are kept loaded.
+ */
+void               nautilus_directory_prefetch                 (NautilusDirectory         *directory);
+
 /* Get a list of all files currently known in the directory. */
 GList *            nautilus_directory_get_file_list            (NautilusDirectory         *directory);
 
@@ -227,6 +239,12 @@ gboolean           nautilus_directory_is_in_trash              (NautilusDirector
 gboolean           nautilus_directory_is_in_recent             (NautilusDirectory         *directory);
 gboolean           nautilus_directory_is_remote                (NautilusDirectory         *directory);
 
+/* Give async. I/O for the directory at this location priority over
+ * other directories. Used for the directory shown in the active
+ * window slot.
+ */
+void               nautilus_directory_set_foreground_location  (GFile                     *location);
+
 /* Return false if directory contains anything besides a Nautilus metafile.
  * Only valid if directory is monitored. Used by the Trash monitor.
  */
@@ -42,13 +42,54 @@ typedef struct
     int screen;
 } NautilusFileChange;
 
+/* A change seen by a directory monitor, waiting for more changes to
+ * the same file to be merged with it.
+ */
+typedef struct
+{
+    NautilusFileChangeKind kind;
+    GFile *location;
+    gint64 first_time;
+    gint64 due_time;
+    GList *link; /* in settling_order */
+} SettlingChange;
+
 typedef struct
 {
     GList *head;
     GList *tail;
     GMutex mutex;
+
+    GHashTable *settling; /* GFile -> SettlingChange */
+    GQueue settling_order; /* oldest first */
+    GHashTable *recent_changes; /* GFile -> time of the last change let through */
+    guint settle_timeout_id;
 } NautilusFileChangesQueue;
 
+enum
+{
+    /* Monitor changes are let through once there was no other change
+     * to the same file for this long, or once they waited for the
+     * longest time.
+     */
+    SETTLE_TIME = 100 * 1000, /* microseconds */
+    MAX_SETTLE_TIME = 1000 * 1000,
+
+    /* A file that keeps changing is not looked at again more often
+     * than this.
+     */
+    CHANGE_RATE_LIMIT = 1000 * 1000,
+
+    SETTLE_CHECK_INTERVAL = 50 /* milliseconds */
+};
+
+static void
+settling_change_free (SettlingChange *change)
+{
+    g_object_unref (change->location);
+    g_free (change);
+}
+
 static NautilusFileChangesQueue *
 nautilus_file_changes_queue_new (void)
 {
@@ -56,6 +97,11 @@ nautilus_file_changes_queue_new (void)
 
     result = g_new0 (NautilusFileChangesQueue, 1);
     g_mutex_init (&result->mutex);
+    result->settling = g_hash_table_new_full (g_file_hash, (GEqualFunc) g_file_equal,
+                                              NULL, (GDestroyNotify) settling_change_free);
+    g_queue_init (&result->settling_order);
+    result->recent_changes = g_hash_table_new_full (g_file_hash, (GEqualFunc) g_file_equal,
+                                                    g_object_unref, g_free);
 
     return result;
 }
@@ -73,22 +119,204 @@ nautilus_file_changes_queue_get (void)
     return file_changes_queue;
 }
 
+static void
+add_change_locked (NautilusFileChangesQueue *queue,
+                   NautilusFileChange       *new_item)
+{
+    queue->head = g_list_prepend (queue->head, new_item);
+    if (queue->tail == NULL)
+    {
+        queue->tail = queue->head;
+    }
+}
+
+/* Moves a settling change to the queue proper. */
+static void
+release_settling_change_locked (NautilusFileChangesQueue *queue,
+                                SettlingChange           *change,
+                                gint64                    now)
+{
+    NautilusFileChange *new_item;
+    gint64 *last_time;
+
+    new_item = g_new0 (NautilusFileChange, 1);
+    new_item->kind = change->kind;
+    new_item->from = g_object_ref (change->location);
+    add_change_locked (queue, new_item);
+
+    if (change->kind == CHANGE_FILE_CHANGED)
+    {
+        last_time = g_new (gint64, 1);
+        *last_time = now;
+        g_hash_table_replace (queue->recent_changes,
+                              g_object_ref (change->location), last_time);
+    }
+
+    g_queue_delete_link (&queue->settling_order, change->link);
+    g_hash_table_remove (queue->settling, change->location);
+}
+
+static void
+release_all_settling_changes_locked (NautilusFileChangesQueue *queue)
+{
+    gint64 now;
+
+    now = g_get_monotonic_time ();
+    while (!g_queue_is_empty (&queue->settling_order))
+    {
+        release_settling_change_locked (queue,
+                                        g_queue_peek_head (&queue->settling_order),
+                                        now);
+    }
+}
+
 static void
 nautilus_file_changes_queue_add_common (NautilusFileChangesQueue *queue,
                                         NautilusFileChange       *new_item)
 {
+    SettlingChange *change;
+
     /* enqueue the new queue item while locking down the list */
     g_mutex_lock (&queue->mutex);
 
-    queue->head = g_list_prepend (queue->head, new_item);
-    if (queue->tail == NULL)
+    /* Whatever the monitors saw before has to come first. For a move
+     * that goes for every file, since both its ends may have been seen
+     * under other names.
+     */
+    if (new_item->kind == CHANGE_FILE_MOVED)
     {
-        queue->tail = queue->head;
+        release_all_settling_changes_locked (queue);
+    }
+    else
+    {
+        change = g_hash_table_lookup (queue->settling, new_item->from);
+        if (change != NULL)
+        {
+            release_settling_change_locked (queue, change, g_get_monotonic_time ());
+        }
     }
 
+    add_change_locked (queue, new_item);
+
     g_mutex_unlock (&queue->mutex);
 }
 
+static gboolean
+recent_change_is_stale (gpointer key,
+                        gpointer value,
+                        gpointer user_data)
+{
+    gint64 *last_time, *now;
+
+    last_time = value;
+    now = user_data;
+
+    return *now - *last_time >= CHANGE_RATE_LIMIT;
+}
+
+static gboolean
+settle_timeout_callback (gpointer callback_data)
+{
+    NautilusFileChangesQueue *queue;
+    SettlingChange *change;
+    gint64 now, *last_time;
+    GList *node, *next;
+    gboolean released, keep_going;
+
+    queue = callback_data;
+    now = g_get_monotonic_time ();
+    released = FALSE;
+
+    g_mutex_lock (&queue->mutex);
+
+    for (node = queue->settling_order.head; node != NULL; node = next)
+    {
+        next = node->next;
+        change = node->data;
+
+        if (change->kind == CHANGE_FILE_CHANGED)
+        {
+            last_time = g_hash_table_lookup (queue->recent_changes, change->location);
+            if (last_time != NULL &&
+                change->due_time < *last_time + CHANGE_RATE_LIMIT)
+            {
+                change->due_time = *last_time + CHANGE_RATE_LIMIT;
+            }
+        }
+
+        if (change->due_time <= now)
+        {
+            release_settling_change_locked (queue, change, now);
+            released = TRUE;
+        }
+    }
+
+    g_hash_table_foreach_remove (queue->recent_changes, recent_change_is_stale, &now);
+
+    keep_going = !g_queue_is_empty (&queue->settling_order) ||
+                 g_hash_table_size (queue->recent_changes) > 0;
+    if (!keep_going)
+    {
+        queue->settle_timeout_id = 0;
+    }
+
+    g_mutex_unlock (&queue->mutex);
+
+    if (released)
+    {
+        nautilus_file_changes_consume_changes (TRUE);
+    }
+
+    return keep_going;
+}
+
+/* Merges a new monitor change into the one already waiting for the
+ * same file. Returns FALSE if the two cancel each other out.
+ */
+static gboolean
+merge_settling_change (SettlingChange         *change,
+                       NautilusFileChangeKind  kind)
+{
+    switch (change->kind)
+    {
+        case CHANGE_FILE_ADDED:
+        {
+            /* A file that comes and goes was never there as far as
+             * anyone else can tell. Changes to a new file are seen when
+             * it is added.
+             */
+            return kind != CHANGE_FILE_REMOVED;
+        }
+
+        case CHANGE_FILE_CHANGED:
+        {
+            if (kind == CHANGE_FILE_REMOVED)
+            {
+                change->kind = CHANGE_FILE_REMOVED;
+            }
+        }
+        break;
+
+        case CHANGE_FILE_REMOVED:
+        {
+            /* Replaced by another file of the same name. */
+            if (kind != CHANGE_FILE_REMOVED)
+            {
+                change->kind = CHANGE_FILE_CHANGED;
+            }
+        }
+        break;
+
+        default:
+        {
+            g_assert_not_reached ();
+        }
+        break;
+    }
+
+    return TRUE;
+}
+
 void
 nautilus_file_changes_queue_file_added (GFile *location)
 {
@@ -131,6 +359,87 @@ nautilus_file_changes_queue_file_removed (GFile *location)
     nautilus_file_changes_queue_add_common (queue, new_item);
 }
 
+/* Changes seen by directory monitors come in bursts, so they wait a
+ * little for more changes to the same file and are merged with them
+ * before anyone is told.
+ */
+void
+nautilus_file_changes_queue_monitor_event (GFile             *location,
+                                           GFileMonitorEvent  event_type)
+{
+    NautilusFileChangesQueue *queue;
+    NautilusFileChangeKind kind;
+    SettlingChange *change;
+    gint64 now;
+
+    switch (event_type)
+    {
+        case G_FILE_MONITOR_EVENT_ATTRIBUTE_CHANGED:
+        case G_FILE_MONITOR_EVENT_CHANGES_DONE_HINT:
+        {
+            kind = CHANGE_FILE_CHANGED;
+        }
+        break;
+
+        case G_FILE_MONITOR_EVENT_UNMOUNTED:
+        case G_FILE_MONITOR_EVENT_DELETED:
+        {
+            kind = CHANGE_FILE_REMOVED;
+        }
+        break;
+
+        case G_FILE_MONITOR_EVENT_CREATED:
+        {
+            kind = CHANGE_FILE_ADDED;
+        }
+        break;
+
+        default:
+        {
+            /* ignore */
+            return;
+        }
+    }
+
+    queue = nautilus_file_changes_queue_get ();
+    now = g_get_monotonic_time ();
+
+    g_mutex_lock (&queue->mutex);
+
+    change = g_hash_table_lookup (queue->settling, location);
+    if (change == NULL)
+    {
+        change = g_new0 (SettlingChange, 1);
+        change->kind = kind;
+        change->location = g_object_ref (location);
+        change->first_time = now;
+        g_queue_push_tail (&queue->settling_order, change);
+        change->link = queue->settling_order.tail;
+        g_hash_table_insert (queue->settling, change->location, change);
+    }
+    else if (!merge_settling_change (change, kind))
+    {
+        g_queue_delete_link (&queue->settling_order, change->link);
+        g_hash_table_remove (queue->settling, location);
+        change = NULL;
+    }
+
+    if (change != NULL)
+    {
+        change->due_time = MIN (now + SETTLE_TIME,
+                                change->first_time + MAX_SETTLE_TIME);
+    }
+
+    if (queue->settle_timeout_id == 0)
+    {
+        queue->settle_timeout_id = g_timeout_add (SETTLE_CHECK_INTERVAL,
+                                                  settle_timeout_callback,
+                                                  queue);
+    }
+
+    g_mutex_unlock (&queue->mutex);
+}
+
 void
 nautilus_file_changes_queue_file_moved (GFile *from,
                                         GFile *to)
@@ -26,6 +26,8 @@
 void nautilus_file_changes_queue_file_added                      (GFile      *location);
 void nautilus_file_changes_queue_file_changed                    (GFile      *location);
 void nautilus_file_changes_queue_file_removed                    (GFile      *location);
+void nautilus_file_changes_queue_monitor_event                   (GFile      *location,
+								  GFileMonitorEvent event_type);
 void nautilus_file_changes_queue_file_moved                      (GFile      *from,
 								  GFile      *to);
 void nautilus_file_changes_queue_schedule_position_set           (GFile      *location,
@@ -24,6 +24,7 @@
 
 #include "nautilus-directory.h"
 #include "nautilus-file.h"
+#include "nautilus-local-enumerator.h"
 #include "nautilus-monitor.h"
 #include "nautilus-file-undo-operations.h"
 #include <eel/eel-glib-extensions.h>
@@ -41,6 +42,53 @@ typedef enum {
 	UNKNOWN
 } Knowledge;
 
+/* Fields that most files never set. They are allocated the first time
+ * one of them is set, to keep the many NautilusFile objects small.
+ */
+typedef struct
+{
+	char *description;
+
+	char *trash_orig_path;
+	time_t trash_time; /* 0 is unknown */
+
+	guint deep_directory_count;
+	guint deep_file_count;
+	guint deep_unreadable_count;
+	goffset deep_size;
+
+	guint64 free_space; /* (guint)-1 for unknown */
+	time_t free_space_read; /* The time free_space was updated, or 0 for never */
+
+	/* The following is for file operations in progress. */
+	GList *operations_in_progress;
+
+	/* Emblems provided by extensions */
+	GList *extension_emblems;
+	GList *pending_extension_emblems;
+
+	/* Attributes provided by extensions */
+	GHashTable *extension_attributes;
+	GHashTable *pending_extension_attributes;
+} NautilusFileRareDetails;
+
+/* Sort keys that are costly to work out. They are made the first time
+ * a sort needs them and dropped whenever the file changes.
+ */
+typedef struct
+{
+	guint generation; /* all keys are stale when it is not current */
+
+	gboolean type_key_set;
+	char *type_collation_key; /* NULL if the file has no type */
+
+	gboolean size_key_set;
+	gint64 size_key;
+
+	GQuark attribute_q; /* what attribute_value is for, 0 for nothing */
+	eel_ref_str attribute_value;
+} NautilusFileSortKeys;
+
 struct NautilusFileDetails
 {
 	NautilusDirectory *directory;
@@ -73,19 +121,16 @@ struct NautilusFileDetails
 	char *symlink_name;
 	
 	eel_ref_str mime_type;
-	
-	char *selinux_context;
-	char *description;
+
+	/* Set for nearly every file where SELinux is enabled, and shared
+	 * by most files of a folder.
+	 */
+	eel_ref_str selinux_context;
 	
 	GError *get_info_error;
 	
 	guint directory_count;
 
-	guint deep_directory_count;
-	guint deep_file_count;
-	guint deep_unreadable_count;
-	goffset deep_size;
-
 	GIcon *icon;
 	
 	char *thumbnail_path;
@@ -106,27 +151,23 @@ struct NautilusFileDetails
 	 */
 	eel_ref_str filesystem_id;
 
-	char *trash_orig_path;
-
-	/* The following is for file operations in progress. Since
-	 * there are normally only a few of these, we can move them to
-	 * a separate hash table or something if required to keep the
-	 * file objects small.
-	 */
-	GList *operations_in_progress;
-
 	/* NautilusInfoProviders that need to be run for this file */
 	GList *pending_info_providers;
 
-	/* Emblems provided by extensions */
-	GList *extension_emblems;
-	GList *pending_extension_emblems;
+	GHashTable *metadata;
 
-	/* Attributes provided by extensions */
-	GHashTable *extension_attributes;
-	GHashTable *pending_extension_attributes;
+	NautilusFileRareDetails *rare; /* NULL until needed */
+	NautilusFileSortKeys *sort_keys; /* NULL until a sort needs them */
 
-	GHashTable *metadata;
+	/* The load of the directory that last saw this file. Files that
+	 * the current load has not seen yet are unconfirmed.
+	 */
+	guint load_generation;
+
+	/* Summary of the attributes a reload is most likely to change,
+	 * 0 if unknown. When it is the same, the rest is not compared.
+	 */
+	guint64 change_signature;
 
 	/* Mount for mountpoint or the references GMount for a "mountable" */
 	GMount *mount;
@@ -134,11 +175,14 @@ struct NautilusFileDetails
 	/* boolean fields: bitfield to save space, since there can be
            many NautilusFile objects. */
 
-	eel_boolean_bit unconfirmed                   : 1;
 	eel_boolean_bit is_gone                       : 1;
 	/* Set when emitting files_added on the directory to make sure we
 	   add a file, and only once */
 	eel_boolean_bit is_added                      : 1;
+	/* Set while the file only comes from the listing cache and the
+	 * load has not seen it yet.
+	 */
+	eel_boolean_bit is_from_listing_cache         : 1;
 	/* Set by the NautilusDirectory while it's loading the file
 	 * list so the file knows not to do redundant I/O.
 	 */
@@ -204,12 +248,7 @@ struct NautilusFileDetails
 	eel_boolean_bit filesystem_info_is_up_to_date : 1;
         eel_ref_str     filesystem_type;
 
-	time_t trash_time; /* 0 is unknown */
-
 	gdouble search_relevance;
-
-	guint64 free_space; /* (guint)-1 for unknown */
-	time_t free_space_read; /* The time free_space was updated, or 0 for never */
 };
 
 typedef struct {
@@ -229,9 +268,26 @@ typedef struct {
 
 NautilusFile *nautilus_file_new_from_info                  (NautilusDirectory      *directory,
 							    GFileInfo              *info);
+NautilusFile *nautilus_file_new_detached_from_info         (NautilusDirectory      *directory,
+							    const char             *directory_name_collation_key,
+							    GFileInfo              *info);
+NautilusFile *nautilus_file_new_detached_from_local_entry  (NautilusDirectory      *directory,
+							    const char             *directory_name_collation_key,
+							    NautilusLocalEntry     *entry);
+void          nautilus_file_attach_detached                (NautilusFile           *file);
+void          nautilus_file_discard_detached               (NautilusFile           *file);
 void          nautilus_file_emit_changed                   (NautilusFile           *file);
 void          nautilus_file_mark_gone                      (NautilusFile           *file);
 
+/* The rarely set fields, for reading. Files that never set any of
+ * them share one block holding the unset values.
+ */
+const NautilusFileRareDetails *
+              nautilus_file_peek_rare                      (NautilusFile           *file);
+/* The rarely set fields, for changing them. */
+NautilusFileRareDetails *
+              nautilus_file_get_rare                       (NautilusFile           *file);
+
 gboolean      nautilus_file_get_date                       (NautilusFile           *file,
 							    NautilusDateType        date_type,
 							    time_t                 *date);
@@ -248,6 +304,8 @@ gboolean      nautilus_file_update_name                    (NautilusFile
 							    const char             *name);
 gboolean      nautilus_file_update_metadata_from_info      (NautilusFile           *file,
 							    GFileInfo              *info);
+gboolean      nautilus_file_update_from_local_entry        (NautilusFile           *file,
+							    NautilusLocalEntry     *entry);
 
 gboolean      nautilus_file_update_name_and_directory      (NautilusFile           *file,
 							    const char             *name,
@@ -126,6 +126,8 @@ static NautilusSpeedTradeoffValue show_file_thumbs;
 
 static NautilusSpeedTradeoffValue show_directory_item_count;
 
+static guint sort_keys_generation;
+
 static GQuark attribute_name_q,
               attribute_size_q,
               attribute_type_q,
@@ -163,13 +165,35 @@ static char *nautilus_file_get_owner_as_string (NautilusFile *file,
                                                 gboolean      include_real_name);
 static char *nautilus_file_get_type_as_string (NautilusFile *file);
 static char *nautilus_file_get_detailed_type_as_string (NautilusFile *file);
+
+/* How update_info_internal() and update_from_local_entry_internal()
+ * treat the name and the global symlink table.
+ */
+typedef enum
+{
+    UPDATE_INFO_KEEP_NAME,
+    UPDATE_INFO_NAME,
+    /* The file is not in its directory yet and has its name already.
+     * This may run on a worker thread, so the symlink table is left
+     * to nautilus_file_attach_detached().
+     */
+    UPDATE_INFO_DETACHED
+} UpdateInfoMode;
+
+static gboolean update_info_internal (NautilusFile   *file,
+                                      GFileInfo      *info,
+                                      UpdateInfoMode  mode);
 static gboolean update_info_and_name (NautilusFile *file,
                                       GFileInfo    *info);
+static gboolean update_from_local_entry_internal (NautilusFile       *file,
+                                                  NautilusLocalEntry *entry,
+                                                  UpdateInfoMode      mode);
 static const char *nautilus_file_peek_display_name (NautilusFile *file);
 static const char *nautilus_file_peek_display_name_collation_key (NautilusFile *file);
 static void file_mount_unmounted (GMount  *mount,
                                   gpointer data);
 static void metadata_hash_free (GHashTable *hash);
+static void update_links_if_target (NautilusFile *target_file);
 static gboolean real_drag_can_accept_files (NautilusFile *drop_target_item);
 
 G_DEFINE_TYPE_WITH_CODE (NautilusFile, nautilus_file, G_TYPE_OBJECT,
@@ -183,8 +207,87 @@ nautilus_file_init (NautilusFile *file)
 
     nautilus_file_clear_info (file);
     nautilus_file_invalidate_extension_info_internal (file);
+}
+
+static const NautilusFileRareDetails rare_details_unset =
+{
+    .free_space = (guint64) - 1,
+};
+
+const NautilusFileRareDetails *
+nautilus_file_peek_rare (NautilusFile *file)
+{
+    return file->details->rare != NULL ? file->details->rare : &rare_details_unset;
+}
+
+NautilusFileRareDetails *
+nautilus_file_get_rare (NautilusFile *file)
+{
+    if (file->details->rare == NULL)
+    {
+        file->details->rare = g_slice_dup (NautilusFileRareDetails, &rare_details_unset);
+    }
+
+    return file->details->rare;
+}
+
+static void
+clear_sort_keys (NautilusFile *file)
+{
+    NautilusFileSortKeys *keys;
+
+    keys = file->details->sort_keys;
+    if (keys == NULL)
+    {
+        return;
+    }
 
-    file->details->free_space = -1;
+    g_free (keys->type_collation_key);
+    eel_ref_str_unref (keys->attribute_value);
+    g_slice_free (NautilusFileSortKeys, keys);
+    file->details->sort_keys = NULL;
+}
+
+static NautilusFileSortKeys *
+get_sort_keys (NautilusFile *file)
+{
+    if (file->details->sort_keys != NULL &&
+        file->details->sort_keys->generation != sort_keys_generation)
+    {
+        clear_sort_keys (file);
+    }
+
+    if (file->details->sort_keys == NULL)
+    {
+        file->details->sort_keys = g_slice_new0 (NautilusFileSortKeys);
+        file->details->sort_keys->generation = sort_keys_generation;
+    }
+
+    return file->details->sort_keys;
+}
+
+static void
+rare_details_free (NautilusFileRareDetails *rare)
+{
+    g_assert (rare->operations_in_progress == NULL);
+
+    g_free (rare->description);
+    g_free (rare->trash_orig_path);
+
+    g_list_free_full (rare->pending_extension_emblems, g_free);
+    g_list_free_full (rare->extension_emblems, g_free);
+
+    if (rare->pending_extension_attributes)
+    {
+        g_hash_table_destroy (rare->pending_extension_attributes);
+    }
+
+    if (rare->extension_attributes)
+    {
+        g_hash_table_destroy (rare->extension_attributes);
+    }
+
+    g_slice_free (NautilusFileRareDetails, rare);
 }
 
 static GObject *
@@ -530,15 +633,17 @@ nautilus_file_clear_info (NautilusFile *file)
     file->details->sort_order = 0;
     file->details->mtime = 0;
     file->details->atime = 0;
-    file->details->trash_time = 0;
     g_free (file->details->symlink_name);
     file->details->symlink_name = NULL;
     eel_ref_str_unref (file->details->mime_type);
     file->details->mime_type = NULL;
-    g_free (file->details->selinux_context);
+    eel_ref_str_unref (file->details->selinux_context);
     file->details->selinux_context = NULL;
-    g_free (file->details->description);
-    file->details->description = NULL;
+    if (file->details->rare != NULL)
+    {
+        file->details->rare->trash_time = 0;
+        g_clear_pointer (&file->details->rare->description, g_free);
+    }
     eel_ref_str_unref (file->details->owner);
     file->details->owner = NULL;
     eel_ref_str_unref (file->details->owner_real);
@@ -700,6 +805,91 @@ nautilus_file_new_from_info (NautilusDirectory *directory,
     return file;
 }
 
+static NautilusFile *
+nautilus_file_new_detached (NautilusDirectory *directory,
+                            const char        *directory_name_collation_key,
+                            const char        *name)
+{
+    NautilusFile *file;
+
+    file = NAUTILUS_FILE (g_object_new (NAUTILUS_TYPE_VFS_FILE, NULL));
+    file->details->directory = nautilus_directory_ref (directory);
+    file->details->directory_name_collation_key = g_strdup (directory_name_collation_key);
+    file->details->name = eel_ref_str_new (name);
+
+    return file;
+}
+
+/* The nautilus_file_new_detached_* () calls build a file for a
+ * directory without touching the directory, so they can be used from
+ * a worker thread. The only shared state they read is the list of
+ * info providers, which nautilus-module.c guards. The caller passes
+ * the collation key of the directory URI, to avoid computing it again
+ * for every file.
+ *
+ * Once back on the main thread, the file is either added to the
+ * directory and given to nautilus_file_attach_detached(), or dropped
+ * with nautilus_file_discard_detached().
+ */
+NautilusFile *
+nautilus_file_new_detached_from_info (NautilusDirectory *directory,
+                                      const char        *directory_name_collation_key,
+                                      GFileInfo         *info)
+{
+    NautilusFile *file;
+
+    g_return_val_if_fail (NAUTILUS_IS_DIRECTORY (directory), NULL);
+    g_return_val_if_fail (info != NULL, NULL);
+
+    file = nautilus_file_new_detached (directory,
+                                       directory_name_collation_key,
+                                       g_file_info_get_name (info));
+    update_info_internal (file, info, UPDATE_INFO_DETACHED);
+
+    return file;
+}
+
+NautilusFile *
+nautilus_file_new_detached_from_local_entry (NautilusDirectory  *directory,
+                                             const char         *directory_name_collation_key,
+                                             NautilusLocalEntry *entry)
+{
+    NautilusFile *file;
+
+    g_return_val_if_fail (NAUTILUS_IS_DIRECTORY (directory), NULL);
+    g_return_val_if_fail (entry != NULL && !entry->metadata_only, NULL);
+
+    file = nautilus_file_new_detached (directory,
+                                       directory_name_collation_key,
+                                       entry->name);
+    update_from_local_entry_internal (file, entry, UPDATE_INFO_DETACHED);
+
+    return file;
+}
+
+void
+nautilus_file_attach_detached (NautilusFile *file)
+{
+    g_return_if_fail (NAUTILUS_IS_FILE (file));
+
+    add_to_link_hash_table (file);
+    update_links_if_target (file);
+
+#ifdef NAUTILUS_FILE_DEBUG_REF
+    DEBUG_REF_PRINTF ("%10p ref'd", file);
+#endif
+}
+
+void
+nautilus_file_discard_detached (NautilusFile *file)
+{
+    g_return_if_fail (NAUTILUS_IS_FILE (file));
+
+    /* Keep finalize from looking for the file in its directory. */
+    file->details->is_gone = TRUE;
+    nautilus_file_unref (file);
+}
+
 static NautilusFile *
 nautilus_file_get_internal (GFile    *location,
                             gboolean  create)
@@ -827,8 +1017,6 @@ finalize (GObject *object)
 
     file = NAUTILUS_FILE (object);
 
-    g_assert (file->details->operations_in_progress == NULL);
-
     if (file->details->is_thumbnailing)
     {
         uri = nautilus_file_get_uri (file);
@@ -872,11 +1060,10 @@ finalize (GObject *object)
     g_free (file->details->thumbnail_path);
     g_free (file->details->symlink_name);
     eel_ref_str_unref (file->details->mime_type);
+    eel_ref_str_unref (file->details->selinux_context);
     eel_ref_str_unref (file->details->owner);
     eel_ref_str_unref (file->details->owner_real);
     eel_ref_str_unref (file->details->group);
-    g_free (file->details->selinux_context);
-    g_free (file->details->description);
     g_free (file->details->activation_uri);
     g_clear_object (&file->details->custom_icon);
 
@@ -898,22 +1085,15 @@ finalize (GObject *object)
     eel_ref_str_unref (file->details->filesystem_id);
     eel_ref_str_unref (file->details->filesystem_type);
     file->details->filesystem_type = NULL;
-    g_free (file->details->trash_orig_path);
 
     g_list_free_full (file->details->mime_list, g_free);
-    g_list_free_full (file->details->pending_extension_emblems, g_free);
-    g_list_free_full (file->details->extension_emblems, g_free);
     g_list_free_full (file->details->pending_info_providers, g_object_unref);
 
-    if (file->details->pending_extension_attributes)
-    {
-        g_hash_table_destroy (file->details->pending_extension_attributes);
-    }
-
-    if (file->details->extension_attributes)
+    if (file->details->rare != NULL)
     {
-        g_hash_table_destroy (file->details->extension_attributes);
+        rare_details_free (file->details->rare);
     }
+    clear_sort_keys (file);
 
     if (file->details->metadata)
     {
@@ -1813,8 +1993,8 @@ nautilus_file_operation_new (NautilusFile                  *file,
     op->callback_data = callback_data;
     op->cancellable = g_cancellable_new ();
 
-    op->file->details->operations_in_progress = g_list_prepend
-                                                    (op->file->details->operations_in_progress, op);
+    nautilus_file_get_rare (file)->operations_in_progress =
+        g_list_prepend (nautilus_file_get_rare (file)->operations_in_progress, op);
 
     return op;
 }
@@ -1825,15 +2005,15 @@ nautilus_file_operation_remove (NautilusFileOperation *op)
     GList *l;
     NautilusFile *file;
 
-    op->file->details->operations_in_progress = g_list_remove
-                                                    (op->file->details->operations_in_progress, op);
+    nautilus_file_get_rare (op->file)->operations_in_progress =
+        g_list_remove (nautilus_file_get_rare (op->file)->operations_in_progress, op);
 
 
     for (l = op->files; l != NULL; l = l->next)
     {
         file = NAUTILUS_FILE (l->data);
-        file->details->operations_in_progress = g_list_remove
-                                                    (file->details->operations_in_progress, op);
+        nautilus_file_get_rare (file)->operations_in_progress =
+            g_list_remove (nautilus_file_get_rare (file)->operations_in_progress, op);
     }
 }
 
@@ -2285,8 +2465,8 @@ real_batch_rename (GList                         *files,
     {
         file = NAUTILUS_FILE (l1->data);
 
-        file->details->operations_in_progress = g_list_prepend (file->details->operations_in_progress,
-                                                                op);
+        nautilus_file_get_rare (file)->operations_in_progress =
+            g_list_prepend (nautilus_file_get_rare (file)->operations_in_progress, op);
     }
 
     for (l1 = files, l2 = new_names; l1 != NULL && l2 != NULL; l1 = l1->next, l2 = l2->next)
@@ -2454,7 +2634,7 @@ nautilus_file_rename_in_progress (NautilusFile *file)
     GList *node;
     NautilusFileOperation *op;
 
-    for (node = file->details->operations_in_progress; node != NULL; node = node->next)
+    for (node = nautilus_file_peek_rare (file)->operations_in_progress; node != NULL; node = node->next)
     {
         op = node->data;
         if (op->is_rename)
@@ -2473,7 +2653,7 @@ nautilus_file_cancel (NautilusFile                  *file,
     GList *node, *next;
     NautilusFileOperation *op;
 
-    for (node = file->details->operations_in_progress; node != NULL; node = next)
+    for (node = nautilus_file_peek_rare (file)->operations_in_progress; node != NULL; node = next)
     {
         next = node->next;
         op = node->data;
@@ -2588,11 +2768,185 @@ update_links_if_target (NautilusFile *target_file)
 }
 
 static gboolean
-update_info_internal (NautilusFile *file,
-                      GFileInfo    *info,
-                      gboolean      update_name)
+update_name_from_info (NautilusFile *file,
+                       const char   *name,
+                       gboolean      has_display_name)
 {
     GList *node;
+
+    if (file->details->name != NULL &&
+        strcmp (eel_ref_str_peek (file->details->name), name) == 0)
+    {
+        return FALSE;
+    }
+
+    node = nautilus_directory_begin_file_name_change
+               (file->details->directory, file);
+
+    eel_ref_str_unref (file->details->name);
+    if (g_strcmp0 (eel_ref_str_peek (file->details->display_name),
+                   name) == 0)
+    {
+        file->details->name = eel_ref_str_ref (file->details->display_name);
+    }
+    else
+    {
+        file->details->name = eel_ref_str_new (name);
+    }
+
+    if (!file->details->got_custom_display_name &&
+        !has_display_name)
+    {
+        /* If the file info's display name is NULL,
+         * nautilus_file_set_display_name() did
+         * not unset the display name.
+         */
+        nautilus_file_clear_display_name (file);
+    }
+
+    nautilus_directory_end_file_name_change
+        (file->details->directory, file, node);
+
+    return TRUE;
+}
+
+/* A cheap summary of what stat() says about a file, used to tell a
+ * reload that found nothing new from one that needs a full update.
+ * The change time moves on any write, chmod, chown or xattr change,
+ * together with the mtime, size and inode it covers what the file
+ * info reads from the file itself. The rest can change while the
+ * file stays as it is: thumbnails are made without touching it, the
+ * content type and icon change with the MIME database, hiding comes
+ * from the .hidden file of the directory and access from the
+ * permissions of the directory. So those are mixed in as well.
+ * 0 means unknown.
+ */
+static guint64
+mix_change_signature (guint64 signature,
+                      guint64 value)
+{
+    int i;
+
+    for (i = 0; i < 8; i++)
+    {
+        signature ^= (value >> (i * 8)) & 0xff;
+        signature *= G_GUINT64_CONSTANT (0x100000001b3);
+    }
+
+    return signature;
+}
+
+static guint
+make_change_flags (gboolean is_hidden,
+                   gboolean can_read,
+                   gboolean can_write,
+                   gboolean can_execute,
+                   gboolean can_delete,
+                   gboolean can_rename,
+                   gboolean can_trash)
+{
+    return (is_hidden ? 1 << 0 : 0) |
+           (can_read ? 1 << 1 : 0) |
+           (can_write ? 1 << 2 : 0) |
+           (can_execute ? 1 << 3 : 0) |
+           (can_delete ? 1 << 4 : 0) |
+           (can_rename ? 1 << 5 : 0) |
+           (can_trash ? 1 << 6 : 0);
+}
+
+static guint64
+make_change_signature (guint64     device,
+                       guint64     inode,
+                       goffset     size,
+                       time_t      mtime,
+                       guint32     mtime_usec,
+                       time_t      ctime,
+                       guint32     ctime_usec,
+                       const char *thumbnail_path,
+                       gboolean    thumbnailing_failed,
+                       const char *content_type,
+                       GIcon      *icon,
+                       guint       flags)
+{
+    guint64 signature;
+
+    signature = G_GUINT64_CONSTANT (0xcbf29ce484222325);
+    signature = mix_change_signature (signature, device);
+    signature = mix_change_signature (signature, inode);
+    signature = mix_change_signature (signature, size);
+    signature = mix_change_signature (signature, mtime);
+    signature = mix_change_signature (signature, mtime_usec);
+    signature = mix_change_signature (signature, ctime);
+    signature = mix_change_signature (signature, ctime_usec);
+    signature = mix_change_signature (signature,
+                                      thumbnail_path != NULL ? g_str_hash (thumbnail_path) : 0);
+    signature = mix_change_signature (signature, thumbnailing_failed);
+    signature = mix_change_signature (signature,
+                                      content_type != NULL ? g_str_hash (content_type) : 0);
+    signature = mix_change_signature (signature,
+                                      icon != NULL ? g_icon_hash (icon) : 0);
+    signature = mix_change_signature (signature, flags);
+
+    return signature != 0 ? signature : 1;
+}
+
+static guint64
+get_info_change_signature (GFileInfo *info)
+{
+    if (!g_file_info_has_attribute (info, G_FILE_ATTRIBUTE_UNIX_INODE) ||
+        !g_file_info_has_attribute (info, G_FILE_ATTRIBUTE_TIME_CHANGED))
+    {
+        return 0;
+    }
+
+    return make_change_signature (g_file_info_get_attribute_uint32 (info, G_FILE_ATTRIBUTE_UNIX_DEVICE),
+                                  g_file_info_get_attribute_uint64 (info, G_FILE_ATTRIBUTE_UNIX_INODE),
+                                  g_file_info_get_size (info),
+                                  g_file_info_get_attribute_uint64 (info, G_FILE_ATTRIBUTE_TIME_MODIFIED),
+                                  g_file_info_get_attribute_uint32 (info, G_FILE_ATTRIBUTE_TIME_MODIFIED_USEC),
+                                  g_file_info_get_attribute_uint64 (info, G_FILE_ATTRIBUTE_TIME_CHANGED),
+                                  g_file_info_get_attribute_uint32 (info, G_FILE_ATTRIBUTE_TIME_CHANGED_USEC),
+                                  g_file_info_get_attribute_byte_string (info, G_FILE_ATTRIBUTE_THUMBNAIL_PATH),
+                                  g_file_info_get_attribute_boolean (info, G_FILE_ATTRIBUTE_THUMBNAILING_FAILED),
+                                  g_file_info_get_content_type (info),
+                                  g_file_info_get_icon (info),
+                                  make_change_flags (g_file_info_get_is_hidden (info),
+                                                     g_file_info_get_attribute_boolean (info, G_FILE_ATTRIBUTE_ACCESS_CAN_READ),
+                                                     g_file_info_get_attribute_boolean (info, G_FILE_ATTRIBUTE_ACCESS_CAN_WRITE),
+                                                     g_file_info_get_attribute_boolean (info, G_FILE_ATTRIBUTE_ACCESS_CAN_EXECUTE),
+                                                     g_file_info_get_attribute_boolean (info, G_FILE_ATTRIBUTE_ACCESS_CAN_DELETE),
+                                                     g_file_info_get_attribute_boolean (info, G_FILE_ATTRIBUTE_ACCESS_CAN_RENAME),
+                                                     g_file_info_get_attribute_boolean (info, G_FILE_ATTRIBUTE_ACCESS_CAN_TRASH)));
+}
+
+static guint64
+get_local_entry_change_signature (NautilusLocalEntry *entry)
+{
+    return make_change_signature (entry->device,
+                                  entry->inode,
+                                  entry->size,
+                                  entry->mtime,
+                                  entry->mtime_nsec / 1000,
+                                  entry->ctime,
+                                  entry->ctime_nsec / 1000,
+                                  entry->thumbnail_path,
+                                  entry->thumbnailing_failed,
+                                  entry->content_type,
+                                  entry->icon,
+                                  make_change_flags (entry->is_hidden,
+                                                     entry->can_read,
+                                                     entry->can_write,
+                                                     entry->can_execute,
+                                                     entry->can_delete,
+                                                     entry->can_rename,
+                                                     entry->can_trash));
+}
+
+static gboolean
+update_info_internal (NautilusFile   *file,
+                      GFileInfo      *info,
+                      UpdateInfoMode  mode)
+{
     gboolean changed;
     gboolean is_symlink, is_hidden, is_mountpoint;
     gboolean has_permissions;
@@ -2608,7 +2962,7 @@ update_info_internal (NautilusFile *file,
     time_t trash_time;
     GTimeVal g_trash_time;
     const char *time_string;
-    const char *symlink_name, *mime_type, *selinux_context, *name, *thumbnail_path;
+    const char *symlink_name, *mime_type, *selinux_context, *thumbnail_path;
     GFileType file_type;
     GIcon *icon;
     char *old_activation_uri;
@@ -2618,6 +2972,7 @@ update_info_internal (NautilusFile *file,
     const char *trash_orig_path;
     const char *group, *owner, *owner_real;
     gboolean free_owner, free_group;
+    guint64 signature;
 
     if (file->details->is_gone)
     {
@@ -2630,13 +2985,30 @@ update_info_internal (NautilusFile *file,
         return TRUE;
     }
 
+    /* Reloads mostly find files as they were. If stat() agrees,
+     * only the metadata, which lives elsewhere, can have changed.
+     */
+    signature = get_info_change_signature (info);
+    if (mode == UPDATE_INFO_KEEP_NAME &&
+        file->details->got_file_info &&
+        signature != 0 &&
+        signature == file->details->change_signature)
+    {
+        file->details->file_info_is_up_to_date = TRUE;
+        return nautilus_file_update_metadata_from_info (file, info);
+    }
+    file->details->change_signature = signature;
+
     file->details->file_info_is_up_to_date = TRUE;
 
     /* FIXME bugzilla.gnome.org 42044: Need to let links that
      * point to the old name know that the file has been renamed.
      */
 
-    remove_from_link_hash_table (file);
+    if (mode != UPDATE_INFO_DETACHED)
+    {
+        remove_from_link_hash_table (file);
+    }
 
     changed = FALSE;
 
@@ -2982,108 +3354,332 @@ update_info_internal (NautilusFile *file,
         file->details->thumbnailing_failed = thumbnailing_failed;
     }
 
-    symlink_name = g_file_info_get_symlink_target (info);
-    if (g_strcmp0 (file->details->symlink_name, symlink_name) != 0)
+    symlink_name = g_file_info_get_symlink_target (info);
+    if (g_strcmp0 (file->details->symlink_name, symlink_name) != 0)
+    {
+        changed = TRUE;
+        g_free (file->details->symlink_name);
+        file->details->symlink_name = g_strdup (symlink_name);
+    }
+
+    mime_type = g_file_info_get_content_type (info);
+    if (g_strcmp0 (eel_ref_str_peek (file->details->mime_type), mime_type) != 0)
+    {
+        changed = TRUE;
+        eel_ref_str_unref (file->details->mime_type);
+        file->details->mime_type = eel_ref_str_get_unique (mime_type);
+    }
+
+    selinux_context = g_file_info_get_attribute_string (info, G_FILE_ATTRIBUTE_SELINUX_CONTEXT);
+    if (g_strcmp0 (eel_ref_str_peek (file->details->selinux_context), selinux_context) != 0)
+    {
+        changed = TRUE;
+        eel_ref_str_unref (file->details->selinux_context);
+        file->details->selinux_context = eel_ref_str_get_unique (selinux_context);
+    }
+
+    description = g_file_info_get_attribute_string (info, G_FILE_ATTRIBUTE_STANDARD_DESCRIPTION);
+    if (g_strcmp0 (nautilus_file_peek_rare (file)->description, description) != 0)
+    {
+        changed = TRUE;
+        g_free (nautilus_file_get_rare (file)->description);
+        nautilus_file_get_rare (file)->description = g_strdup (description);
+    }
+
+    filesystem_id = g_file_info_get_attribute_string (info, G_FILE_ATTRIBUTE_ID_FILESYSTEM);
+    if (g_strcmp0 (eel_ref_str_peek (file->details->filesystem_id), filesystem_id) != 0)
+    {
+        changed = TRUE;
+        eel_ref_str_unref (file->details->filesystem_id);
+        file->details->filesystem_id = eel_ref_str_get_unique (filesystem_id);
+    }
+
+    trash_time = 0;
+    time_string = g_file_info_get_attribute_string (info, "trash::deletion-date");
+    if (time_string != NULL)
+    {
+        g_time_val_from_iso8601 (time_string, &g_trash_time);
+        trash_time = g_trash_time.tv_sec;
+    }
+    if (nautilus_file_peek_rare (file)->trash_time != trash_time)
+    {
+        changed = TRUE;
+        nautilus_file_get_rare (file)->trash_time = trash_time;
+    }
+
+    trash_orig_path = g_file_info_get_attribute_byte_string (info, "trash::orig-path");
+    if (g_strcmp0 (nautilus_file_peek_rare (file)->trash_orig_path, trash_orig_path) != 0)
+    {
+        changed = TRUE;
+        g_free (nautilus_file_get_rare (file)->trash_orig_path);
+        nautilus_file_get_rare (file)->trash_orig_path = g_strdup (trash_orig_path);
+    }
+
+    changed |=
+        nautilus_file_update_metadata_from_info (file, info);
+
+    if (mode == UPDATE_INFO_NAME)
+    {
+        changed |= update_name_from_info (file,
+                                          g_file_info_get_name (info),
+                                          g_file_info_get_display_name (info) != NULL);
+    }
+
+    if (changed && mode != UPDATE_INFO_DETACHED)
+    {
+        add_to_link_hash_table (file);
+
+        update_links_if_target (file);
+    }
+
+    return changed;
+}
+
+static gboolean
+update_info_and_name (NautilusFile *file,
+                      GFileInfo    *info)
+{
+    return update_info_internal (file, info, UPDATE_INFO_NAME);
+}
+
+gboolean
+nautilus_file_update_info (NautilusFile *file,
+                           GFileInfo    *info)
+{
+    return update_info_internal (file, info, UPDATE_INFO_KEEP_NAME);
+}
+
+/* Same as update_info_internal(), for a file read by the local
+ * enumerator. Metadata is not part of the entry and is left alone.
+ */
+static gboolean
+update_from_local_entry_internal (NautilusFile       *file,
+                                  NautilusLocalEntry *entry,
+                                  UpdateInfoMode      mode)
+{
+    gboolean changed;
+    gboolean thumbnail_changed;
+    guint64 signature;
+
+    g_assert (!entry->metadata_only);
+
+    if (file->details->is_gone)
+    {
+        return FALSE;
+    }
+
+    signature = get_local_entry_change_signature (entry);
+    if (mode == UPDATE_INFO_KEEP_NAME &&
+        file->details->got_file_info &&
+        signature == file->details->change_signature)
+    {
+        file->details->file_info_is_up_to_date = TRUE;
+        return FALSE;
+    }
+    file->details->change_signature = signature;
+
+    file->details->file_info_is_up_to_date = TRUE;
+
+    if (mode != UPDATE_INFO_DETACHED)
+    {
+        remove_from_link_hash_table (file);
+    }
+
+    changed = !file->details->got_file_info;
+    file->details->got_file_info = TRUE;
+
+    changed |= nautilus_file_set_display_name (file,
+                                               entry->display_name != NULL ?
+                                               entry->display_name : entry->name,
+                                               entry->edit_name,
+                                               FALSE);
+
+    if (file->details->type != entry->type)
+    {
+        changed = TRUE;
+        file->details->type = entry->type;
+    }
+
+    /* Local files never have a target URI. */
+    if (!file->details->got_custom_activation_uri &&
+        file->details->activation_uri != NULL)
+    {
+        changed = TRUE;
+        g_free (file->details->activation_uri);
+        file->details->activation_uri = NULL;
+    }
+
+    if (file->details->is_symlink != entry->is_symlink ||
+        file->details->is_hidden != (entry->is_hidden || entry->is_backup) ||
+        file->details->is_mountpoint != entry->is_mountpoint ||
+        !file->details->has_permissions ||
+        file->details->permissions != entry->mode)
+    {
+        changed = TRUE;
+    }
+    file->details->is_symlink = entry->is_symlink;
+    file->details->is_hidden = entry->is_hidden || entry->is_backup;
+    file->details->is_mountpoint = entry->is_mountpoint;
+    file->details->has_permissions = TRUE;
+    file->details->permissions = entry->mode;
+
+    if (file->details->can_read != entry->can_read ||
+        file->details->can_write != entry->can_write ||
+        file->details->can_execute != entry->can_execute ||
+        file->details->can_delete != entry->can_delete ||
+        file->details->can_trash != entry->can_trash ||
+        file->details->can_rename != entry->can_rename ||
+        file->details->can_mount ||
+        file->details->can_unmount ||
+        file->details->can_eject ||
+        file->details->can_start ||
+        file->details->can_start_degraded ||
+        file->details->can_stop ||
+        file->details->start_stop_type != G_DRIVE_START_STOP_TYPE_UNKNOWN ||
+        file->details->can_poll_for_media ||
+        file->details->is_media_check_automatic)
+    {
+        changed = TRUE;
+    }
+    file->details->can_read = entry->can_read;
+    file->details->can_write = entry->can_write;
+    file->details->can_execute = entry->can_execute;
+    file->details->can_delete = entry->can_delete;
+    file->details->can_trash = entry->can_trash;
+    file->details->can_rename = entry->can_rename;
+    file->details->can_mount = FALSE;
+    file->details->can_unmount = FALSE;
+    file->details->can_eject = FALSE;
+    file->details->can_start = FALSE;
+    file->details->can_start_degraded = FALSE;
+    file->details->can_stop = FALSE;
+    file->details->start_stop_type = G_DRIVE_START_STOP_TYPE_UNKNOWN;
+    file->details->can_poll_for_media = FALSE;
+    file->details->is_media_check_automatic = FALSE;
+
+    if (file->details->uid != (int) entry->uid ||
+        file->details->gid != (int) entry->gid)
+    {
+        changed = TRUE;
+    }
+    file->details->uid = entry->uid;
+    file->details->gid = entry->gid;
+
+    if (g_strcmp0 (eel_ref_str_peek (file->details->owner), entry->owner) != 0)
+    {
+        changed = TRUE;
+        eel_ref_str_unref (file->details->owner);
+        file->details->owner = eel_ref_str_get_unique (entry->owner);
+    }
+
+    if (g_strcmp0 (eel_ref_str_peek (file->details->owner_real), entry->owner_real) != 0)
+    {
+        changed = TRUE;
+        eel_ref_str_unref (file->details->owner_real);
+        file->details->owner_real = eel_ref_str_get_unique (entry->owner_real);
+    }
+
+    if (g_strcmp0 (eel_ref_str_peek (file->details->group), entry->group) != 0)
+    {
+        changed = TRUE;
+        eel_ref_str_unref (file->details->group);
+        file->details->group = eel_ref_str_get_unique (entry->group);
+    }
+
+    if (file->details->size != entry->size ||
+        file->details->sort_order != 0)
+    {
+        changed = TRUE;
+    }
+    file->details->size = entry->size;
+    file->details->sort_order = 0;
+
+    thumbnail_changed = file->details->atime != entry->atime ||
+                        file->details->mtime != entry->mtime;
+    if (thumbnail_changed)
+    {
+        if (file->details->thumbnail == NULL)
+        {
+            file->details->thumbnail_is_up_to_date = FALSE;
+        }
+
+        changed = TRUE;
+    }
+    file->details->atime = entry->atime;
+    file->details->mtime = entry->mtime;
+
+    if (file->details->thumbnail != NULL &&
+        file->details->thumbnail_mtime != 0 &&
+        file->details->thumbnail_mtime != entry->mtime)
+    {
+        file->details->thumbnail_is_up_to_date = FALSE;
+        changed = TRUE;
+    }
+
+    if (!g_icon_equal (entry->icon, file->details->icon))
+    {
+        changed = TRUE;
+
+        if (file->details->icon)
+        {
+            g_object_unref (file->details->icon);
+        }
+        file->details->icon = g_object_ref (entry->icon);
+    }
+
+    if (g_strcmp0 (file->details->thumbnail_path, entry->thumbnail_path) != 0)
     {
         changed = TRUE;
-        g_free (file->details->symlink_name);
-        file->details->symlink_name = g_strdup (symlink_name);
+        g_free (file->details->thumbnail_path);
+        file->details->thumbnail_path = g_strdup (entry->thumbnail_path);
     }
 
-    mime_type = g_file_info_get_content_type (info);
-    if (g_strcmp0 (eel_ref_str_peek (file->details->mime_type), mime_type) != 0)
+    if (file->details->thumbnailing_failed != entry->thumbnailing_failed)
     {
         changed = TRUE;
-        eel_ref_str_unref (file->details->mime_type);
-        file->details->mime_type = eel_ref_str_get_unique (mime_type);
+        file->details->thumbnailing_failed = entry->thumbnailing_failed;
     }
 
-    selinux_context = g_file_info_get_attribute_string (info, G_FILE_ATTRIBUTE_SELINUX_CONTEXT);
-    if (g_strcmp0 (file->details->selinux_context, selinux_context) != 0)
+    if (g_strcmp0 (file->details->symlink_name, entry->symlink_target) != 0)
     {
         changed = TRUE;
-        g_free (file->details->selinux_context);
-        file->details->selinux_context = g_strdup (selinux_context);
+        g_free (file->details->symlink_name);
+        file->details->symlink_name = g_strdup (entry->symlink_target);
     }
 
-    description = g_file_info_get_attribute_string (info, G_FILE_ATTRIBUTE_STANDARD_DESCRIPTION);
-    if (g_strcmp0 (file->details->description, description) != 0)
+    if (g_strcmp0 (eel_ref_str_peek (file->details->mime_type), entry->content_type) != 0)
     {
         changed = TRUE;
-        g_free (file->details->description);
-        file->details->description = g_strdup (description);
+        eel_ref_str_unref (file->details->mime_type);
+        file->details->mime_type = eel_ref_str_get_unique (entry->content_type);
     }
 
-    filesystem_id = g_file_info_get_attribute_string (info, G_FILE_ATTRIBUTE_ID_FILESYSTEM);
-    if (g_strcmp0 (eel_ref_str_peek (file->details->filesystem_id), filesystem_id) != 0)
+    if (g_strcmp0 (eel_ref_str_peek (file->details->selinux_context), entry->selinux_context) != 0)
     {
         changed = TRUE;
-        eel_ref_str_unref (file->details->filesystem_id);
-        file->details->filesystem_id = eel_ref_str_get_unique (filesystem_id);
+        eel_ref_str_unref (file->details->selinux_context);
+        file->details->selinux_context = eel_ref_str_get_unique (entry->selinux_context);
     }
 
-    trash_time = 0;
-    time_string = g_file_info_get_attribute_string (info, "trash::deletion-date");
-    if (time_string != NULL)
-    {
-        g_time_val_from_iso8601 (time_string, &g_trash_time);
-        trash_time = g_trash_time.tv_sec;
-    }
-    if (file->details->trash_time != trash_time)
+    if (nautilus_file_peek_rare (file)->description != NULL)
     {
         changed = TRUE;
-        file->details->trash_time = trash_time;
+        g_clear_pointer (&nautilus_file_get_rare (file)->description, g_free);
     }
 
-    trash_orig_path = g_file_info_get_attribute_byte_string (info, "trash::orig-path");
-    if (g_strcmp0 (file->details->trash_orig_path, trash_orig_path) != 0)
+    if (g_strcmp0 (eel_ref_str_peek (file->details->filesystem_id), entry->filesystem_id) != 0)
     {
         changed = TRUE;
-        g_free (file->details->trash_orig_path);
-        file->details->trash_orig_path = g_strdup (trash_orig_path);
+        eel_ref_str_unref (file->details->filesystem_id);
+        file->details->filesystem_id = eel_ref_str_get_unique (entry->filesystem_id);
     }
 
-    changed |=
-        nautilus_file_update_metadata_from_info (file, info);
-
-    if (update_name)
+    if (mode == UPDATE_INFO_NAME)
     {
-        name = g_file_info_get_name (info);
-        if (file->details->name == NULL ||
-            strcmp (eel_ref_str_peek (file->details->name), name) != 0)
-        {
-            changed = TRUE;
-
-            node = nautilus_directory_begin_file_name_change
-                       (file->details->directory, file);
-
-            eel_ref_str_unref (file->details->name);
-            if (g_strcmp0 (eel_ref_str_peek (file->details->display_name),
-                           name) == 0)
-            {
-                file->details->name = eel_ref_str_ref (file->details->display_name);
-            }
-            else
-            {
-                file->details->name = eel_ref_str_new (name);
-            }
-
-            if (!file->details->got_custom_display_name &&
-                g_file_info_get_display_name (info) == NULL)
-            {
-                /* If the file info's display name is NULL,
-                 * nautilus_file_set_display_name() did
-                 * not unset the display name.
-                 */
-                nautilus_file_clear_display_name (file);
-            }
-
-            nautilus_directory_end_file_name_change
-                (file->details->directory, file, node);
-        }
+        changed |= update_name_from_info (file, entry->name, TRUE);
     }
 
-    if (changed)
+    if (changed && mode != UPDATE_INFO_DETACHED)
     {
         add_to_link_hash_table (file);
 
@@ -3093,18 +3689,11 @@ update_info_internal (NautilusFile *file,
     return changed;
 }
 
-static gboolean
-update_info_and_name (NautilusFile *file,
-                      GFileInfo    *info)
-{
-    return update_info_internal (file, info, TRUE);
-}
-
 gboolean
-nautilus_file_update_info (NautilusFile *file,
-                           GFileInfo    *info)
+nautilus_file_update_from_local_entry (NautilusFile       *file,
+                                       NautilusLocalEntry *entry)
 {
-    return update_info_internal (file, info, FALSE);
+    return update_from_local_entry_internal (file, entry, UPDATE_INFO_KEEP_NAME);
 }
 
 static gboolean
@@ -3315,7 +3904,7 @@ get_time (NautilusFile     *file,
 
         case NAUTILUS_DATE_TYPE_TRASHED:
         {
-            time = file->details->trash_time;
+            time = nautilus_file_peek_rare (file)->trash_time;
         }
         break;
 
@@ -3339,96 +3928,63 @@ get_time (NautilusFile     *file,
     return KNOWN;
 }
 
-static int
-compare_directories_by_count (NautilusFile *file_1,
-                              NautilusFile *file_2)
+/* The item count of a directory or the size of a file, packed so
+ * that plain comparison puts them in this order:
+ *   Unknown.
+ *   "Unknowable".
+ *   Smaller counts or sizes.
+ *   Larger counts or sizes.
+ */
+static gint64
+get_size_sort_key (NautilusFile *file)
 {
-    /* Sort order:
-     *   Directories with unknown # of items
-     *   Directories with "unknowable" # of items
-     *   Directories with 0 items
-     *   Directories with n items
-     */
-
-    Knowledge count_known_1, count_known_2;
-    guint count_1, count_2;
-
-    count_known_1 = get_item_count (file_1, &count_1);
-    count_known_2 = get_item_count (file_2, &count_2);
-
-    if (count_known_1 > count_known_2)
-    {
-        return -1;
-    }
-    if (count_known_1 < count_known_2)
-    {
-        return +1;
-    }
-
-    /* count_known_1 and count_known_2 are equal now. Check if count
-     * details are UNKNOWABLE or UNKNOWN.
-     */
-    if (count_known_1 == UNKNOWABLE || count_known_1 == UNKNOWN)
-    {
-        return 0;
-    }
+    NautilusFileSortKeys *keys;
+    Knowledge known;
+    guint count;
+    goffset size;
 
-    if (count_1 < count_2)
-    {
-        return -1;
-    }
-    if (count_1 > count_2)
+    keys = get_sort_keys (file);
+    if (!keys->size_key_set)
     {
-        return +1;
-    }
-
-    return 0;
-}
-
-static int
-compare_files_by_size (NautilusFile *file_1,
-                       NautilusFile *file_2)
-{
-    /* Sort order:
-     *   Files with unknown size.
-     *   Files with "unknowable" size.
-     *   Files with smaller sizes.
-     *   Files with large sizes.
-     */
-
-    Knowledge size_known_1, size_known_2;
-    goffset size_1 = 0, size_2 = 0;
+        count = 0;
+        size = 0;
+        if (nautilus_file_is_directory (file))
+        {
+            known = get_item_count (file, &count);
+            size = count;
+        }
+        else
+        {
+            known = get_size (file, &size);
+        }
 
-    size_known_1 = get_size (file_1, &size_1);
-    size_known_2 = get_size (file_2, &size_2);
+        /* Reading the preferences for the first time makes the keys stale */
+        keys = get_sort_keys (file);
 
-    if (size_known_1 > size_known_2)
-    {
-        return -1;
-    }
-    if (size_known_1 < size_known_2)
-    {
-        return +1;
-    }
+        switch (known)
+        {
+            case KNOWN:
+            {
+                keys->size_key = size;
+            }
+            break;
 
-    /* size_known_1 and size_known_2 are equal now. Check if size
-     * details are UNKNOWABLE or UNKNOWN
-     */
-    if (size_known_1 == UNKNOWABLE || size_known_1 == UNKNOWN)
-    {
-        return 0;
-    }
+            case UNKNOWABLE:
+            {
+                keys->size_key = G_MININT64 + 1;
+            }
+            break;
 
-    if (size_1 < size_2)
-    {
-        return -1;
-    }
-    if (size_1 > size_2)
-    {
-        return +1;
+            default:
+            {
+                keys->size_key = G_MININT64;
+            }
+            break;
+        }
+        keys->size_key_set = TRUE;
     }
 
-    return 0;
+    return keys->size_key;
 }
 
 static int
@@ -3447,6 +4003,7 @@ compare_by_size (NautilusFile *file_1,
      */
 
     gboolean is_directory_1, is_directory_2;
+    gint64 size_key_1, size_key_2;
 
     is_directory_1 = nautilus_file_is_directory (file_1);
     is_directory_2 = nautilus_file_is_directory (file_2);
@@ -3460,14 +4017,19 @@ compare_by_size (NautilusFile *file_1,
         return +1;
     }
 
-    if (is_directory_1)
+    size_key_1 = get_size_sort_key (file_1);
+    size_key_2 = get_size_sort_key (file_2);
+
+    if (size_key_1 < size_key_2)
     {
-        return compare_directories_by_count (file_1, file_2);
+        return -1;
     }
-    else
+    if (size_key_1 > size_key_2)
     {
-        return compare_files_by_size (file_1, file_2);
+        return +1;
     }
+
+    return 0;
 }
 
 static int
@@ -3549,15 +4111,64 @@ prepend_automatic_keywords (NautilusFile *file,
     return names;
 }
 
+/* The collation key of the type as shown to the user */
+static const char *
+get_type_sort_key (NautilusFile *file)
+{
+    NautilusFileSortKeys *keys;
+    char *type_string;
+
+    keys = get_sort_keys (file);
+    if (!keys->type_key_set)
+    {
+        type_string = nautilus_file_get_type_as_string (file);
+        if (type_string != NULL)
+        {
+            keys->type_collation_key = g_utf8_collate_key (type_string, -1);
+            g_free (type_string);
+        }
+        keys->type_key_set = TRUE;
+    }
+
+    return keys->type_collation_key;
+}
+
+/* The string value of an attribute. It is interned, so equal values
+ * have equal pointers.
+ */
+static eel_ref_str
+get_attribute_sort_key (NautilusFile *file,
+                        GQuark        attribute)
+{
+    NautilusFileSortKeys *keys;
+    char *value;
+
+    keys = get_sort_keys (file);
+    if (keys->attribute_q != attribute)
+    {
+        eel_ref_str_unref (keys->attribute_value);
+        keys->attribute_value = NULL;
+
+        value = nautilus_file_get_string_attribute_q (file, attribute);
+        if (value != NULL)
+        {
+            keys->attribute_value = eel_ref_str_get_unique (value);
+            g_free (value);
+        }
+        keys->attribute_q = attribute;
+    }
+
+    return keys->attribute_value;
+}
+
 static int
 compare_by_type (NautilusFile *file_1,
                  NautilusFile *file_2)
 {
     gboolean is_directory_1;
     gboolean is_directory_2;
-    char *type_string_1;
-    char *type_string_2;
-    int result;
+    const char *type_key_1;
+    const char *type_key_2;
 
     /* Directories go first. Then, if mime types are identical,
      * don't bother getting strings (for speed). This assumes
@@ -3590,17 +4201,17 @@ compare_by_type (NautilusFile *file_1,
         return 0;
     }
 
-    type_string_1 = nautilus_file_get_type_as_string (file_1);
-    type_string_2 = nautilus_file_get_type_as_string (file_2);
+    type_key_1 = get_type_sort_key (file_1);
+    type_key_2 = get_type_sort_key (file_2);
 
-    if (type_string_1 == NULL || type_string_2 == NULL)
+    if (type_key_1 == NULL || type_key_2 == NULL)
     {
-        if (type_string_1 != NULL)
+        if (type_key_1 != NULL)
         {
             return -1;
         }
 
-        if (type_string_2 != NULL)
+        if (type_key_2 != NULL)
         {
             return 1;
         }
@@ -3608,12 +4219,7 @@ compare_by_type (NautilusFile *file_1,
         return 0;
     }
 
-    result = g_utf8_collate (type_string_1, type_string_2);
-
-    g_free (type_string_1);
-    g_free (type_string_2);
-
-    return result;
+    return strcmp (type_key_1, type_key_2);
 }
 
 static Knowledge
@@ -3875,69 +4481,68 @@ nautilus_file_compare_for_sort (NautilusFile         *file_1,
     return result;
 }
 
-int
-nautilus_file_compare_for_sort_by_attribute_q   (NautilusFile *file_1,
-                                                 NautilusFile *file_2,
-                                                 GQuark        attribute,
-                                                 gboolean      directories_first,
-                                                 gboolean      reversed)
+static gboolean
+get_sort_type_for_attribute (GQuark                attribute,
+                             NautilusFileSortType *sort_type)
 {
-    int result;
-
-    if (file_1 == file_2)
-    {
-        return 0;
-    }
-
-    /* Convert certain attributes into NautilusFileSortTypes and use
-     * nautilus_file_compare_for_sort()
-     */
     if (attribute == 0 || attribute == attribute_name_q)
     {
-        return nautilus_file_compare_for_sort (file_1, file_2,
-                                               NAUTILUS_FILE_SORT_BY_DISPLAY_NAME,
-                                               directories_first,
-                                               reversed);
+        *sort_type = NAUTILUS_FILE_SORT_BY_DISPLAY_NAME;
     }
     else if (attribute == attribute_size_q)
     {
-        return nautilus_file_compare_for_sort (file_1, file_2,
-                                               NAUTILUS_FILE_SORT_BY_SIZE,
-                                               directories_first,
-                                               reversed);
+        *sort_type = NAUTILUS_FILE_SORT_BY_SIZE;
     }
     else if (attribute == attribute_type_q)
     {
-        return nautilus_file_compare_for_sort (file_1, file_2,
-                                               NAUTILUS_FILE_SORT_BY_TYPE,
-                                               directories_first,
-                                               reversed);
+        *sort_type = NAUTILUS_FILE_SORT_BY_TYPE;
     }
     else if (attribute == attribute_modification_date_q || attribute == attribute_date_modified_q || attribute == attribute_date_modified_with_time_q || attribute == attribute_date_modified_full_q)
     {
-        return nautilus_file_compare_for_sort (file_1, file_2,
-                                               NAUTILUS_FILE_SORT_BY_MTIME,
-                                               directories_first,
-                                               reversed);
+        *sort_type = NAUTILUS_FILE_SORT_BY_MTIME;
     }
     else if (attribute == attribute_accessed_date_q || attribute == attribute_date_accessed_q || attribute == attribute_date_accessed_full_q)
     {
-        return nautilus_file_compare_for_sort (file_1, file_2,
-                                               NAUTILUS_FILE_SORT_BY_ATIME,
-                                               directories_first,
-                                               reversed);
+        *sort_type = NAUTILUS_FILE_SORT_BY_ATIME;
     }
     else if (attribute == attribute_trashed_on_q || attribute == attribute_trashed_on_full_q)
     {
-        return nautilus_file_compare_for_sort (file_1, file_2,
-                                               NAUTILUS_FILE_SORT_BY_TRASHED_TIME,
-                                               directories_first,
-                                               reversed);
+        *sort_type = NAUTILUS_FILE_SORT_BY_TRASHED_TIME;
     }
     else if (attribute == attribute_search_relevance_q)
+    {
+        *sort_type = NAUTILUS_FILE_SORT_BY_SEARCH_RELEVANCE;
+    }
+    else
+    {
+        return FALSE;
+    }
+
+    return TRUE;
+}
+
+int
+nautilus_file_compare_for_sort_by_attribute_q   (NautilusFile *file_1,
+                                                 NautilusFile *file_2,
+                                                 GQuark        attribute,
+                                                 gboolean      directories_first,
+                                                 gboolean      reversed)
+{
+    NautilusFileSortType sort_type;
+    int result;
+
+    if (file_1 == file_2)
+    {
+        return 0;
+    }
+
+    /* Convert certain attributes into NautilusFileSortTypes and use
+     * nautilus_file_compare_for_sort()
+     */
+    if (get_sort_type_for_attribute (attribute, &sort_type))
     {
         return nautilus_file_compare_for_sort (file_1, file_2,
-                                               NAUTILUS_FILE_SORT_BY_SEARCH_RELEVANCE,
+                                               sort_type,
                                                directories_first,
                                                reversed);
     }
@@ -3948,22 +4553,17 @@ nautilus_file_compare_for_sort_by_attribute_q   (NautilusFile *file_1,
 
     if (result == 0)
     {
-        char *value_1;
-        char *value_2;
+        eel_ref_str value_1;
+        eel_ref_str value_2;
 
-        value_1 = nautilus_file_get_string_attribute_q (file_1,
-                                                        attribute);
-        value_2 = nautilus_file_get_string_attribute_q (file_2,
-                                                        attribute);
+        value_1 = get_attribute_sort_key (file_1, attribute);
+        value_2 = get_attribute_sort_key (file_2, attribute);
 
-        if (value_1 != NULL && value_2 != NULL)
+        if (value_1 != NULL && value_2 != NULL && value_1 != value_2)
         {
             result = strcmp (value_1, value_2);
         }
 
-        g_free (value_1);
-        g_free (value_2);
-
         if (reversed)
         {
             result = -result;
@@ -3987,6 +4587,49 @@ nautilus_file_compare_for_sort_by_attribute     (NautilusFile *file_1,
 }
 
 
+/**
+ * nautilus_file_prepare_for_sort:
+ * @file: A file object
+ * @sort_type: Sort criterion
+ *
+ * Works out ahead of time what comparing @file for @sort_type needs.
+ * After that, and until the file changes, nautilus_file_compare_for_sort()
+ * only reads the file, so sorts can compare files from other threads
+ * while the main loop waits for them.
+ **/
+void
+nautilus_file_prepare_for_sort (NautilusFile         *file,
+                                NautilusFileSortType  sort_type)
+{
+    /* Sets the display name if there is none yet */
+    nautilus_file_peek_display_name (file);
+
+    if (sort_type == NAUTILUS_FILE_SORT_BY_TYPE)
+    {
+        get_type_sort_key (file);
+    }
+    else if (sort_type == NAUTILUS_FILE_SORT_BY_SIZE)
+    {
+        get_size_sort_key (file);
+    }
+}
+
+void
+nautilus_file_prepare_for_sort_by_attribute_q (NautilusFile *file,
+                                               GQuark        attribute)
+{
+    NautilusFileSortType sort_type;
+
+    if (get_sort_type_for_attribute (attribute, &sort_type))
+    {
+        nautilus_file_prepare_for_sort (file, sort_type);
+    }
+    else
+    {
+        get_attribute_sort_key (file, attribute);
+    }
+}
+
 /**
  * nautilus_file_compare_name:
  * @file: A file object
@@ -4535,7 +5178,7 @@ nautilus_file_get_name (NautilusFile *file)
 char *
 nautilus_file_get_description (NautilusFile *file)
 {
-    return g_strdup (file->details->description);
+    return g_strdup (nautilus_file_peek_rare (file)->description);
 }
 
 void
@@ -5031,8 +5674,8 @@ nautilus_file_get_keywords (NautilusFile *file)
 
     g_return_val_if_fail (NAUTILUS_IS_FILE (file), NULL);
 
-    keywords = g_list_copy_deep (file->details->extension_emblems, (GCopyFunc) g_strdup, NULL);
-    keywords = g_list_concat (keywords, g_list_copy_deep (file->details->pending_extension_emblems, (GCopyFunc) g_strdup, NULL));
+    keywords = g_list_copy_deep (nautilus_file_peek_rare (file)->extension_emblems, (GCopyFunc) g_strdup, NULL);
+    keywords = g_list_concat (keywords, g_list_copy_deep (nautilus_file_peek_rare (file)->pending_extension_emblems, (GCopyFunc) g_strdup, NULL));
 
     metadata_keywords = nautilus_file_get_metadata_list (file, NAUTILUS_METADATA_KEY_EMBLEMS);
     clean_up_metadata_keywords (file, &metadata_keywords);
@@ -5540,7 +6183,7 @@ nautilus_file_get_trash_original_file_parent_as_string (NautilusFile *file)
     GFile *location;
     char *filename;
 
-    if (file->details->trash_orig_path != NULL)
+    if (nautilus_file_peek_rare (file)->trash_orig_path != NULL)
     {
         orig_file = nautilus_file_get_trash_original_file (file);
         parent = nautilus_file_get_parent (orig_file);
@@ -5758,6 +6401,9 @@ static void
 show_directory_item_count_changed_callback (gpointer callback_data)
 {
     show_directory_item_count = g_settings_get_enum (nautilus_preferences, NAUTILUS_PREFERENCES_SHOW_DIRECTORY_ITEM_COUNTS);
+
+    /* Item counts in size sort keys may be shown or not now */
+    sort_keys_generation++;
 }
 
 static gboolean
@@ -6249,7 +6895,7 @@ nautilus_file_get_selinux_context (NautilusFile *file)
         return NULL;
     }
 
-    raw = file->details->selinux_context;
+    raw = (char *) eel_ref_str_peek (file->details->selinux_context);
 
 #ifdef HAVE_SELINUX
     if (selinux_raw_to_trans_context (raw, &translated) == 0)
@@ -7387,15 +8033,15 @@ nautilus_file_get_string_attribute_q (NautilusFile *file,
 
     extension_attribute = NULL;
 
-    if (file->details->pending_extension_attributes)
+    if (nautilus_file_peek_rare (file)->pending_extension_attributes)
     {
-        extension_attribute = g_hash_table_lookup (file->details->pending_extension_attributes,
+        extension_attribute = g_hash_table_lookup (nautilus_file_peek_rare (file)->pending_extension_attributes,
                                                    GINT_TO_POINTER (attribute_q));
     }
 
-    if (extension_attribute == NULL && file->details->extension_attributes)
+    if (extension_attribute == NULL && nautilus_file_peek_rare (file)->extension_attributes)
     {
-        extension_attribute = g_hash_table_lookup (file->details->extension_attributes,
+        extension_attribute = g_hash_table_lookup (nautilus_file_peek_rare (file)->extension_attributes,
                                                    GINT_TO_POINTER (attribute_q));
     }
 
@@ -7900,9 +8546,9 @@ get_fs_free_cb (GObject      *source_object,
         g_object_unref (info);
     }
 
-    if (file->details->free_space != free_space)
+    if (nautilus_file_peek_rare (file)->free_space != free_space)
     {
-        file->details->free_space = free_space;
+        nautilus_file_get_rare (file)->free_space = free_space;
         nautilus_file_emit_changed (file);
     }
 
@@ -7925,10 +8571,10 @@ nautilus_file_get_volume_free_space (NautilusFile *file)
 
     now = time (NULL);
     /* Update first time and then every 2 seconds */
-    if (file->details->free_space_read == 0 ||
-        (now - file->details->free_space_read) > 2)
+    if (nautilus_file_peek_rare (file)->free_space_read == 0 ||
+        (now - nautilus_file_peek_rare (file)->free_space_read) > 2)
     {
-        file->details->free_space_read = now;
+        nautilus_file_get_rare (file)->free_space_read = now;
         location = nautilus_file_get_location (file);
         g_file_query_filesystem_info_async (location,
                                             G_FILE_ATTRIBUTE_FILESYSTEM_FREE,
@@ -7939,9 +8585,9 @@ nautilus_file_get_volume_free_space (NautilusFile *file)
     }
 
     res = NULL;
-    if (file->details->free_space != (guint64) - 1)
+    if (nautilus_file_peek_rare (file)->free_space != (guint64) - 1)
     {
-        res = g_format_size (file->details->free_space);
+        res = g_format_size (nautilus_file_peek_rare (file)->free_space);
     }
 
     return res;
@@ -8299,9 +8945,9 @@ nautilus_file_get_trash_original_file (NautilusFile *file)
 
     original_file = NULL;
 
-    if (file->details->trash_orig_path != NULL)
+    if (nautilus_file_peek_rare (file)->trash_orig_path != NULL)
     {
-        location = g_file_new_for_path (file->details->trash_orig_path);
+        location = g_file_new_for_path (nautilus_file_peek_rare (file)->trash_orig_path);
         original_file = nautilus_file_get (location);
         g_object_unref (location);
     }
@@ -8412,6 +9058,8 @@ nautilus_file_emit_changed (NautilusFile *file)
 
     g_assert (NAUTILUS_IS_FILE (file));
 
+    clear_sort_keys (file);
+
     /* Send out a signal. */
     g_signal_emit (file, signals[CHANGED], 0, file);
 
@@ -8715,7 +9363,7 @@ nautilus_file_invalidate_all_attributes (NautilusFile *file)
 void
 nautilus_file_dump (NautilusFile *file)
 {
-    long size = file->details->deep_size;
+    long size = nautilus_file_peek_rare (file)->deep_size;
     char *uri;
     const char *file_kind;
 
@@ -9282,15 +9930,18 @@ static void
 nautilus_file_add_emblem (NautilusFile *file,
                           const char   *emblem_name)
 {
+    NautilusFileRareDetails *rare;
+
+    rare = nautilus_file_get_rare (file);
     if (file->details->pending_info_providers)
     {
-        file->details->pending_extension_emblems = g_list_prepend (file->details->pending_extension_emblems,
-                                                                   g_strdup (emblem_name));
+        rare->pending_extension_emblems = g_list_prepend (rare->pending_extension_emblems,
+                                                          g_strdup (emblem_name));
     }
     else
     {
-        file->details->extension_emblems = g_list_prepend (file->details->extension_emblems,
-                                                           g_strdup (emblem_name));
+        rare->extension_emblems = g_list_prepend (rare->extension_emblems,
+                                                  g_strdup (emblem_name));
     }
 
     nautilus_file_changed (file);
@@ -9301,30 +9952,33 @@ nautilus_file_add_string_attribute (NautilusFile *file,
                                     const char   *attribute_name,
                                     const char   *value)
 {
+    NautilusFileRareDetails *rare;
+
+    rare = nautilus_file_get_rare (file);
     if (file->details->pending_info_providers)
     {
         /* Lazily create hashtable */
-        if (!file->details->pending_extension_attributes)
+        if (!rare->pending_extension_attributes)
         {
-            file->details->pending_extension_attributes =
+            rare->pending_extension_attributes =
                 g_hash_table_new_full (g_direct_hash, g_direct_equal,
                                        NULL,
                                        (GDestroyNotify) g_free);
         }
-        g_hash_table_insert (file->details->pending_extension_attributes,
+        g_hash_table_insert (rare->pending_extension_attributes,
                              GINT_TO_POINTER (g_quark_from_string (attribute_name)),
                              g_strdup (value));
     }
     else
     {
-        if (!file->details->extension_attributes)
+        if (!rare->extension_attributes)
         {
-            file->details->extension_attributes =
+            rare->extension_attributes =
                 g_hash_table_new_full (g_direct_hash, g_direct_equal,
                                        NULL,
                                        (GDestroyNotify) g_free);
         }
-        g_hash_table_insert (file->details->extension_attributes,
+        g_hash_table_insert (rare->extension_attributes,
                              GINT_TO_POINTER (g_quark_from_string (attribute_name)),
                              g_strdup (value));
     }
@@ -9341,17 +9995,23 @@ nautilus_file_invalidate_extension_info (NautilusFile *file)
 void
 nautilus_file_info_providers_done (NautilusFile *file)
 {
-    g_list_free_full (file->details->extension_emblems, g_free);
-    file->details->extension_emblems = file->details->pending_extension_emblems;
-    file->details->pending_extension_emblems = NULL;
+    NautilusFileRareDetails *rare;
 
-    if (file->details->extension_attributes)
+    rare = file->details->rare;
+    if (rare != NULL)
     {
-        g_hash_table_destroy (file->details->extension_attributes);
-    }
+        g_list_free_full (rare->extension_emblems, g_free);
+        rare->extension_emblems = rare->pending_extension_emblems;
+        rare->pending_extension_emblems = NULL;
 
-    file->details->extension_attributes = file->details->pending_extension_attributes;
-    file->details->pending_extension_attributes = NULL;
+        if (rare->extension_attributes)
+        {
+            g_hash_table_destroy (rare->extension_attributes);
+        }
+
+        rare->extension_attributes = rare->pending_extension_attributes;
+        rare->pending_extension_attributes = NULL;
+    }
 
     nautilus_file_changed (file);
 }
@@ -431,6 +431,12 @@ int                     nautilus_file_compare_for_sort_by_attribute_q   (Nautilu
 									 gboolean                        reversed);
 gboolean                nautilus_file_is_date_sort_attribute_q          (GQuark                          attribute);
 
+/* Making the comparisons above read-only, so they can run off the main thread */
+void                    nautilus_file_prepare_for_sort                  (NautilusFile                   *file,
+									 NautilusFileSortType            sort_type);
+void                    nautilus_file_prepare_for_sort_by_attribute_q   (NautilusFile                   *file,
+									 GQuark                          attribute);
+
 int                     nautilus_file_compare_location                  (NautilusFile                    *file_1,
                                                                          NautilusFile                    *file_2);
 
@@ -107,20 +107,28 @@
 #define UPDATE_INTERVAL_MIN 100
 /* Maximum update interval */
 #define UPDATE_INTERVAL_MAX 2000
-/* Amount of miliseconds the update interval is increased */
-#define UPDATE_INTERVAL_INC 250
-/* Interval at which the update interval is increased */
-#define UPDATE_INTERVAL_TIMEOUT_INTERVAL 250
-/* Milliseconds that have to pass without a change to reset the update interval */
-#define UPDATE_INTERVAL_RESET 1000
+/* The update interval is this many times what showing the last batch
+ * of pending files took, so that while files keep coming in, showing
+ * them takes up no more than a fifth of the main loop.
+ */
+#define UPDATE_INTERVAL_COST_FACTOR 4
+
+/* Microseconds one slice of pending files may take, so that a frame
+ * can be drawn between slices.
+ */
+#define PENDING_FILES_TIME_BUDGET 8000
+/* The first slice after the view is cleared has at least this many
+ * files whatever it takes, so the window fills up at once.
+ */
+#define PENDING_FILES_FIRST_SLICE 100
+/* Check the clock after this many files */
+#define PENDING_FILES_CHECK_INTERVAL 16
 
 #define SILENT_WINDOW_OPEN_LIMIT 5
 
 #define DUPLICATE_HORIZONTAL_ICON_OFFSET 70
 #define DUPLICATE_VERTICAL_ICON_OFFSET   30
 
-#define MAX_QUEUED_UPDATES 500
-
 #define MAX_MENU_LEVELS 5
 #define TEMPLATE_LIMIT 30
 
@@ -131,6 +139,11 @@
 
 #define MIN_COMMON_FILENAME_PREFIX_LENGTH 4
 
+/* How long a folder has to stay under the pointer or be the only
+ * selected item before it gets loaded ahead of time.
+ */
+#define PREFETCH_DELAY 150 /* ms */
+
 
 enum
 {
@@ -198,10 +211,10 @@ struct NautilusFilesViewDetails
     guint reveal_selection_idle_id;
 
     guint display_pending_source_id;
-    guint changes_timeout_id;
 
     guint update_interval;
-    guint64 last_queued;
+    gint64 update_batch_cost; /* microseconds spent on the batch being shown */
+    gboolean shown_first_slice;
 
     guint files_added_handler_id;
     guint files_changed_handler_id;
@@ -268,6 +281,10 @@ struct NautilusFilesViewDetails
     guint floating_bar_loading_timeout_id;
     GtkWidget *floating_bar;
 
+    /* Folder to load ahead of time once it's been pointed at long enough */
+    NautilusFile *prefetch_file;
+    guint prefetch_timeout_id;
+
     /* Toolbar menu */
     NautilusToolbarMenuSections *toolbar_menu_sections;
     GtkWidget *sort_menu;
@@ -306,6 +323,14 @@ static void     schedule_update_status (NautilusFilesView *view);
 static void     remove_update_status_idle_callback (NautilusFilesView *view);
 static void     reset_update_interval (NautilusFilesView *view);
 static void     schedule_idle_display_of_pending_files (NautilusFilesView *view);
+static void     schedule_timeout_display_of_pending_files (NautilusFilesView *view,
+                                                           guint              interval);
+static gboolean can_display_pending_files (NautilusFilesView *view,
+                                           NautilusDirectory *directory);
+static void     queue_pending_files (NautilusFilesView  *view,
+                                     NautilusDirectory  *directory,
+                                     GList              *files,
+                                     GList             **pending_list);
 static void     unschedule_display_of_pending_files (NautilusFilesView *view);
 static void     disconnect_model_handlers (NautilusFilesView *view);
 static void     metadata_for_directory_as_file_ready_callback (NautilusFile *file,
@@ -2362,10 +2387,67 @@ action_properties (GSimpleAction *action,
     nautilus_file_list_free (selection);
 }
 
+/* Monitor the things needed to get the right icon. Also
+ * monitor a directory's item count because the "size"
+ * attribute is based on that, and the file's metadata
+ * and possible custom name.
+ */
+static NautilusFileAttributes
+get_directory_monitor_attributes (void)
+{
+    return NAUTILUS_FILE_ATTRIBUTES_FOR_ICON |
+           NAUTILUS_FILE_ATTRIBUTE_DIRECTORY_ITEM_COUNT |
+           NAUTILUS_FILE_ATTRIBUTE_INFO |
+           NAUTILUS_FILE_ATTRIBUTE_LINK_INFO |
+           NAUTILUS_FILE_ATTRIBUTE_MOUNT |
+           NAUTILUS_FILE_ATTRIBUTE_EXTENSION_INFO;
+}
+
+/* Adds or removes the hidden files of a directory shown in the view.
+ * The directory keeps its hidden files in any case, so there is no
+ * need to load it again.
+ */
+static void
+update_hidden_files (NautilusFilesView *view,
+                     NautilusDirectory *directory)
+{
+    GList *files, *hidden, *node;
+
+    /* From now on "all files" does or does not include hidden ones,
+     * so they get their attributes fetched or not.
+     */
+    nautilus_directory_file_monitor_add (directory,
+                                         &view->details->model,
+                                         view->details->show_hidden_files,
+                                         get_directory_monitor_attributes (),
+                                         NULL, NULL);
+
+    files = nautilus_directory_get_file_list (directory);
+    hidden = NULL;
+    for (node = files; node != NULL; node = node->next)
+    {
+        if (nautilus_file_is_hidden_file (node->data))
+        {
+            hidden = g_list_prepend (hidden, node->data);
+        }
+    }
+
+    /* Changed files that should no longer be shown are removed. */
+    queue_pending_files (view, directory, hidden,
+                         view->details->show_hidden_files ?
+                         &view->details->new_added_files :
+                         &view->details->new_changed_files);
+
+    g_list_free (hidden);
+    nautilus_file_list_free (files);
+}
+
 static void
 nautilus_files_view_set_show_hidden_files (NautilusFilesView *view,
                                            gboolean           show_hidden)
 {
+    GList *node;
+
     if (view->details->ignore_hidden_file_preferences)
     {
         return;
@@ -2379,10 +2461,27 @@ nautilus_files_view_set_show_hidden_files (NautilusFilesView *view,
                                 NAUTILUS_PREFERENCES_SHOW_HIDDEN_FILES,
                                 show_hidden);
 
-        if (view->details->model != NULL)
+        if (view->details->model == NULL)
+        {
+            return;
+        }
+
+        /* Search results are filtered by the search engine, so they
+         * have to be looked for again.
+         */
+        if (nautilus_view_is_searching (NAUTILUS_VIEW (view)))
         {
             load_directory (view, view->details->model);
+            return;
         }
+
+        update_hidden_files (view, view->details->model);
+        for (node = view->details->subdirectory_list; node != NULL; node = node->next)
+        {
+            update_hidden_files (view, node->data);
+        }
+
+        schedule_update_status (view);
     }
 }
 
@@ -2996,6 +3095,7 @@ nautilus_files_view_destroy (GtkWidget *object)
 
     remove_update_context_menus_timeout_callback (view);
     remove_update_status_idle_callback (view);
+    nautilus_files_view_set_prefetch_file (view, NULL);
 
     if (view->details->display_selection_idle_id != 0)
     {
@@ -3877,98 +3977,200 @@ on_end_file_changes (NautilusFilesView *view)
     }
 }
 
-static void
+/* Whether a slice of pending files that started at @start and has
+ * done @n_files so far has used up its time.
+ */
+static gboolean
+pending_slice_is_over (gint64 start,
+                       guint  n_files,
+                       guint  min_files)
+{
+    return n_files >= min_files &&
+           n_files % PENDING_FILES_CHECK_INTERVAL == 0 &&
+           g_get_monotonic_time () - start >= PENDING_FILES_TIME_BUDGET;
+}
+
+/* Cuts *list in front of @rest, leaving @rest in *list. Returns the
+ * part that was cut off.
+ */
+static GList *
+take_list_head (GList **list,
+                GList  *rest)
+{
+    GList *head;
+
+    head = *list;
+    if (rest == head)
+    {
+        return NULL;
+    }
+
+    if (rest != NULL)
+    {
+        rest->prev->next = NULL;
+        rest->prev = NULL;
+    }
+    *list = rest;
+
+    return head;
+}
+
+/* Hands ready files over to the subclass in the order they are shown,
+ * as many as fit in PENDING_FILES_TIME_BUDGET. Changes are only sent
+ * once all added files are in. Returns TRUE if files are left over
+ * for another slice.
+ */
+static gboolean
 process_old_files (NautilusFilesView *view)
 {
     GList *files_added, *files_changed, *node;
     FileAndDirectory *pending;
     GList *selection, *files;
+    gboolean send_selection_change;
+    gint64 start;
+    guint n_files, min_files;
 
-    files_added = view->details->old_added_files;
-    files_changed = view->details->old_changed_files;
+    if (view->details->old_added_files == NULL &&
+        view->details->old_changed_files == NULL)
+    {
+        return FALSE;
+    }
 
+    start = g_get_monotonic_time ();
+    n_files = 0;
+    min_files = view->details->shown_first_slice ? 1 : PENDING_FILES_FIRST_SLICE;
+    view->details->shown_first_slice = TRUE;
+    send_selection_change = FALSE;
 
-    if (files_added != NULL || files_changed != NULL)
+    g_signal_emit (view, signals[BEGIN_FILE_CHANGES], 0);
+
+    for (node = view->details->old_added_files; node != NULL; node = node->next)
     {
-        gboolean send_selection_change = FALSE;
+        if (pending_slice_is_over (start, n_files, min_files))
+        {
+            break;
+        }
+        n_files++;
+
+        pending = node->data;
+        g_signal_emit (view,
+                       signals[ADD_FILE], 0, pending->file, pending->directory);
+        /* Acknowledge the files that were pending to be revealed */
+        if (g_hash_table_contains (view->details->pending_reveal, pending->file))
+        {
+            g_hash_table_insert (view->details->pending_reveal,
+                                 pending->file,
+                                 GUINT_TO_POINTER (TRUE));
+        }
+    }
+    files_added = take_list_head (&view->details->old_added_files, node);
+
+    node = view->details->old_changed_files;
+    if (view->details->old_added_files != NULL)
+    {
+        node = NULL;
+    }
+    for (; node != NULL; node = node->next)
+    {
+        gboolean should_show_file;
+
+        if (pending_slice_is_over (start, n_files, min_files))
+        {
+            break;
+        }
+        n_files++;
 
-        g_signal_emit (view, signals[BEGIN_FILE_CHANGES], 0);
+        pending = node->data;
+        should_show_file = still_should_show_file (view, pending->file, pending->directory);
+        g_signal_emit (view,
+                       signals[should_show_file ? FILE_CHANGED : REMOVE_FILE], 0,
+                       pending->file, pending->directory);
 
-        for (node = files_added; node != NULL; node = node->next)
+        /* Acknowledge the files that were pending to be revealed */
+        if (g_hash_table_contains (view->details->pending_reveal, pending->file))
         {
-            pending = node->data;
-            g_signal_emit (view,
-                           signals[ADD_FILE], 0, pending->file, pending->directory);
-            /* Acknowledge the files that were pending to be revealed */
-            if (g_hash_table_contains (view->details->pending_reveal, pending->file))
+            if (should_show_file)
             {
                 g_hash_table_insert (view->details->pending_reveal,
                                      pending->file,
                                      GUINT_TO_POINTER (TRUE));
             }
-        }
-
-        for (node = files_changed; node != NULL; node = node->next)
-        {
-            gboolean should_show_file;
-            pending = node->data;
-            should_show_file = still_should_show_file (view, pending->file, pending->directory);
-            g_signal_emit (view,
-                           signals[should_show_file ? FILE_CHANGED : REMOVE_FILE], 0,
-                           pending->file, pending->directory);
-
-            /* Acknowledge the files that were pending to be revealed */
-            if (g_hash_table_contains (view->details->pending_reveal, pending->file))
+            else
             {
-                if (should_show_file)
-                {
-                    g_hash_table_insert (view->details->pending_reveal,
-                                         pending->file,
-                                         GUINT_TO_POINTER (TRUE));
-                }
-                else
-                {
-                    g_hash_table_remove (view->details->pending_reveal,
-                                         pending->file);
-                }
+                g_hash_table_remove (view->details->pending_reveal,
+                                     pending->file);
             }
         }
+    }
+    files_changed = view->details->old_added_files != NULL ? NULL :
+                    take_list_head (&view->details->old_changed_files, node);
 
-        if (files_changed != NULL)
-        {
-            selection = nautilus_view_get_selection (NAUTILUS_VIEW (view));
-            files = file_and_directory_list_to_files (files_changed);
-            send_selection_change = eel_g_lists_sort_and_check_for_intersection
-                                        (&files, &selection);
-            nautilus_file_list_free (files);
-            nautilus_file_list_free (selection);
-        }
+    if (files_changed != NULL)
+    {
+        selection = nautilus_view_get_selection (NAUTILUS_VIEW (view));
+        files = file_and_directory_list_to_files (files_changed);
+        send_selection_change = eel_g_lists_sort_and_check_for_intersection
+                                    (&files, &selection);
+        nautilus_file_list_free (files);
+        nautilus_file_list_free (selection);
+    }
 
-        file_and_directory_list_free (view->details->old_added_files);
-        view->details->old_added_files = NULL;
+    file_and_directory_list_free (files_added);
+    file_and_directory_list_free (files_changed);
 
-        file_and_directory_list_free (view->details->old_changed_files);
-        view->details->old_changed_files = NULL;
+    if (send_selection_change)
+    {
+        /* Send a selection change since some file names could
+         * have changed.
+         */
+        nautilus_files_view_send_selection_change (view);
+    }
 
-        if (send_selection_change)
-        {
-            /* Send a selection change since some file names could
-             * have changed.
-             */
-            nautilus_files_view_send_selection_change (view);
-        }
+    g_signal_emit (view, signals[END_FILE_CHANGES], 0);
 
-        g_signal_emit (view, signals[END_FILE_CHANGES], 0);
-    }
+    return view->details->old_added_files != NULL ||
+           view->details->old_changed_files != NULL;
 }
 
 static void
 display_pending_files (NautilusFilesView *view)
 {
     GList *selection;
+    gint64 start;
 
-    process_new_files (view);
-    process_old_files (view);
+    start = g_get_monotonic_time ();
+
+    /* Files that come in while a batch is being shown in slices wait
+     * for the next batch, so the rest of this one needn't be sorted
+     * again for every slice.
+     */
+    if (view->details->old_added_files == NULL &&
+        view->details->old_changed_files == NULL)
+    {
+        view->details->update_batch_cost = 0;
+        process_new_files (view);
+    }
+
+    if (process_old_files (view))
+    {
+        view->details->update_batch_cost += g_get_monotonic_time () - start;
+        schedule_idle_display_of_pending_files (view);
+        return;
+    }
+
+    /* Wait for the next batch in proportion to what this one cost. */
+    view->details->update_batch_cost += g_get_monotonic_time () - start;
+    view->details->update_interval =
+        CLAMP (view->details->update_batch_cost * UPDATE_INTERVAL_COST_FACTOR / 1000,
+               UPDATE_INTERVAL_MIN, UPDATE_INTERVAL_MAX);
+
+    if ((view->details->new_added_files != NULL ||
+         view->details->new_changed_files != NULL) &&
+        view->details->model != NULL &&
+        can_display_pending_files (view, view->details->model))
+    {
+        schedule_timeout_display_of_pending_files (view, view->details->update_interval);
+    }
 
     selection = nautilus_files_view_get_selection (NAUTILUS_VIEW (view));
 
@@ -4099,6 +4301,20 @@ unschedule_display_of_pending_files (NautilusFilesView *view)
     }
 }
 
+/* Generally we don't want to show the files while the directory is loading
+ * the files themselves, so we avoid jumping and oddities. However, for
+ * search it can be a long wait, and we actually want to show files as
+ * they are getting found. So for search is fine if not all files are
+ * seen */
+static gboolean
+can_display_pending_files (NautilusFilesView *view,
+                           NautilusDirectory *directory)
+{
+    return !view->details->loading ||
+           nautilus_directory_are_all_files_seen (directory) ||
+           nautilus_view_is_searching (NAUTILUS_VIEW (view));
+}
+
 static void
 queue_pending_files (NautilusFilesView  *view,
                      NautilusDirectory  *directory,
@@ -4112,26 +4328,20 @@ queue_pending_files (NautilusFilesView  *view,
 
     *pending_list = g_list_concat (file_and_directory_list_from_files (directory, files),
                                    *pending_list);
-    /* Generally we don't want to show the files while the directory is loading
-     * the files themselves, so we avoid jumping and oddities. However, for
-     * search it can be a long wait, and we actually want to show files as
-     * they are getting found. So for search is fine if not all files are
-     * seen */
-    if (!view->details->loading ||
-        (nautilus_directory_are_all_files_seen (directory) ||
-         nautilus_view_is_searching (NAUTILUS_VIEW (view))))
-    {
-        schedule_timeout_display_of_pending_files (view, view->details->update_interval);
-    }
-}
-
-static void
-remove_changes_timeout_callback (NautilusFilesView *view)
-{
-    if (view->details->changes_timeout_id != 0)
+    if (can_display_pending_files (view, directory))
     {
-        g_source_remove (view->details->changes_timeout_id);
-        view->details->changes_timeout_id = 0;
+        /* Nothing to look at yet, so don't keep the first files waiting. */
+        if (!view->details->shown_first_slice)
+        {
+            if (view->details->display_pending_source_id == 0)
+            {
+                schedule_idle_display_of_pending_files (view);
+            }
+        }
+        else
+        {
+            schedule_timeout_display_of_pending_files (view, view->details->update_interval);
+        }
     }
 }
 
@@ -4139,7 +4349,6 @@ static void
 reset_update_interval (NautilusFilesView *view)
 {
     view->details->update_interval = UPDATE_INTERVAL_MIN;
-    remove_changes_timeout_callback (view);
     /* Reschedule a pending timeout to idle */
     if (view->details->display_pending_source_id != 0)
     {
@@ -4147,60 +4356,6 @@ reset_update_interval (NautilusFilesView *view)
     }
 }
 
-static gboolean
-changes_timeout_callback (gpointer data)
-{
-    gint64 now;
-    gint64 time_delta;
-    gboolean ret;
-    NautilusFilesView *view;
-
-    view = NAUTILUS_FILES_VIEW (data);
-
-    g_object_ref (G_OBJECT (view));
-
-    now = g_get_monotonic_time ();
-    time_delta = now - view->details->last_queued;
-
-    if (time_delta < UPDATE_INTERVAL_RESET * 1000)
-    {
-        if (view->details->update_interval < UPDATE_INTERVAL_MAX &&
-            view->details->loading)
-        {
-            /* Increase */
-            view->details->update_interval += UPDATE_INTERVAL_INC;
-        }
-        ret = TRUE;
-    }
-    else
-    {
-        /* Reset */
-        reset_update_interval (view);
-        ret = FALSE;
-    }
-
-    g_object_unref (G_OBJECT (view));
-
-    return ret;
-}
-
-static void
-schedule_changes (NautilusFilesView *view)
-{
-    /* Remember when the change was queued */
-    view->details->last_queued = g_get_monotonic_time ();
-
-    /* No need to schedule if there are already changes pending or during loading */
-    if (view->details->changes_timeout_id != 0 ||
-        view->details->loading)
-    {
-        return;
-    }
-
-    view->details->changes_timeout_id =
-        g_timeout_add (UPDATE_INTERVAL_TIMEOUT_INTERVAL, changes_timeout_callback, view);
-}
-
 static void
 files_added_callback (NautilusDirectory *directory,
                       GList             *files,
@@ -4220,8 +4375,6 @@ files_added_callback (NautilusDirectory *directory,
                  window, uri ? uri : "(no directory)");
     g_free (uri);
 
-    schedule_changes (view);
-
     queue_pending_files (view, directory, files, &view->details->new_added_files);
 
     /* The number of items could have changed */
@@ -4247,8 +4400,6 @@ files_changed_callback (NautilusDirectory *directory,
                  window, uri ? uri : "(no directory)");
     g_free (uri);
 
-    schedule_changes (view);
-
     queue_pending_files (view, directory, files, &view->details->new_changed_files);
 
     /* The free space or the number of items could have changed */
@@ -4314,13 +4465,7 @@ nautilus_files_view_add_subdirectory (NautilusFilesView *view,
 
     nautilus_directory_ref (directory);
 
-    attributes =
-        NAUTILUS_FILE_ATTRIBUTES_FOR_ICON |
-        NAUTILUS_FILE_ATTRIBUTE_DIRECTORY_ITEM_COUNT |
-        NAUTILUS_FILE_ATTRIBUTE_INFO |
-        NAUTILUS_FILE_ATTRIBUTE_LINK_INFO |
-        NAUTILUS_FILE_ATTRIBUTE_MOUNT |
-        NAUTILUS_FILE_ATTRIBUTE_EXTENSION_INFO;
+    attributes = get_directory_monitor_attributes ();
 
     nautilus_directory_file_monitor_add (directory,
                                          &view->details->model,
@@ -7887,6 +8032,65 @@ schedule_update_status (NautilusFilesView *view)
     }
 }
 
+static gboolean
+prefetch_timeout_callback (gpointer data)
+{
+    NautilusFilesView *view;
+    NautilusDirectory *directory;
+
+    view = NAUTILUS_FILES_VIEW (data);
+    view->details->prefetch_timeout_id = 0;
+
+    directory = nautilus_directory_get_for_file (view->details->prefetch_file);
+    nautilus_directory_prefetch (directory);
+    nautilus_directory_unref (directory);
+
+    g_clear_pointer (&view->details->prefetch_file, nautilus_file_unref);
+
+    return G_SOURCE_REMOVE;
+}
+
+/**
+ * nautilus_files_view_set_prefetch_file:
+ *
+ * Tell the view which file the pointer is over or has keyboard focus,
+ * so a folder can be loaded before it gets opened. Called by
+ * subclasses.
+ * @view: NautilusFilesView the file is in.
+ * @file: The file, or NULL for none.
+ *
+ **/
+void
+nautilus_files_view_set_prefetch_file (NautilusFilesView *view,
+                                       NautilusFile      *file)
+{
+    g_return_if_fail (NAUTILUS_IS_FILES_VIEW (view));
+
+    if (file != NULL && !nautilus_file_is_directory (file))
+    {
+        file = NULL;
+    }
+
+    if (file == view->details->prefetch_file)
+    {
+        return;
+    }
+
+    if (view->details->prefetch_timeout_id != 0)
+    {
+        g_source_remove (view->details->prefetch_timeout_id);
+        view->details->prefetch_timeout_id = 0;
+    }
+    g_clear_pointer (&view->details->prefetch_file, nautilus_file_unref);
+
+    if (file != NULL)
+    {
+        view->details->prefetch_file = nautilus_file_ref (file);
+        view->details->prefetch_timeout_id =
+            g_timeout_add (PREFETCH_DELAY, prefetch_timeout_callback, view);
+    }
+}
+
 /**
  * nautilus_files_view_notify_selection_changed:
  *
@@ -7906,6 +8110,12 @@ nautilus_files_view_notify_selection_changed (NautilusFilesView *view)
     selection = nautilus_view_get_selection (NAUTILUS_VIEW (view));
     window = nautilus_files_view_get_containing_window (view);
     DEBUG_FILES (selection, "Selection changed in window %p", window);
+
+    /* A single selected folder is where keyboard navigation is. */
+    if (selection != NULL && selection->next == NULL)
+    {
+        nautilus_files_view_set_prefetch_file (view, selection->data);
+    }
     nautilus_file_list_free (selection);
 
     view->details->selection_was_removed = FALSE;
@@ -7941,8 +8151,6 @@ file_changed_callback (NautilusFile *file,
 {
     NautilusFilesView *view = NAUTILUS_FILES_VIEW (callback_data);
 
-    schedule_changes (view);
-
     schedule_update_context_menus (view);
     schedule_update_status (view);
 }
@@ -7971,6 +8179,7 @@ load_directory (NautilusFilesView *view,
     g_signal_emit (view, signals[CLEAR], 0);
 
     view->details->loading = TRUE;
+    view->details->shown_first_slice = FALSE;
 
     setup_loading_floating_bar (view);
 
@@ -8076,18 +8285,7 @@ finish_loading (NautilusFilesView *view)
                                                (view->details->model, "load-error",
                                                G_CALLBACK (load_error_callback), view);
 
-    /* Monitor the things needed to get the right icon. Also
-     * monitor a directory's item count because the "size"
-     * attribute is based on that, and the file's metadata
-     * and possible custom name.
-     */
-    attributes =
-        NAUTILUS_FILE_ATTRIBUTES_FOR_ICON |
-        NAUTILUS_FILE_ATTRIBUTE_DIRECTORY_ITEM_COUNT |
-        NAUTILUS_FILE_ATTRIBUTE_INFO |
-        NAUTILUS_FILE_ATTRIBUTE_LINK_INFO |
-        NAUTILUS_FILE_ATTRIBUTE_MOUNT |
-        NAUTILUS_FILE_ATTRIBUTE_EXTENSION_INFO;
+    attributes = get_directory_monitor_attributes ();
 
     nautilus_directory_file_monitor_add (view->details->model,
                                          &view->details->model,
@@ -8199,6 +8397,8 @@ disconnect_model_handlers (NautilusFilesView *view)
     nautilus_directory_cancel_callback (view->details->model,
                                         metadata_for_files_in_directory_ready_callback,
                                         view);
+    /* Before the monitor goes, so the files stay loaded for going back. */
+    nautilus_directory_retain (view->details->model);
     nautilus_directory_file_monitor_remove (view->details->model,
                                             &view->details->model);
     nautilus_file_monitor_remove (view->details->directory_as_file,
@@ -9072,10 +9272,11 @@ nautilus_files_view_init (NautilusFilesView *view)
     view->details->reload = GTK_WIDGET (gtk_builder_get_object (builder, "reload"));
     view->details->stop = GTK_WIDGET (gtk_builder_get_object (builder, "stop"));
 
-    g_signal_connect (view,
-                      "end-file-changes",
-                      G_CALLBACK (on_end_file_changes),
-                      view);
+    /* After the class handler, so views that batch changes are done */
+    g_signal_connect_after (view,
+                            "end-file-changes",
+                            G_CALLBACK (on_end_file_changes),
+                            view);
 
     g_object_unref (builder);
 
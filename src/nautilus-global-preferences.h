@@ -130,6 +130,9 @@ typedef enum
 } NautilusSpeedTradeoffValue;
 
 #define NAUTILUS_PREFERENCES_SHOW_DIRECTORY_ITEM_COUNTS "show-directory-item-counts"
+#define NAUTILUS_PREFERENCES_USE_LISTING_CACHE		"use-listing-cache"
+#define NAUTILUS_PREFERENCES_RETAINED_FOLDERS		"retained-folders"
+#define NAUTILUS_PREFERENCES_RETAINED_FOLDERS_MEMORY	"retained-folders-memory"
 #define NAUTILUS_PREFERENCES_SHOW_FILE_THUMBNAILS	"show-image-thumbnails"
 #define NAUTILUS_PREFERENCES_FILE_THUMBNAIL_LIMIT	"thumbnail-limit"
 
@@ -31,6 +31,7 @@
 #include <gtk/gtk.h>
 #include <cairo-gobject.h>
 
+#include <eel/eel-glib-extensions.h>
 #include <eel/eel-graphic-effects.h>
 #include "nautilus-dnd.h"
 
@@ -48,6 +49,11 @@ static GQuark attribute_name_q,
 /* msec delay after Loading... dummy row turns into (empty) */
 #define LOADING_TO_EMPTY_DELAY 100
 
+/* Directories with at least this many rows are sorted by several
+ * threads at once.
+ */
+#define PARALLEL_SORT_THRESHOLD 10000
+
 static guint list_model_signals[LAST_SIGNAL] = { 0 };
 
 static int nautilus_list_model_file_entry_compare_func (gconstpointer a,
@@ -75,9 +81,23 @@ struct NautilusListModelDetails
 
     GPtrArray *columns;
 
-    GList *highlight_files;
+    GHashTable *highlight_files;     /* set of NautilusFile's */
+    GHashTable *icon_surfaces;       /* set of SharedIconSurface's */
 };
 
+/* Rows showing the same pixbuf at the same scale share one surface,
+ * so a folder full of files with the same icon only has one of them.
+ * Neither the pixbuf nor the surface is referenced; the entry goes
+ * away with whichever of the two goes first.
+ */
+typedef struct
+{
+    GHashTable *surfaces;
+    GdkPixbuf *pixbuf;               /* NULL once out of surfaces */
+    int scale;
+    cairo_surface_t *surface;
+} SharedIconSurface;
+
 typedef struct
 {
     NautilusListModel *model;
@@ -96,6 +116,14 @@ struct FileEntry
     GSequence *files;
     GSequenceIter *ptr;
     guint loaded : 1;
+
+    /* The last icon handed out, for the zoom level and scale
+     * it was made for. Dropped when the row changes. Rows with
+     * the same icon share the surface.
+     */
+    cairo_surface_t *icon_surface;
+    NautilusListZoomLevel icon_zoom_level;
+    int icon_scale;
 };
 
 G_DEFINE_TYPE_WITH_CODE (NautilusListModel, nautilus_list_model, G_TYPE_OBJECT,
@@ -110,9 +138,122 @@ static const GtkTargetEntry drag_types [] =
     { NAUTILUS_ICON_DND_URI_LIST_TYPE, 0, NAUTILUS_ICON_DND_URI_LIST },
 };
 
+static cairo_user_data_key_t shared_icon_surface_key;
+
+static guint
+shared_icon_surface_hash (gconstpointer key)
+{
+    const SharedIconSurface *shared;
+
+    shared = key;
+
+    return g_direct_hash (shared->pixbuf) ^ shared->scale;
+}
+
+static gboolean
+shared_icon_surface_equal (gconstpointer a,
+                           gconstpointer b)
+{
+    const SharedIconSurface *shared_a, *shared_b;
+
+    shared_a = a;
+    shared_b = b;
+
+    return shared_a->pixbuf == shared_b->pixbuf &&
+           shared_a->scale == shared_b->scale;
+}
+
+static void
+shared_icon_surface_pixbuf_finalized (gpointer  data,
+                                      GObject  *where_the_object_was)
+{
+    SharedIconSurface *shared;
+
+    shared = data;
+
+    /* Another pixbuf may get the same address. */
+    g_hash_table_remove (shared->surfaces, shared);
+    shared->pixbuf = NULL;
+}
+
+static void
+shared_icon_surface_forget (SharedIconSurface *shared)
+{
+    if (shared->pixbuf != NULL)
+    {
+        g_hash_table_remove (shared->surfaces, shared);
+        g_object_weak_unref (G_OBJECT (shared->pixbuf),
+                             shared_icon_surface_pixbuf_finalized, shared);
+        shared->pixbuf = NULL;
+    }
+}
+
+/* Called once no row shows the surface anymore. */
+static void
+shared_icon_surface_destroyed (gpointer data)
+{
+    SharedIconSurface *shared;
+
+    shared = data;
+
+    shared_icon_surface_forget (shared);
+    g_free (shared);
+}
+
+static void
+shared_icon_surface_forget_foreach (gpointer key,
+                                    gpointer value,
+                                    gpointer user_data)
+{
+    SharedIconSurface *shared;
+
+    shared = key;
+
+    /* Not through shared_icon_surface_forget(), the table is being iterated. */
+    g_object_weak_unref (G_OBJECT (shared->pixbuf),
+                         shared_icon_surface_pixbuf_finalized, shared);
+    shared->pixbuf = NULL;
+}
+
+static cairo_surface_t *
+get_shared_icon_surface (NautilusListModel *model,
+                         GdkPixbuf         *pixbuf,
+                         int                scale)
+{
+    SharedIconSurface key, *shared;
+
+    key.pixbuf = pixbuf;
+    key.scale = scale;
+    shared = g_hash_table_lookup (model->details->icon_surfaces, &key);
+    if (shared != NULL)
+    {
+        return cairo_surface_reference (shared->surface);
+    }
+
+    shared = g_new0 (SharedIconSurface, 1);
+    shared->surfaces = model->details->icon_surfaces;
+    shared->pixbuf = pixbuf;
+    shared->scale = scale;
+    shared->surface = gdk_cairo_surface_create_from_pixbuf (pixbuf, scale, NULL);
+
+    cairo_surface_set_user_data (shared->surface, &shared_icon_surface_key,
+                                 shared, shared_icon_surface_destroyed);
+    g_object_weak_ref (G_OBJECT (pixbuf), shared_icon_surface_pixbuf_finalized, shared);
+    g_hash_table_add (model->details->icon_surfaces, shared);
+
+    return shared->surface;
+}
+
+static void
+file_entry_clear_icon (FileEntry *file_entry)
+{
+    g_clear_pointer (&file_entry->icon_surface, cairo_surface_destroy);
+}
+
 static void
 file_entry_free (FileEntry *file_entry)
 {
+    file_entry_clear_icon (file_entry);
     nautilus_file_unref (file_entry->file);
     if (file_entry->reverse_map)
     {
@@ -311,6 +452,70 @@ nautilus_list_model_get_icon_size_for_zoom_level (NautilusListZoomLevel zoom_lev
     g_return_val_if_reached (NAUTILUS_LIST_ICON_SIZE_STANDARD);
 }
 
+static gboolean
+is_drag_dest_row (NautilusListModel *model,
+                  GtkTreeIter       *iter)
+{
+    GtkTreePath *path;
+    GtkTreeIter dest_iter;
+    gboolean result;
+
+    gtk_tree_view_get_drag_dest_row (model->details->drag_view, &path, NULL);
+    if (path == NULL)
+    {
+        return FALSE;
+    }
+
+    result = gtk_tree_model_get_iter (GTK_TREE_MODEL (model), &dest_iter, path) &&
+             dest_iter.user_data == iter->user_data;
+    gtk_tree_path_free (path);
+
+    return result;
+}
+
+static cairo_surface_t *
+create_icon_surface (NautilusListModel     *model,
+                     NautilusFile          *file,
+                     NautilusListZoomLevel  zoom_level,
+                     int                    icon_scale,
+                     gboolean               drag_accept)
+{
+    GdkPixbuf *icon, *rendered_icon;
+    NautilusFileIconFlags flags;
+    cairo_surface_t *surface;
+    int icon_size;
+
+    icon_size = nautilus_list_model_get_icon_size_for_zoom_level (zoom_level);
+
+    flags = NAUTILUS_FILE_ICON_FLAGS_USE_THUMBNAILS |
+            NAUTILUS_FILE_ICON_FLAGS_FORCE_THUMBNAIL_SIZE |
+            NAUTILUS_FILE_ICON_FLAGS_USE_EMBLEMS |
+            NAUTILUS_FILE_ICON_FLAGS_USE_ONE_EMBLEM;
+    if (drag_accept)
+    {
+        flags |= NAUTILUS_FILE_ICON_FLAGS_FOR_DRAG_ACCEPT;
+    }
+
+    icon = nautilus_file_get_icon_pixbuf (file, icon_size, TRUE, icon_scale, flags);
+
+    if (model->details->highlight_files != NULL &&
+        g_hash_table_contains (model->details->highlight_files, file))
+    {
+        rendered_icon = eel_create_spotlight_pixbuf (icon);
+
+        if (rendered_icon != NULL)
+        {
+            g_object_unref (icon);
+            icon = rendered_icon;
+        }
+    }
+
+    surface = get_shared_icon_surface (model, icon, icon_scale);
+    g_object_unref (icon);
+
+    return surface;
+}
+
 static void
 nautilus_list_model_get_value (GtkTreeModel *tree_model,
                                GtkTreeIter  *iter,
@@ -321,11 +526,9 @@ nautilus_list_model_get_value (GtkTreeModel *tree_model,
     FileEntry *file_entry;
     NautilusFile *file;
     char *str;
-    GdkPixbuf *icon, *rendered_icon;
-    int icon_size, icon_scale;
+    int icon_scale;
     NautilusListZoomLevel zoom_level;
-    NautilusFileIconFlags flags;
-    cairo_surface_t *surface;
+    gboolean drag_accept;
 
     model = (NautilusListModel *) tree_model;
 
@@ -363,53 +566,31 @@ nautilus_list_model_get_value (GtkTreeModel *tree_model,
                 if (file != NULL)
                 {
                     zoom_level = nautilus_list_model_get_zoom_level_from_column_id (column);
-                    icon_size = nautilus_list_model_get_icon_size_for_zoom_level (zoom_level);
                     icon_scale = nautilus_list_model_get_icon_scale (model);
+                    drag_accept = model->details->drag_view != NULL &&
+                                  is_drag_dest_row (model, iter);
 
-                    flags = NAUTILUS_FILE_ICON_FLAGS_USE_THUMBNAILS |
-                            NAUTILUS_FILE_ICON_FLAGS_FORCE_THUMBNAIL_SIZE |
-                            NAUTILUS_FILE_ICON_FLAGS_USE_EMBLEMS |
-                            NAUTILUS_FILE_ICON_FLAGS_USE_ONE_EMBLEM;
-
-                    if (model->details->drag_view != NULL)
+                    if (drag_accept)
                     {
-                        GtkTreePath *path_a, *path_b;
-
-                        gtk_tree_view_get_drag_dest_row (model->details->drag_view,
-                                                         &path_a,
-                                                         NULL);
-                        if (path_a != NULL)
-                        {
-                            path_b = gtk_tree_model_get_path (tree_model, iter);
-
-                            if (gtk_tree_path_compare (path_a, path_b) == 0)
-                            {
-                                flags |= NAUTILUS_FILE_ICON_FLAGS_FOR_DRAG_ACCEPT;
-                            }
-
-                            gtk_tree_path_free (path_a);
-                            gtk_tree_path_free (path_b);
-                        }
+                        /* Only shown while hovered, not worth keeping */
+                        g_value_take_boxed (value,
+                                            create_icon_surface (model, file, zoom_level,
+                                                                 icon_scale, TRUE));
                     }
-
-                    icon = nautilus_file_get_icon_pixbuf (file, icon_size, TRUE, icon_scale, flags);
-
-                    if (model->details->highlight_files != NULL &&
-                        g_list_find_custom (model->details->highlight_files,
-                                            file, (GCompareFunc) nautilus_file_compare_location))
+                    else
                     {
-                        rendered_icon = eel_create_spotlight_pixbuf (icon);
-
-                        if (rendered_icon != NULL)
+                        if (file_entry->icon_surface == NULL ||
+                            file_entry->icon_zoom_level != zoom_level ||
+                            file_entry->icon_scale != icon_scale)
                         {
-                            g_object_unref (icon);
-                            icon = rendered_icon;
+                            file_entry_clear_icon (file_entry);
+                            file_entry->icon_surface = create_icon_surface (model, file, zoom_level,
+                                                                            icon_scale, FALSE);
+                            file_entry->icon_zoom_level = zoom_level;
+                            file_entry->icon_scale = icon_scale;
                         }
+                        g_value_set_boxed (value, file_entry->icon_surface);
                     }
-
-                    surface = gdk_cairo_surface_create_from_pixbuf (icon, icon_scale, NULL);
-                    g_value_take_boxed (value, surface);
-                    g_object_unref (icon);
                 }
             }
             break;
@@ -780,6 +961,43 @@ nautilus_list_model_compare_func (NautilusListModel *model,
     return result;
 }
 
+static void
+sort_file_entries_in_parallel (NautilusListModel *model,
+                               GSequence         *files,
+                               int                length)
+{
+    FileEntry **entries;
+    GSequenceIter *ptr, *end;
+    int i;
+
+    entries = g_new (FileEntry *, length);
+    for (ptr = g_sequence_get_begin_iter (files), i = 0;
+         !g_sequence_iter_is_end (ptr);
+         ptr = g_sequence_iter_next (ptr), i++)
+    {
+        entries[i] = g_sequence_get (ptr);
+        if (entries[i]->file != NULL)
+        {
+            nautilus_file_prepare_for_sort_by_attribute_q (entries[i]->file,
+                                                           model->details->sort_attribute);
+        }
+    }
+
+    eel_sort_pointers_parallel ((gpointer *) entries, length,
+                                nautilus_list_model_file_entry_compare_func, model);
+
+    /* Moving every row to the end in sorted order leaves them sorted.
+     * The iters stay valid, as the model promises.
+     */
+    end = g_sequence_get_end_iter (files);
+    for (i = 0; i < length; i++)
+    {
+        g_sequence_move (entries[i]->ptr, end);
+    }
+
+    g_free (entries);
+}
+
 static void
 nautilus_list_model_sort_file_entries (NautilusListModel *model,
                                        GSequence         *files,
@@ -818,7 +1036,14 @@ nautilus_list_model_sort_file_entries (NautilusListModel *model,
     }
 
     /* sort */
-    g_sequence_sort (files, nautilus_list_model_file_entry_compare_func, model);
+    if (length >= PARALLEL_SORT_THRESHOLD)
+    {
+        sort_file_entries_in_parallel (model, files, length);
+    }
+    else
+    {
+        g_sequence_sort (files, nautilus_list_model_file_entry_compare_func, model);
+    }
 
     /* generate new order */
     new_order = g_new (int, length);
@@ -914,20 +1139,29 @@ nautilus_list_model_has_default_sort_func (GtkTreeSortable *sortable)
     return FALSE;
 }
 
-static void
-add_dummy_row (NautilusListModel *model,
-               FileEntry         *parent_entry)
+static GSequenceIter *
+insert_dummy_row (NautilusListModel *model,
+                  FileEntry         *parent_entry)
 {
     FileEntry *dummy_file_entry;
-    GtkTreeIter iter;
-    GtkTreePath *path;
 
     dummy_file_entry = g_new0 (FileEntry, 1);
     dummy_file_entry->parent = parent_entry;
     dummy_file_entry->ptr = g_sequence_insert_sorted (parent_entry->files, dummy_file_entry,
                                                       nautilus_list_model_file_entry_compare_func, model);
+
+    return dummy_file_entry->ptr;
+}
+
+static void
+add_dummy_row (NautilusListModel *model,
+               FileEntry         *parent_entry)
+{
+    GtkTreeIter iter;
+    GtkTreePath *path;
+
+    iter.user_data = insert_dummy_row (model, parent_entry);
     iter.stamp = model->details->stamp;
-    iter.user_data = dummy_file_entry->ptr;
 
     path = gtk_tree_model_get_path (GTK_TREE_MODEL (model), &iter);
     gtk_tree_model_row_inserted (GTK_TREE_MODEL (model), path, &iter);
@@ -1035,6 +1269,193 @@ nautilus_list_model_add_file (NautilusListModel *model,
     return TRUE;
 }
 
+static int
+file_entry_compare_indirect (gconstpointer a,
+                             gconstpointer b,
+                             gpointer      user_data)
+{
+    return nautilus_list_model_file_entry_compare_func (*(FileEntry **) a,
+                                                        *(FileEntry **) b,
+                                                        user_data);
+}
+
+static gboolean
+file_entries_are_sorted (NautilusListModel *model,
+                         GPtrArray         *entries)
+{
+    guint i;
+
+    for (i = 1; i < entries->len; i++)
+    {
+        if (nautilus_list_model_file_entry_compare_func (g_ptr_array_index (entries, i - 1),
+                                                         g_ptr_array_index (entries, i),
+                                                         model) > 0)
+        {
+            return FALSE;
+        }
+    }
+
+    return TRUE;
+}
+
+/* Adds a batch of files to the same directory. The batch is sorted
+ * once and merged into the rows already there, instead of each file
+ * being looked up in the sequence. A tree view that was detached from
+ * the model for the occasion isn't told about each row.
+ */
+void
+nautilus_list_model_add_files (NautilusListModel *model,
+                               GList             *files,
+                               NautilusDirectory *directory)
+{
+    GtkTreeIter iter;
+    GtkTreePath *path;
+    FileEntry *parent_entry, *file_entry;
+    GSequenceIter *parent_ptr, *ptr, *cursor;
+    GSequence *sequence;
+    GHashTable *parent_hash;
+    GPtrArray *entries;
+    GList *node;
+    gboolean replace_dummy, notify, merge;
+    guint i, n_existing;
+
+    parent_ptr = g_hash_table_lookup (model->details->directory_reverse_map,
+                                      directory);
+    if (parent_ptr != NULL)
+    {
+        parent_entry = g_sequence_get (parent_ptr);
+        sequence = parent_entry->files;
+        parent_hash = parent_entry->reverse_map;
+    }
+    else
+    {
+        parent_entry = NULL;
+        sequence = model->details->files;
+        parent_hash = model->details->top_reverse_map;
+    }
+
+    entries = g_ptr_array_new ();
+    for (node = files; node != NULL; node = node->next)
+    {
+        if (g_hash_table_contains (parent_hash, node->data))
+        {
+            g_warning ("file already in tree (parent_ptr: %p)!!!\n", parent_ptr);
+            continue;
+        }
+
+        file_entry = g_new0 (FileEntry, 1);
+        file_entry->file = nautilus_file_ref (node->data);
+        file_entry->parent = parent_entry;
+        g_ptr_array_add (entries, file_entry);
+
+        /* Claim the file now, to catch it twice in the batch. */
+        g_hash_table_insert (parent_hash, file_entry->file, NULL);
+    }
+
+    if (entries->len == 0)
+    {
+        g_ptr_array_free (entries, TRUE);
+        return;
+    }
+
+    /* The view sorts pending files the same way, so this is usually
+     * a single pass.
+     */
+    if (!file_entries_are_sorted (model, entries))
+    {
+        g_ptr_array_sort_with_data (entries, file_entry_compare_indirect, model);
+    }
+
+    replace_dummy = FALSE;
+    if (parent_entry != NULL)
+    {
+        /* See nautilus_list_model_add_file() */
+        parent_entry->loaded = 1;
+        if (g_sequence_get_length (sequence) == 1)
+        {
+            ptr = g_sequence_get_begin_iter (sequence);
+            if (((FileEntry *) g_sequence_get (ptr))->file == NULL)
+            {
+                model->details->stamp++;
+                g_sequence_remove (ptr);
+                replace_dummy = TRUE;
+            }
+        }
+    }
+
+    /* Walking the existing rows only pays when the batch isn't tiny
+     * next to them. Otherwise each file is looked up on its own.
+     */
+    n_existing = g_sequence_get_length (sequence);
+    merge = (guint64) entries->len * g_bit_storage (n_existing) >= n_existing;
+
+    notify = g_signal_has_handler_pending (model,
+                                           g_signal_lookup ("row-inserted", GTK_TYPE_TREE_MODEL),
+                                           0, FALSE);
+
+    cursor = g_sequence_get_begin_iter (sequence);
+    for (i = 0; i < entries->len; i++)
+    {
+        file_entry = g_ptr_array_index (entries, i);
+
+        if (merge)
+        {
+            while (!g_sequence_iter_is_end (cursor) &&
+                   nautilus_list_model_file_entry_compare_func (g_sequence_get (cursor),
+                                                                file_entry, model) <= 0)
+            {
+                cursor = g_sequence_iter_next (cursor);
+            }
+            file_entry->ptr = g_sequence_insert_before (cursor, file_entry);
+        }
+        else
+        {
+            file_entry->ptr = g_sequence_insert_sorted (sequence, file_entry,
+                                                        nautilus_list_model_file_entry_compare_func, model);
+        }
+
+        g_hash_table_insert (parent_hash, file_entry->file, file_entry->ptr);
+
+        if (nautilus_file_is_directory (file_entry->file))
+        {
+            file_entry->files = g_sequence_new ((GDestroyNotify) file_entry_free);
+        }
+
+        if (!notify)
+        {
+            if (file_entry->files != NULL)
+            {
+                insert_dummy_row (model, file_entry);
+            }
+            continue;
+        }
+
+        iter.stamp = model->details->stamp;
+        iter.user_data = file_entry->ptr;
+
+        path = gtk_tree_model_get_path (GTK_TREE_MODEL (model), &iter);
+        if (replace_dummy && i == 0)
+        {
+            gtk_tree_model_row_changed (GTK_TREE_MODEL (model), path, &iter);
+        }
+        else
+        {
+            gtk_tree_model_row_inserted (GTK_TREE_MODEL (model), path, &iter);
+        }
+
+        if (file_entry->files != NULL)
+        {
+            add_dummy_row (model, file_entry);
+
+            gtk_tree_model_row_has_child_toggled (GTK_TREE_MODEL (model),
+                                                  path, &iter);
+        }
+        gtk_tree_path_free (path);
+    }
+
+    g_ptr_array_free (entries, TRUE);
+}
+
 void
 nautilus_list_model_file_changed (NautilusListModel *model,
                                   NautilusFile      *file,
@@ -1055,6 +1476,7 @@ nautilus_list_model_file_changed (NautilusListModel *model,
         return;
     }
 
+    file_entry_clear_icon (g_sequence_get (ptr));
 
     pos_before = g_sequence_iter_get_position (ptr);
 
@@ -1596,10 +2018,15 @@ nautilus_list_model_finalize (GObject *object)
 
     if (model->details->highlight_files != NULL)
     {
-        nautilus_file_list_free (model->details->highlight_files);
+        g_hash_table_destroy (model->details->highlight_files);
         model->details->highlight_files = NULL;
     }
 
+    /* The tree view may still hold some of the surfaces. */
+    g_hash_table_foreach (model->details->icon_surfaces,
+                          shared_icon_surface_forget_foreach, NULL);
+    g_hash_table_destroy (model->details->icon_surfaces);
+
     g_free (model->details);
 
     G_OBJECT_CLASS (nautilus_list_model_parent_class)->finalize (object);
@@ -1615,6 +2042,8 @@ nautilus_list_model_init (NautilusListModel *model)
     model->details->stamp = g_random_int ();
     model->details->sort_attribute = 0;
     model->details->columns = g_ptr_array_new ();
+    model->details->icon_surfaces = g_hash_table_new (shared_icon_surface_hash,
+                                                      shared_icon_surface_equal);
 }
 
 static void
@@ -1729,6 +2158,7 @@ refresh_row (gpointer data,
     NautilusListModel *model;
     GList *iters, *l;
     GtkTreePath *path;
+    GtkTreeIter *iter;
 
     model = user_data;
     file = data;
@@ -1736,8 +2166,11 @@ refresh_row (gpointer data,
     iters = nautilus_list_model_get_all_iters_for_file (model, file);
     for (l = iters; l != NULL; l = l->next)
     {
-        path = gtk_tree_model_get_path (GTK_TREE_MODEL (model), l->data);
-        gtk_tree_model_row_changed (GTK_TREE_MODEL (model), path, l->data);
+        iter = l->data;
+        file_entry_clear_icon (g_sequence_get (iter->user_data));
+
+        path = gtk_tree_model_get_path (GTK_TREE_MODEL (model), iter);
+        gtk_tree_model_row_changed (GTK_TREE_MODEL (model), path, iter);
 
         gtk_tree_path_free (path);
     }
@@ -1749,18 +2182,69 @@ void
 nautilus_list_model_set_highlight_for_files (NautilusListModel *model,
                                              GList             *files)
 {
-    if (model->details->highlight_files != NULL)
+    GHashTable *old_files;
+    GHashTableIter iter;
+    gpointer file;
+    GList *l;
+
+    /* NautilusFile's are unique per location, so the set can
+     * go by pointer.
+     */
+    old_files = model->details->highlight_files;
+    model->details->highlight_files = NULL;
+
+    if (files != NULL)
     {
-        g_list_foreach (model->details->highlight_files,
-                        refresh_row, model);
-        nautilus_file_list_free (model->details->highlight_files);
-        model->details->highlight_files = NULL;
+        model->details->highlight_files = g_hash_table_new_full (NULL, NULL,
+                                                                 (GDestroyNotify) nautilus_file_unref,
+                                                                 NULL);
+        for (l = files; l != NULL; l = l->next)
+        {
+            g_hash_table_add (model->details->highlight_files,
+                              nautilus_file_ref (l->data));
+        }
     }
 
-    if (files != NULL)
+    if (old_files != NULL)
+    {
+        g_hash_table_iter_init (&iter, old_files);
+        while (g_hash_table_iter_next (&iter, &file, NULL))
+        {
+            refresh_row (file, model);
+        }
+        g_hash_table_destroy (old_files);
+    }
+
+    for (l = files; l != NULL; l = l->next)
+    {
+        refresh_row (l->data, model);
+    }
+}
+
+static void
+clear_icons_in_sequence (GSequence *files)
+{
+    GSequenceIter *ptr;
+    FileEntry *file_entry;
+
+    for (ptr = g_sequence_get_begin_iter (files);
+         !g_sequence_iter_is_end (ptr);
+         ptr = g_sequence_iter_next (ptr))
     {
-        model->details->highlight_files = nautilus_file_list_copy (files);
-        g_list_foreach (model->details->highlight_files,
-                        refresh_row, model);
+        file_entry = g_sequence_get (ptr);
+        file_entry_clear_icon (file_entry);
+        if (file_entry->files != NULL)
+        {
+            clear_icons_in_sequence (file_entry->files);
+        }
     }
 }
+
+/* Drops the icons kept for the rows, for when they won't be
+ * asked for at the same size again.
+ */
+void
+nautilus_list_model_clear_icon_cache (NautilusListModel *model)
+{
+    clear_icons_in_sequence (model->details->files);
+}
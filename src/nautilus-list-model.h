@@ -70,6 +70,9 @@ GType    nautilus_list_model_get_type                          (void);
 gboolean nautilus_list_model_add_file                          (NautilusListModel          *model,
 								NautilusFile         *file,
 								NautilusDirectory    *directory);
+void     nautilus_list_model_add_files                         (NautilusListModel          *model,
+								GList                *files,
+								NautilusDirectory    *directory);
 void     nautilus_list_model_file_changed                      (NautilusListModel          *model,
 								NautilusFile         *file,
 								NautilusDirectory    *directory);
@@ -128,5 +131,7 @@ void              nautilus_list_model_subdirectory_done_loading (NautilusListMod
 
 void              nautilus_list_model_set_highlight_for_files (NautilusListModel *model,
 							       GList *files);
+
+void              nautilus_list_model_clear_icon_cache (NautilusListModel *model);
 						   
 #endif /* NAUTILUS_LIST_MODEL_H */
@@ -41,6 +41,12 @@ struct NautilusListViewDetails {
 
   GtkTreePath *new_selection_path;   /* Path of the new selection after removing a file */
 
+  /* Files added since begin_file_changes, not yet in the model.
+   * Maps a directory to a GQueue of its files.
+   */
+  GHashTable *pending_added_files;
+  gboolean batching_file_changes;
+
   GtkTreePath *hover_path;
 
   gint last_event_button_x;
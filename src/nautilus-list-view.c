@@ -80,6 +80,12 @@ struct SelectionForeachData
 /* We wait two seconds after row is collapsed to unload the subdirectory */
 #define COLLAPSE_TO_UNLOAD_DELAY 2
 
+/* Filling an empty list with at least this many files is done with
+ * the model detached from the tree view, so the tree view doesn't
+ * handle the rows one at a time.
+ */
+#define DETACHED_FILL_THRESHOLD 256
+
 static GdkCursor *hand_cursor = NULL;
 
 static GList *nautilus_list_view_get_selection (NautilusFilesView *view);
@@ -317,6 +323,27 @@ nautilus_list_view_did_not_drag (NautilusListView *view,
     }
 }
 
+/* Let the view load the folder under the pointer ahead of time. */
+static void
+update_prefetch_file (NautilusListView *view,
+                      double            x,
+                      double            y)
+{
+    GtkTreePath *path;
+    NautilusFile *file;
+
+    file = NULL;
+    if (gtk_tree_view_get_path_at_pos (view->details->tree_view,
+                                       x, y, &path, NULL, NULL, NULL))
+    {
+        file = nautilus_list_model_file_for_path (view->details->model, path);
+        gtk_tree_path_free (path);
+    }
+
+    nautilus_files_view_set_prefetch_file (NAUTILUS_FILES_VIEW (view), file);
+    nautilus_file_unref (file);
+}
+
 static gboolean
 motion_notify_callback (GtkWidget      *widget,
                         GdkEventMotion *event,
@@ -360,6 +387,8 @@ motion_notify_callback (GtkWidget      *widget,
         }
     }
 
+    update_prefetch_file (view, event->x, event->y);
+
     nautilus_list_view_dnd_init (view);
     handled = nautilus_list_view_dnd_drag_begin (view, event);
 
@@ -382,6 +411,8 @@ leave_notify_callback (GtkWidget        *widget,
         view->details->hover_path = NULL;
     }
 
+    nautilus_files_view_set_prefetch_file (NAUTILUS_FILES_VIEW (view), NULL);
+
     return FALSE;
 }
 
@@ -2047,15 +2078,81 @@ create_and_set_up_tree_view (NautilusListView *view)
     g_strfreev (default_column_order);
 }
 
+static void
+pending_files_free (GQueue *files)
+{
+    g_queue_free_full (files, (GDestroyNotify) nautilus_file_unref);
+}
+
+static void
+flush_added_files (NautilusListView *list_view)
+{
+    GHashTableIter iter;
+    gpointer directory, files;
+    guint count;
+    gboolean detach;
+
+    if (g_hash_table_size (list_view->details->pending_added_files) == 0)
+    {
+        return;
+    }
+
+    count = 0;
+    g_hash_table_iter_init (&iter, list_view->details->pending_added_files);
+    while (g_hash_table_iter_next (&iter, NULL, &files))
+    {
+        count += g_queue_get_length (files);
+    }
+
+    detach = count >= DETACHED_FILL_THRESHOLD &&
+             nautilus_list_model_is_empty (list_view->details->model);
+    if (detach)
+    {
+        gtk_tree_view_set_model (list_view->details->tree_view, NULL);
+    }
+
+    g_hash_table_iter_init (&iter, list_view->details->pending_added_files);
+    while (g_hash_table_iter_next (&iter, &directory, &files))
+    {
+        nautilus_list_model_add_files (list_view->details->model,
+                                       ((GQueue *) files)->head,
+                                       directory);
+    }
+
+    if (detach)
+    {
+        gtk_tree_view_set_model (list_view->details->tree_view,
+                                 GTK_TREE_MODEL (list_view->details->model));
+    }
+
+    g_hash_table_remove_all (list_view->details->pending_added_files);
+}
+
 static void
 nautilus_list_view_add_file (NautilusFilesView *view,
                              NautilusFile      *file,
                              NautilusDirectory *directory)
 {
-    NautilusListModel *model;
+    NautilusListView *list_view;
+    GQueue *files;
+
+    list_view = NAUTILUS_LIST_VIEW (view);
 
-    model = NAUTILUS_LIST_VIEW (view)->details->model;
-    nautilus_list_model_add_file (model, file, directory);
+    if (!list_view->details->batching_file_changes)
+    {
+        nautilus_list_model_add_file (list_view->details->model, file, directory);
+        return;
+    }
+
+    /* Added in one go at end_file_changes */
+    files = g_hash_table_lookup (list_view->details->pending_added_files, directory);
+    if (files == NULL)
+    {
+        files = g_queue_new ();
+        g_hash_table_insert (list_view->details->pending_added_files,
+                             nautilus_directory_ref (directory), files);
+    }
+    g_queue_push_tail (files, nautilus_file_ref (file));
 }
 
 static char **
@@ -2300,6 +2397,8 @@ nautilus_list_view_clear (NautilusFilesView *view)
 
     list_view = NAUTILUS_LIST_VIEW (view);
 
+    g_hash_table_remove_all (list_view->details->pending_added_files);
+
     if (list_view->details->model != NULL)
     {
         nautilus_list_model_clear (list_view->details->model);
@@ -2315,6 +2414,7 @@ nautilus_list_view_file_changed (NautilusFilesView *view,
 
     listview = NAUTILUS_LIST_VIEW (view);
 
+    flush_added_files (listview);
     nautilus_list_model_file_changed (listview->details->model, file, directory);
 }
 
@@ -2577,6 +2677,12 @@ nautilus_list_view_is_empty (NautilusFilesView *view)
     return nautilus_list_model_is_empty (NAUTILUS_LIST_VIEW (view)->details->model);
 }
 
+static void
+nautilus_list_view_begin_file_changes (NautilusFilesView *view)
+{
+    NAUTILUS_LIST_VIEW (view)->details->batching_file_changes = TRUE;
+}
+
 static void
 nautilus_list_view_end_file_changes (NautilusFilesView *view)
 {
@@ -2584,6 +2690,9 @@ nautilus_list_view_end_file_changes (NautilusFilesView *view)
 
     list_view = NAUTILUS_LIST_VIEW (view);
 
+    flush_added_files (list_view);
+    list_view->details->batching_file_changes = FALSE;
+
     if (list_view->details->new_selection_path)
     {
         gtk_tree_view_set_cursor (list_view->details->tree_view,
@@ -2613,6 +2722,8 @@ nautilus_list_view_remove_file (NautilusFilesView *view,
     list_view = NAUTILUS_LIST_VIEW (view);
     tree_model = GTK_TREE_MODEL (list_view->details->model);
 
+    flush_added_files (list_view);
+
     if (nautilus_list_model_get_tree_iter_from_file (list_view->details->model, file, directory, &iter))
     {
         selection = gtk_tree_view_get_selection (list_view->details->tree_view);
@@ -3032,6 +3143,9 @@ nautilus_list_view_set_zoom_level (NautilusListView      *view,
                                          "surface", column,
                                          NULL);
     set_up_pixbuf_size (view);
+
+    /* The icons made for the old size are not needed anymore */
+    nautilus_list_model_clear_icon_cache (view->details->model);
 }
 
 static void
@@ -3254,6 +3368,7 @@ nautilus_list_view_finalize (GObject *object)
 
     g_list_free (list_view->details->cells);
     g_hash_table_destroy (list_view->details->columns);
+    g_hash_table_destroy (list_view->details->pending_added_files);
 
     if (list_view->details->hover_path != NULL)
     {
@@ -3463,6 +3578,7 @@ nautilus_list_view_class_init (NautilusListViewClass *class)
     G_OBJECT_CLASS (class)->finalize = nautilus_list_view_finalize;
 
     nautilus_files_view_class->add_file = nautilus_list_view_add_file;
+    nautilus_files_view_class->begin_file_changes = nautilus_list_view_begin_file_changes;
     nautilus_files_view_class->begin_loading = nautilus_list_view_begin_loading;
     nautilus_files_view_class->end_loading = nautilus_list_view_end_loading;
     nautilus_files_view_class->bump_zoom_level = nautilus_list_view_bump_zoom_level;
@@ -3501,6 +3617,10 @@ nautilus_list_view_init (NautilusListView *list_view)
     list_view->details = g_new0 (NautilusListViewDetails, 1);
 
     list_view->details->icon = g_themed_icon_new ("view-list-symbolic");
+    list_view->details->pending_added_files =
+        g_hash_table_new_full (NULL, NULL,
+                               (GDestroyNotify) nautilus_directory_unref,
+                               (GDestroyNotify) pending_files_free);
 
     /* ensure that the zoom level is always set before settings up the tree view columns */
     list_view->details->zoom_level = get_default_zoom_level ();
@@ -0,0 +1,487 @@
+/*
+ *  nautilus-listing-cache.c: On-disk snapshots of directory listings.
+ *
+ *  This program is free software; you can redistribute it and/or
+ *  modify it under the terms of the GNU General Public License as
+ *  published by the Free Software Foundation; either version 2 of the
+ *  License, or (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ *  General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public
+ *  License along with this program; if not, see <http://www.gnu.org/licenses/>.
+ */
+
+/* When a big or remote folder is opened again after its
+ * NautilusDirectory went away, the files from the last visit are shown
+ * right away from a snapshot, while the folder is read again in the
+ * background.
+ *
+ * A snapshot is one file in ~/.cache/nautilus/listings, named after
+ * the MD5 sum of the folder URI. It is meant to be mapped and read in
+ * place: a header, an array of fixed size entries, and a table of
+ * NUL terminated strings the entries point into. The header records
+ * the folder's modification time and inode; if either changed, the
+ * snapshot is not used.
+ */
+
+#include <config.h>
+#include "nautilus-listing-cache.h"
+
+#include <string.h>
+#include <glib/gstdio.h>
+
+#include "nautilus-file-private.h"
+#include "nautilus-global-preferences.h"
+
+#define LISTING_CACHE_MAGIC "NLCACHE"
+#define LISTING_CACHE_VERSION 1
+
+/* Local folders smaller than this read fast enough without a
+ * snapshot. Remote folders are always kept.
+ */
+#define LISTING_CACHE_MIN_LOCAL_FILES 1000
+
+/* Snapshots kept at most; the ones used least recently go first. */
+#define LISTING_CACHE_MAX_FILES 256
+
+#define LISTING_CACHE_NO_STRING G_MAXUINT32
+
+#define LISTING_CACHE_DIRECTORY_ATTRIBUTES \
+    G_FILE_ATTRIBUTE_TIME_MODIFIED "," \
+    G_FILE_ATTRIBUTE_UNIX_INODE
+
+enum
+{
+    ENTRY_IS_HIDDEN = 1 << 0,
+    ENTRY_IS_SYMLINK = 1 << 1
+};
+
+typedef struct
+{
+    char magic[8];
+    guint32 version;
+    guint32 n_entries;
+    guint64 directory_mtime;
+    guint64 directory_inode;
+    guint32 uri;           /* offset into the string table */
+    guint32 strings_size;
+} ListingCacheHeader;
+
+typedef struct
+{
+    gint64 size;
+    guint64 mtime;
+    guint32 name;          /* offset into the string table */
+    guint32 mime_type;     /* same, or LISTING_CACHE_NO_STRING */
+    guint32 type;          /* GFileType */
+    guint32 flags;
+    gint32 item_count;     /* -1 if unknown */
+    guint32 unused;
+} ListingCacheEntry;
+
+typedef struct
+{
+    GFile *location;
+    char *uri;
+    GArray *entries;
+    GString *strings;
+} SaveData;
+
+gboolean
+nautilus_listing_cache_is_enabled (void)
+{
+    return g_settings_get_boolean (nautilus_preferences,
+                                   NAUTILUS_PREFERENCES_USE_LISTING_CACHE);
+}
+
+static char *
+get_cache_directory (void)
+{
+    return g_build_filename (g_get_user_cache_dir (),
+                             "nautilus", "listings", NULL);
+}
+
+static char *
+get_cache_path (const char *uri)
+{
+    char *directory, *name, *path;
+
+    directory = get_cache_directory ();
+    name = g_compute_checksum_for_string (G_CHECKSUM_MD5, uri, -1);
+    path = g_build_filename (directory, name, NULL);
+    g_free (name);
+    g_free (directory);
+
+    return path;
+}
+
+static gboolean
+query_directory_key (GFile   *location,
+                     guint64 *mtime,
+                     guint64 *inode)
+{
+    GFileInfo *info;
+
+    info = g_file_query_info (location,
+                              LISTING_CACHE_DIRECTORY_ATTRIBUTES,
+                              G_FILE_QUERY_INFO_NONE,
+                              NULL, NULL);
+    if (info == NULL)
+    {
+        return FALSE;
+    }
+
+    /* Remote file systems may have no inodes; the time has to do
+     * then.
+     */
+    *mtime = g_file_info_get_attribute_uint64 (info, G_FILE_ATTRIBUTE_TIME_MODIFIED);
+    *inode = g_file_info_get_attribute_uint64 (info, G_FILE_ATTRIBUTE_UNIX_INODE);
+    g_object_unref (info);
+
+    return *mtime != 0;
+}
+
+static GFileInfo *
+info_from_entry (const ListingCacheEntry *entry,
+                 const char              *strings)
+{
+    GFileInfo *info;
+    const char *name, *mime_type;
+    char *display_name;
+    GIcon *icon;
+
+    name = strings + entry->name;
+    mime_type = entry->mime_type != LISTING_CACHE_NO_STRING ?
+                strings + entry->mime_type : NULL;
+
+    info = g_file_info_new ();
+    g_file_info_set_name (info, name);
+    display_name = g_filename_display_name (name);
+    g_file_info_set_display_name (info, display_name);
+    g_free (display_name);
+
+    g_file_info_set_file_type (info, entry->type);
+    g_file_info_set_size (info, entry->size);
+    g_file_info_set_attribute_uint64 (info, G_FILE_ATTRIBUTE_TIME_MODIFIED, entry->mtime);
+    g_file_info_set_is_hidden (info, (entry->flags & ENTRY_IS_HIDDEN) != 0);
+    g_file_info_set_is_symlink (info, (entry->flags & ENTRY_IS_SYMLINK) != 0);
+
+    if (mime_type != NULL)
+    {
+        g_file_info_set_content_type (info, mime_type);
+    }
+    icon = g_content_type_get_icon (mime_type != NULL ?
+                                    mime_type : "application/octet-stream");
+    g_file_info_set_icon (info, icon);
+    g_object_unref (icon);
+
+    if (entry->item_count >= 0)
+    {
+        g_file_info_set_attribute_int32 (info,
+                                         NAUTILUS_LISTING_CACHE_ATTRIBUTE_ITEM_COUNT,
+                                         entry->item_count);
+    }
+
+    return info;
+}
+
+GList *
+nautilus_listing_cache_load (GFile *location)
+{
+    GMappedFile *mapped;
+    const char *contents, *strings;
+    const ListingCacheHeader *header;
+    const ListingCacheEntry *entries;
+    gsize length, entries_size;
+    guint64 mtime, inode;
+    char *uri, *path;
+    GList *infos;
+    guint i;
+
+    uri = g_file_get_uri (location);
+    path = get_cache_path (uri);
+    infos = NULL;
+
+    mapped = g_mapped_file_new (path, FALSE, NULL);
+    if (mapped == NULL)
+    {
+        goto out;
+    }
+
+    contents = g_mapped_file_get_contents (mapped);
+    length = g_mapped_file_get_length (mapped);
+
+    /* Check the layout before trusting any offset in the file. */
+    if (length < sizeof (ListingCacheHeader))
+    {
+        goto out;
+    }
+    header = (const ListingCacheHeader *) contents;
+    if (memcmp (header->magic, LISTING_CACHE_MAGIC, sizeof (header->magic)) != 0 ||
+        header->version != LISTING_CACHE_VERSION ||
+        header->n_entries > (length - sizeof (ListingCacheHeader)) / sizeof (ListingCacheEntry))
+    {
+        goto out;
+    }
+    entries_size = header->n_entries * sizeof (ListingCacheEntry);
+    if (header->strings_size == 0 ||
+        header->strings_size != length - sizeof (ListingCacheHeader) - entries_size)
+    {
+        goto out;
+    }
+    entries = (const ListingCacheEntry *) (contents + sizeof (ListingCacheHeader));
+    strings = contents + sizeof (ListingCacheHeader) + entries_size;
+    if (strings[header->strings_size - 1] != '\0' ||
+        header->uri >= header->strings_size ||
+        strcmp (strings + header->uri, uri) != 0)
+    {
+        goto out;
+    }
+    for (i = 0; i < header->n_entries; i++)
+    {
+        if (entries[i].name >= header->strings_size ||
+            (entries[i].mime_type != LISTING_CACHE_NO_STRING &&
+             entries[i].mime_type >= header->strings_size))
+        {
+            goto out;
+        }
+    }
+
+    if (!query_directory_key (location, &mtime, &inode) ||
+        mtime != header->directory_mtime ||
+        inode != header->directory_inode)
+    {
+        goto out;
+    }
+
+    for (i = 0; i < header->n_entries; i++)
+    {
+        infos = g_list_prepend (infos, info_from_entry (&entries[i], strings));
+    }
+    infos = g_list_reverse (infos);
+
+    /* Mark the snapshot as recently used. */
+    g_utime (path, NULL);
+
+out:
+    if (mapped != NULL)
+    {
+        g_mapped_file_unref (mapped);
+    }
+    g_free (path);
+    g_free (uri);
+
+    return infos;
+}
+
+static guint32
+add_string (GString    *strings,
+            const char *string)
+{
+    guint32 offset;
+
+    offset = strings->len;
+    g_string_append_len (strings, string, strlen (string) + 1);
+
+    return offset;
+}
+
+static gint
+compare_by_mtime (gconstpointer a,
+                  gconstpointer b)
+{
+    GStatBuf *stat_a, *stat_b;
+
+    stat_a = *(GStatBuf **) a;
+    stat_b = *(GStatBuf **) b;
+
+    return (stat_a->st_mtime > stat_b->st_mtime) - (stat_a->st_mtime < stat_b->st_mtime);
+}
+
+/* Removes the snapshots used least recently, leaving at most
+ * LISTING_CACHE_MAX_FILES. Each GStatBuf is followed by its path.
+ */
+static void
+prune_cache (const char *directory)
+{
+    GDir *dir;
+    const char *name;
+    GPtrArray *files;
+    GStatBuf *buf;
+    char *path;
+    guint i;
+
+    dir = g_dir_open (directory, 0, NULL);
+    if (dir == NULL)
+    {
+        return;
+    }
+
+    files = g_ptr_array_new_with_free_func (g_free);
+    while ((name = g_dir_read_name (dir)) != NULL)
+    {
+        path = g_build_filename (directory, name, NULL);
+        buf = g_malloc (sizeof (GStatBuf) + strlen (path) + 1);
+        if (g_stat (path, buf) == 0)
+        {
+            strcpy ((char *) (buf + 1), path);
+            g_ptr_array_add (files, buf);
+        }
+        else
+        {
+            g_free (buf);
+        }
+        g_free (path);
+    }
+    g_dir_close (dir);
+
+    if (files->len > LISTING_CACHE_MAX_FILES)
+    {
+        g_ptr_array_sort (files, compare_by_mtime);
+        for (i = 0; i < files->len - LISTING_CACHE_MAX_FILES; i++)
+        {
+            buf = g_ptr_array_index (files, i);
+            g_unlink ((char *) (buf + 1));
+        }
+    }
+
+    g_ptr_array_unref (files);
+}
+
+static void
+save_data_free (SaveData *data)
+{
+    g_object_unref (data->location);
+    g_free (data->uri);
+    g_array_unref (data->entries);
+    g_string_free (data->strings, TRUE);
+    g_free (data);
+}
+
+static void
+save_thread (GTask        *task,
+             gpointer      source_object,
+             gpointer      task_data,
+             GCancellable *cancellable)
+{
+    SaveData *data;
+    ListingCacheHeader header;
+    GString *contents;
+    char *directory, *path;
+
+    data = task_data;
+
+    memset (&header, 0, sizeof (header));
+    memcpy (header.magic, LISTING_CACHE_MAGIC, sizeof (header.magic));
+    header.version = LISTING_CACHE_VERSION;
+    header.n_entries = data->entries->len;
+    header.uri = add_string (data->strings, data->uri);
+    header.strings_size = data->strings->len;
+
+    /* The key is taken now instead of when the load started, so a
+     * change in between can go unnoticed. The view reads the folder
+     * again each time anyway; the snapshot is only a head start.
+     */
+    if (!query_directory_key (data->location,
+                              &header.directory_mtime,
+                              &header.directory_inode))
+    {
+        g_task_return_boolean (task, FALSE);
+        return;
+    }
+
+    contents = g_string_sized_new (sizeof (header) +
+                                   data->entries->len * sizeof (ListingCacheEntry) +
+                                   data->strings->len);
+    g_string_append_len (contents, (const char *) &header, sizeof (header));
+    g_string_append_len (contents, data->entries->data,
+                         data->entries->len * sizeof (ListingCacheEntry));
+    g_string_append_len (contents, data->strings->str, data->strings->len);
+
+    directory = get_cache_directory ();
+    path = get_cache_path (data->uri);
+    if (g_mkdir_with_parents (directory, 0700) == 0 &&
+        g_file_set_contents (path, contents->str, contents->len, NULL))
+    {
+        prune_cache (directory);
+    }
+    g_free (path);
+    g_free (directory);
+    g_string_free (contents, TRUE);
+
+    g_task_return_boolean (task, TRUE);
+}
+
+void
+nautilus_listing_cache_save (GFile *location,
+                             GList *files)
+{
+    SaveData *data;
+    GHashTable *mime_types;
+    ListingCacheEntry entry;
+    NautilusFile *file;
+    gpointer offset;
+    GTask *task;
+    GList *l;
+
+    if (files == NULL ||
+        (g_file_is_native (location) &&
+         g_list_length (files) < LISTING_CACHE_MIN_LOCAL_FILES))
+    {
+        return;
+    }
+
+    data = g_new0 (SaveData, 1);
+    data->location = g_object_ref (location);
+    data->uri = g_file_get_uri (location);
+    data->entries = g_array_new (FALSE, FALSE, sizeof (ListingCacheEntry));
+    data->strings = g_string_new (NULL);
+
+    /* MIME types are interned, so they can be told apart by pointer. */
+    mime_types = g_hash_table_new (g_direct_hash, g_direct_equal);
+
+    memset (&entry, 0, sizeof (entry));
+    for (l = files; l != NULL; l = l->next)
+    {
+        file = l->data;
+        if (file->details->is_gone || file->details->name == NULL)
+        {
+            continue;
+        }
+
+        entry.size = file->details->size;
+        entry.mtime = file->details->mtime;
+        entry.name = add_string (data->strings, eel_ref_str_peek (file->details->name));
+        entry.type = file->details->type;
+        entry.flags = (file->details->is_hidden ? ENTRY_IS_HIDDEN : 0) |
+                      (file->details->is_symlink ? ENTRY_IS_SYMLINK : 0);
+        entry.item_count = file->details->got_directory_count &&
+                           !file->details->directory_count_failed ?
+                           (gint32) file->details->directory_count : -1;
+
+        entry.mime_type = LISTING_CACHE_NO_STRING;
+        if (file->details->mime_type != NULL)
+        {
+            if (!g_hash_table_lookup_extended (mime_types, file->details->mime_type,
+                                               NULL, &offset))
+            {
+                offset = GUINT_TO_POINTER (add_string (data->strings,
+                                                       eel_ref_str_peek (file->details->mime_type)));
+                g_hash_table_insert (mime_types, (gpointer) file->details->mime_type, offset);
+            }
+            entry.mime_type = GPOINTER_TO_UINT (offset);
+        }
+
+        g_array_append_val (data->entries, entry);
+    }
+    g_hash_table_destroy (mime_types);
+
+    task = g_task_new (NULL, NULL, NULL, NULL);
+    g_task_set_task_data (task, data, (GDestroyNotify) save_data_free);
+    g_task_run_in_thread (task, save_thread);
+    g_object_unref (task);
+}
@@ -0,0 +1,43 @@
+/*
+   nautilus-listing-cache.h: On-disk snapshots of directory listings.
+
+   This program is free software; you can redistribute it and/or
+   modify it under the terms of the GNU General Public License as
+   published by the Free Software Foundation; either version 2 of the
+   License, or (at your option) any later version.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+   General Public License for more details.
+
+   You should have received a copy of the GNU General Public
+   License along with this program; if not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef NAUTILUS_LISTING_CACHE_H
+#define NAUTILUS_LISTING_CACHE_H
+
+#include <gio/gio.h>
+
+/* Set on the GFileInfo of folders whose item count was known when the
+ * snapshot was written.
+ */
+#define NAUTILUS_LISTING_CACHE_ATTRIBUTE_ITEM_COUNT "nautilus::item-count"
+
+gboolean nautilus_listing_cache_is_enabled (void);
+
+/* Reads the snapshot of a directory, as a list of GFileInfo's. Returns
+ * NULL if there is none, or if the directory changed since it was
+ * written. This blocks, so it is meant for worker threads.
+ */
+GList *  nautilus_listing_cache_load       (GFile *location);
+
+/* Writes a snapshot of the files of a directory that just finished
+ * loading. The list is read right away; the writing happens on a
+ * worker thread.
+ */
+void     nautilus_listing_cache_save       (GFile *location,
+					    GList *files);
+
+#endif /* NAUTILUS_LISTING_CACHE_H */
@@ -0,0 +1,1063 @@
+/*
+ *  nautilus-local-enumerator.c: Fast enumeration of local directories.
+ *
+ *  This program is free software; you can redistribute it and/or
+ *  modify it under the terms of the GNU General Public License as
+ *  published by the Free Software Foundation; either version 2 of the
+ *  License, or (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ *  General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public
+ *  License along with this program; if not, see <http://www.gnu.org/licenses/>.
+ */
+
+/* Reads a local directory without going through GFileEnumerator.
+ * Entries come straight from getdents64() in large batches and are
+ * looked at with fstatat() relative to the directory's file
+ * descriptor, which saves a path lookup, a GFileInfo and an attribute
+ * matcher run for every entry.
+ *
+ * The attributes mirror what GIO's local file backend reports for
+ * NAUTILUS_FILE_DEFAULT_ATTRIBUTES, so files loaded either way look
+ * the same.
+ */
+
+#include <config.h>
+#include "nautilus-local-enumerator.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <grp.h>
+#include <pwd.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <sys/types.h>
+#include <unistd.h>
+
+#ifdef __linux__
+#include <sys/syscall.h>
+#else
+#include <dirent.h>
+#endif
+
+#include <glib/gi18n.h>
+
+#ifdef HAVE_SELINUX
+#include <selinux/selinux.h>
+#endif
+
+/* Bytes read from the directory with each getdents64() call. */
+#define DIRENT_BUFFER_SIZE (32 * 1024)
+
+/* Bytes read from a file whose type can't be told by its name. */
+#define CONTENT_SNIFF_SIZE 4096
+
+#define METADATA_ATTRIBUTES "standard::name,metadata::*"
+
+#ifdef __linux__
+struct linux_dirent64
+{
+    guint64 d_ino;
+    gint64 d_off;
+    unsigned short d_reclen;
+    unsigned char d_type;
+    char d_name[1];
+};
+#endif
+
+typedef struct
+{
+    const char *name;      /* interned */
+    const char *real_name; /* interned */
+} UserInfo;
+
+struct NautilusLocalEnumerator
+{
+    GFile *location;
+    char *path;
+
+    int fd;
+#ifdef __linux__
+    char *buffer;
+    long buffer_length;
+    long buffer_position;
+#else
+    DIR *dir;
+#endif
+    gboolean reached_end;
+
+    struct stat dir_stat;
+    gboolean dir_writable;
+    int has_trash_dir; /* -1 until known */
+
+    GHashTable *hidden_names;
+    GHashTable *special_dir_icons; /* child name -> icon name */
+    GHashTable *users;
+    GHashTable *groups;
+
+    dev_t filesystem_id_device;
+    const char *filesystem_id;
+
+    GFileEnumerator *metadata_enumerator;
+    gboolean metadata_done;
+};
+
+typedef struct
+{
+    NautilusLocalEnumerator *enumerator;
+    int num_entries;
+} NextEntriesData;
+
+gboolean
+nautilus_local_enumerator_is_supported (GFile *location)
+{
+    char *path;
+    gboolean supported;
+
+    if (!g_file_is_native (location))
+    {
+        return FALSE;
+    }
+
+    path = g_file_get_path (location);
+    supported = path != NULL;
+    g_free (path);
+
+    return supported;
+}
+
+NautilusLocalEnumerator *
+nautilus_local_enumerator_new (GFile *location)
+{
+    NautilusLocalEnumerator *enumerator;
+
+    g_return_val_if_fail (nautilus_local_enumerator_is_supported (location), NULL);
+
+    enumerator = g_new0 (NautilusLocalEnumerator, 1);
+    enumerator->location = g_object_ref (location);
+    enumerator->path = g_file_get_path (location);
+    enumerator->fd = -1;
+    enumerator->has_trash_dir = -1;
+
+    return enumerator;
+}
+
+void
+nautilus_local_enumerator_free (NautilusLocalEnumerator *enumerator)
+{
+    if (enumerator == NULL)
+    {
+        return;
+    }
+
+#ifdef __linux__
+    g_free (enumerator->buffer);
+#else
+    if (enumerator->dir != NULL)
+    {
+        closedir (enumerator->dir);
+    }
+#endif
+    if (enumerator->fd != -1)
+    {
+        close (enumerator->fd);
+    }
+
+    if (enumerator->metadata_enumerator != NULL)
+    {
+        g_object_unref (enumerator->metadata_enumerator);
+    }
+
+    g_clear_pointer (&enumerator->hidden_names, g_hash_table_destroy);
+    g_clear_pointer (&enumerator->special_dir_icons, g_hash_table_destroy);
+    g_clear_pointer (&enumerator->users, g_hash_table_destroy);
+    g_clear_pointer (&enumerator->groups, g_hash_table_destroy);
+
+    g_object_unref (enumerator->location);
+    g_free (enumerator->path);
+    g_free (enumerator);
+}
+
+void
+nautilus_local_entry_free (NautilusLocalEntry *entry)
+{
+    g_free (entry->name);
+    g_free (entry->display_name);
+    g_free (entry->edit_name);
+    g_free (entry->symlink_target);
+    g_free (entry->thumbnail_path);
+    g_free (entry->selinux_context);
+    if (entry->icon != NULL)
+    {
+        g_object_unref (entry->icon);
+    }
+    if (entry->metadata_info != NULL)
+    {
+        g_object_unref (entry->metadata_info);
+    }
+    g_free (entry);
+}
+
+static void
+local_entry_list_free (GList *entries)
+{
+    g_list_free_full (entries, (GDestroyNotify) nautilus_local_entry_free);
+}
+
+static void
+set_error_from_errno (GError     **error,
+                      int          saved_errno,
+                      const char  *format,
+                      const char  *path)
+{
+    char *display_name;
+
+    display_name = g_filename_display_name (path);
+    g_set_error (error, G_IO_ERROR,
+                 g_io_error_from_errno (saved_errno),
+                 format, display_name, g_strerror (saved_errno));
+    g_free (display_name);
+}
+
+/* Files listed in a .hidden file are hidden, like GIO does it. */
+static void
+read_hidden_names (NautilusLocalEnumerator *enumerator)
+{
+    char *hidden_path;
+    char *contents;
+    char **lines;
+    int i;
+
+    enumerator->hidden_names = g_hash_table_new_full (g_str_hash, g_str_equal,
+                                                      g_free, NULL);
+
+    hidden_path = g_build_filename (enumerator->path, ".hidden", NULL);
+    if (g_file_get_contents (hidden_path, &contents, NULL, NULL))
+    {
+        lines = g_strsplit (contents, "\n", -1);
+        for (i = 0; lines[i] != NULL; i++)
+        {
+            if (lines[i][0] != '\0')
+            {
+                g_hash_table_add (enumerator->hidden_names, lines[i]);
+            }
+            else
+            {
+                g_free (lines[i]);
+            }
+        }
+        g_free (lines);
+        g_free (contents);
+    }
+    g_free (hidden_path);
+}
+
+static void
+add_special_dir_icon (NautilusLocalEnumerator *enumerator,
+                      const char              *dir,
+                      const char              *icon_name)
+{
+    char *parent;
+
+    if (dir == NULL)
+    {
+        return;
+    }
+
+    parent = g_path_get_dirname (dir);
+    if (strcmp (parent, enumerator->path) == 0)
+    {
+        g_hash_table_insert (enumerator->special_dir_icons,
+                             g_path_get_basename (dir),
+                             (gpointer) icon_name);
+    }
+    g_free (parent);
+}
+
+/* The XDG user directories get their own icons. */
+static void
+find_special_dirs (NautilusLocalEnumerator *enumerator)
+{
+    enumerator->special_dir_icons = g_hash_table_new_full (g_str_hash, g_str_equal,
+                                                           g_free, NULL);
+
+    add_special_dir_icon (enumerator, g_get_home_dir (), "user-home");
+    add_special_dir_icon (enumerator, g_get_user_special_dir (G_USER_DIRECTORY_DESKTOP), "user-desktop");
+    add_special_dir_icon (enumerator, g_get_user_special_dir (G_USER_DIRECTORY_DOCUMENTS), "folder-documents");
+    add_special_dir_icon (enumerator, g_get_user_special_dir (G_USER_DIRECTORY_DOWNLOAD), "folder-download");
+    add_special_dir_icon (enumerator, g_get_user_special_dir (G_USER_DIRECTORY_MUSIC), "folder-music");
+    add_special_dir_icon (enumerator, g_get_user_special_dir (G_USER_DIRECTORY_PICTURES), "folder-pictures");
+    add_special_dir_icon (enumerator, g_get_user_special_dir (G_USER_DIRECTORY_PUBLIC_SHARE), "folder-publicshare");
+    add_special_dir_icon (enumerator, g_get_user_special_dir (G_USER_DIRECTORY_TEMPLATES), "folder-templates");
+    add_special_dir_icon (enumerator, g_get_user_special_dir (G_USER_DIRECTORY_VIDEOS), "folder-videos");
+}
+
+static gboolean
+ensure_open (NautilusLocalEnumerator  *enumerator,
+             GError                  **error)
+{
+#ifndef __linux__
+    int dir_fd;
+#endif
+
+    if (enumerator->fd != -1)
+    {
+        return TRUE;
+    }
+
+    enumerator->fd = open (enumerator->path, O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+    if (enumerator->fd == -1)
+    {
+        set_error_from_errno (error, errno,
+                              _("Error opening directory “%s”: %s"),
+                              enumerator->path);
+        return FALSE;
+    }
+
+    if (fstat (enumerator->fd, &enumerator->dir_stat) != 0)
+    {
+        set_error_from_errno (error, errno,
+                              _("Error opening directory “%s”: %s"),
+                              enumerator->path);
+        close (enumerator->fd);
+        enumerator->fd = -1;
+        return FALSE;
+    }
+
+#ifdef __linux__
+    enumerator->buffer = g_malloc (DIRENT_BUFFER_SIZE);
+#else
+    /* The DIR takes over the descriptor it is given, so give it a
+     * copy of the one kept for fstatat().
+     */
+    dir_fd = dup (enumerator->fd);
+    enumerator->dir = dir_fd != -1 ? fdopendir (dir_fd) : NULL;
+    if (enumerator->dir == NULL)
+    {
+        set_error_from_errno (error, errno,
+                              _("Error opening directory “%s”: %s"),
+                              enumerator->path);
+        if (dir_fd != -1)
+        {
+            close (dir_fd);
+        }
+        close (enumerator->fd);
+        enumerator->fd = -1;
+        return FALSE;
+    }
+#endif
+
+    enumerator->dir_writable = access (enumerator->path, W_OK) == 0;
+
+    read_hidden_names (enumerator);
+    find_special_dirs (enumerator);
+    enumerator->users = g_hash_table_new_full (NULL, NULL, NULL, g_free);
+    enumerator->groups = g_hash_table_new (NULL, NULL);
+
+    return TRUE;
+}
+
+/* Returns the next name in the directory, NULL at the end or on
+ * error. The name stays valid until the next call.
+ */
+static const char *
+read_next_name (NautilusLocalEnumerator  *enumerator,
+                GError                  **error)
+{
+#ifdef __linux__
+    struct linux_dirent64 *dirent;
+    long result;
+
+    while (TRUE)
+    {
+        if (enumerator->buffer_position >= enumerator->buffer_length)
+        {
+            do
+            {
+                result = syscall (SYS_getdents64, enumerator->fd,
+                                  enumerator->buffer, DIRENT_BUFFER_SIZE);
+            }
+            while (result < 0 && errno == EINTR);
+
+            if (result < 0)
+            {
+                set_error_from_errno (error, errno,
+                                      _("Error while reading directory “%s”: %s"),
+                                      enumerator->path);
+                return NULL;
+            }
+
+            if (result == 0)
+            {
+                return NULL;
+            }
+
+            enumerator->buffer_length = result;
+            enumerator->buffer_position = 0;
+        }
+
+        dirent = (struct linux_dirent64 *) (enumerator->buffer + enumerator->buffer_position);
+        enumerator->buffer_position += dirent->d_reclen;
+
+        if (strcmp (dirent->d_name, ".") != 0 &&
+            strcmp (dirent->d_name, "..") != 0)
+        {
+            return dirent->d_name;
+        }
+    }
+#else
+    struct dirent *dirent;
+
+    while (TRUE)
+    {
+        errno = 0;
+        dirent = readdir (enumerator->dir);
+        if (dirent == NULL)
+        {
+            if (errno != 0)
+            {
+                set_error_from_errno (error, errno,
+                                      _("Error while reading directory “%s”: %s"),
+                                      enumerator->path);
+            }
+            return NULL;
+        }
+
+        if (strcmp (dirent->d_name, ".") != 0 &&
+            strcmp (dirent->d_name, "..") != 0)
+        {
+            return dirent->d_name;
+        }
+    }
+#endif
+}
+
+static GFileType
+file_type_from_mode (mode_t mode)
+{
+    if (S_ISREG (mode))
+    {
+        return G_FILE_TYPE_REGULAR;
+    }
+    else if (S_ISDIR (mode))
+    {
+        return G_FILE_TYPE_DIRECTORY;
+    }
+    else if (S_ISLNK (mode))
+    {
+        return G_FILE_TYPE_SYMBOLIC_LINK;
+    }
+    else
+    {
+        return G_FILE_TYPE_SPECIAL;
+    }
+}
+
+static char *
+to_utf8 (const char *string)
+{
+    if (string == NULL)
+    {
+        return NULL;
+    }
+
+    if (g_utf8_validate (string, -1, NULL))
+    {
+        return g_strdup (string);
+    }
+
+    return g_locale_to_utf8 (string, -1, NULL, NULL, NULL);
+}
+
+static const UserInfo *
+lookup_user (NautilusLocalEnumerator *enumerator,
+             uid_t                    uid)
+{
+    UserInfo *user;
+    struct passwd pwbuf;
+    struct passwd *pw;
+    char *buffer;
+    gsize buffer_size;
+    char *name, *real_name, *comma;
+    int result;
+
+    user = g_hash_table_lookup (enumerator->users, GUINT_TO_POINTER (uid));
+    if (user != NULL)
+    {
+        return user;
+    }
+
+    pw = NULL;
+    buffer_size = 4096;
+    buffer = g_malloc (buffer_size);
+    while ((result = getpwuid_r (uid, &pwbuf, buffer, buffer_size, &pw)) == ERANGE)
+    {
+        buffer_size *= 2;
+        buffer = g_realloc (buffer, buffer_size);
+    }
+
+    name = NULL;
+    real_name = NULL;
+    if (result == 0 && pw != NULL)
+    {
+        if (pw->pw_gecos != NULL)
+        {
+            comma = strchr (pw->pw_gecos, ',');
+            if (comma != NULL)
+            {
+                *comma = '\0';
+            }
+            real_name = to_utf8 (pw->pw_gecos);
+        }
+        name = to_utf8 (pw->pw_name);
+    }
+    g_free (buffer);
+
+    if (real_name == NULL)
+    {
+        real_name = name != NULL ? g_strdup (name) : g_strdup_printf ("user #%d", (int) uid);
+    }
+    if (name == NULL)
+    {
+        name = g_strdup_printf ("%d", (int) uid);
+    }
+
+    user = g_new0 (UserInfo, 1);
+    user->name = g_intern_string (name);
+    user->real_name = g_intern_string (real_name);
+    g_free (name);
+    g_free (real_name);
+
+    g_hash_table_insert (enumerator->users, GUINT_TO_POINTER (uid), user);
+
+    return user;
+}
+
+static const char *
+lookup_group (NautilusLocalEnumerator *enumerator,
+              gid_t                    gid)
+{
+    const char *group;
+    struct group grbuf;
+    struct group *gr;
+    char *buffer;
+    gsize buffer_size;
+    char *name;
+    int result;
+
+    group = g_hash_table_lookup (enumerator->groups, GUINT_TO_POINTER (gid));
+    if (group != NULL)
+    {
+        return group;
+    }
+
+    gr = NULL;
+    buffer_size = 4096;
+    buffer = g_malloc (buffer_size);
+    while ((result = getgrgid_r (gid, &grbuf, buffer, buffer_size, &gr)) == ERANGE)
+    {
+        buffer_size *= 2;
+        buffer = g_realloc (buffer, buffer_size);
+    }
+
+    name = NULL;
+    if (result == 0 && gr != NULL)
+    {
+        name = to_utf8 (gr->gr_name);
+    }
+    g_free (buffer);
+
+    if (name == NULL)
+    {
+        name = g_strdup_printf ("%d", (int) gid);
+    }
+
+    group = g_intern_string (name);
+    g_free (name);
+
+    g_hash_table_insert (enumerator->groups, GUINT_TO_POINTER (gid), (gpointer) group);
+
+    return group;
+}
+
+static const char *
+get_content_type (NautilusLocalEnumerator *enumerator,
+                  const char              *name,
+                  struct stat             *statbuf,
+                  gboolean                 broken_symlink)
+{
+    char *content_type;
+    const char *interned;
+    gboolean uncertain;
+    guchar sniff_buffer[CONTENT_SNIFF_SIZE];
+    ssize_t sniff_length;
+    int fd;
+
+    if (broken_symlink)
+    {
+        return g_intern_static_string ("inode/symlink");
+    }
+    else if (S_ISDIR (statbuf->st_mode))
+    {
+        return g_intern_static_string ("inode/directory");
+    }
+    else if (S_ISCHR (statbuf->st_mode))
+    {
+        return g_intern_static_string ("inode/chardevice");
+    }
+    else if (S_ISBLK (statbuf->st_mode))
+    {
+        return g_intern_static_string ("inode/blockdevice");
+    }
+    else if (S_ISFIFO (statbuf->st_mode))
+    {
+        return g_intern_static_string ("inode/fifo");
+    }
+    else if (S_ISSOCK (statbuf->st_mode))
+    {
+        return g_intern_static_string ("inode/socket");
+    }
+
+    content_type = g_content_type_guess (name, NULL, 0, &uncertain);
+
+    /* Look inside the file when the name isn't enough. */
+    if (uncertain && S_ISREG (statbuf->st_mode))
+    {
+        fd = openat (enumerator->fd, name, O_RDONLY | O_CLOEXEC);
+        if (fd != -1)
+        {
+            do
+            {
+                sniff_length = read (fd, sniff_buffer, CONTENT_SNIFF_SIZE);
+            }
+            while (sniff_length < 0 && errno == EINTR);
+            close (fd);
+
+            if (sniff_length >= 0)
+            {
+                g_free (content_type);
+                content_type = g_content_type_guess (name, sniff_buffer, sniff_length, NULL);
+            }
+        }
+    }
+
+    interned = g_intern_string (content_type);
+    g_free (content_type);
+
+    return interned;
+}
+
+static GIcon *
+get_icon (NautilusLocalEnumerator *enumerator,
+          const char              *name,
+          struct stat             *statbuf,
+          const char              *content_type)
+{
+    const char *icon_name;
+
+    if (S_ISDIR (statbuf->st_mode))
+    {
+        icon_name = g_hash_table_lookup (enumerator->special_dir_icons, name);
+        if (icon_name != NULL)
+        {
+            if (g_str_has_prefix (icon_name, "folder-"))
+            {
+                return g_themed_icon_new_with_default_fallbacks (icon_name);
+            }
+            return g_themed_icon_new (icon_name);
+        }
+    }
+
+    return g_content_type_get_icon (content_type);
+}
+
+static void
+get_display_names (NautilusLocalEntry *entry)
+{
+    char *display_name;
+
+    display_name = g_filename_display_name (entry->name);
+
+    /* Look for U+FFFD REPLACEMENT CHARACTER */
+    if (strstr (display_name, "\357\277\275") != NULL)
+    {
+        entry->edit_name = display_name;
+        entry->display_name = g_strconcat (display_name, _(" (invalid encoding)"), NULL);
+    }
+    else if (strcmp (display_name, entry->name) != 0)
+    {
+        entry->display_name = display_name;
+    }
+    else
+    {
+        g_free (display_name);
+    }
+}
+
+static void
+get_thumbnail_info (const char         *path,
+                    NautilusLocalEntry *entry)
+{
+    char *uri, *checksum, *basename, *filename;
+
+    uri = g_filename_to_uri (path, NULL, NULL);
+    if (uri == NULL)
+    {
+        return;
+    }
+
+    checksum = g_compute_checksum_for_string (G_CHECKSUM_MD5, uri, -1);
+    basename = g_strconcat (checksum, ".png", NULL);
+    g_free (checksum);
+    g_free (uri);
+
+    filename = g_build_filename (g_get_user_cache_dir (), "thumbnails", "large", basename, NULL);
+    if (g_file_test (filename, G_FILE_TEST_IS_REGULAR))
+    {
+        entry->thumbnail_path = filename;
+        filename = NULL;
+    }
+    else
+    {
+        g_free (filename);
+        filename = g_build_filename (g_get_user_cache_dir (), "thumbnails", "normal", basename, NULL);
+        if (g_file_test (filename, G_FILE_TEST_IS_REGULAR))
+        {
+            entry->thumbnail_path = filename;
+            filename = NULL;
+        }
+        else
+        {
+            g_free (filename);
+            filename = g_build_filename (g_get_user_cache_dir (), "thumbnails", "fail",
+                                         "gnome-thumbnail-factory", basename, NULL);
+            entry->thumbnailing_failed = g_file_test (filename, G_FILE_TEST_IS_REGULAR);
+        }
+    }
+
+    g_free (filename);
+    g_free (basename);
+}
+
+/* Whether files in this directory can be moved to the trash, provided
+ * the directory is writable. Finding the trash directory is involved,
+ * so ask GIO once, using the first writable child.
+ */
+static gboolean
+directory_has_trash_dir (NautilusLocalEnumerator *enumerator,
+                         const char              *name)
+{
+    GFile *child;
+    GFileInfo *info;
+
+    if (enumerator->has_trash_dir == -1)
+    {
+        child = g_file_get_child (enumerator->location, name);
+        info = g_file_query_info (child, G_FILE_ATTRIBUTE_ACCESS_CAN_TRASH,
+                                  G_FILE_QUERY_INFO_NOFOLLOW_SYMLINKS,
+                                  NULL, NULL);
+        enumerator->has_trash_dir = info != NULL &&
+                                    g_file_info_get_attribute_boolean (info, G_FILE_ATTRIBUTE_ACCESS_CAN_TRASH);
+        if (info != NULL)
+        {
+            g_object_unref (info);
+        }
+        g_object_unref (child);
+    }
+
+    return enumerator->has_trash_dir;
+}
+
+static const char *
+get_filesystem_id (NautilusLocalEnumerator *enumerator,
+                   dev_t                    device)
+{
+    char *id;
+
+    if (enumerator->filesystem_id == NULL ||
+        enumerator->filesystem_id_device != device)
+    {
+        id = g_strdup_printf ("l%" G_GUINT64_FORMAT, (guint64) device);
+        enumerator->filesystem_id = g_intern_string (id);
+        enumerator->filesystem_id_device = device;
+        g_free (id);
+    }
+
+    return enumerator->filesystem_id;
+}
+
+static NautilusLocalEntry *
+local_entry_new (NautilusLocalEnumerator *enumerator,
+                 const char              *name)
+{
+    NautilusLocalEntry *entry;
+    struct stat lstatbuf, statbuf;
+    gboolean broken_symlink;
+    const UserInfo *user;
+    char *path;
+    char target[4096];
+    ssize_t target_length;
+    gboolean writable;
+    uid_t euid;
+
+    if (fstatat (enumerator->fd, name, &lstatbuf, AT_SYMLINK_NOFOLLOW) != 0)
+    {
+        /* Gone already. */
+        return NULL;
+    }
+
+    entry = g_new0 (NautilusLocalEntry, 1);
+    entry->name = g_strdup (name);
+    get_display_names (entry);
+
+    broken_symlink = FALSE;
+    entry->is_symlink = S_ISLNK (lstatbuf.st_mode);
+    if (entry->is_symlink)
+    {
+        target_length = readlinkat (enumerator->fd, name, target, sizeof (target) - 1);
+        if (target_length >= 0)
+        {
+            target[target_length] = '\0';
+            entry->symlink_target = g_strdup (target);
+        }
+
+        if (fstatat (enumerator->fd, name, &statbuf, 0) != 0)
+        {
+            statbuf = lstatbuf;
+            broken_symlink = TRUE;
+        }
+    }
+    else
+    {
+        statbuf = lstatbuf;
+    }
+
+    entry->type = file_type_from_mode (statbuf.st_mode);
+    entry->is_hidden = name[0] == '.' ||
+                       g_hash_table_contains (enumerator->hidden_names, name);
+    entry->is_backup = g_str_has_suffix (name, "~");
+    entry->is_mountpoint = S_ISDIR (statbuf.st_mode) &&
+                           statbuf.st_dev != enumerator->dir_stat.st_dev;
+
+    entry->mode = statbuf.st_mode;
+    entry->uid = statbuf.st_uid;
+    entry->gid = statbuf.st_gid;
+    user = lookup_user (enumerator, statbuf.st_uid);
+    entry->owner = user->name;
+    entry->owner_real = user->real_name;
+    entry->group = lookup_group (enumerator, statbuf.st_gid);
+
+    entry->size = statbuf.st_size;
+    entry->atime = statbuf.st_atime;
+    entry->mtime = statbuf.st_mtime;
+    entry->ctime = statbuf.st_ctime;
+#ifdef HAVE_STRUCT_STAT_ST_MTIM_TV_NSEC
+    entry->mtime_nsec = statbuf.st_mtim.tv_nsec;
+    entry->ctime_nsec = statbuf.st_ctim.tv_nsec;
+#endif
+    entry->device = statbuf.st_dev;
+    entry->inode = statbuf.st_ino;
+
+    entry->content_type = get_content_type (enumerator, name, &statbuf, broken_symlink);
+    entry->icon = get_icon (enumerator, name, &statbuf, entry->content_type);
+    entry->filesystem_id = get_filesystem_id (enumerator, statbuf.st_dev);
+
+    entry->can_read = faccessat (enumerator->fd, name, R_OK, 0) == 0;
+    entry->can_write = faccessat (enumerator->fd, name, W_OK, 0) == 0;
+    entry->can_execute = faccessat (enumerator->fd, name, X_OK, 0) == 0;
+
+    /* In a sticky directory only the owners can remove a file. */
+    writable = FALSE;
+    if (enumerator->dir_writable)
+    {
+        euid = geteuid ();
+        writable = (enumerator->dir_stat.st_mode & S_ISVTX) == 0 ||
+                   euid == 0 ||
+                   euid == statbuf.st_uid ||
+                   euid == enumerator->dir_stat.st_uid;
+    }
+    entry->can_delete = writable;
+    entry->can_rename = writable;
+    entry->can_trash = writable && directory_has_trash_dir (enumerator, name);
+
+    path = NULL;
+    if (S_ISREG (statbuf.st_mode))
+    {
+        path = g_build_filename (enumerator->path, name, NULL);
+        get_thumbnail_info (path, entry);
+    }
+
+#ifdef HAVE_SELINUX
+    if (is_selinux_enabled ())
+    {
+        char *context;
+
+        if (path == NULL)
+        {
+            path = g_build_filename (enumerator->path, name, NULL);
+        }
+
+        if (getfilecon_raw (path, &context) >= 0)
+        {
+            entry->selinux_context = g_strdup (context);
+            freecon (context);
+        }
+    }
+#endif
+
+    g_free (path);
+
+    return entry;
+}
+
+/* Returns the next entry that has metadata, NULL when there are no
+ * more. Errors just end the metadata pass; the files are all there.
+ */
+static NautilusLocalEntry *
+read_next_metadata_entry (NautilusLocalEnumerator *enumerator,
+                          GCancellable            *cancellable)
+{
+    NautilusLocalEntry *entry;
+    GFileInfo *info;
+
+    if (enumerator->metadata_enumerator == NULL)
+    {
+        enumerator->metadata_enumerator =
+            g_file_enumerate_children (enumerator->location,
+                                       METADATA_ATTRIBUTES,
+                                       G_FILE_QUERY_INFO_NOFOLLOW_SYMLINKS,
+                                       cancellable, NULL);
+        if (enumerator->metadata_enumerator == NULL)
+        {
+            enumerator->metadata_done = TRUE;
+            return NULL;
+        }
+    }
+
+    while ((info = g_file_enumerator_next_file (enumerator->metadata_enumerator,
+                                                cancellable, NULL)) != NULL)
+    {
+        if (g_file_info_has_namespace (info, "metadata") &&
+            g_file_info_get_name (info) != NULL)
+        {
+            entry = g_new0 (NautilusLocalEntry, 1);
+            entry->name = g_strdup (g_file_info_get_name (info));
+            entry->metadata_only = TRUE;
+            entry->metadata_info = info;
+            return entry;
+        }
+        g_object_unref (info);
+    }
+
+    g_file_enumerator_close (enumerator->metadata_enumerator, NULL, NULL);
+    enumerator->metadata_done = TRUE;
+
+    return NULL;
+}
+
+static void
+next_entries_thread (GTask        *task,
+                     gpointer      source_object,
+                     gpointer      task_data,
+                     GCancellable *cancellable)
+{
+    NextEntriesData *data;
+    NautilusLocalEnumerator *enumerator;
+    NautilusLocalEntry *entry;
+    const char *name;
+    GList *entries;
+    GError *error;
+    int count;
+
+    data = task_data;
+    enumerator = data->enumerator;
+
+    error = NULL;
+    if (!ensure_open (enumerator, &error))
+    {
+        g_task_return_error (task, error);
+        return;
+    }
+
+    entries = NULL;
+    count = 0;
+    while (count < data->num_entries && !enumerator->reached_end)
+    {
+        if (g_cancellable_set_error_if_cancelled (cancellable, &error))
+        {
+            local_entry_list_free (entries);
+            g_task_return_error (task, error);
+            return;
+        }
+
+        name = read_next_name (enumerator, &error);
+        if (error != NULL)
+        {
+            local_entry_list_free (entries);
+            g_task_return_error (task, error);
+            return;
+        }
+
+        if (name == NULL)
+        {
+            enumerator->reached_end = TRUE;
+            break;
+        }
+
+        entry = local_entry_new (enumerator, name);
+        if (entry != NULL)
+        {
+            entries = g_list_prepend (entries, entry);
+            count++;
+        }
+    }
+
+    while (count < data->num_entries &&
+           enumerator->reached_end &&
+           !enumerator->metadata_done)
+    {
+        entry = read_next_metadata_entry (enumerator, cancellable);
+        if (entry != NULL)
+        {
+            entries = g_list_prepend (entries, entry);
+            count++;
+        }
+    }
+
+    g_task_return_pointer (task, g_list_reverse (entries),
+                           (GDestroyNotify) local_entry_list_free);
+}
+
+void
+nautilus_local_enumerator_next_entries_async (NautilusLocalEnumerator *enumerator,
+                                              int                      num_entries,
+                                              GCancellable            *cancellable,
+                                              GAsyncReadyCallback      callback,
+                                              gpointer                 user_data)
+{
+    GTask *task;
+    NextEntriesData *data;
+
+    data = g_new0 (NextEntriesData, 1);
+    data->enumerator = enumerator;
+    data->num_entries = num_entries;
+
+    task = g_task_new (NULL, cancellable, callback, user_data);
+    g_task_set_task_data (task, data, g_free);
+    g_task_run_in_thread (task, next_entries_thread);
+    g_object_unref (task);
+}
+
+GList *
+nautilus_local_enumerator_next_entries_finish (NautilusLocalEnumerator  *enumerator,
+                                               GAsyncResult             *result,
+                                               GError                  **error)
+{
+    g_return_val_if_fail (g_task_is_valid (result, NULL), NULL);
+
+    return g_task_propagate_pointer (G_TASK (result), error);
+}
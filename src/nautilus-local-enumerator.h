@@ -0,0 +1,104 @@
+/*
+   nautilus-local-enumerator.h: Fast enumeration of local directories.
+
+   This program is free software; you can redistribute it and/or
+   modify it under the terms of the GNU General Public License as
+   published by the Free Software Foundation; either version 2 of the
+   License, or (at your option) any later version.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+   General Public License for more details.
+
+   You should have received a copy of the GNU General Public
+   License along with this program; if not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef NAUTILUS_LOCAL_ENUMERATOR_H
+#define NAUTILUS_LOCAL_ENUMERATOR_H
+
+#include <gio/gio.h>
+#include <time.h>
+
+/* What the local enumerator found out about one directory entry. It
+ * covers the parts of NAUTILUS_FILE_DEFAULT_ATTRIBUTES that can be
+ * answered from the file system directly, without a GFileInfo.
+ *
+ * Metadata is stored by gvfs and can only be read through GIO, so it
+ * is read in a second pass once all entries are out. Entries of that
+ * pass have metadata_only set and carry nothing but the name and a
+ * GFileInfo with the metadata::* attributes.
+ */
+typedef struct
+{
+	char *name;
+	char *display_name;   /* NULL if the same as name */
+	char *edit_name;      /* NULL if the same as name */
+
+	GFileType type;
+	gboolean is_symlink;
+	gboolean is_hidden;
+	gboolean is_backup;
+	gboolean is_mountpoint;
+	char *symlink_target;
+
+	guint32 mode;
+	guint32 uid;
+	guint32 gid;
+	const char *owner;       /* interned */
+	const char *owner_real;  /* interned */
+	const char *group;       /* interned */
+
+	goffset size;
+	time_t atime;
+	time_t mtime;
+	time_t ctime;
+	guint32 mtime_nsec; /* 0 if the platform doesn't tell */
+	guint32 ctime_nsec;
+	guint64 device;
+	guint64 inode;
+
+	const char *content_type;  /* interned */
+	GIcon *icon;
+	const char *filesystem_id; /* interned */
+
+	gboolean can_read;
+	gboolean can_write;
+	gboolean can_execute;
+	gboolean can_delete;
+	gboolean can_rename;
+	gboolean can_trash;
+
+	char *thumbnail_path;
+	gboolean thumbnailing_failed;
+	char *selinux_context;
+
+	gboolean metadata_only;
+	GFileInfo *metadata_info;
+} NautilusLocalEntry;
+
+typedef struct NautilusLocalEnumerator NautilusLocalEnumerator;
+
+/* Whether the location can be read with a local enumerator. */
+gboolean                 nautilus_local_enumerator_is_supported        (GFile                    *location);
+
+NautilusLocalEnumerator *nautilus_local_enumerator_new                 (GFile                    *location);
+void                     nautilus_local_enumerator_free                (NautilusLocalEnumerator  *enumerator);
+
+/* Read up to num_entries entries on a worker thread. Like
+ * g_file_enumerator_next_files_async(), only one request may be
+ * pending at a time, and an empty list means the end was reached.
+ */
+void                     nautilus_local_enumerator_next_entries_async  (NautilusLocalEnumerator  *enumerator,
+									int                       num_entries,
+									GCancellable             *cancellable,
+									GAsyncReadyCallback       callback,
+									gpointer                  user_data);
+GList *                  nautilus_local_enumerator_next_entries_finish (NautilusLocalEnumerator  *enumerator,
+									GAsyncResult             *result,
+									GError                  **error);
+
+void                     nautilus_local_entry_free                     (NautilusLocalEntry       *entry);
+
+#endif /* NAUTILUS_LOCAL_ENUMERATOR_H */
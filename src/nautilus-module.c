@@ -55,6 +55,10 @@ struct _NautilusModuleClass
     GTypeModuleClass parent;
 };
 
+/* Files built on worker threads while a folder loads look up their
+ * info providers, so the list is only used under the lock.
+ */
+static GMutex module_objects_mutex;
 static GList *module_objects = NULL;
 
 static GType nautilus_module_get_type (void);
@@ -164,7 +168,9 @@ static void
 module_object_weak_notify (gpointer  user_data,
                            GObject  *object)
 {
+    g_mutex_lock (&module_objects_mutex);
     module_objects = g_list_remove (module_objects, object);
+    g_mutex_unlock (&module_objects_mutex);
 }
 
 static void
@@ -239,15 +245,21 @@ load_module_dir (const char *dirname)
 static void
 free_module_objects (void)
 {
-    GList *l, *next;
+    GList *objects, *l, *next;
+
+    /* Unreffing runs the weak notify, which takes the lock again. */
+    g_mutex_lock (&module_objects_mutex);
+    objects = module_objects;
+    module_objects = NULL;
+    g_mutex_unlock (&module_objects_mutex);
 
-    for (l = module_objects; l != NULL; l = next)
+    for (l = objects; l != NULL; l = next)
     {
         next = l->next;
         g_object_unref (l->data);
     }
 
-    g_list_free (module_objects);
+    g_list_free (objects);
 }
 
 void
@@ -271,6 +283,7 @@ nautilus_module_get_extensions_for_type (GType type)
     GList *l;
     GList *ret = NULL;
 
+    g_mutex_lock (&module_objects_mutex);
     for (l = module_objects; l != NULL; l = l->next)
     {
         if (G_TYPE_CHECK_INSTANCE_TYPE (G_OBJECT (l->data),
@@ -280,6 +293,7 @@ nautilus_module_get_extensions_for_type (GType type)
             ret = g_list_prepend (ret, l->data);
         }
     }
+    g_mutex_unlock (&module_objects_mutex);
 
     return ret;
 }
@@ -307,5 +321,7 @@ nautilus_module_add_type (GType type)
                        (GWeakNotify) module_object_weak_notify,
                        NULL);
 
+    g_mutex_lock (&module_objects_mutex);
     module_objects = g_list_prepend (module_objects, object);
+    g_mutex_unlock (&module_objects_mutex);
 }
@@ -123,7 +123,9 @@ vfs_are_all_files_seen (NautilusDirectory *directory)
 {
     g_assert (NAUTILUS_IS_VFS_DIRECTORY (directory));
 
-    return directory->details->directory_loaded;
+    /* Files can still be waiting to be added after the load is done. */
+    return directory->details->directory_loaded &&
+           directory->details->directory_loaded_sent_notification;
 }
 
 static gboolean
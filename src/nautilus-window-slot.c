@@ -36,6 +36,7 @@
 #include <glib/gi18n.h>
 #include <eel/eel-stock-dialogs.h>
 
+#include "nautilus-directory.h"
 #include "nautilus-file.h"
 #include "nautilus-file-utilities.h"
 #include "nautilus-global-preferences.h"
@@ -1044,6 +1045,25 @@ save_scroll_position_for_history (NautilusWindowSlot *self)
     }
 }
 
+/* Let the directory this slot is loading or showing jump ahead of
+ * background directories for async. I/O while the slot is active.
+ */
+static void
+nautilus_window_slot_update_foreground_location (NautilusWindowSlot *self)
+{
+    NautilusWindowSlotPrivate *priv;
+
+    priv = nautilus_window_slot_get_instance_private (self);
+    if (!priv->active)
+    {
+        return;
+    }
+
+    nautilus_directory_set_foreground_location (priv->pending_location != NULL ?
+                                                priv->pending_location :
+                                                priv->location);
+}
+
 /*
  * begin_location_change
  *
@@ -1100,6 +1120,8 @@ begin_location_change (NautilusWindowSlot         *self,
 
     priv->pending_scroll_to = g_strdup (scroll_pos);
 
+    nautilus_window_slot_update_foreground_location (self);
+
     check_force_reload (location, type);
 
     save_scroll_position_for_history (self);
@@ -1138,6 +1160,8 @@ nautilus_window_slot_set_location (NautilusWindowSlot *self,
     old_location = priv->location;
     priv->location = g_object_ref (location);
 
+    nautilus_window_slot_update_foreground_location (self);
+
     if (nautilus_window_slot_get_active (self))
     {
         nautilus_window_sync_location_widgets (priv->window);
@@ -2391,6 +2415,47 @@ nautilus_window_slot_update_for_new_location (NautilusWindowSlot *self)
     nautilus_window_slot_sync_actions (self);
 }
 
+/* How many of the parents in the path bar get loaded ahead of time,
+ * going up being a likely next step once a folder is shown.
+ */
+#define PREFETCH_PARENT_LEVELS 2
+
+static void
+prefetch_parent_directories (NautilusWindowSlot *self)
+{
+    NautilusWindowSlotPrivate *priv;
+    NautilusDirectory *directory;
+    GFile *parents[PREFETCH_PARENT_LEVELS];
+    int i, n_parents;
+
+    priv = nautilus_window_slot_get_instance_private (self);
+    if (priv->location == NULL)
+    {
+        return;
+    }
+
+    n_parents = 0;
+    parents[0] = g_file_get_parent (priv->location);
+    while (parents[n_parents] != NULL)
+    {
+        n_parents++;
+        if (n_parents == PREFETCH_PARENT_LEVELS)
+        {
+            break;
+        }
+        parents[n_parents] = g_file_get_parent (parents[n_parents - 1]);
+    }
+
+    /* The nearest parent goes last so it counts as most recent. */
+    for (i = n_parents - 1; i >= 0; i--)
+    {
+        directory = nautilus_directory_get (parents[i]);
+        nautilus_directory_prefetch (directory);
+        nautilus_directory_unref (directory);
+        g_object_unref (parents[i]);
+    }
+}
+
 static void
 view_started_loading (NautilusWindowSlot *self,
                       NautilusView       *view)
@@ -2425,6 +2490,7 @@ view_ended_loading (NautilusWindowSlot *self,
         }
 
         end_location_change (self);
+        prefetch_parent_directories (self);
     }
 
     if (priv->needs_reload)
@@ -2667,6 +2733,11 @@ nautilus_window_slot_dispose (GObject *object)
 
     nautilus_window_slot_set_viewed_file (self, NULL);
 
+    if (priv->active)
+    {
+        nautilus_directory_set_foreground_location (NULL);
+    }
+
     g_clear_object (&priv->location);
 
     nautilus_file_list_free (priv->pending_selection);
@@ -3086,6 +3157,7 @@ nautilus_window_slot_set_active (NautilusWindowSlot *self,
 
         if (active)
         {
+            nautilus_window_slot_update_foreground_location (self);
             g_signal_emit (self, signals[ACTIVE], 0);
         }
         else
@@ -0,0 +1,116 @@
+#include <glib.h>
+#include <glib/gprintf.h>
+
+#include "eel/eel-string.h"
+
+/* Interns the same kind of strings file loading does, from more and
+ * more threads at once, and prints how many strings per second get
+ * interned. With interning that scales, the rate grows with the
+ * number of threads.
+ */
+
+#define N_STRINGS 256
+#define ITERATIONS_PER_THREAD 2000000
+
+static char *strings[N_STRINGS];
+
+static gpointer
+intern_thread (gpointer data)
+{
+    guint i, seed;
+    eel_ref_str str;
+
+    seed = GPOINTER_TO_UINT (data);
+    for (i = 0; i < ITERATIONS_PER_THREAD; i++)
+    {
+        /* Runs of the same string, like the files of one directory. */
+        str = eel_ref_str_get_unique (strings[((i / 16) * 7 + seed) % N_STRINGS]);
+        eel_ref_str_unref (str);
+    }
+
+    return NULL;
+}
+
+static double
+run (guint n_threads)
+{
+    GThread **threads;
+    gint64 start, end;
+    guint i;
+
+    threads = g_new (GThread *, n_threads);
+
+    start = g_get_monotonic_time ();
+    for (i = 0; i < n_threads; i++)
+    {
+        threads[i] = g_thread_new ("intern", intern_thread, GUINT_TO_POINTER (i * 31));
+    }
+    for (i = 0; i < n_threads; i++)
+    {
+        g_thread_join (threads[i]);
+    }
+    end = g_get_monotonic_time ();
+
+    g_free (threads);
+
+    return (double) n_threads * ITERATIONS_PER_THREAD / ((end - start) / (double) G_USEC_PER_SEC);
+}
+
+int
+main (int   argc,
+      char *argv[])
+{
+    guint i, n_threads, max_threads;
+    double rate, single_rate;
+
+    for (i = 0; i < N_STRINGS; i++)
+    {
+        switch (i % 4)
+        {
+            case 0:
+            {
+                strings[i] = g_strdup_printf ("application/x-type-%u", i);
+            }
+            break;
+
+            case 1:
+            {
+                strings[i] = g_strdup_printf ("user%u", i);
+            }
+            break;
+
+            case 2:
+            {
+                strings[i] = g_strdup_printf ("group%u", i);
+            }
+            break;
+
+            default:
+            {
+                strings[i] = g_strdup_printf ("fs-%08x", i * 2654435761u);
+            }
+            break;
+        }
+    }
+
+    max_threads = MAX (g_get_num_processors (), 1);
+    single_rate = 0;
+
+    g_printf ("threads  strings/s      speedup\n");
+    for (n_threads = 1; n_threads <= max_threads; n_threads *= 2)
+    {
+        rate = run (n_threads);
+        if (n_threads == 1)
+        {
+            single_rate = rate;
+        }
+        g_printf ("%7u  %12.0f  %7.2fx\n", n_threads, rate, rate / single_rate);
+    }
+
+    for (i = 0; i < N_STRINGS; i++)
+    {
+        g_free (strings[i]);
+    }
+
+    return 0;
+}
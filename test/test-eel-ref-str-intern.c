@@ -0,0 +1,149 @@
+#include <glib.h>
+
+#include "eel/eel-string.h"
+
+#define N_STRINGS 256
+#define N_THREADS 8
+#define ITERATIONS_PER_THREAD 20000
+
+static eel_ref_str held[N_STRINGS];
+static char *strings[N_STRINGS];
+
+static void
+test_equal_strings_are_shared (void)
+{
+    eel_ref_str a, b;
+    char *copy;
+
+    copy = g_strdup ("application/x-test");
+
+    a = eel_ref_str_get_unique ("application/x-test");
+    b = eel_ref_str_get_unique (copy);
+    g_assert_true (a == b);
+    g_assert_cmpstr (eel_ref_str_peek (a), ==, "application/x-test");
+
+    eel_ref_str_unref (a);
+    eel_ref_str_unref (b);
+    g_free (copy);
+}
+
+static void
+test_different_strings_are_not_shared (void)
+{
+    eel_ref_str a, b;
+
+    a = eel_ref_str_get_unique ("user1");
+    b = eel_ref_str_get_unique ("user2");
+    g_assert_true (a != b);
+    g_assert_cmpstr (eel_ref_str_peek (a), ==, "user1");
+    g_assert_cmpstr (eel_ref_str_peek (b), ==, "user2");
+
+    eel_ref_str_unref (a);
+    eel_ref_str_unref (b);
+}
+
+static void
+test_new_is_not_interned (void)
+{
+    eel_ref_str unique, str;
+
+    unique = eel_ref_str_get_unique ("group1");
+    str = eel_ref_str_new ("group1");
+    g_assert_true (unique != str);
+    g_assert_cmpstr (eel_ref_str_peek (str), ==, "group1");
+
+    eel_ref_str_unref (str);
+    eel_ref_str_unref (unique);
+}
+
+static void
+test_unique_outlives_other_references (void)
+{
+    eel_ref_str a, b;
+
+    a = eel_ref_str_get_unique ("fs-0000beef");
+    b = eel_ref_str_ref (a);
+    eel_ref_str_unref (a);
+    g_assert_cmpstr (eel_ref_str_peek (b), ==, "fs-0000beef");
+
+    a = eel_ref_str_get_unique ("fs-0000beef");
+    g_assert_true (a == b);
+
+    eel_ref_str_unref (a);
+    eel_ref_str_unref (b);
+}
+
+static gpointer
+intern_thread (gpointer data)
+{
+    guint i, seed, n;
+    eel_ref_str str;
+
+    seed = GPOINTER_TO_UINT (data);
+    for (i = 0; i < ITERATIONS_PER_THREAD; i++)
+    {
+        /* Runs of the same string, like the files of one directory. */
+        n = ((i / 16) * 7 + seed) % N_STRINGS;
+        str = eel_ref_str_get_unique (strings[n]);
+        g_assert_true (str == held[n]);
+        eel_ref_str_unref (str);
+    }
+
+    return NULL;
+}
+
+static void
+test_threads_share_strings (void)
+{
+    GThread *threads[N_THREADS];
+    guint i;
+
+    for (i = 0; i < N_STRINGS; i++)
+    {
+        strings[i] = g_strdup_printf ("application/x-type-%u", i);
+        held[i] = eel_ref_str_get_unique (strings[i]);
+    }
+
+    for (i = 0; i < N_THREADS; i++)
+    {
+        threads[i] = g_thread_new ("intern", intern_thread, GUINT_TO_POINTER (i * 31));
+    }
+    for (i = 0; i < N_THREADS; i++)
+    {
+        g_thread_join (threads[i]);
+    }
+
+    for (i = 0; i < N_STRINGS; i++)
+    {
+        g_assert_cmpstr (eel_ref_str_peek (held[i]), ==, strings[i]);
+        eel_ref_str_unref (held[i]);
+        g_free (strings[i]);
+    }
+}
+
+static void
+setup_test_suite (void)
+{
+    g_test_add_func ("/ref-str-intern/1.0",
+                     test_equal_strings_are_shared);
+    g_test_add_func ("/ref-str-intern/1.1",
+                     test_different_strings_are_not_shared);
+    g_test_add_func ("/ref-str-intern/1.2",
+                     test_new_is_not_interned);
+    g_test_add_func ("/ref-str-intern/1.3",
+                     test_unique_outlives_other_references);
+
+    g_test_add_func ("/ref-str-intern/2.0",
+                     test_threads_share_strings);
+}
+
+int
+main (int   argc,
+      char *argv[])
+{
+    g_test_init (&argc, &argv, NULL);
+
+    setup_test_suite ();
+
+    return g_test_run ();
+}
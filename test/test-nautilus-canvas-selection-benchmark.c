@@ -0,0 +1,97 @@
+#include <gtk/gtk.h>
+#include <glib/gprintf.h>
+
+#include "src/nautilus-canvas-container.h"
+#include "src/nautilus-canvas-private.h"
+#include "src/nautilus-global-preferences.h"
+
+/* Fills a canvas container with more and more icons, then restores a
+ * selection the way "select pasted files" does: first by looking each
+ * pasted file up by URI, then by setting the selection to the files.
+ * Prints how long each step takes; with indexed lookups the time per
+ * selected file stays flat as the folder grows.
+ */
+
+#define SELECTED_FRACTION 5
+
+static char *
+get_icon_uri (NautilusCanvasContainer *container,
+              NautilusCanvasIconData  *data,
+              gpointer                 user_data)
+{
+    /* The icon data are the URIs themselves. */
+    return g_strdup ((const char *) data);
+}
+
+static void
+run (guint n_icons)
+{
+    GtkWidget *container;
+    GPtrArray *uris;
+    GList *selection;
+    gint64 start, lookup_time, restore_time;
+    guint i, n_selected, found;
+
+    container = nautilus_canvas_container_new ();
+    g_object_ref_sink (container);
+    g_signal_connect (container, "get-icon-uri",
+                      G_CALLBACK (get_icon_uri), NULL);
+
+    uris = g_ptr_array_new_with_free_func (g_free);
+    for (i = 0; i < n_icons; i++)
+    {
+        g_ptr_array_add (uris, g_strdup_printf ("file:///tmp/large-folder/file-%08u.txt", i));
+        nautilus_canvas_container_add (NAUTILUS_CANVAS_CONTAINER (container),
+                                       g_ptr_array_index (uris, i));
+    }
+
+    /* Spread the selection over the whole folder. */
+    n_selected = n_icons / SELECTED_FRACTION;
+    selection = NULL;
+    found = 0;
+
+    start = g_get_monotonic_time ();
+    for (i = 0; i < n_selected; i++)
+    {
+        if (nautilus_canvas_container_get_icon_by_uri (NAUTILUS_CANVAS_CONTAINER (container),
+                                                       g_ptr_array_index (uris, i * SELECTED_FRACTION)) != NULL)
+        {
+            found++;
+        }
+        selection = g_list_prepend (selection, g_ptr_array_index (uris, i * SELECTED_FRACTION));
+    }
+    lookup_time = g_get_monotonic_time () - start;
+
+    start = g_get_monotonic_time ();
+    nautilus_canvas_container_set_selection (NAUTILUS_CANVAS_CONTAINER (container), selection);
+    restore_time = g_get_monotonic_time () - start;
+
+    g_assert_cmpuint (found, ==, n_selected);
+
+    g_printf ("%8u  %8u  %12.3f  %12.3f\n",
+              n_icons, n_selected,
+              lookup_time / 1000.0, restore_time / 1000.0);
+
+    g_list_free (selection);
+    gtk_widget_destroy (container);
+    g_object_unref (container);
+    g_ptr_array_unref (uris);
+}
+
+int
+main (int   argc,
+      char *argv[])
+{
+    guint n_icons;
+
+    gtk_init (&argc, &argv);
+    nautilus_global_preferences_init ();
+
+    g_printf ("   icons  selected  lookup (ms)  restore (ms)\n");
+    for (n_icons = 1000; n_icons <= 64000; n_icons *= 2)
+    {
+        run (n_icons);
+    }
+
+    return 0;
+}
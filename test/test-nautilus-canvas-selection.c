@@ -0,0 +1,211 @@
+#include <gtk/gtk.h>
+
+#include "src/nautilus-canvas-container.h"
+#include "src/nautilus-canvas-private.h"
+#include "src/nautilus-global-preferences.h"
+
+#define N_ICONS 200
+
+typedef struct
+{
+    GtkWidget *container;
+    char *uris[N_ICONS];
+} Fixture;
+
+static char *
+get_icon_uri (NautilusCanvasContainer *container,
+              NautilusCanvasIconData  *data,
+              gpointer                 user_data)
+{
+    /* The icon data are the URIs themselves. */
+    return g_strdup ((const char *) data);
+}
+
+static void
+fixture_set_up (Fixture       *fixture,
+                gconstpointer  user_data)
+{
+    guint i;
+
+    fixture->container = nautilus_canvas_container_new ();
+    g_object_ref_sink (fixture->container);
+    g_signal_connect (fixture->container, "get-icon-uri",
+                      G_CALLBACK (get_icon_uri), NULL);
+
+    for (i = 0; i < N_ICONS; i++)
+    {
+        fixture->uris[i] = g_strdup_printf ("file:///tmp/folder/file-%03u.txt", i);
+        g_assert_true (nautilus_canvas_container_add (NAUTILUS_CANVAS_CONTAINER (fixture->container),
+                                                      fixture->uris[i]));
+    }
+}
+
+static void
+fixture_tear_down (Fixture       *fixture,
+                   gconstpointer  user_data)
+{
+    guint i;
+
+    gtk_widget_destroy (fixture->container);
+    g_object_unref (fixture->container);
+    for (i = 0; i < N_ICONS; i++)
+    {
+        g_free (fixture->uris[i]);
+    }
+}
+
+/* Checks that exactly the icons whose index is a multiple of
+ * @step, starting at @first, are selected.
+ */
+static void
+assert_selection (Fixture *fixture,
+                  guint    first,
+                  guint    step)
+{
+    NautilusCanvasContainer *container;
+    NautilusCanvasIcon *icon;
+    GList *selection;
+    guint i, n_selected;
+
+    container = NAUTILUS_CANVAS_CONTAINER (fixture->container);
+
+    n_selected = 0;
+    for (i = 0; i < N_ICONS; i++)
+    {
+        icon = nautilus_canvas_container_get_icon_by_uri (container, fixture->uris[i]);
+        g_assert_nonnull (icon);
+        if (step != 0 && i >= first && (i - first) % step == 0)
+        {
+            g_assert_true (icon->is_selected);
+            n_selected++;
+        }
+        else
+        {
+            g_assert_false (icon->is_selected);
+        }
+    }
+
+    selection = nautilus_canvas_container_get_selection (container);
+    g_assert_cmpuint (g_list_length (selection), ==, n_selected);
+    g_list_free (selection);
+}
+
+static GList *
+make_selection (Fixture *fixture,
+                guint    first,
+                guint    step)
+{
+    GList *selection;
+    guint i;
+
+    selection = NULL;
+    for (i = first; i < N_ICONS; i += step)
+    {
+        selection = g_list_prepend (selection, fixture->uris[i]);
+    }
+
+    return selection;
+}
+
+static void
+test_lookup_by_uri (Fixture       *fixture,
+                    gconstpointer  user_data)
+{
+    NautilusCanvasContainer *container;
+    NautilusCanvasIcon *icon;
+    char *uri;
+    guint i;
+
+    container = NAUTILUS_CANVAS_CONTAINER (fixture->container);
+
+    for (i = 0; i < N_ICONS; i++)
+    {
+        /* Look up with a copy, as pasted files have their own URIs. */
+        uri = g_strdup (fixture->uris[i]);
+        icon = nautilus_canvas_container_get_icon_by_uri (container, uri);
+        g_assert_nonnull (icon);
+        g_assert_true (icon->data == (NautilusCanvasIconData *) fixture->uris[i]);
+        g_free (uri);
+    }
+
+    g_assert_null (nautilus_canvas_container_get_icon_by_uri (container,
+                                                              "file:///tmp/folder/missing.txt"));
+}
+
+static void
+test_lookup_after_remove (Fixture       *fixture,
+                          gconstpointer  user_data)
+{
+    NautilusCanvasContainer *container;
+
+    container = NAUTILUS_CANVAS_CONTAINER (fixture->container);
+
+    g_assert_true (nautilus_canvas_container_remove (container, fixture->uris[7]));
+    g_assert_null (nautilus_canvas_container_get_icon_by_uri (container, fixture->uris[7]));
+    g_assert_nonnull (nautilus_canvas_container_get_icon_by_uri (container, fixture->uris[8]));
+}
+
+static void
+test_set_selection (Fixture       *fixture,
+                    gconstpointer  user_data)
+{
+    NautilusCanvasContainer *container;
+    GList *selection;
+
+    container = NAUTILUS_CANVAS_CONTAINER (fixture->container);
+
+    assert_selection (fixture, 0, 0);
+
+    selection = make_selection (fixture, 0, 5);
+    nautilus_canvas_container_set_selection (container, selection);
+    g_list_free (selection);
+    assert_selection (fixture, 0, 5);
+
+    /* Overlaps the previous selection, so some icons stay selected,
+     * some get unselected and some newly selected.
+     */
+    selection = make_selection (fixture, 0, 3);
+    nautilus_canvas_container_set_selection (container, selection);
+    g_list_free (selection);
+    assert_selection (fixture, 0, 3);
+
+    selection = make_selection (fixture, 1, 3);
+    nautilus_canvas_container_set_selection (container, selection);
+    g_list_free (selection);
+    assert_selection (fixture, 1, 3);
+
+    nautilus_canvas_container_set_selection (container, NULL);
+    assert_selection (fixture, 0, 0);
+}
+
+static void
+setup_test_suite (void)
+{
+    g_test_add ("/canvas-selection/1.0", Fixture, NULL,
+                fixture_set_up, test_lookup_by_uri, fixture_tear_down);
+    g_test_add ("/canvas-selection/1.1", Fixture, NULL,
+                fixture_set_up, test_lookup_after_remove, fixture_tear_down);
+
+    g_test_add ("/canvas-selection/2.0", Fixture, NULL,
+                fixture_set_up, test_set_selection, fixture_tear_down);
+}
+
+int
+main (int   argc,
+      char *argv[])
+{
+    g_test_init (&argc, &argv, NULL);
+
+    /* The container is a widget, so this needs a display; tell
+     * "make check" to skip the test when there is none.
+     */
+    if (!gtk_init_check (&argc, &argv))
+    {
+        return 77;
+    }
+    nautilus_global_preferences_init ();
+
+    setup_test_suite ();
+
+    return g_test_run ();
+}
@@ -1,5 +1,6 @@
 #include <gtk/gtk.h>
 #include <src/nautilus-directory.h>
+#include <src/nautilus-directory-private.h>
 #include <src/nautilus-search-directory.h>
 #include <src/nautilus-file.h>
 #include <unistd.h>
@@ -43,10 +44,29 @@ files_changed (NautilusDirectory *directory,
              g_list_length (changed_files));
 }
 
+static void
+print_async_job_stats (void)
+{
+    NautilusAsyncJobStats stats;
+
+    nautilus_directory_get_async_job_stats (&stats);
+
+    g_print ("async jobs: %d local, %d remote running\n",
+             stats.running_jobs[NAUTILUS_ASYNC_JOB_POOL_LOCAL],
+             stats.running_jobs[NAUTILUS_ASYNC_JOB_POOL_REMOTE]);
+    g_print ("waiting directories: %u now, %u at most\n",
+             stats.queue_depth, stats.max_queue_depth);
+    g_print ("blocked job starts: %" G_GUINT64_FORMAT ", wake ups: %" G_GUINT64_FORMAT "\n",
+             stats.blocked_jobs, stats.wake_ups);
+    g_print ("wait time: %" G_GINT64_FORMAT " us total, %" G_GINT64_FORMAT " us at most\n",
+             stats.total_wait_time, stats.max_wait_time);
+}
+
 static void
 done_loading (NautilusDirectory *directory)
 {
     g_print ("done loading\n");
+    print_async_job_stats ();
     gtk_main_quit ();
 }
 